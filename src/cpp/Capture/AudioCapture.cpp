@@ -0,0 +1,276 @@
+//------------------------------------------------------------------------
+// This file contains the implementation of the audio capture (WAV/RF64
+// header and writer thread)
+//------------------------------------------------------------------------
+#include "AudioCapture.h"
+
+#include <pongasoft/logging/logging.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+namespace pongasoft::VST::JSGain::Capture {
+
+namespace {
+
+// how often the writer thread checks the ring (the RT never wakes it up: it would need a lock)
+constexpr auto kPollInterval = std::chrono::milliseconds{10};
+
+// offsets in the header (see makeWavHeader)
+constexpr size_t kFmtOffset = 48;
+constexpr size_t kPadOffset = 74;
+constexpr size_t kDataOffset = kHeaderSize - 8;
+
+// WAV files are little endian
+void writeU16(uint8_t *oBytes, uint16_t iValue)
+{
+  oBytes[0] = static_cast<uint8_t>(iValue);
+  oBytes[1] = static_cast<uint8_t>(iValue >> 8);
+}
+
+void writeU32(uint8_t *oBytes, uint32_t iValue)
+{
+  for(int i = 0; i < 4; i++)
+    oBytes[i] = static_cast<uint8_t>(iValue >> (8 * i));
+}
+
+void writeU64(uint8_t *oBytes, uint64_t iValue)
+{
+  for(int i = 0; i < 8; i++)
+    oBytes[i] = static_cast<uint8_t>(iValue >> (8 * i));
+}
+
+void writeTag(uint8_t *oBytes, char const *iTag)
+{
+  std::memcpy(oBytes, iTag, 4);
+}
+
+}
+
+//------------------------------------------------------------------------
+// makeWavHeader
+// 0    RIFF (or RF64) <size> WAVE
+// 12   JUNK (or ds64) 28 <riff size, data size, sample count, table size>
+// 48   fmt  18 <IEEE float, 2 channels, 32 bits>
+// 74   JUNK <size> (padding so that the data starts at kHeaderSize)
+// 4088 data <size>
+//------------------------------------------------------------------------
+void makeWavHeader(uint8_t *oHeader, double iSampleRate, uint64_t iNumFrames)
+{
+  std::fill(oHeader, oHeader + kHeaderSize, 0);
+
+  auto dataSize = iNumFrames * kFrameSize;
+  auto riffSize = kHeaderSize - 8 + dataSize;
+  bool rf64 = riffSize > 0xFFFFFFFFu;
+
+  writeTag(oHeader, rf64 ? "RF64" : "RIFF");
+  writeU32(oHeader + 4, rf64 ? 0xFFFFFFFFu : static_cast<uint32_t>(riffSize));
+  writeTag(oHeader + 8, "WAVE");
+
+  writeTag(oHeader + 12, rf64 ? "ds64" : "JUNK");
+  writeU32(oHeader + 16, 28);
+  if(rf64)
+  {
+    writeU64(oHeader + 20, riffSize);
+    writeU64(oHeader + 28, dataSize);
+    writeU64(oHeader + 36, iNumFrames);
+    writeU32(oHeader + 44, 0);
+  }
+
+  auto sampleRate = static_cast<uint32_t>(std::lround(iSampleRate));
+  auto fmt = oHeader + kFmtOffset;
+  writeTag(fmt, "fmt ");
+  writeU32(fmt + 4, 18);
+  writeU16(fmt + 8, 3); // WAVE_FORMAT_IEEE_FLOAT
+  writeU16(fmt + 10, kNumChannels);
+  writeU32(fmt + 12, sampleRate);
+  writeU32(fmt + 16, static_cast<uint32_t>(sampleRate * kFrameSize));
+  writeU16(fmt + 20, static_cast<uint16_t>(kFrameSize));
+  writeU16(fmt + 22, 32);
+  writeU16(fmt + 24, 0);
+
+  writeTag(oHeader + kPadOffset, "JUNK");
+  writeU32(oHeader + kPadOffset + 4, static_cast<uint32_t>(kDataOffset - kPadOffset - 8));
+
+  writeTag(oHeader + kDataOffset, "data");
+  writeU32(oHeader + kDataOffset + 4, rf64 ? 0xFFFFFFFFu : static_cast<uint32_t>(dataSize));
+}
+
+//------------------------------------------------------------------------
+// makeCapturePath
+//------------------------------------------------------------------------
+std::string makeCapturePath(std::string const &iName, char const *iExtension)
+{
+  char const *directory = std::getenv("JSGAIN_CAPTURE_DIR");
+  for(auto variable: {"TMPDIR", "TEMP", "TMP"})
+  {
+    if(directory)
+      break;
+    directory = std::getenv(variable);
+  }
+
+  using namespace std::chrono;
+  auto now = duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+  return std::string{directory ? directory : "."} + "/" + iName + "-" + std::to_string(now) + iExtension;
+}
+
+//------------------------------------------------------------------------
+// CaptureWriter::create
+//------------------------------------------------------------------------
+std::unique_ptr<CaptureWriter> CaptureWriter::create(std::string iPath, double iSampleRate)
+{
+  auto file = std::fopen(iPath.c_str(), "wb");
+  if(!file)
+  {
+    LOG_F(WARNING, "Capture - cannot create %s", iPath.c_str());
+    return nullptr;
+  }
+
+  // the writes are already done in big chunks: no need for another buffer
+  std::setvbuf(file, nullptr, _IONBF, 0);
+
+  return std::unique_ptr<CaptureWriter>(new CaptureWriter(file, std::move(iPath), iSampleRate));
+}
+
+//------------------------------------------------------------------------
+// CaptureWriter::CaptureWriter
+//------------------------------------------------------------------------
+CaptureWriter::CaptureWriter(std::FILE *iFile, std::string iPath, double iSampleRate) :
+  fRing{new float[kRingFrames * kNumChannels]},
+  fChunk{new Chunk},
+  fFile{iFile},
+  fPath{std::move(iPath)},
+  fSampleRate{iSampleRate}
+{
+  // touches the ring now so that the RT does not page it in
+  std::fill(fRing.get(), fRing.get() + kRingFrames * kNumChannels, 0.0f);
+
+  // the header (with no data) is the first chunk
+  makeWavHeader(fChunk->fBytes, fSampleRate, 0);
+  fChunkSize = kHeaderSize;
+  fChunkHeaderSize = kHeaderSize;
+
+  fThread = std::thread{[this] { run(); }};
+}
+
+//------------------------------------------------------------------------
+// CaptureWriter::~CaptureWriter
+//------------------------------------------------------------------------
+CaptureWriter::~CaptureWriter()
+{
+  {
+    std::lock_guard<std::mutex> lock{fMutex};
+    fStopRequested = true;
+  }
+  fCondition.notify_one();
+  fThread.join();
+}
+
+//------------------------------------------------------------------------
+// CaptureWriter::run
+//------------------------------------------------------------------------
+void CaptureWriter::run()
+{
+  std::unique_lock<std::mutex> lock{fMutex};
+  while(!fStopRequested)
+  {
+    // read before draining so that all the blocks written before the end are drained
+    bool endOfStream = fEndOfStream.load(std::memory_order_acquire);
+
+    drainRing();
+
+    if(endOfStream)
+      break;
+
+    fCondition.wait_for(lock, kPollInterval, [this] { return fStopRequested; });
+  }
+
+  // stop requested (the RT is not processing anymore): what is in the ring is all there is
+  drainRing();
+  close();
+}
+
+//------------------------------------------------------------------------
+// CaptureWriter::drainRing
+//------------------------------------------------------------------------
+uint64_t CaptureWriter::drainRing()
+{
+  auto readFrame = fReadFrame.load(std::memory_order_relaxed);
+  auto writeFrame = fWriteFrame.load(std::memory_order_acquire);
+  auto start = readFrame;
+
+  while(readFrame < writeFrame)
+  {
+    // contiguous in the ring and fits in the chunk
+    auto ringIndex = readFrame & kRingMask;
+    auto numFrames = std::min({writeFrame - readFrame,
+                               kRingFrames - ringIndex,
+                               static_cast<uint64_t>((kWriteSize - fChunkSize) / kFrameSize)});
+
+    std::memcpy(fChunk->fBytes + fChunkSize, fRing.get() + ringIndex * kNumChannels, numFrames * kFrameSize);
+    fChunkSize += numFrames * kFrameSize;
+    readFrame += numFrames;
+
+    // frees the room in the ring as soon as possible
+    fReadFrame.store(readFrame, std::memory_order_release);
+
+    if(fChunkSize == kWriteSize)
+      writeChunk();
+  }
+
+  return readFrame - start;
+}
+
+//------------------------------------------------------------------------
+// CaptureWriter::writeChunk
+//------------------------------------------------------------------------
+void CaptureWriter::writeChunk()
+{
+  if(fChunkSize == 0)
+    return;
+
+  // on error (ex: disk full) the ring is still drained (the RT does not drop blocks) but nothing is written
+  if(!fWriteError)
+  {
+    if(std::fwrite(fChunk->fBytes, 1, fChunkSize, fFile) == fChunkSize)
+      fNumFramesWritten.fetch_add((fChunkSize - fChunkHeaderSize) / kFrameSize, std::memory_order_relaxed);
+    else
+    {
+      LOG_F(WARNING, "Capture - error while writing %s", fPath.c_str());
+      fWriteError = true;
+    }
+  }
+
+  fChunkSize = 0;
+  fChunkHeaderSize = 0;
+}
+
+//------------------------------------------------------------------------
+// CaptureWriter::close
+//------------------------------------------------------------------------
+void CaptureWriter::close()
+{
+  writeChunk();
+
+  auto numFrames = getNumFramesWritten();
+
+  uint8_t header[kHeaderSize];
+  makeWavHeader(header, fSampleRate, numFrames);
+  if(fWriteError || std::fseek(fFile, 0, SEEK_SET) != 0 || std::fwrite(header, 1, kHeaderSize, fFile) != kHeaderSize)
+    LOG_F(WARNING, "Capture - cannot write the header of %s", fPath.c_str());
+
+  std::fclose(fFile);
+  fFile = nullptr;
+
+  LOG_F(INFO, "Capture - %s closed (%llu frames, %llu blocks dropped)",
+        fPath.c_str(),
+        static_cast<unsigned long long>(numFrames),
+        static_cast<unsigned long long>(getDroppedBlocksCount()));
+
+  fFinished.store(true, std::memory_order_release);
+}
+
+}
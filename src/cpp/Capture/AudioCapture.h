@@ -0,0 +1,169 @@
+//------------------------------------------------------------------------------------------------------------
+// This file defines the capture of the audio processed by the plugin (pre or post gain) into a file, to debug
+// a session without having to set up a second recorder ("$capture" command, see parseUICommands).
+//
+// - CaptureWriter::create (NOT RT) preallocates the ring, opens the file and starts the writer thread
+// - the RT copies every block in the ring (interleaved 32 bits float, always stereo): no allocation, no lock,
+//   no syscall. When the ring does not have enough room (the writer fell behind), the whole block is dropped
+//   and counted: the RT never waits
+// - the writer thread copies the ring in a 4K aligned buffer which is written kWriteSize bytes at a time
+//   (unbuffered). The header is kHeaderSize bytes long so that these writes are also aligned in the file
+// - the file is a WAV (IEEE float) file which is turned into an RF64 file (EBU Tech 3306) when it is closed
+//   if it is bigger than 4GB (the first chunk reserves the room for the ds64 chunk)
+//------------------------------------------------------------------------------------------------------------
+#pragma once
+
+#include <pluginterfaces/base/ftypes.h>
+#include "../Concurrent/CacheLine.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace pongasoft::VST::JSGain::Capture {
+
+using namespace Steinberg;
+
+constexpr int32 kNumChannels = 2;
+constexpr size_t kFrameSize = kNumChannels * sizeof(float);
+constexpr size_t kHeaderSize = 4096;
+
+//------------------------------------------------------------------------
+// makeWavHeader - fills oHeader (kHeaderSize bytes) with the header of a
+// file containing iNumFrames frames (RF64 when it does not fit in a WAV)
+//------------------------------------------------------------------------
+void makeWavHeader(uint8_t *oHeader, double iSampleRate, uint64_t iNumFrames);
+
+//------------------------------------------------------------------------
+// makeCapturePath - a new file (iName-<time><iExtension>) in the directory
+// given by the JSGAIN_CAPTURE_DIR environment variable, or the temporary
+// directory
+//------------------------------------------------------------------------
+std::string makeCapturePath(std::string const &iName, char const *iExtension = ".wav");
+
+//------------------------------------------------------------------------
+// CaptureWriter - one per capture (the thread stops when the capture ends)
+//------------------------------------------------------------------------
+class CaptureWriter
+{
+public:
+  static constexpr size_t kRingFrames = 1 << 19; // 4MB, ~10s at 48kHz (power of 2)
+  static constexpr size_t kWriteSize = 1 << 16; // bytes written at once (multiple of kFrameSize)
+
+  //------------------------------------------------------------------------
+  // create - opens iPath and starts the writer thread. Returns nullptr
+  // when the file cannot be created. NOT RT safe.
+  //------------------------------------------------------------------------
+  static std::unique_ptr<CaptureWriter> create(std::string iPath, double iSampleRate);
+
+  // the writer thread writes what is left in the ring before closing the file
+  ~CaptureWriter();
+
+  CaptureWriter(CaptureWriter const &) = delete;
+  CaptureWriter &operator=(CaptureWriter const &) = delete;
+
+  //------------------------------------------------------------------------
+  // write - RT: copies one block (iRight can be nullptr for mono, in which
+  // case the left channel is duplicated). Returns false when the block is
+  // dropped (not enough room in the ring).
+  //------------------------------------------------------------------------
+  template<typename SampleType>
+  inline bool write(SampleType const *iLeft, SampleType const *iRight, int32 iNumSamples)
+  {
+    auto writeFrame = fWriteFrame.load(std::memory_order_relaxed);
+    auto numFrames = static_cast<uint64_t>(iNumSamples);
+    if(kRingFrames - (writeFrame - fCachedReadFrame) < numFrames)
+    {
+      // only read the (shared) read position when the cached value says there is not enough room
+      fCachedReadFrame = fReadFrame.load(std::memory_order_acquire);
+      if(kRingFrames - (writeFrame - fCachedReadFrame) < numFrames)
+      {
+        fDroppedBlocksCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+    }
+
+    auto ring = fRing.get();
+    if(!iRight)
+      iRight = iLeft;
+    for(int32 i = 0; i < iNumSamples; i++)
+    {
+      auto sample = ring + ((writeFrame + i) & kRingMask) * kNumChannels;
+      sample[0] = static_cast<float>(iLeft[i]);
+      sample[1] = static_cast<float>(iRight[i]);
+    }
+    fWriteFrame.store(writeFrame + numFrames, std::memory_order_release);
+    return true;
+  }
+
+  // endOfStream - RT: no more blocks will be written (the writer thread closes the file once the ring is empty)
+  inline void endOfStream() { fEndOfStream.store(true, std::memory_order_release); }
+
+  // isFinished - true when the file is closed (the RT is not using this writer anymore)
+  bool isFinished() const { return fFinished.load(std::memory_order_acquire); }
+
+  std::string const &getPath() const { return fPath; }
+  uint64_t getDroppedBlocksCount() const { return fDroppedBlocksCount.load(std::memory_order_relaxed); }
+
+  // number of frames written in the file (so far)
+  uint64_t getNumFramesWritten() const { return fNumFramesWritten.load(std::memory_order_relaxed); }
+
+private:
+  static constexpr uint64_t kRingMask = kRingFrames - 1;
+  static_assert((kRingFrames & kRingMask) == 0, "kRingFrames must be a power of 2");
+  static_assert(kWriteSize % kFrameSize == 0 && kWriteSize % kHeaderSize == 0, "Writes must be aligned");
+
+  // the buffer written to the file (aligned to the page size)
+  struct alignas(kHeaderSize) Chunk
+  {
+    uint8_t fBytes[kWriteSize];
+  };
+
+  CaptureWriter(std::FILE *iFile, std::string iPath, double iSampleRate);
+
+  // the loop of the writer thread
+  void run();
+
+  // copies what is in the ring in the chunk (written when full). Returns the number of frames copied.
+  uint64_t drainRing();
+
+  // writes the chunk (even if not full)
+  void writeChunk();
+
+  // writes the final header and closes the file
+  void close();
+
+private:
+  // RT side
+  alignas(Concurrent::kCacheLineSize) std::atomic<uint64_t> fWriteFrame{0};
+  uint64_t fCachedReadFrame{0};
+  std::atomic<uint64_t> fDroppedBlocksCount{0};
+  std::atomic<bool> fEndOfStream{false};
+
+  // writer thread side
+  alignas(Concurrent::kCacheLineSize) std::atomic<uint64_t> fReadFrame{0};
+  std::atomic<uint64_t> fNumFramesWritten{0};
+  std::atomic<bool> fFinished{false};
+
+  std::unique_ptr<float[]> fRing;
+  std::unique_ptr<Chunk> fChunk;
+  size_t fChunkSize{0};
+  size_t fChunkHeaderSize{0}; // the first chunk starts with the header
+
+  std::FILE *fFile;
+  std::string const fPath;
+  double const fSampleRate;
+  bool fWriteError{false};
+
+  std::mutex fMutex{};
+  std::condition_variable fCondition{};
+  bool fStopRequested{false};
+  std::thread fThread{};
+};
+
+}
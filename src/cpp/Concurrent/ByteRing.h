@@ -0,0 +1,99 @@
+//------------------------------------------------------------------------------------------------------------
+// This file defines a bounded, lock-free, single producer / single consumer ring of bytes for variable size
+// records. Like SPSCQueue, the producer never waits: a record which does not fit (the consumer is behind) is
+// rejected as a whole so the consumer never sees a partial record. The consumer reads the bytes in (at most
+// two) contiguous segments which lets it write them directly to a file without any extra copy.
+//------------------------------------------------------------------------------------------------------------
+#pragma once
+
+#include "CacheLine.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+namespace pongasoft::VST::JSGain::Concurrent {
+
+//------------------------------------------------------------------------
+// ByteRing
+// - Capacity (in bytes) must be a power of 2 (index wrapping is a mask)
+// - the storage is allocated (and zeroed) by the constructor
+// - write must always be called from the same (producer) thread and read
+//   from the same (consumer) thread
+//------------------------------------------------------------------------
+template<size_t Capacity>
+class ByteRing
+{
+  static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of 2");
+
+public:
+  ByteRing() : fBytes{new uint8_t[Capacity]()} {}
+
+  // capacity
+  static constexpr size_t capacity() { return Capacity; }
+
+  //------------------------------------------------------------------------
+  // write - called by the producer. Returns false when there is not
+  // enough room for iSize bytes (nothing is written)
+  //------------------------------------------------------------------------
+  bool write(void const *iBytes, size_t iSize)
+  {
+    auto head = fHead.load(std::memory_order_relaxed);
+    if(Capacity - (head - fCachedTail) < iSize)
+    {
+      // only read the (shared) tail when the cached value says there is not enough room
+      fCachedTail = fTail.load(std::memory_order_acquire);
+      if(Capacity - (head - fCachedTail) < iSize)
+        return false;
+    }
+
+    auto bytes = static_cast<uint8_t const *>(iBytes);
+    auto index = head & kMask;
+    auto first = std::min(iSize, Capacity - index);
+    std::memcpy(fBytes.get() + index, bytes, first);
+    std::memcpy(fBytes.get(), bytes + first, iSize - first);
+
+    fHead.store(head + iSize, std::memory_order_release);
+    return true;
+  }
+
+  //------------------------------------------------------------------------
+  // read - called by the consumer. Invokes iConsumer(uint8_t const *, size_t)
+  // with all the bytes available at the time of the call (1 or 2 contiguous
+  // segments, in order) then releases them. Returns the number of bytes.
+  //------------------------------------------------------------------------
+  template<typename Consumer>
+  size_t read(Consumer &&iConsumer)
+  {
+    auto tail = fTail.load(std::memory_order_relaxed);
+    auto head = fHead.load(std::memory_order_acquire);
+    auto size = static_cast<size_t>(head - tail);
+    if(size == 0)
+      return 0;
+
+    auto index = tail & kMask;
+    auto first = std::min(size, Capacity - index);
+    iConsumer(static_cast<uint8_t const *>(fBytes.get() + index), first);
+    if(first < size)
+      iConsumer(static_cast<uint8_t const *>(fBytes.get()), size - first);
+
+    fTail.store(head, std::memory_order_release);
+    return size;
+  }
+
+private:
+  static constexpr uint64_t kMask = Capacity - 1;
+
+  // producer side (written by producer, read by consumer)
+  alignas(kCacheLineSize) std::atomic<uint64_t> fHead{0};
+  uint64_t fCachedTail{0};
+
+  // consumer side (written by consumer, read by producer)
+  alignas(kCacheLineSize) std::atomic<uint64_t> fTail{0};
+
+  std::unique_ptr<uint8_t[]> fBytes;
+};
+
+}
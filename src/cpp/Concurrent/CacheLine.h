@@ -0,0 +1,19 @@
+//------------------------------------------------------------------------------------------------------------
+// This file contains the constants used to lay out data shared between threads. Data written by one thread
+// and read by another should live on its own cache line to avoid "false sharing" (2 threads bouncing the
+// same cache line back and forth while touching unrelated variables).
+//------------------------------------------------------------------------------------------------------------
+#pragma once
+
+#include <cstddef>
+
+namespace pongasoft::VST::JSGain::Concurrent {
+
+//------------------------------------------------------------------------
+// Not using std::hardware_destructive_interference_size because it is not
+// available with every compiler/standard library used to build the plugin.
+// 64 bytes is the size of a cache line on x86_64 and Apple Silicon (L1).
+//------------------------------------------------------------------------
+constexpr size_t kCacheLineSize = 64;
+
+}
@@ -0,0 +1,113 @@
+//------------------------------------------------------------------------------------------------------------
+// This file defines a bounded, lock-free, single producer / single consumer queue. Unlike the
+// SingleElementQueue used by Jamba for Jmb parameters (which only keeps the latest value), every element
+// pushed is kept until it is popped. Elements are copied in and out of a preallocated array so neither push
+// nor pop ever allocates memory or locks which makes it safe to use from the RT.
+//------------------------------------------------------------------------------------------------------------
+#pragma once
+
+#include "CacheLine.h"
+
+#include <array>
+#include <atomic>
+#include <type_traits>
+
+namespace pongasoft::VST::JSGain::Concurrent {
+
+//------------------------------------------------------------------------
+// SPSCQueue
+// - Capacity must be a power of 2 (index wrapping is a simple mask)
+// - T must be trivially copyable (ex: a struct with a static char array
+//   like UIMessage, NOT a std::string)
+// - push must always be called from the same (producer) thread and pop/
+//   drain from the same (consumer) thread
+//------------------------------------------------------------------------
+template<typename T, size_t Capacity>
+class SPSCQueue
+{
+  static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of 2");
+  static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable (no memory allocation allowed)");
+
+public:
+  // capacity
+  static constexpr size_t capacity() { return Capacity; }
+
+  //------------------------------------------------------------------------
+  // push - called by the producer. Returns false when the queue is full
+  // (the element is NOT added)
+  //------------------------------------------------------------------------
+  bool push(T const &iElement)
+  {
+    auto head = fHead.load(std::memory_order_relaxed);
+    if(head - fCachedTail == Capacity)
+    {
+      // only read the (shared) tail when the cached value says we are full
+      fCachedTail = fTail.load(std::memory_order_acquire);
+      if(head - fCachedTail == Capacity)
+        return false;
+    }
+    fElements[head & kMask] = iElement;
+    fHead.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  //------------------------------------------------------------------------
+  // pop - called by the consumer. Returns false when the queue is empty
+  // (oElement is left untouched)
+  //------------------------------------------------------------------------
+  bool pop(T &oElement)
+  {
+    auto tail = fTail.load(std::memory_order_relaxed);
+    if(tail == fCachedHead)
+    {
+      fCachedHead = fHead.load(std::memory_order_acquire);
+      if(tail == fCachedHead)
+        return false;
+    }
+    oElement = fElements[tail & kMask];
+    fTail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  //------------------------------------------------------------------------
+  // drain - called by the consumer. Invokes iCallback (with T const &) on
+  // every element present at the time of the call, in order, without
+  // copying them out of the queue. The slots are released all at once at
+  // the end (a single atomic store no matter how many elements). Returns
+  // the number of elements processed.
+  //------------------------------------------------------------------------
+  template<typename Callback>
+  size_t drain(Callback &&iCallback)
+  {
+    auto tail = fTail.load(std::memory_order_relaxed);
+    fCachedHead = fHead.load(std::memory_order_acquire);
+
+    if(tail == fCachedHead)
+      return 0;
+
+    auto count = fCachedHead - tail;
+    for(; tail != fCachedHead; ++tail)
+      iCallback(fElements[tail & kMask]);
+
+    fTail.store(tail, std::memory_order_release);
+    return count;
+  }
+
+  // empty - only a hint when called from a thread which is not the consumer
+  bool empty() const { return fHead.load(std::memory_order_acquire) == fTail.load(std::memory_order_acquire); }
+
+private:
+  static constexpr size_t kMask = Capacity - 1;
+
+  // producer side (written by producer, read by consumer)
+  alignas(kCacheLineSize) std::atomic<size_t> fHead{0};
+  size_t fCachedTail{0};
+
+  // consumer side (written by consumer, read by producer)
+  alignas(kCacheLineSize) std::atomic<size_t> fTail{0};
+  size_t fCachedHead{0};
+
+  alignas(kCacheLineSize) std::array<T, Capacity> fElements{};
+};
+
+}
@@ -0,0 +1,89 @@
+//------------------------------------------------------------------------------------------------------------
+// This file defines a lock-free ring of samples with a single writer (the RT) which never waits and a single
+// reader (a worker thread) which only ever wants the most recent samples. Unlike SPSCQueue, the writer
+// never checks whether the reader is keeping up: old samples are simply overwritten and the reader detects
+// (and discards) a copy which was overwritten while it was reading it (similar to SeqLock: the writer
+// announces how far it is about to write before storing the samples, and publishes them once stored).
+//------------------------------------------------------------------------------------------------------------
+#pragma once
+
+#include "CacheLine.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+
+namespace pongasoft::VST::JSGain::Concurrent {
+
+//------------------------------------------------------------------------
+// SampleRing
+// - Capacity must be a power of 2 (index wrapping is a simple mask)
+// - write must always be called from the same (writer) thread and
+//   readLatest from the same (reader) thread
+//------------------------------------------------------------------------
+template<typename T, size_t Capacity>
+class SampleRing
+{
+  static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of 2");
+  static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable");
+
+public:
+  // capacity
+  static constexpr size_t capacity() { return Capacity; }
+
+  //------------------------------------------------------------------------
+  // write - called by the writer. iSampleAt(i) is called for i in
+  // [0, iNumSamples) to generate the samples (which lets the caller mix or
+  // convert without a temporary buffer)
+  //------------------------------------------------------------------------
+  template<typename SampleAt>
+  inline void write(int32_t iNumSamples, SampleAt &&iSampleAt)
+  {
+    auto writeIndex = fWriteIndex.load(std::memory_order_relaxed);
+    // the samples about to be overwritten are no longer valid for the reader
+    fWriteEndIndex.store(writeIndex + iNumSamples, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for(int32_t i = 0; i < iNumSamples; i++)
+      fSamples[(writeIndex + i) & kMask] = iSampleAt(i);
+    fWriteIndex.store(writeIndex + iNumSamples, std::memory_order_release);
+  }
+
+  //------------------------------------------------------------------------
+  // readLatest - called by the reader. Copies the iNumSamples most recent
+  // samples (oldest first) in oSamples. Returns false if not enough samples
+  // have been written yet or if the writer overwrote them during the copy
+  // (oSamples is then garbage and the reader should try again later).
+  //------------------------------------------------------------------------
+  inline bool readLatest(T *oSamples, int32_t iNumSamples) const
+  {
+    if(iNumSamples <= 0 || static_cast<size_t>(iNumSamples) > Capacity)
+      return false;
+
+    auto writeIndex = fWriteIndex.load(std::memory_order_acquire);
+    if(writeIndex < static_cast<uint64_t>(iNumSamples))
+      return false;
+
+    auto start = writeIndex - iNumSamples;
+    for(int32_t i = 0; i < iNumSamples; i++)
+      oSamples[i] = fSamples[(start + i) & kMask];
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    // the oldest sample copied is overwritten once the writer (including a write in progress, not yet
+    // published in fWriteIndex) is Capacity ahead of it
+    return fWriteEndIndex.load(std::memory_order_relaxed) - start <= Capacity;
+  }
+
+  // number of samples written since creation (can be used to detect new samples)
+  inline uint64_t getWriteIndex() const { return fWriteIndex.load(std::memory_order_acquire); }
+
+private:
+  static constexpr uint64_t kMask = Capacity - 1;
+
+  alignas(kCacheLineSize) std::atomic<uint64_t> fWriteIndex{0}; // samples before it are written
+  std::atomic<uint64_t> fWriteEndIndex{0};                       // samples from it on are not being written
+  alignas(kCacheLineSize) std::array<T, Capacity> fSamples{};
+};
+
+}
@@ -0,0 +1,91 @@
+//------------------------------------------------------------------------------------------------------------
+// This file defines a sequence lock (seqlock): a single writer publishes a (trivially copyable) value with
+// plain stores bracketed by a sequence counter, and any number of readers copy the value and retry if the
+// counter tells them that a write happened in the meantime. The writer never waits (which makes it safe to
+// use from the RT) and the readers never block the writer. Because it only relies on lock-free atomics,
+// it also works when the value lives in memory shared between processes.
+//------------------------------------------------------------------------------------------------------------
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace pongasoft::VST::JSGain::Concurrent {
+
+template<typename T>
+class SeqLock
+{
+  static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable");
+  static_assert(std::atomic<uint32_t>::is_always_lock_free, "required for shared memory usage");
+
+public:
+  //------------------------------------------------------------------------
+  // update - (single) writer only. iUpdater is called with T & and can
+  // modify the value in place (only the fields that changed).
+  //------------------------------------------------------------------------
+  template<typename Updater>
+  inline void update(Updater &&iUpdater)
+  {
+    auto sequence = fSequence.load(std::memory_order_relaxed);
+    // odd => write in progress
+    fSequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    iUpdater(fValue);
+    fSequence.store(sequence + 2, std::memory_order_release);
+  }
+
+  // write - (single) writer only
+  inline void write(T const &iValue) { update([&iValue](T &oValue) { oValue = iValue; }); }
+
+  //------------------------------------------------------------------------
+  // tryRead - any thread. Returns false (oValue is then garbage) if a write
+  // was in progress or happened during the copy. On success, oSequence is
+  // the sequence of the value read (see sequence()).
+  //------------------------------------------------------------------------
+  inline bool tryRead(T &oValue, uint32_t &oSequence) const
+  {
+    auto sequence = fSequence.load(std::memory_order_acquire);
+    if(sequence & 1)
+      return false;
+    std::memcpy(&oValue, &fValue, sizeof(T));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if(fSequence.load(std::memory_order_relaxed) != sequence)
+      return false;
+    oSequence = sequence;
+    return true;
+  }
+
+  inline bool tryRead(T &oValue) const { uint32_t sequence; return tryRead(oValue, sequence); }
+
+  //------------------------------------------------------------------------
+  // read - any thread (except the writer!). Retries up to iMaxAttempts
+  // times and returns false if it never succeeded. On success, oSequence
+  // is the sequence of the value read which may be more recent than the
+  // one returned by a previous call to sequence().
+  //------------------------------------------------------------------------
+  inline bool read(T &oValue, uint32_t &oSequence, int iMaxAttempts = 100) const
+  {
+    for(int i = 0; i < iMaxAttempts; i++)
+    {
+      if(tryRead(oValue, oSequence))
+        return true;
+    }
+    return false;
+  }
+
+  inline bool read(T &oValue, int iMaxAttempts = 100) const { uint32_t sequence; return read(oValue, sequence, iMaxAttempts); }
+
+  //------------------------------------------------------------------------
+  // sequence - changes every time the value is written so readers can
+  // cheaply check whether there is anything new to read
+  //------------------------------------------------------------------------
+  inline uint32_t sequence() const { return fSequence.load(std::memory_order_acquire); }
+
+private:
+  std::atomic<uint32_t> fSequence{0};
+  T fValue{};
+};
+
+}
@@ -0,0 +1,163 @@
+//------------------------------------------------------------------------------------------------------------
+// Implementation of the frame scheduler. Everything happens on the UI thread (requests, cancellations and the
+// timer) so there is no need for synchronization besides the creation of the shared instance. There are only
+// a handful of clients (one per view) so they are simply kept in vectors.
+//------------------------------------------------------------------------------------------------------------
+#include "FrameScheduler.h"
+#include "../Trace/Trace.h"
+
+#include <algorithm>
+#include <limits>
+#include <mutex>
+
+namespace pongasoft::VST::JSGain::GUI {
+
+//------------------------------------------------------------------------
+// FrameScheduler::getShared
+//------------------------------------------------------------------------
+std::shared_ptr<FrameScheduler> FrameScheduler::getShared()
+{
+  static std::mutex sMutex{};
+  static std::weak_ptr<FrameScheduler> sScheduler{};
+
+  std::lock_guard<std::mutex> lock{sMutex};
+
+  auto scheduler = sScheduler.lock();
+  if(!scheduler)
+  {
+    scheduler = std::make_shared<FrameScheduler>();
+    sScheduler = scheduler;
+  }
+  return scheduler;
+}
+
+//------------------------------------------------------------------------
+// FrameScheduler::requestFrame
+//------------------------------------------------------------------------
+void FrameScheduler::requestFrame(IFrameClient *iClient)
+{
+  if(iClient == nullptr)
+    return;
+
+  // the frame is sooner than the delayed one (which the client can request again from onFrame)
+  fDelayedClients.erase(std::remove_if(fDelayedClients.begin(), fDelayedClients.end(),
+                                       [iClient](auto const &iDelayed) { return iDelayed.fClient == iClient; }),
+                        fDelayedClients.end());
+
+  if(std::find(fPendingClients.begin(), fPendingClients.end(), iClient) == fPendingClients.end())
+    fPendingClients.emplace_back(iClient);
+
+  // the timer only runs at the frame rate while there are clients waiting for a frame (see onTimer)
+  if(!fTimer || fTimerIntervalMs != fFrameIntervalMs)
+    startTimer(fFrameIntervalMs);
+}
+
+//------------------------------------------------------------------------
+// FrameScheduler::requestFrameIn
+//------------------------------------------------------------------------
+void FrameScheduler::requestFrameIn(IFrameClient *iClient, uint32 iDelayMs)
+{
+  if(iClient == nullptr)
+    return;
+
+  // already getting the next frame
+  if(std::find(fPendingClients.begin(), fPendingClients.end(), iClient) != fPendingClients.end())
+    return;
+
+  auto dueTime = Clock::getCurrentTimeMillis() + iDelayMs;
+
+  auto delayed = std::find_if(fDelayedClients.begin(), fDelayedClients.end(),
+                              [iClient](auto const &iDelayed) { return iDelayed.fClient == iClient; });
+  if(delayed == fDelayedClients.end())
+    fDelayedClients.emplace_back(DelayedClient{iClient, dueTime});
+  else
+    delayed->fDueTime = std::min(delayed->fDueTime, dueTime);
+
+  // not running, or running slower than needed for this one (otherwise onTimer takes care of it)
+  auto intervalMs = std::max(iDelayMs, fFrameIntervalMs);
+  if(!fTimer || fTimerIntervalMs > intervalMs)
+    startTimer(intervalMs);
+}
+
+//------------------------------------------------------------------------
+// FrameScheduler::cancelFrame
+//------------------------------------------------------------------------
+void FrameScheduler::cancelFrame(IFrameClient *iClient)
+{
+  fPendingClients.erase(std::remove(fPendingClients.begin(), fPendingClients.end(), iClient), fPendingClients.end());
+  fDelayedClients.erase(std::remove_if(fDelayedClients.begin(), fDelayedClients.end(),
+                                       [iClient](auto const &iDelayed) { return iDelayed.fClient == iClient; }),
+                        fDelayedClients.end());
+
+  // the client may be destroyed while another client is being called
+  std::replace(fFrameClients.begin(), fFrameClients.end(), iClient, static_cast<IFrameClient *>(nullptr));
+}
+
+//------------------------------------------------------------------------
+// FrameScheduler::startTimer
+//------------------------------------------------------------------------
+void FrameScheduler::startTimer(uint32 iIntervalMs)
+{
+  fTimer = AutoReleaseTimer::create(this, iIntervalMs);
+  fTimerIntervalMs = iIntervalMs;
+}
+
+//------------------------------------------------------------------------
+// FrameScheduler::onTimer
+//------------------------------------------------------------------------
+void FrameScheduler::onTimer(Timer * /* timer */)
+{
+  JSGAIN_TRACE_THREAD("gui");
+  JSGAIN_TRACE_FRAME("gui.frame");
+
+  auto now = Clock::getCurrentTimeMillis();
+
+  // the delayed clients which are due (at most half a frame early) get this frame
+  for(auto i = fDelayedClients.size(); i > 0; i--)
+  {
+    if(fDelayedClients[i - 1].fDueTime <= now + fFrameIntervalMs / 2)
+    {
+      fPendingClients.emplace_back(fDelayedClients[i - 1].fClient);
+      fDelayedClients[i - 1] = fDelayedClients.back();
+      fDelayedClients.pop_back();
+    }
+  }
+
+  //------------------------------------------------------------------------
+  // Nothing requested during the last frame => the timer is stopped (the
+  // next call to requestFrame starts it again). Waiting for an idle frame
+  // (instead of stopping right after calling the clients) avoids stopping
+  // and restarting the timer at every frame while the views are animated.
+  //------------------------------------------------------------------------
+  if(fPendingClients.empty() && fDelayedClients.empty())
+  {
+    fTimer = nullptr;
+    fTimerIntervalMs = 0;
+    return;
+  }
+
+  // swap (instead of copy) so that no memory is allocated once both vectors have grown
+  std::swap(fFrameClients, fPendingClients);
+
+  for(auto client: fFrameClients)
+  {
+    if(client)
+      client->onFrame();
+  }
+
+  fFrameClients.clear();
+
+  // only delayed frames left => no need to wake up before the first one is due (requestFrame goes back to the
+  // frame rate)
+  if(fPendingClients.empty() && !fDelayedClients.empty())
+  {
+    auto nextDueTime = std::numeric_limits<int64>::max();
+    for(auto const &delayed: fDelayedClients)
+      nextDueTime = std::min(nextDueTime, delayed.fDueTime);
+    auto intervalMs = static_cast<uint32>(std::max<int64>(nextDueTime - now, fFrameIntervalMs));
+    if(intervalMs != fTimerIntervalMs)
+      startTimer(intervalMs);
+  }
+}
+
+}
@@ -0,0 +1,78 @@
+//------------------------------------------------------------------------------------------------------------
+// This file defines the frame scheduler which paces the redraws of the views. Instead of redrawing every time
+// a parameter changes (which happens at the rate the host calls process) or running their own timer, the
+// views request a frame (IFrameScheduler::requestFrame) and are called back (IFrameClient::onFrame) at most
+// once per frame, at a capped frame rate, which is where they decide what (if anything) needs to be redrawn.
+// The timer only runs while some views are waiting for a frame: when the only frames requested are delayed
+// ones (IFrameScheduler::requestFrameIn, for example a view refreshing a duration or polling slowly while
+// nothing changes), it wakes up when the first one is due instead of at every frame.
+//
+// By default there is one scheduler per controller (hence per editor). When JSGAIN_SHARED_FRAME_SCHEDULER is
+// enabled, all the editors of the process share the same one (a single timer no matter how many editors are
+// open).
+//------------------------------------------------------------------------------------------------------------
+#pragma once
+
+#include <pongasoft/VST/Timer.h>
+#include "../JSGainModel.h"
+
+#include <memory>
+#include <vector>
+
+namespace pongasoft::VST::JSGain::GUI {
+
+class FrameScheduler : public IFrameScheduler, public ITimerCallback
+{
+public:
+  // ~30 fps
+  static constexpr uint32 kDefaultFrameIntervalMs = 33;
+
+  explicit FrameScheduler(uint32 iFrameIntervalMs = kDefaultFrameIntervalMs) : fFrameIntervalMs{iFrameIntervalMs}
+  {}
+
+  //------------------------------------------------------------------------
+  // getShared - the scheduler shared by all the editors of the process
+  // (created on demand and destroyed when the last controller releases it)
+  //------------------------------------------------------------------------
+  static std::shared_ptr<FrameScheduler> getShared();
+
+  // IFrameScheduler::requestFrame (starts the timer if not running at the frame rate)
+  void requestFrame(IFrameClient *iClient) override;
+
+  // IFrameScheduler::requestFrameIn (starts the timer if not running)
+  void requestFrameIn(IFrameClient *iClient, uint32 iDelayMs) override;
+
+  // IFrameScheduler::cancelFrame
+  void cancelFrame(IFrameClient *iClient) override;
+
+  // calls onFrame on every client which requested a frame since the previous one or whose delayed frame is
+  // due (stops the timer when there is none, or slows it down when only delayed frames are left)
+  void onTimer(Timer *timer) override;
+
+private:
+  // (re)starts the timer
+  void startTimer(uint32 iIntervalMs);
+
+  uint32 fFrameIntervalMs;
+
+  // the clients which requested a frame (no duplicate)
+  std::vector<IFrameClient *> fPendingClients{};
+
+  // the clients which requested a delayed frame (no duplicate, never in fPendingClients at the same time)
+  struct DelayedClient
+  {
+    IFrameClient *fClient;
+    int64 fDueTime; // Clock::getCurrentTimeMillis
+  };
+  std::vector<DelayedClient> fDelayedClients{};
+
+  // the clients being called during the current frame (a client requesting a frame from onFrame gets it at
+  // the next frame)
+  std::vector<IFrameClient *> fFrameClients{};
+
+  // only running while some clients are pending (at the frame rate) or delayed (slower)
+  std::unique_ptr<AutoReleaseTimer> fTimer{};
+  uint32 fTimerIntervalMs{0};
+};
+
+}
@@ -3,6 +3,12 @@
 //------------------------------------------------------------------------
 #include "JSGainController.h"
 
+#include <base/source/fstreamer.h>
+#include <public.sdk/source/common/memorystream.h>
+#include <vstgui/plugin-bindings/vst3editor.h>
+
+#include <cstring>
+
 namespace pongasoft::VST::JSGain::GUI {
 
 //------------------------------------------------------------------------
@@ -10,11 +16,22 @@ namespace pongasoft::VST::JSGain::GUI {
 // Note how the super constructor is expecting the xml file which defines
 // the layout and look and feel of the plugin
 //------------------------------------------------------------------------
-JSGainController::JSGainController() : GUIController("JSGain.uidesc"),
+JSGainController::JSGainController() : GUIController(kUIDescFile),
                                        fParameters{},
                                        fState{fParameters}
 {
   DLOG_F(INFO, "JSGainController()");
+
+  // makes sendUICommands available to the views (via the state)
+  fState.fUICommandSender = this;
+
+  // one scheduler per editor unless it is shared by all the editors of the process
+#if JSGAIN_SHARED_FRAME_SCHEDULER
+  fFrameScheduler = FrameScheduler::getShared();
+#else
+  fFrameScheduler = std::make_shared<FrameScheduler>();
+#endif
+  fState.fFrameScheduler = fFrameScheduler.get();
 }
 
 //------------------------------------------------------------------------
@@ -23,6 +40,9 @@ JSGainController::JSGainController() : GUIController("JSGain.uidesc"),
 JSGainController::~JSGainController()
 {
   DLOG_F(INFO, "~JSGainController()");
+
+  // the processor goes back to messages (in case it outlives this controller)
+  attachSharedInstance(0);
 }
 
 //------------------------------------------------------------------------
@@ -49,4 +69,139 @@ tresult JSGainController::initialize(FUnknown *context)
   return res;
 }
 
+//------------------------------------------------------------------------
+// JSGainController::createView
+// Every editor gets its own description (VST3Editor becomes its
+// controller) but only the first editor of the process reads the file and
+// decodes the bitmaps: the description is parsed from the content kept in
+// memory and the resources come from the description shared by all the
+// controllers. In editor mode the description can be edited (and saved)
+// so every editor keeps its own resources (default behavior).
+//------------------------------------------------------------------------
+IPlugView *JSGainController::createView(FIDString name)
+{
+#if !EDITOR_MODE
+  if(name && std::strcmp(name, ViewType::kEditor) == 0)
+  {
+    if(!fUIResources)
+      fUIResources = UIDescriptionCache::acquireResources(kUIDescFile);
+
+    if(fUIResources)
+    {
+      auto description = UIDescriptionCache::createDescription(fUIResources);
+      if(description)
+        return new VSTGUI::VST3Editor(description.get(), this, kMainViewName);
+    }
+  }
+#endif
+
+  return GUIController::createView(name);
+}
+
+//------------------------------------------------------------------------
+// JSGainController::didOpen
+//------------------------------------------------------------------------
+void JSGainController::didOpen(VST3Editor *editor)
+{
+  GUIController::didOpen(editor);
+  sendUICommand(UICommand::Type::kEditorOpened);
+}
+
+//------------------------------------------------------------------------
+// JSGainController::willClose
+//------------------------------------------------------------------------
+void JSGainController::willClose(VST3Editor *editor)
+{
+  sendUICommand(UICommand::Type::kEditorClosed);
+  GUIController::willClose(editor);
+}
+
+//------------------------------------------------------------------------
+// JSGainController::notify
+// The processor sends its token as soon as it is connected and activated:
+// this is the first time the controller can tell whether both live in the
+// same process.
+//------------------------------------------------------------------------
+tresult JSGainController::notify(IMessage *iMessage)
+{
+  auto res = GUIController::notify(iMessage);
+
+  if(*fState.fInstanceToken != fSharedInstanceToken)
+    attachSharedInstance(*fState.fInstanceToken);
+
+  return res;
+}
+
+//------------------------------------------------------------------------
+// JSGainController::attachSharedInstance
+//------------------------------------------------------------------------
+void JSGainController::attachSharedInstance(InstanceToken iToken)
+{
+  if(fState.fSharedInstance)
+  {
+    fState.fSharedInstance->detachStatsReader();
+    fState.fSharedInstance = nullptr;
+  }
+
+  fSharedInstanceToken = iToken;
+  if(!iToken.isValid())
+    return;
+
+  fState.fSharedInstance = JSGainInstanceRegistry::find(iToken);
+  if(fState.fSharedInstance)
+  {
+    DLOG_F(INFO, "JSGainController - same process as the processor => stats are shared directly");
+    fState.fSharedInstance->attachStatsReader();
+  }
+  else
+    DLOG_F(INFO, "JSGainController - processor not found (different process) => stats are sent as messages");
+}
+
+//------------------------------------------------------------------------
+// JSGainController::sendUICommands
+// Bypasses the Jmb param messaging (which only keeps the latest value) so
+// that every command of the batch reaches the RT (see
+// JSGainProcessor::notify). The whole batch is one message.
+//------------------------------------------------------------------------
+tresult JSGainController::sendUICommands(UICommand const *iCommands, int32 iCount)
+{
+  if(iCount <= 0)
+    return kResultOk;
+
+  iCount = std::min(iCount, MAX_UI_COMMANDS_PER_BATCH);
+
+  auto message = owned(allocateMessage());
+  if(!message)
+    return kResultFalse;
+
+  message->setMessageID(kUICommandsMessageID);
+
+  MemoryStream stream{};
+  IBStreamer streamer{&stream, kLittleEndian};
+  streamer.writeInt32(iCount);
+  // every command of the batch is stamped with the same send time (see JSGainProcessor::processInputs)
+  auto sendTimeNanos = getMonotonicTimeNanos();
+  UICommandSerializer serializer{};
+  for(int32 i = 0; i < iCount; i++)
+  {
+    auto command = iCommands[i];
+    command.fSendTimeNanos = sendTimeNanos;
+    serializer.writeToStream(command, streamer);
+  }
+
+  message->getAttributes()->setBinary(kUICommandsAttrID, stream.getData(), static_cast<uint32>(stream.getSize()));
+
+  return sendMessage(message);
+}
+
+//------------------------------------------------------------------------
+// JSGainController::sendUICommand
+//------------------------------------------------------------------------
+tresult JSGainController::sendUICommand(UICommand::Type iType)
+{
+  UICommand command{};
+  command.fType = iType;
+  return sendUICommands(&command, 1);
+}
+
 }
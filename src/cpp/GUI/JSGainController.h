@@ -10,6 +10,10 @@
 
 #include <pongasoft/VST/GUI/GUIController.h>
 #include "../JSGainPlugin.h"
+#include "FrameScheduler.h"
+#include "UIDescriptionCache.h"
+
+#include <memory>
 
 namespace pongasoft::VST::JSGain::GUI {
 
@@ -20,7 +24,7 @@ using namespace pongasoft::VST::GUI;
 // Note that you can override many methods to enhance and/or bypass what
 // the framework is doing.
 //------------------------------------------------------------------------
-class JSGainController : public GUIController
+class JSGainController : public GUIController, public IUICommandSender
 {
 public:
   //------------------------------------------------------------------------
@@ -46,15 +50,64 @@ public:
   //------------------------------------------------------------------------
   GUIState *getGUIState() override { return &fState; }
 
+  //------------------------------------------------------------------------
+  // Sends all the commands to the RT in a single message (IUICommandSender)
+  //------------------------------------------------------------------------
+  tresult sendUICommands(UICommand const *iCommands, int32 iCount) override;
+
+  //------------------------------------------------------------------------
+  // Creates the editor with its own UI description whose resources
+  // (bitmaps...) are shared by all the controllers of the process (see
+  // UIDescriptionCache.h) instead of being decoded again
+  //------------------------------------------------------------------------
+  IPlugView *PLUGIN_API createView(FIDString name) override;
+
+  //------------------------------------------------------------------------
+  // Delegates to the framework then checks whether the processor (token)
+  // changed (see attachSharedInstance)
+  //------------------------------------------------------------------------
+  tresult PLUGIN_API notify(IMessage *iMessage) override;
+
+  //------------------------------------------------------------------------
+  // Let the RT know whether an editor is open: the VU meter output
+  // parameter can be turned off when there is none (see
+  // RT/VuPPMThrottle.h)
+  //------------------------------------------------------------------------
+  void didOpen(VST3Editor *editor) override;
+  void willClose(VST3Editor *editor) override;
+
 protected:
   tresult initialize(FUnknown *context) override;
 
+  //------------------------------------------------------------------------
+  // Looks up the data shared by the processor: found only when both live
+  // in the same process in which case the processor stops sending the
+  // stats as messages (see JSGainProcessor::flushStats)
+  //------------------------------------------------------------------------
+  void attachSharedInstance(InstanceToken iToken);
+
+  // sends a single command (without text) to the RT
+  tresult sendUICommand(UICommand::Type iType);
+
 private:
   // The controller gets its own copy of the parameters (defined in JSGainPlugin.h)
   JSGainParameters fParameters;
 
   // The state (also defined in JSGainPlugin.h) is readily accessible in the views (see views for usage)
   JSGainGUIState fState;
+
+  // paces the redraws of the views (either owned by this controller or shared by all the controllers)
+  std::shared_ptr<FrameScheduler> fFrameScheduler;
+
+  // the xml file which defines the layout and look and feel of the plugin and its main template
+  static constexpr char const *kUIDescFile = "JSGain.uidesc";
+  static constexpr char const *kMainViewName = "view";
+
+  // the description content and resources (shared by all the controllers) kept for as long as this controller lives
+  std::shared_ptr<UIDescriptionCache::Resources const> fUIResources{};
+
+  // the token of the processor (invalid until received)
+  InstanceToken fSharedInstanceToken{};
 };
 
 }
@@ -0,0 +1,90 @@
+//------------------------------------------------------------------------------------------------------------
+// Implementation of the level histogram view. Like JSGainStatsView, it is redrawn at the pace of the frame
+// scheduler when a new histogram is received.
+//------------------------------------------------------------------------------------------------------------
+#include "JSGainLevelHistogramView.h"
+
+#include <algorithm>
+
+namespace pongasoft::VST::JSGain::GUI {
+
+//------------------------------------------------------------------------
+// JSGainLevelHistogramView::registerParameters
+//------------------------------------------------------------------------
+void JSGainLevelHistogramView::registerParameters()
+{
+  fLevelHistogramParam = registerParam(fState->fLevelHistogram);
+}
+
+//------------------------------------------------------------------------
+// JSGainLevelHistogramView::~JSGainLevelHistogramView
+//------------------------------------------------------------------------
+JSGainLevelHistogramView::~JSGainLevelHistogramView()
+{
+  if(fState)
+    fState->fFrameScheduler->cancelFrame(this);
+}
+
+//------------------------------------------------------------------------
+// JSGainLevelHistogramView::onParameterChange
+//------------------------------------------------------------------------
+void JSGainLevelHistogramView::onParameterChange(ParamID iParamID)
+{
+  fState->fFrameScheduler->requestFrame(this);
+}
+
+//------------------------------------------------------------------------
+// JSGainLevelHistogramView::onFrame
+//------------------------------------------------------------------------
+void JSGainLevelHistogramView::onFrame()
+{
+  markDirty();
+}
+
+//------------------------------------------------------------------------
+// JSGainLevelHistogramView::draw
+//------------------------------------------------------------------------
+void JSGainLevelHistogramView::draw(CDrawContext *iContext)
+{
+  // the parent view takes care of drawing the background
+  CustomView::draw(iContext);
+
+  auto const &histogram = *fLevelHistogramParam;
+
+  //------------------------------------------------------------------------
+  // The last bin (which includes silence) is not displayed: it would
+  // dwarf all the others whenever the input is silent.
+  //------------------------------------------------------------------------
+  constexpr int32 numBins = LevelHistogram::kNumBins - 1;
+
+  uint32 maxCount = 0;
+  for(int32 bin = 0; bin < numBins; bin++)
+    maxCount = std::max(maxCount, histogram.fCounts[bin]);
+
+  if(maxCount == 0)
+    return;
+
+  auto const &size = getViewSize();
+  auto barWidth = size.getWidth() / numBins;
+
+  for(int32 bin = 0; bin < numBins; bin++)
+  {
+    auto count = histogram.fCounts[bin];
+    if(count == 0)
+      continue;
+
+    // bin 0 (loudest) is on the right
+    auto left = size.left + (numBins - 1 - bin) * barWidth;
+    auto height = size.getHeight() * count / maxCount;
+
+    iContext->setFillColor(bin == 0 ? fClipColor : fBarColor);
+    iContext->drawRect(CRect{left, size.bottom - height, left + barWidth, size.bottom}, kDrawFilled);
+  }
+}
+
+//------------------------------------------------------------------------
+// This makes the JSGainLevelHistogramView class available to the editor
+//------------------------------------------------------------------------
+JSGainLevelHistogramView::Creator __gJSGainLevelHistogramCreator("JSGain::LevelHistogram", "JSGain - Level Histogram");
+
+}
@@ -0,0 +1,75 @@
+//------------------------------------------------------------------------------------------------------------
+// This file defines a custom view which displays the distribution of the output levels (LevelHistogram) sent
+// by the RT: one bar per bin, from the quietest (left) to the loudest (right), the clipping bin using its own
+// color.
+//------------------------------------------------------------------------------------------------------------
+#pragma once
+
+#include <pongasoft/VST/GUI/Views/CustomView.h>
+#include "../JSGainPlugin.h"
+
+namespace pongasoft::VST::JSGain::GUI {
+
+using namespace pongasoft::VST::GUI::Views;
+using namespace VSTGUI;
+
+class JSGainLevelHistogramView : public StateAwareCustomView<JSGainGUIState>, public IFrameClient
+{
+public:
+  // Constructor
+  explicit JSGainLevelHistogramView(const CRect &iSize) : StateAwareCustomView<JSGainGUIState>(iSize)
+  {}
+
+  // Destructor (no more frames)
+  ~JSGainLevelHistogramView() override;
+
+  //------------------------------------------------------------------------
+  // tied to custom attribute "bar-color" (see Creator below)
+  //------------------------------------------------------------------------
+  const CColor &getBarColor() const { return fBarColor;  }
+  void setBarColor(const CColor &iColor) { fBarColor = iColor; }
+
+  //------------------------------------------------------------------------
+  // tied to custom attribute "clip-color" (see Creator below)
+  //------------------------------------------------------------------------
+  const CColor &getClipColor() const { return fClipColor;  }
+  void setClipColor(const CColor &iColor) { fClipColor = iColor; }
+
+  // registers the histogram param (the view is redrawn at the next frame every time it changes)
+  void registerParameters() override;
+
+  // a new histogram was received => requests a frame
+  void onParameterChange(ParamID iParamID) override;
+
+  // redraws the view (IFrameClient)
+  void onFrame() override;
+
+  // draws the bars
+  void draw(CDrawContext *iContext) override;
+
+  CLASS_METHODS_NOCOPY(JSGainLevelHistogramView, CustomView)
+
+protected:
+  CColor fBarColor{kGreenCColor};
+  CColor fClipColor{kRedCColor};
+
+  GUIJmbParam<LevelHistogram> fLevelHistogramParam{};
+
+public:
+  class Creator : public CustomViewCreator<JSGainLevelHistogramView, StateAwareCustomView<JSGainGUIState>>
+  {
+  public:
+    explicit Creator(char const *iViewName = nullptr, char const *iDisplayName = nullptr) noexcept :
+      CustomViewCreator(iViewName, iDisplayName)
+    {
+      registerColorAttribute("bar-color",
+                             &JSGainLevelHistogramView::getBarColor,
+                             &JSGainLevelHistogramView::setBarColor);
+      registerColorAttribute("clip-color",
+                             &JSGainLevelHistogramView::getClipColor,
+                             &JSGainLevelHistogramView::setClipColor);
+    }
+  };
+};
+
+}
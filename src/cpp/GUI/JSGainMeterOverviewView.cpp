@@ -0,0 +1,139 @@
+//------------------------------------------------------------------------------------------------------------
+// Implementation of the mixer overview. Polling 256 slots is a few hundred relaxed loads per frame, and the
+// view is only redrawn when one of the instances published something new (or came and went). While none does,
+// the slots are polled at a slower pace.
+//------------------------------------------------------------------------------------------------------------
+#include "JSGainMeterOverviewView.h"
+
+#include <algorithm>
+
+namespace pongasoft::VST::JSGain::GUI {
+
+//------------------------------------------------------------------------
+// JSGainMeterOverviewView::registerParameters
+//------------------------------------------------------------------------
+void JSGainMeterOverviewView::registerParameters()
+{
+  fInstanceTokenParam = registerParam(fState->fInstanceToken);
+
+  // the slots are polled (see onFrame)
+  fState->fFrameScheduler->requestFrame(this);
+}
+
+//------------------------------------------------------------------------
+// JSGainMeterOverviewView::~JSGainMeterOverviewView
+//------------------------------------------------------------------------
+JSGainMeterOverviewView::~JSGainMeterOverviewView()
+{
+  if(fState)
+    fState->fFrameScheduler->cancelFrame(this);
+}
+
+//------------------------------------------------------------------------
+// JSGainMeterOverviewView::onFrame
+//------------------------------------------------------------------------
+void JSGainMeterOverviewView::onFrame()
+{
+  // the update counters (and tokens) of the claimed slots change whenever something needs to be redrawn
+  uint64 signature = 0;
+  auto slots = MeterRegistry::getSlots();
+  for(int32 i = 0; i < MeterRegistry::kMaxSlots; i++)
+  {
+    auto const &slot = slots[i];
+    if(!slot.fClaimed.load(std::memory_order_acquire))
+      continue;
+    signature = signature * 31 + static_cast<uint64>(slot.fInstanceId.load(std::memory_order_relaxed));
+    signature = signature * 31 + slot.fUpdateCount.load(std::memory_order_relaxed);
+  }
+
+  auto changed = signature != fLastSignature;
+  if(changed)
+  {
+    fLastSignature = signature;
+    markDirty();
+  }
+
+  // there is no notification when an instance publishes, comes or goes (polled slowly when nothing changes)
+  fState->fFrameScheduler->poll(this, changed, fIdleFrames);
+}
+
+//------------------------------------------------------------------------
+// JSGainMeterOverviewView::toHeight
+//------------------------------------------------------------------------
+CCoord JSGainMeterOverviewView::toHeight(float iSample) const
+{
+  if(iSample <= 0)
+    return 0;
+  auto level = std::clamp(static_cast<float>(sampleToDb(iSample)), kMinDb, 0.0f);
+  return getViewSize().getHeight() * (level - kMinDb) / -kMinDb;
+}
+
+//------------------------------------------------------------------------
+// JSGainMeterOverviewView::draw
+//------------------------------------------------------------------------
+void JSGainMeterOverviewView::draw(CDrawContext *iContext)
+{
+  // the parent view takes care of drawing the background
+  CustomView::draw(iContext);
+
+  auto slots = MeterRegistry::getSlots();
+
+  int32 numColumns = 0;
+  for(int32 i = 0; i < MeterRegistry::kMaxSlots; i++)
+  {
+    if(slots[i].fClaimed.load(std::memory_order_acquire))
+      numColumns++;
+  }
+
+  if(numColumns == 0)
+    return;
+
+  auto const &size = getViewSize();
+  auto columnWidth = size.getWidth() / std::max(numColumns, kMinNumColumns);
+  // the processor of this editor may live in another process (the slots are only the ones of this process)
+  auto token = *fInstanceTokenParam;
+  auto instanceId = JSGainInstanceRegistry::isLocal(token) ? token.fId : 0;
+
+  int32 column = 0;
+  for(int32 i = 0; i < MeterRegistry::kMaxSlots && column < numColumns; i++)
+  {
+    auto const &slot = slots[i];
+    if(!slot.fClaimed.load(std::memory_order_acquire))
+      continue;
+
+    auto left = size.left + column * columnWidth;
+    auto right = left + std::max<CCoord>(columnWidth - 1, 1);
+    column++;
+
+    // loudness (rms)
+    iContext->setFillColor(fBarColor);
+    iContext->drawRect(CRect{left, size.bottom - toHeight(slot.fRMS.load(std::memory_order_relaxed)), right, size.bottom},
+                       kDrawFilled);
+
+    // peak (line)
+    auto peakTop = size.bottom - toHeight(slot.fPeak.load(std::memory_order_relaxed));
+    iContext->setFillColor(fPeakColor);
+    iContext->drawRect(CRect{left, peakTop, right, std::min(peakTop + 1, size.bottom)}, kDrawFilled);
+
+    // clip indicator (until the max is reset)
+    if(slot.fClipCount.load(std::memory_order_relaxed) > 0)
+    {
+      iContext->setFillColor(fClipColor);
+      iContext->drawRect(CRect{left, size.top, right, size.top + 3}, kDrawFilled);
+    }
+
+    // this instance
+    if(instanceId != 0 && slot.fInstanceId.load(std::memory_order_relaxed) == instanceId)
+    {
+      iContext->setFrameColor(fPeakColor);
+      iContext->drawRect(CRect{left, size.top, right, size.bottom}, kDrawStroked);
+    }
+  }
+}
+
+//------------------------------------------------------------------------
+// This makes the JSGainMeterOverviewView class available to the editor
+//------------------------------------------------------------------------
+JSGainMeterOverviewView::Creator __gJSGainMeterOverviewCreator("JSGain::MeterOverview", "JSGain - Meter Overview");
+
+}
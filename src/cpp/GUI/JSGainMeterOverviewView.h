@@ -0,0 +1,98 @@
+//------------------------------------------------------------------------------------------------------------
+// This file defines a custom view which displays the levels of every instance of the plugin in the process
+// (mixer overview): one column per claimed slot of the MeterRegistry, polled at every frame (slower while
+// nothing changes). The instance which owns the editor is highlighted.
+//------------------------------------------------------------------------------------------------------------
+#pragma once
+
+#include <pongasoft/VST/GUI/Views/CustomView.h>
+#include "../JSGainPlugin.h"
+#include "../JSGainMeterRegistry.h"
+
+namespace pongasoft::VST::JSGain::GUI {
+
+using namespace pongasoft::VST::GUI::Views;
+using namespace VSTGUI;
+
+class JSGainMeterOverviewView : public StateAwareCustomView<JSGainGUIState>, public IFrameClient
+{
+public:
+  // Constructor
+  explicit JSGainMeterOverviewView(const CRect &iSize) : StateAwareCustomView<JSGainGUIState>(iSize)
+  {}
+
+  // Destructor (no more frames)
+  ~JSGainMeterOverviewView() override;
+
+  //------------------------------------------------------------------------
+  // tied to custom attribute "bar-color" (see Creator below)
+  //------------------------------------------------------------------------
+  const CColor &getBarColor() const { return fBarColor;  }
+  void setBarColor(const CColor &iColor) { fBarColor = iColor; }
+
+  //------------------------------------------------------------------------
+  // tied to custom attribute "peak-color" (see Creator below)
+  //------------------------------------------------------------------------
+  const CColor &getPeakColor() const { return fPeakColor;  }
+  void setPeakColor(const CColor &iColor) { fPeakColor = iColor; }
+
+  //------------------------------------------------------------------------
+  // tied to custom attribute "clip-color" (see Creator below)
+  //------------------------------------------------------------------------
+  const CColor &getClipColor() const { return fClipColor;  }
+  void setClipColor(const CColor &iColor) { fClipColor = iColor; }
+
+  // registers the instance token param (to highlight this instance) and requests the first frame
+  void registerParameters() override;
+
+  // polls the slots and redraws the view when any of them changed (IFrameClient)
+  void onFrame() override;
+
+  // draws one column per instance
+  void draw(CDrawContext *iContext) override;
+
+  CLASS_METHODS_NOCOPY(JSGainMeterOverviewView, CustomView)
+
+protected:
+  // levels below this value are not displayed
+  static constexpr float kMinDb = -60.0f;
+
+  // the columns never get wider than this (fraction of the width)
+  static constexpr int32 kMinNumColumns = 16;
+
+  // height of a level in dB (0 to the height of the view)
+  CCoord toHeight(float iSample) const;
+
+  CColor fBarColor{kGreenCColor};
+  CColor fPeakColor{kWhiteCColor};
+  CColor fClipColor{kRedCColor};
+
+  GUIJmbParam<InstanceToken> fInstanceTokenParam{};
+
+  // what was polled the last time the view was redrawn (see onFrame)
+  uint64 fLastSignature{0};
+
+  // number of frames without change (see IFrameScheduler::poll)
+  int32 fIdleFrames{0};
+
+public:
+  class Creator : public CustomViewCreator<JSGainMeterOverviewView, StateAwareCustomView<JSGainGUIState>>
+  {
+  public:
+    explicit Creator(char const *iViewName = nullptr, char const *iDisplayName = nullptr) noexcept :
+      CustomViewCreator(iViewName, iDisplayName)
+    {
+      registerColorAttribute("bar-color",
+                             &JSGainMeterOverviewView::getBarColor,
+                             &JSGainMeterOverviewView::setBarColor);
+      registerColorAttribute("peak-color",
+                             &JSGainMeterOverviewView::getPeakColor,
+                             &JSGainMeterOverviewView::setPeakColor);
+      registerColorAttribute("clip-color",
+                             &JSGainMeterOverviewView::getClipColor,
+                             &JSGainMeterOverviewView::setClipColor);
+    }
+  };
+};
+
+}
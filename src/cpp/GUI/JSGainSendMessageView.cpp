@@ -2,6 +2,10 @@
 // This file contains the implementation of the JSGainSendMessageView
 //------------------------------------------------------------------------
 #include "JSGainSendMessageView.h"
+#include "../Trace/Trace.h"
+
+#include <sstream>
+#include <iomanip>
 
 namespace pongasoft::VST::JSGain::GUI {
 
@@ -28,6 +32,7 @@ void JSGainSendMessageView::onClick()
   // This is how easy it is to send the message to the RT...
   // broadcast(msg) is a shortcut: setValue(msg) then broadcast()
   //------------------------------------------------------------------------
+  msg.fSendTimeNanos = getMonotonicTimeNanos();
   fState->fUIMessage.broadcast(msg);
 
   //------------------------------------------------------------------------
@@ -41,6 +46,127 @@ void JSGainSendMessageView::onClick()
            msg.fText,
            Debug::ParamTable::from(fState).full().toString().c_str());
   }
+
+#if JSGAIN_ENABLE_TRACE
+  // dumps the events recorded so far (all threads) in a Chrome trace file
+  if(command == "$trace")
+  {
+    auto path = Trace::dumpChromeTraceToFile();
+    LOG_F(INFO, "gui - trace written to [%s] (%llu events dropped)",
+          path.c_str(),
+          static_cast<unsigned long long>(Trace::getDroppedEventsCount()));
+  }
+#endif
+
+  //------------------------------------------------------------------------
+  // A text starting with $ is also interpreted as a burst of commands for
+  // the RT (ex: "$reset;$state"). Unlike fUIMessage, all the commands are
+  // guaranteed to be executed (in order) and they travel in one message.
+  //------------------------------------------------------------------------
+  if(!command.empty() && command[0] == '$')
+  {
+    UICommand commands[MAX_UI_COMMANDS_PER_BATCH];
+    auto count = parseUICommands(text.getString(), commands, MAX_UI_COMMANDS_PER_BATCH);
+    fState->sendUICommands(commands, count);
+  }
+}
+
+//------------------------------------------------------------------------
+// registerParameters
+//------------------------------------------------------------------------
+void JSGainSendMessageView::registerParameters()
+{
+  TextButtonView::registerParameters();
+  fRTStateSnapshot = registerParam(fState->fRTStateSnapshot);
+}
+
+//------------------------------------------------------------------------
+// formatLatency - one line summary of a latency histogram (in us)
+//------------------------------------------------------------------------
+std::string formatLatency(LatencyHistogram const &iLatency)
+{
+  std::ostringstream s;
+  s << "count=" << iLatency.fCount
+    << " mean=" << iLatency.getMeanNanos() / 1000 << "us"
+    << " p50<=" << iLatency.getPercentileNanos(0.5) / 1000 << "us"
+    << " p99<=" << iLatency.getPercentileNanos(0.99) / 1000 << "us"
+    << " max=" << iLatency.fMaxNanos / 1000 << "us";
+  return s.str();
+}
+
+//------------------------------------------------------------------------
+// formatMessagingStats - latency and throughput of the RT -> GUI path
+// (as measured by JSGainStatsView)
+//------------------------------------------------------------------------
+std::string formatMessagingStats(MessagingStats const &iStats)
+{
+  std::ostringstream s;
+  s << "stats (rt -> gui) | messages=" << iStats.fMessageCount
+    << " (" << std::fixed << std::setprecision(1) << iStats.getMessagesPerSecond() << "/s)"
+    << " | snapshots=" << iStats.fItemCount
+    << " (" << iStats.getItemsPerSecond() << "/s)\n"
+    << "  receive: " << formatLatency(iStats.fReceiveLatency) << "\n"
+    << "  draw:    " << formatLatency(iStats.fDrawLatency);
+  return s.str();
+}
+
+//------------------------------------------------------------------------
+// formatRTStateSnapshot - generates a table (similar to Debug::ParamTable)
+// from the snapshot. This happens in the GUI so memory allocation is ok.
+//------------------------------------------------------------------------
+std::string formatRTStateSnapshot(RTStateSnapshot const &iSnapshot, JSGainParameters const &iParams)
+{
+  std::ostringstream s;
+
+  s << "frames=" << iSnapshot.fFrameCount
+    << " | lastNumSamples=" << iSnapshot.fLastNumSamples
+    << " | sampleRate=" << iSnapshot.fSampleRate
+    << " | maxSinceReset=" << toDbString(iSnapshot.fMaxSinceReset)
+    << " | droppedUICommands=" << iSnapshot.fDroppedUICommandsCount
+    << "\n";
+
+  s << "commands (gui -> rt) | " << formatLatency(iSnapshot.fUICommandLatency) << "\n";
+
+  s << "| ID   | VALUE          | NORM. |\n";
+  s << "---------------------------------\n";
+  for(int32 i = 0; i < iSnapshot.fParamCount; i++)
+  {
+    auto paramID = iSnapshot.fParamIDs[i];
+    auto value = iSnapshot.fNormalizedValues[i];
+
+    char text[128]{};
+    if(auto paramDef = iParams.getRawVstParamDef(paramID))
+    {
+      String128 text16{};
+      paramDef->toString(value, text16);
+      Steinberg::UString(text16, str16BufferSize(String128)).toAscii(text, sizeof(text));
+    }
+
+    s << "| " << std::setw(4) << paramID
+      << " | " << std::setw(14) << std::left << text << std::right
+      << " | " << std::fixed << std::setprecision(3) << value
+      << " |\n";
+  }
+  s << "---------------------------------";
+
+  return s.str();
+}
+
+//------------------------------------------------------------------------
+// onParameterChange
+//------------------------------------------------------------------------
+void JSGainSendMessageView::onParameterChange(ParamID iParamID)
+{
+  if(iParamID == fRTStateSnapshot.getParamID())
+  {
+    LOG_F(INFO, "rt - snapshot (taken at %lld) --->\n%s\n%s",
+          fRTStateSnapshot->fTimestamp,
+          formatRTStateSnapshot(*fRTStateSnapshot, *fParams).c_str(),
+          formatMessagingStats(fState->fStatsMessaging).c_str());
+    return;
+  }
+
+  TextButtonView::onParameterChange(iParamID);
 }
 
 //------------------------------------------------------------------------
@@ -1,8 +1,8 @@
 //------------------------------------------------------------------------------------------------------------
 // This file defines the view representing the button that sends whatever text is entered in the input
 // text field to the the RT processing. This example demonstrates how to extend a Jamba custom control
-// (momentary button) and get access to the state. Note how the view simply uses the state and does not
-// register any parameter as nothing needs to happen when the values of the parameter it uses changes.
+// (momentary button) and get access to the state. The view registers the RT state snapshot param only
+// because it displays the RT state that the "$state" command requests.
 //------------------------------------------------------------------------------------------------------------
 #pragma once
 
@@ -34,6 +34,20 @@ public:
   //------------------------------------------------------------------------
   void onClick() override;
 
+  //------------------------------------------------------------------------
+  // Registers the RT state snapshot param (sent by the RT in response to
+  // the "$state" or "$rtState" command)
+  //------------------------------------------------------------------------
+  void registerParameters() override;
+
+  //------------------------------------------------------------------------
+  // Called when the RT state snapshot is received => formats it
+  //------------------------------------------------------------------------
+  void onParameterChange(ParamID iParamID) override;
+
+protected:
+  GUIJmbParam<RTStateSnapshot> fRTStateSnapshot{};
+
 public:
   //------------------------------------------------------------------------
   // The Creator class is what makes this new view accessible in the editor
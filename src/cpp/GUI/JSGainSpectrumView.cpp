@@ -0,0 +1,107 @@
+//------------------------------------------------------------------------------------------------------------
+// Implementation of the spectrum view. Note that the FFT never runs on the UI thread (nor on the RT): the
+// only thing happening on the UI thread is copying the bands (SeqLock) and drawing them.
+//------------------------------------------------------------------------------------------------------------
+#include "JSGainSpectrumView.h"
+
+#include <algorithm>
+
+namespace pongasoft::VST::JSGain::GUI {
+
+//------------------------------------------------------------------------
+// JSGainSpectrumView::registerParameters
+//------------------------------------------------------------------------
+void JSGainSpectrumView::registerParameters()
+{
+  fInstanceTokenParam = registerParam(fState->fInstanceToken);
+
+  // the first frame creates the analyzer (see onFrame)
+  fState->fFrameScheduler->requestFrame(this);
+}
+
+//------------------------------------------------------------------------
+// JSGainSpectrumView::~JSGainSpectrumView
+//------------------------------------------------------------------------
+JSGainSpectrumView::~JSGainSpectrumView()
+{
+  if(fState)
+    fState->fFrameScheduler->cancelFrame(this);
+}
+
+//------------------------------------------------------------------------
+// JSGainSpectrumView::onParameterChange
+//------------------------------------------------------------------------
+void JSGainSpectrumView::onParameterChange(ParamID iParamID)
+{
+  if(iParamID == fInstanceTokenParam.getParamID())
+  {
+    // stops the worker thread (a new one will be created in onFrame)
+    fAnalyzer = nullptr;
+    fState->fFrameScheduler->requestFrame(this);
+  }
+}
+
+//------------------------------------------------------------------------
+// JSGainSpectrumView::onFrame
+//------------------------------------------------------------------------
+void JSGainSpectrumView::onFrame()
+{
+  if(!fAnalyzer)
+  {
+    // the processor lives in another process (or its token has not been received yet) => nothing to analyze
+    // until the token changes (see onParameterChange)
+    auto instance = JSGainInstanceRegistry::find(*fInstanceTokenParam);
+    if(!instance)
+      return;
+    fAnalyzer = std::make_unique<Spectrum::SpectrumAnalyzer>(std::move(instance));
+    fLastSequence = 0;
+    fIdleFrames = 0;
+  }
+
+  auto changed = false;
+  auto sequence = fAnalyzer->getSequence();
+  if(sequence != fLastSequence && fAnalyzer->readBands(fBands))
+  {
+    fLastSequence = sequence;
+    changed = true;
+    markDirty();
+  }
+
+  // the analyzer only publishes while the plugin is processing (polled slowly otherwise)
+  fState->fFrameScheduler->poll(this, changed, fIdleFrames);
+}
+
+//------------------------------------------------------------------------
+// JSGainSpectrumView::draw
+//------------------------------------------------------------------------
+void JSGainSpectrumView::draw(CDrawContext *iContext)
+{
+  // the parent view takes care of drawing the background
+  CustomView::draw(iContext);
+
+  if(fBands.fSampleRate <= 0)
+    return;
+
+  auto const &size = getViewSize();
+  auto barWidth = size.getWidth() / Spectrum::SpectrumBands::kNumBands;
+
+  iContext->setFillColor(fBarColor);
+
+  for(int32 band = 0; band < Spectrum::SpectrumBands::kNumBands; band++)
+  {
+    auto level = std::clamp(fBands.fLevelsInDb[band], kMinDb, 0.0f);
+    if(level <= kMinDb)
+      continue;
+
+    auto height = size.getHeight() * (level - kMinDb) / -kMinDb;
+    auto left = size.left + band * barWidth;
+    iContext->drawRect(CRect{left, size.bottom - height, left + barWidth, size.bottom}, kDrawFilled);
+  }
+}
+
+//------------------------------------------------------------------------
+// This makes the JSGainSpectrumView class available to the editor
+//------------------------------------------------------------------------
+JSGainSpectrumView::Creator __gJSGainSpectrumCreator("JSGain::Spectrum", "JSGain - Spectrum");
+
+}
@@ -0,0 +1,75 @@
+//------------------------------------------------------------------------------------------------------------
+// This file defines a custom view which displays the spectrum of the output of the plugin. The view does not
+// compute anything: it owns a SpectrumAnalyzer (which runs its own worker thread) and simply draws the bands
+// it publishes (checked at every frame while it publishes, see FrameScheduler).
+//------------------------------------------------------------------------------------------------------------
+#pragma once
+
+#include <pongasoft/VST/GUI/Views/CustomView.h>
+#include "../JSGainPlugin.h"
+#include "../Spectrum/SpectrumAnalyzer.h"
+
+namespace pongasoft::VST::JSGain::GUI {
+
+using namespace pongasoft::VST::GUI::Views;
+using namespace VSTGUI;
+
+class JSGainSpectrumView : public StateAwareCustomView<JSGainGUIState>, public IFrameClient
+{
+public:
+  // Constructor
+  explicit JSGainSpectrumView(const CRect &iSize) : StateAwareCustomView<JSGainGUIState>(iSize)
+  {}
+
+  // Destructor (no more frames)
+  ~JSGainSpectrumView() override;
+
+  //------------------------------------------------------------------------
+  // tied to custom attribute "bar-color" (see Creator below)
+  //------------------------------------------------------------------------
+  const CColor &getBarColor() const { return fBarColor;  }
+  void setBarColor(const CColor &iColor) { fBarColor = iColor; }
+
+  // registers the instance token param and requests the first frame
+  void registerParameters() override;
+
+  // the instance token changed => a new analyzer is needed
+  void onParameterChange(ParamID iParamID) override;
+
+  // draws the (precomputed) bands
+  void draw(CDrawContext *iContext) override;
+
+  // checks whether the analyzer has published new bands (IFrameClient)
+  void onFrame() override;
+
+  CLASS_METHODS_NOCOPY(JSGainSpectrumView, CustomView)
+
+protected:
+  // levels below this value are not displayed
+  static constexpr float kMinDb = -90.0f;
+
+  CColor fBarColor{kGreenCColor};
+
+  GUIJmbParam<InstanceToken> fInstanceTokenParam{};
+
+  // created on demand (in onFrame) and destroyed with the view (which stops the worker thread)
+  std::unique_ptr<Spectrum::SpectrumAnalyzer> fAnalyzer{};
+  uint32_t fLastSequence{0};
+  int32 fIdleFrames{0}; // see IFrameScheduler::poll
+  Spectrum::SpectrumBands fBands{};
+
+public:
+  class Creator : public CustomViewCreator<JSGainSpectrumView, StateAwareCustomView<JSGainGUIState>>
+  {
+  public:
+    explicit Creator(char const *iViewName = nullptr, char const *iDisplayName = nullptr) noexcept :
+      CustomViewCreator(iViewName, iDisplayName)
+    {
+      registerColorAttribute("bar-color",
+                             &JSGainSpectrumView::getBarColor,
+                             &JSGainSpectrumView::setBarColor);
+    }
+  };
+};
+
+}
@@ -1,11 +1,14 @@
 //------------------------------------------------------------------------------------------------------------
-// Implementation of the view. Note that the view does not override onParameterChange because the default
-// implementation is to mark the view dirty (so that it gets redrawn) which is exactly what we want when the
-// stats get updated.
+// Implementation of the view. Note that the view overrides onParameterChange because the default
+// implementation is to mark the view dirty right away (so at the rate the RT sends the stats): instead it
+// requests a frame from the frame scheduler and only redraws when the text actually changes. In between, it
+// only needs a (delayed) frame to refresh the duration.
 //------------------------------------------------------------------------------------------------------------
 #include <pongasoft/VST/GUI/DrawContext.h>
 #include "JSGainStatsView.h"
+#include "../Trace/Trace.h"
 
+#include <algorithm>
 #include <chrono>
 #include <sstream>
 
@@ -34,13 +37,18 @@ void JSGainStatsView::registerParameters()
   //------------------------------------------------------------------------
   fStatsParam = registerParam(fState->fStats);
 
-  //------------------------------------------------------------------------
-  // Create a timer that will fire every 200ms. Note that because it is
-  // a std::unique_ptr<AutoReleaseTimer> and AutoReleaseTimer handles
-  // release on destruction, this call is safe no matter how many time you
-  // do it
-  //------------------------------------------------------------------------
-  fTimer = AutoReleaseTimer::create(this, 200);
+  // the first frame computes the text (and decides when the next one is needed, see onFrame)
+  fStatsChanged = true;
+  fState->fFrameScheduler->requestFrame(this);
+}
+
+//------------------------------------------------------------------------
+// JSGainStatsView::~JSGainStatsView
+//------------------------------------------------------------------------
+JSGainStatsView::~JSGainStatsView()
+{
+  if(fState)
+    fState->fFrameScheduler->cancelFrame(this);
 }
 
 //------------------------------------------------------------------------
@@ -79,6 +87,8 @@ std::string computeDurationString(long iDuration)
 //------------------------------------------------------------------------
 void JSGainStatsView::draw(CDrawContext *iContext)
 {
+  JSGAIN_TRACE_ZONE("JSGainStatsView::draw");
+
   //------------------------------------------------------------------------
   // The parent view takes care of drawing the background
   //------------------------------------------------------------------------
@@ -90,32 +100,125 @@ void JSGainStatsView::draw(CDrawContext *iContext)
   //------------------------------------------------------------------------
   auto rdc = RelativeDrawContext{this, iContext};
 
-  std::ostringstream s;
-
-  //------------------------------------------------------------------------
-  // Note how the param is being used as if it was the Stats pointer
-  //------------------------------------------------------------------------
-  s << "Rate=" << fStatsParam->fSampleRate
-    << "| Max=" << toDbString(fStatsParam->fMaxSinceReset)
-    << "| Dur.=" << computeDurationString(Clock::getCurrentTimeMillis() - fStatsParam->fResetTime);
-
   StringDrawContext sdc{};
   sdc.fHorizTxtAlign = kCenterText;
   sdc.fTextInset = {2, 2};
   sdc.fFontColor = fTextColor;
   sdc.fFont = fFont;
 
-  // after generating the string, simply draw it
-  rdc.drawString(s.str(), sdc);
+  // the string has already been generated (see onFrame), simply draw it
+  rdc.drawString(fText, sdc);
+
+  if(fUndrawnSendTimeNanos > 0)
+  {
+    fState->fStatsMessaging.onDraw(fUndrawnSendTimeNanos, getMonotonicTimeNanos());
+    fUndrawnSendTimeNanos = 0;
+  }
+}
+
+//------------------------------------------------------------------------
+// JSGainStatsView::computeText
+//------------------------------------------------------------------------
+std::string JSGainStatsView::computeText() const
+{
+  std::ostringstream s;
+
+  // only the most recent snapshot of the batch is displayed
+  auto const &stats = fLatestStats;
+  s << "Rate=" << stats.fSampleRate
+    << "| Max=" << toDbString(stats.fMaxSinceReset)
+    << "| Dur.=" << computeDurationString(Clock::getCurrentTimeMillis() - stats.fResetTime);
+
+  // where the max is on the project timeline (so that it is easy to find it)
+  if(stats.fMaxProjectTimeSamples >= 0 && stats.fSampleRate > 0)
+    s << "| At=" << computeDurationString(static_cast<long>(stats.fMaxProjectTimeSamples * 1000 / stats.fSampleRate));
+
+  return s.str();
+}
+
+//------------------------------------------------------------------------
+// JSGainStatsView::onParameterChange
+//------------------------------------------------------------------------
+void JSGainStatsView::onParameterChange(ParamID iParamID)
+{
+  // not calling CustomView::onParameterChange which would mark the view dirty right away
+
+  //------------------------------------------------------------------------
+  // Note how the param is being used as if it was the StatsBatch object.
+  //------------------------------------------------------------------------
+  onStatsReceived(*fStatsParam);
+
+  fState->fFrameScheduler->requestFrame(this);
+}
+
+//------------------------------------------------------------------------
+// JSGainStatsView::onStatsReceived
+//------------------------------------------------------------------------
+void JSGainStatsView::onStatsReceived(StatsBatch const &iBatch)
+{
+  fStatsChanged = true;
+  fLatestStats = iBatch.latest();
+
+  auto sendTimeNanos = iBatch.fSendTimeNanos;
+  fState->fStatsMessaging.onReceive(sendTimeNanos, iBatch.fCount, getMonotonicTimeNanos());
+  if(fUndrawnSendTimeNanos == 0)
+    fUndrawnSendTimeNanos = sendTimeNanos;
 }
 
 //------------------------------------------------------------------------
-// JSGainStatsView::onTimer
+// JSGainStatsView::onFrame
 //------------------------------------------------------------------------
-void JSGainStatsView::onTimer(Timer *timer)
+void JSGainStatsView::onFrame()
 {
-  // simply mark the view dirty so that it gets redrawn (the duration keeps on changing...)
-  markDirty();
+  // same process => the processor writes the stats in the shared slot instead of sending them
+  auto const &sharedInstance = fState->fSharedInstance;
+  if(sharedInstance)
+  {
+    // cheap check first, then the batch is tracked by the sequence it was actually read at (a newer batch
+    // may have been written in between: it must not be received again at the next frame)
+    if(sharedInstance->fStats.sequence() != fSharedStatsSequence)
+    {
+      StatsBatch batch{};
+      uint32_t sequence{};
+      if(sharedInstance->fStats.read(batch, sequence) && sequence != fSharedStatsSequence)
+      {
+        fSharedStatsSequence = sequence;
+        onStatsReceived(batch);
+      }
+    }
+  }
+
+  auto statsChanged = fStatsChanged;
+
+  auto now = Clock::getCurrentTimeMillis();
+
+  if(fStatsChanged || now >= fNextRefreshTime)
+  {
+    fStatsChanged = false;
+    fNextRefreshTime = now + kRefreshIntervalMs;
+
+    auto text = computeText();
+    if(text != fText)
+    {
+      fText = std::move(text);
+      markDirty();
+    }
+    else
+    {
+      // same text => nothing new to draw (the next draw would not be due to this batch)
+      fUndrawnSendTimeNanos = 0;
+    }
+  }
+
+  //------------------------------------------------------------------------
+  // The shared slot must be polled (while the stats keep on changing, at
+  // every frame). Otherwise the stats come with the param (onParameterChange
+  // requests a frame) and the only thing left is refreshing the duration.
+  //------------------------------------------------------------------------
+  if(sharedInstance)
+    fState->fFrameScheduler->poll(this, statsChanged, fIdleFrames, kRefreshIntervalMs);
+  else
+    fState->fFrameScheduler->requestFrameIn(this, static_cast<uint32>(std::max<int64>(fNextRefreshTime - now, 0)));
 }
 
 //------------------------------------------------------------------------
@@ -2,14 +2,15 @@
 // This file defines a custom view which doesn't inherit from any control from the vst sdk. It will display
 // the stats in a little window. This class gives access to fParams and fState and shows how to create a
 // "Creator" which allows the view to be accessible in the "editor" like all other VST SDK views with custom
-// attributes. It also shows how to create a timer in the GUI layer.
+// attributes. It also shows how to be redrawn at the pace of the frame scheduler (only when the text changes).
 //------------------------------------------------------------------------------------------------------------
 #pragma once
 
 #include <pongasoft/VST/GUI/Views/CustomView.h>
-#include <pongasoft/VST/Timer.h>
 #include "../JSGainPlugin.h"
 
+#include <string>
+
 namespace pongasoft::VST::JSGain::GUI {
 
 using namespace pongasoft::VST::GUI::Views;
@@ -19,13 +20,16 @@ using namespace VSTGUI;
 // By inheriting from PluginCustomView<JSGainGUIState>, this view will inherit the default behaviors of
 // pongasoft::VST::GUI::Views::CustomView and add fState and fParams for dealing for parameters/state.
 //------------------------------------------------------------------------------------------------------------
-class JSGainStatsView : public StateAwareCustomView<JSGainGUIState>, public ITimerCallback
+class JSGainStatsView : public StateAwareCustomView<JSGainGUIState>, public IFrameClient
 {
 public:
   // Constructor
   explicit JSGainStatsView(const CRect &iSize) : StateAwareCustomView<JSGainGUIState>(iSize)
   {}
 
+  // Destructor (no more frames)
+  ~JSGainStatsView() override;
+
   //------------------------------------------------------------------------
   // tied to custom attribute "text-color" (see Creator below)
   //------------------------------------------------------------------------
@@ -51,9 +55,14 @@ public:
   void draw(CDrawContext *iContext) override;
 
   //------------------------------------------------------------------------
-  // Callback (from ITimerCallback) when the timer fires
+  // The stats changed => the text will be recomputed at the next frame
   //------------------------------------------------------------------------
-  void onTimer(Timer *timer) override;
+  void onParameterChange(ParamID iParamID) override;
+
+  //------------------------------------------------------------------------
+  // Callback (from IFrameClient) called by the frame scheduler
+  //------------------------------------------------------------------------
+  void onFrame() override;
 
   CLASS_METHODS_NOCOPY(JSGainStatsView, CustomView)
 
@@ -64,16 +73,41 @@ protected:
   //------------------------------------------------------------------------
   // Using a Jmb param to get to the stats (see registerParameters)
   // GUIJmbParam is a wrapper class (similar to the other ones) which gives
-  // access to the param and make it behave like the underlying type (Stats
-  // in this case).
+  // access to the param and make it behave like the underlying type
+  // (StatsBatch in this case).
   //------------------------------------------------------------------------
-  GUIJmbParam<Stats> fStatsParam{};
+  GUIJmbParam<StatsBatch> fStatsParam{};
 
   //------------------------------------------------------------------------
-  // Using the Jamba AutoReleaseTimer class which takes care of releasing
-  // the timer automatically (RAII concept)
+  // The text is recomputed when the stats change or every
+  // kRefreshIntervalMs (the duration keeps on changing) and the view is
+  // redrawn only when it is different from the one displayed
+  //------------------------------------------------------------------------
+  static constexpr int64 kRefreshIntervalMs = 200;
+  std::string computeText() const;
+  std::string fText{};
+  Stats fLatestStats{};
+  bool fStatsChanged{true};
+  int64 fNextRefreshTime{0};
+
   //------------------------------------------------------------------------
-  std::unique_ptr<AutoReleaseTimer> fTimer{};
+  // Send time of the oldest batch received but not drawn yet (0 if none)
+  // so that draw can record the RT -> screen latency (see
+  // JSGainGUIState::fStatsMessaging)
+  //------------------------------------------------------------------------
+  int64 fUndrawnSendTimeNanos{0};
+
+  //------------------------------------------------------------------------
+  // Handles a batch whether it comes from the param (message) or from the
+  // slot shared with the processor (same process, see onFrame)
+  //------------------------------------------------------------------------
+  void onStatsReceived(StatsBatch const &iBatch);
+
+  // last sequence read from JSGainSharedInstance::fStats
+  uint32_t fSharedStatsSequence{0};
+
+  // number of frames without new stats in the shared slot (see IFrameScheduler::poll)
+  int32 fIdleFrames{0};
 
 public:
   //------------------------------------------------------------------------
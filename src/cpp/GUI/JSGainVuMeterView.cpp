@@ -0,0 +1,108 @@
+//------------------------------------------------------------------------------------------------------------
+// Implementation of the VU meter view. The value (VuPPM) may change at every process call but only the
+// number of lit LEDs is displayed: it is computed once per frame and, when it changes, the rectangle between
+// the previous and the new level is the only area invalidated. When the value drops, the displayed level
+// decays by fDecreaseStepValue per frame (frames keep being requested until it reaches the value).
+//------------------------------------------------------------------------------------------------------------
+#include "JSGainVuMeterView.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace pongasoft::VST::JSGain::GUI {
+
+//------------------------------------------------------------------------
+// JSGainVuMeterView::registerParameters
+//------------------------------------------------------------------------
+void JSGainVuMeterView::registerParameters()
+{
+  fVuPPM = registerRawVstParam(fParams->fVuPPMParam->fParamID);
+  fState->fFrameScheduler->requestFrame(this);
+}
+
+//------------------------------------------------------------------------
+// JSGainVuMeterView::~JSGainVuMeterView
+//------------------------------------------------------------------------
+JSGainVuMeterView::~JSGainVuMeterView()
+{
+  if(fState)
+    fState->fFrameScheduler->cancelFrame(this);
+}
+
+//------------------------------------------------------------------------
+// JSGainVuMeterView::onParameterChange
+//------------------------------------------------------------------------
+void JSGainVuMeterView::onParameterChange(ParamID iParamID)
+{
+  // not calling CustomView::onParameterChange which would mark the whole view dirty right away
+  fState->fFrameScheduler->requestFrame(this);
+}
+
+//------------------------------------------------------------------------
+// JSGainVuMeterView::computeNumLitLed
+//------------------------------------------------------------------------
+int32 JSGainVuMeterView::computeNumLitLed(double iValue) const
+{
+  return static_cast<int32>(std::round(iValue * fNumLed));
+}
+
+//------------------------------------------------------------------------
+// JSGainVuMeterView::getLitTop
+//------------------------------------------------------------------------
+CCoord JSGainVuMeterView::getLitTop(int32 iNumLitLed) const
+{
+  auto const &size = getViewSize();
+  return size.bottom - std::floor(size.getHeight() * iNumLitLed / fNumLed);
+}
+
+//------------------------------------------------------------------------
+// JSGainVuMeterView::onFrame
+//------------------------------------------------------------------------
+void JSGainVuMeterView::onFrame()
+{
+  auto value = std::clamp(static_cast<double>(fVuPPM.getValue()), 0.0, 1.0);
+
+  // same decay as CVuMeter: the level falls by at most fDecreaseStepValue per frame
+  fDisplayedValue = std::max(value, fDisplayedValue - fDecreaseStepValue);
+  if(fDisplayedValue > value)
+    fState->fFrameScheduler->requestFrame(this);
+
+  auto numLitLed = computeNumLitLed(fDisplayedValue);
+  if(numLitLed == fNumLitLed)
+    return;
+
+  // only the LEDs between the previous level and the new one need to be redrawn
+  auto const &size = getViewSize();
+  CRect dirty{size.left, getLitTop(std::max(numLitLed, fNumLitLed)), size.right, getLitTop(std::min(numLitLed, fNumLitLed))};
+
+  fNumLitLed = numLitLed;
+  invalidRect(dirty);
+}
+
+//------------------------------------------------------------------------
+// JSGainVuMeterView::draw
+//------------------------------------------------------------------------
+void JSGainVuMeterView::draw(CDrawContext *iContext)
+{
+  // the parent view takes care of drawing the background
+  CustomView::draw(iContext);
+
+  auto const &size = getViewSize();
+
+  // Note that the draw context is clipped to the invalidated area so drawing everything is cheap
+  if(fOffBitmap)
+    fOffBitmap->draw(iContext, size);
+
+  if(fOnBitmap && fNumLitLed > 0)
+  {
+    auto top = getLitTop(fNumLitLed);
+    fOnBitmap->draw(iContext, CRect{size.left, top, size.right, size.bottom}, CPoint{0, top - size.top});
+  }
+}
+
+//------------------------------------------------------------------------
+// This makes the JSGainVuMeterView class available to the editor
+//------------------------------------------------------------------------
+JSGainVuMeterView::Creator __gJSGainVuMeterCreator("JSGain::VuMeter", "JSGain - VU Meter");
+
+}
@@ -0,0 +1,108 @@
+//------------------------------------------------------------------------------------------------------------
+// This file defines a (vertical) VU meter which replaces CVuMeter: CVuMeter redraws itself entirely every time
+// the value changes (so at the rate the host calls process). This view is redrawn at the pace of the frame
+// scheduler, only when the number of lit LEDs changes, and only the LEDs which changed are invalidated. Like
+// CVuMeter, the level falls by at most "decrease-step-value" per frame.
+//------------------------------------------------------------------------------------------------------------
+#pragma once
+
+#include <pongasoft/VST/GUI/Views/CustomView.h>
+#include "../JSGainPlugin.h"
+
+#include <algorithm>
+
+namespace pongasoft::VST::JSGain::GUI {
+
+using namespace pongasoft::VST::GUI::Views;
+using namespace VSTGUI;
+
+class JSGainVuMeterView : public StateAwareCustomView<JSGainGUIState>, public IFrameClient
+{
+public:
+  // Constructor
+  explicit JSGainVuMeterView(const CRect &iSize) : StateAwareCustomView<JSGainGUIState>(iSize)
+  {}
+
+  // Destructor (no more frames)
+  ~JSGainVuMeterView() override;
+
+  //------------------------------------------------------------------------
+  // tied to custom attribute "on-bitmap" (see Creator below)
+  //------------------------------------------------------------------------
+  BitmapPtr getOnBitmap() const { return fOnBitmap; }
+  void setOnBitmap(BitmapPtr iBitmap) { fOnBitmap = iBitmap; }
+
+  //------------------------------------------------------------------------
+  // tied to custom attribute "off-bitmap" (see Creator below)
+  //------------------------------------------------------------------------
+  BitmapPtr getOffBitmap() const { return fOffBitmap; }
+  void setOffBitmap(BitmapPtr iBitmap) { fOffBitmap = iBitmap; }
+
+  //------------------------------------------------------------------------
+  // tied to custom attribute "num-led" (see Creator below)
+  //------------------------------------------------------------------------
+  int32 getNumLed() const { return fNumLed; }
+  void setNumLed(int32 iNumLed) { fNumLed = std::max(iNumLed, 1); }
+
+  //------------------------------------------------------------------------
+  // tied to custom attribute "decrease-step-value" (see Creator below)
+  //------------------------------------------------------------------------
+  double getDecreaseStepValue() const { return fDecreaseStepValue; }
+  void setDecreaseStepValue(double iValue) { fDecreaseStepValue = std::max(iValue, 0.0); }
+
+  // registers the VuPPM param
+  void registerParameters() override;
+
+  // the value changed => requests a frame
+  void onParameterChange(ParamID iParamID) override;
+
+  // applies the decay and invalidates the LEDs which changed since the previous frame (IFrameClient)
+  void onFrame() override;
+
+  // draws the off bitmap and the lit part of the on bitmap
+  void draw(CDrawContext *iContext) override;
+
+  CLASS_METHODS_NOCOPY(JSGainVuMeterView, CustomView)
+
+protected:
+  // number of lit LEDs for the (displayed) value
+  int32 computeNumLitLed(double iValue) const;
+
+  // top of the iNumLitLed (lit) LEDs (the LEDs are lit from the bottom)
+  CCoord getLitTop(int32 iNumLitLed) const;
+
+  BitmapSPtr fOnBitmap{nullptr};
+  BitmapSPtr fOffBitmap{nullptr};
+  int32 fNumLed{100};
+  double fDecreaseStepValue{0.1};
+
+  // what is currently displayed
+  double fDisplayedValue{0};
+  int32 fNumLitLed{0};
+
+  GUIRawVstParam fVuPPM{};
+
+public:
+  class Creator : public CustomViewCreator<JSGainVuMeterView, StateAwareCustomView<JSGainGUIState>>
+  {
+  public:
+    explicit Creator(char const *iViewName = nullptr, char const *iDisplayName = nullptr) noexcept :
+      CustomViewCreator(iViewName, iDisplayName)
+    {
+      registerBitmapAttribute("on-bitmap",
+                              &JSGainVuMeterView::getOnBitmap,
+                              &JSGainVuMeterView::setOnBitmap);
+      registerBitmapAttribute("off-bitmap",
+                              &JSGainVuMeterView::getOffBitmap,
+                              &JSGainVuMeterView::setOffBitmap);
+      registerIntAttribute("num-led",
+                           &JSGainVuMeterView::getNumLed,
+                           &JSGainVuMeterView::setNumLed);
+      registerDoubleAttribute("decrease-step-value",
+                              &JSGainVuMeterView::getDecreaseStepValue,
+                              &JSGainVuMeterView::setDecreaseStepValue);
+    }
+  };
+};
+
+}
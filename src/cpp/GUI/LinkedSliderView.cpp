@@ -4,6 +4,7 @@
 // that you can use as many params as you want
 //------------------------------------------------------------------------
 #include "LinkedSliderView.h"
+#include "../Trace/Trace.h"
 
 namespace pongasoft::VST::JSGain::GUI {
 
@@ -67,6 +68,8 @@ void LinkedSliderView::registerParameters()
 //------------------------------------------------------------------------
 void LinkedSliderView::onParameterChange(ParamID iParamID)
 {
+  JSGAIN_TRACE_ZONE("LinkedSliderView::onParameterChange");
+
 //------------------------------------------------------------------------
 // EDITOR_MODE is a define that exists while in debug/development mode
 // Since while in the editor you can freely change values it is possible
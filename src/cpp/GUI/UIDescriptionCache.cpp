@@ -0,0 +1,106 @@
+//------------------------------------------------------------------------------------------------------------
+// Implementation of the UI description cache. Editors are created on the UI thread but controllers may be
+// created/destroyed on other threads (depends on the host) so the cache is protected by a mutex (it is only
+// accessed when the first editor of a controller is created). The descriptions of the editors are parsed
+// outside of the lock.
+//------------------------------------------------------------------------------------------------------------
+#include "UIDescriptionCache.h"
+
+#include <pongasoft/logging/logging.h>
+#include <vstgui/lib/cstream.h>
+#include <vstgui/uidescription/xmlparser.h>
+
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace pongasoft::VST::JSGain::GUI {
+
+//------------------------------------------------------------------------
+// UIDescriptionCache::acquireResources
+//------------------------------------------------------------------------
+std::shared_ptr<UIDescriptionCache::Resources const> UIDescriptionCache::acquireResources(char const *iXmlFile,
+                                                                                         ContentLoader const &iLoader)
+{
+  static std::mutex sMutex{};
+  static std::map<std::string, std::weak_ptr<Resources const>> sResources{};
+
+  std::lock_guard<std::mutex> lock{sMutex};
+
+  auto &entry = sResources[iXmlFile];
+  auto resources = entry.lock();
+  if(!resources)
+  {
+    auto loaded = std::make_shared<Resources>();
+    if(!iLoader(iXmlFile, loaded->fContent))
+    {
+      DLOG_F(WARNING, "UIDescriptionCache - cannot read %s", iXmlFile);
+      return nullptr;
+    }
+
+    loaded->fDescription = parse(loaded->fContent);
+    if(!loaded->fDescription)
+    {
+      DLOG_F(WARNING, "UIDescriptionCache - cannot parse %s", iXmlFile);
+      return nullptr;
+    }
+
+    resources = std::move(loaded);
+    entry = resources;
+  }
+  return resources;
+}
+
+//------------------------------------------------------------------------
+// UIDescriptionCache::createDescription
+//------------------------------------------------------------------------
+SharedPointer<UIDescription> UIDescriptionCache::createDescription(std::shared_ptr<Resources const> const &iResources)
+{
+  if(!iResources)
+    return nullptr;
+
+  // parsed from memory (the file is never read again)
+  auto description = parse(iResources->fContent);
+  if(!description)
+  {
+    DLOG_F(WARNING, "UIDescriptionCache - cannot parse description");
+    return nullptr;
+  }
+
+  // the bitmaps, colors, fonts and gradients are looked up in the shared description (never decoded again)
+  description->setSharedResources(iResources->fDescription);
+
+  return description;
+}
+
+//------------------------------------------------------------------------
+// UIDescriptionCache::readResource
+//------------------------------------------------------------------------
+bool UIDescriptionCache::readResource(char const *iXmlFile, std::string &oContent)
+{
+  CResourceInputStream stream{};
+  if(!stream.open(CResourceDescription{iXmlFile}))
+    return false;
+
+  oContent.clear();
+  char buffer[4096];
+  uint32_t size;
+  while((size = stream.readRaw(buffer, sizeof(buffer))) != kStreamIOError && size > 0)
+    oContent.append(buffer, size);
+
+  return !oContent.empty();
+}
+
+//------------------------------------------------------------------------
+// UIDescriptionCache::parse
+//------------------------------------------------------------------------
+SharedPointer<UIDescription> UIDescriptionCache::parse(std::string const &iContent)
+{
+  Xml::MemoryContentProvider provider{iContent.data(), static_cast<uint32_t>(iContent.size())};
+  auto description = makeOwned<UIDescription>(&provider);
+  if(!description->parse())
+    return nullptr;
+  return description;
+}
+
+}
@@ -0,0 +1,62 @@
+//------------------------------------------------------------------------------------------------------------
+// This file defines the (process wide) cache of the UI description resources. By default every editor parses
+// JSGain.uidesc again and decodes all the bitmaps it uses (they are cached in the description): opening the
+// editors of several instances one after the other (flipping through tracks) repeats this work every time.
+//
+// The description itself cannot be shared: VST3Editor installs itself as the controller of its description
+// so each editor must get its own (and VSTGUI has no way to copy a parsed description). Instead, the content
+// of the file is read once and kept in memory, and the bitmaps, colors, fonts and gradients are looked up in a
+// description parsed once and shared by all the controllers (UIDescription::setSharedResources): they stay
+// alive as long as at least one controller holds them, so only the first editor reads the file and decodes
+// the bitmaps. The description of each editor is parsed from the in-memory content and only provides the
+// templates.
+//------------------------------------------------------------------------------------------------------------
+#pragma once
+
+#include <vstgui/uidescription/uidescription.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace pongasoft::VST::JSGain::GUI {
+
+using namespace VSTGUI;
+
+class UIDescriptionCache
+{
+public:
+  // what is shared by all the editors (for one description file)
+  struct Resources
+  {
+    std::string fContent{};                       // the content of the file
+    SharedPointer<UIDescription> fDescription{};  // parsed from fContent, only used for its resources
+  };
+
+  // reads the content of the description file (false when it fails)
+  using ContentLoader = std::function<bool(char const *iXmlFile, std::string &oContent)>;
+
+  //------------------------------------------------------------------------
+  // acquireResources - the resources shared by all the callers. They are
+  // loaded on demand with iLoader and destroyed when the last caller
+  // releases them. Returns nullptr if the description cannot be loaded.
+  //------------------------------------------------------------------------
+  static std::shared_ptr<Resources const> acquireResources(char const *iXmlFile,
+                                                           ContentLoader const &iLoader = readResource);
+
+  //------------------------------------------------------------------------
+  // createDescription - a new description (for one editor) parsed from the
+  // content in memory and which takes its resources from iResources (see
+  // acquireResources). Returns nullptr if the description cannot be parsed.
+  //------------------------------------------------------------------------
+  static SharedPointer<UIDescription> createDescription(std::shared_ptr<Resources const> const &iResources);
+
+  // readResource - reads the description from the plugin resources (like VST3Editor does)
+  static bool readResource(char const *iXmlFile, std::string &oContent);
+
+private:
+  // parses a description from iContent (nullptr when it fails)
+  static SharedPointer<UIDescription> parse(std::string const &iContent);
+};
+
+}
@@ -50,9 +50,23 @@ enum EJSGainParamID : Steinberg::Vst::ParamID
 
   kInputText = 2030,
 
+  kRouting = 2040,
+
+  kModulationMode = 2050,
+
   // 3000s represent the Jmb (Jamba) parameters
   kStats = 3000,
   kUIMessage = 3010,
+  kRTStateSnapshot = 3020,
+  kLevelHistogram = 3030,
+  kInstanceToken = 3040,
 };
 
+//------------------------------------------------------------------------
+// IDs of the messages which are exchanged between the GUI and the RT
+// outside of the Jamba (Jmb param) messaging.
+//------------------------------------------------------------------------
+constexpr auto kUICommandsMessageID = "JSGain::UICommands";
+constexpr auto kUICommandsAttrID = "Commands";
+
 } // namespace pongasoft
@@ -0,0 +1,165 @@
+//------------------------------------------------------------------------------------------------------------
+// This file defines the instrumentation of the RT <-> GUI messaging: every message (StatsBatch, UIMessage,
+// UICommand) is stamped with the monotonic time at which it was sent and the receiving side records how long
+// it took to get there (and, for the stats, to be drawn) in a LatencyHistogram.
+//
+// The clock is std::chrono::steady_clock which is system wide on the supported platforms (CLOCK_MONOTONIC on
+// Linux, mach_absolute_time on macOS, QueryPerformanceCounter on Windows) so the stamps remain comparable
+// even if the host runs the processor and the controller in different processes. Reading it does not make a
+// syscall so it is ok to call it from the RT.
+//------------------------------------------------------------------------------------------------------------
+#pragma once
+
+#include <pluginterfaces/base/ftypes.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+
+namespace pongasoft::VST::JSGain {
+
+using namespace Steinberg;
+
+//------------------------------------------------------------------------
+// getMonotonicTimeNanos - the clock used to stamp the messages
+//------------------------------------------------------------------------
+inline int64 getMonotonicTimeNanos()
+{
+  using namespace std::chrono;
+  return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+//------------------------------------------------------------------------
+// LatencyHistogram - distribution of latencies with one bin per power of 2
+// (in microseconds):
+//   bin 0             : < 2us
+//   bin n             : [2^n, 2^(n+1)) us
+//   bin kNumBins - 1  : everything above (>= ~4s)
+// Fixed size and record is a few integer operations: safe to use in the
+// RT (and to copy in a message, see RTStateSnapshot).
+//------------------------------------------------------------------------
+struct LatencyHistogram
+{
+  static constexpr int32 kNumBins = 23;
+
+  int64 fCount{0};
+  int64 fTotalNanos{0};
+  int64 fMaxNanos{0};
+  uint32 fCounts[kNumBins]{};
+
+  // getBin - bin of a latency (negative latencies, which a clock cannot produce, end up in bin 0)
+  static inline int32 getBin(int64 iNanos)
+  {
+    auto micros = static_cast<uint64>(std::max<int64>(iNanos, 0)) / 1000;
+    int32 bin = 0;
+    while(micros > 1 && bin < kNumBins - 1)
+    {
+      micros >>= 1;
+      bin++;
+    }
+    return bin;
+  }
+
+  // getBinUpperBound - upper bound (exclusive) of the bin in nanoseconds
+  static inline int64 getBinUpperBound(int32 iBin)
+  {
+    return (static_cast<int64>(1) << (iBin + 1)) * 1000;
+  }
+
+  inline void record(int64 iNanos)
+  {
+    iNanos = std::max<int64>(iNanos, 0);
+    fCounts[getBin(iNanos)]++;
+    fCount++;
+    fTotalNanos += iNanos;
+    fMaxNanos = std::max(fMaxNanos, iNanos);
+  }
+
+  // records the time elapsed since iSendTimeNanos (ignored if the message was not stamped)
+  inline void recordSince(int64 iSendTimeNanos, int64 iNowNanos)
+  {
+    if(iSendTimeNanos > 0)
+      record(iNowNanos - iSendTimeNanos);
+  }
+
+  inline int64 getMeanNanos() const { return fCount > 0 ? fTotalNanos / fCount : 0; }
+
+  //------------------------------------------------------------------------
+  // getPercentileNanos - upper bound of the bin containing the percentile
+  // (iPercentile in [0, 1]), capped by the max which is exact
+  //------------------------------------------------------------------------
+  inline int64 getPercentileNanos(double iPercentile) const
+  {
+    if(fCount == 0)
+      return 0;
+
+    auto rank = static_cast<int64>(std::clamp(iPercentile, 0.0, 1.0) * static_cast<double>(fCount - 1)) + 1;
+    int64 count = 0;
+    for(int32 i = 0; i < kNumBins; i++)
+    {
+      count += fCounts[i];
+      if(count >= rank)
+        return std::min(getBinUpperBound(i), fMaxNanos);
+    }
+    return fMaxNanos;
+  }
+
+  inline void clear()
+  {
+    fCount = 0;
+    fTotalNanos = 0;
+    fMaxNanos = 0;
+    std::fill(std::begin(fCounts), std::end(fCounts), 0);
+  }
+};
+
+//------------------------------------------------------------------------
+// MessagingStats - what the receiving side measures for one direction:
+// the latency (send -> receive and, when the message ends up being
+// displayed, send -> draw) and the throughput.
+//------------------------------------------------------------------------
+struct MessagingStats
+{
+  LatencyHistogram fReceiveLatency{};
+  LatencyHistogram fDrawLatency{};
+  int64 fMessageCount{0};
+  int64 fItemCount{0}; // a message may carry several items (ex: the snapshots of a StatsBatch)
+  int64 fFirstReceiveTimeNanos{0};
+  int64 fFirstItemCount{0}; // items of the first message (the rates measure what came after it)
+  int64 fLastReceiveTimeNanos{0};
+
+  inline void onReceive(int64 iSendTimeNanos, int32 iItemCount, int64 iNowNanos)
+  {
+    fReceiveLatency.recordSince(iSendTimeNanos, iNowNanos);
+    if(fMessageCount == 0)
+    {
+      fFirstReceiveTimeNanos = iNowNanos;
+      fFirstItemCount = iItemCount;
+    }
+    fLastReceiveTimeNanos = iNowNanos;
+    fMessageCount++;
+    fItemCount += iItemCount;
+  }
+
+  inline void onDraw(int64 iSendTimeNanos, int64 iNowNanos)
+  {
+    fDrawLatency.recordSince(iSendTimeNanos, iNowNanos);
+  }
+
+  // getMessagesPerSecond - average rate between the first and the last message received
+  inline double getMessagesPerSecond() const { return getRate(fMessageCount - 1); }
+
+  // getItemsPerSecond - same for the items
+  inline double getItemsPerSecond() const { return getRate(fItemCount - fFirstItemCount); }
+
+  inline void clear() { *this = MessagingStats{}; }
+
+private:
+  inline double getRate(int64 iCount) const
+  {
+    auto elapsed = fLastReceiveTimeNanos - fFirstReceiveTimeNanos;
+    return elapsed > 0 ? static_cast<double>(iCount) * 1e9 / static_cast<double>(elapsed) : 0;
+  }
+};
+
+}
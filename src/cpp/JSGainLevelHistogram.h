@@ -0,0 +1,231 @@
+//------------------------------------------------------------------------------------------------------------
+// This file defines the distribution of the (output) sample levels computed by the RT and sent to the GUI
+// (LevelHistogram) as well as the RT side accumulator.
+//
+// Instead of computing the level in dB (log) for every sample, the bin is derived directly from the bits of
+// the IEEE-754 representation of the sample: the exponent gives the octave (1 octave ~ 6dB) and the top
+// bit of the mantissa splits it in 2 (~3dB per bin). The bins are (from loudest to quietest):
+//   bin 0                  : |sample| >= 1.0 (>= 0dBFS, clipping)
+//   bin 1                  : [0.75, 1.0)
+//   bin 2                  : [0.5, 0.75)
+//   bin 2n-1 / 2n          : [0.75 * 2^-(n-1), 2^-(n-1)) / [2^-n, 0.75 * 2^-(n-1))
+//   bin kNumBins - 1       : everything below (including silence)
+//------------------------------------------------------------------------------------------------------------
+#pragma once
+
+#include "JSGainModel.h"
+
+#include <cmath>
+#include <cstring>
+#include <iterator>
+
+namespace pongasoft::VST::JSGain {
+
+//------------------------------------------------------------------------
+// LevelHistogram - number of samples per level bin (see above) since the
+// previous histogram was sent
+//------------------------------------------------------------------------
+struct LevelHistogram
+{
+  // 2 bins per octave => ~120dB
+  static constexpr int32 kNumBins = 40;
+
+  int64 fSampleCount{0};
+  uint32 fCounts[kNumBins]{};
+
+  inline void clear()
+  {
+    fSampleCount = 0;
+    std::fill(std::begin(fCounts), std::end(fCounts), 0);
+  }
+
+  //------------------------------------------------------------------------
+  // getBinLowerBound - lower bound (sample value) of the bin (0 for the
+  // last one which includes silence)
+  //------------------------------------------------------------------------
+  static inline double getBinLowerBound(int32 iBin)
+  {
+    if(iBin <= 0)
+      return 1.0;
+    if(iBin >= kNumBins - 1)
+      return 0;
+    auto octave = (iBin + 1) / 2;
+    return std::ldexp((iBin & 1) ? 1.5 : 1.0, -octave);
+  }
+};
+
+//------------------------------------------------------------------------
+// LevelHistogramBits - where to find the exponent (+ top mantissa bit)
+// for each sample type
+//------------------------------------------------------------------------
+template<typename SampleType>
+struct LevelHistogramBits;
+
+template<>
+struct LevelHistogramBits<Sample32>
+{
+  using Bits = uint32;
+  static constexpr int kShift = 22;           // 8 bits exponent + 1 bit mantissa (23 bits)
+  static constexpr Bits kMask = 0x1ff;        // removes the sign
+  static constexpr int32 kUnityKey = 127 << 1; // key of 1.0 (biased exponent, mantissa bit 0)
+};
+
+template<>
+struct LevelHistogramBits<Sample64>
+{
+  using Bits = uint64;
+  static constexpr int kShift = 51;            // 11 bits exponent + 1 bit mantissa (52 bits)
+  static constexpr Bits kMask = 0xfff;         // removes the sign
+  static constexpr int32 kUnityKey = 1023 << 1; // key of 1.0 (biased exponent, mantissa bit 0)
+};
+
+//------------------------------------------------------------------------
+// LevelHistogramAccumulator - used by the RT (no memory allocation). It is
+// also a reducer (see RT/Reducers.h) so that the processor fills it in the
+// same loop as the gain (add/addMono/endBlock/reset).
+// The counters are split in kNumLanes interleaved copies so that
+// consecutive samples falling in the same bin (very common) do not wait on
+// each other (merged in mergeInto).
+//------------------------------------------------------------------------
+class LevelHistogramAccumulator
+{
+public:
+  //------------------------------------------------------------------------
+  // accumulate - adds the samples to the counters. The work is done in 2
+  // passes per chunk: computing the bins (no dependency between samples
+  // so the compiler can vectorize it) then incrementing the counters.
+  //------------------------------------------------------------------------
+  template<typename SampleType>
+  void accumulate(SampleType const *iSamples, int32 iNumSamples)
+  {
+    int32 bins[kChunkSize];
+
+    while(iNumSamples > 0)
+    {
+      auto numSamples = std::min(iNumSamples, kChunkSize);
+
+      for(int32 i = 0; i < numSamples; i++)
+        bins[i] = getBin(iSamples[i]);
+
+      for(int32 i = 0; i < numSamples; i++)
+        fCounts[i & (kNumLanes - 1)][bins[i]]++;
+
+      fSampleCount += numSamples;
+      iSamples += numSamples;
+      iNumSamples -= numSamples;
+    }
+  }
+
+  //------------------------------------------------------------------------
+  // Reducer interface: 2 samples per frame in stereo, 1 in mono
+  //------------------------------------------------------------------------
+  template<typename SampleType>
+  inline void add(int32 iLane, int32 /* iFrame */, SampleType iLeft, SampleType iRight)
+  {
+    auto &counts = fCounts[iLane & (kNumLanes - 1)];
+    counts[getBin(iLeft)]++;
+    counts[getBin(iRight)]++;
+    fSampleCount += 2;
+  }
+
+  template<typename SampleType>
+  inline void addMono(int32 iLane, int32 /* iFrame */, SampleType iSample)
+  {
+    fCounts[iLane & (kNumLanes - 1)][getBin(iSample)]++;
+    fSampleCount++;
+  }
+
+  inline void endBlock(int32 /* iNumFrames */) {}
+
+  inline void reset() { clear(); }
+
+  inline int64 getSampleCount() const { return fSampleCount; }
+
+  // mergeInto - copies the counters into oHistogram
+  void mergeInto(LevelHistogram &oHistogram) const
+  {
+    oHistogram.fSampleCount = fSampleCount;
+    for(int32 bin = 0; bin < LevelHistogram::kNumBins; bin++)
+    {
+      uint32 count = 0;
+      for(auto const &lane: fCounts)
+        count += lane[bin];
+      oHistogram.fCounts[bin] = count;
+    }
+  }
+
+  void clear()
+  {
+    fSampleCount = 0;
+    for(auto &lane: fCounts)
+      std::fill(std::begin(lane), std::end(lane), 0);
+  }
+
+private:
+  // getBin - the bin of the sample computed from its bits (see top of the file)
+  template<typename SampleType>
+  static inline int32 getBin(SampleType iSample)
+  {
+    using Traits = LevelHistogramBits<SampleType>;
+    typename Traits::Bits bits;
+    std::memcpy(&bits, &iSample, sizeof(bits));
+    auto bin = Traits::kUnityKey - static_cast<int32>((bits >> Traits::kShift) & Traits::kMask);
+    bin = bin < 0 ? 0 : bin;
+    return bin > LevelHistogram::kNumBins - 1 ? LevelHistogram::kNumBins - 1 : bin;
+  }
+
+  static constexpr int32 kChunkSize = 64;
+  static constexpr int32 kNumLanes = 4; // must be a power of 2
+
+  int64 fSampleCount{0};
+  uint32 fCounts[kNumLanes][LevelHistogram::kNumBins]{};
+};
+
+//------------------------------------------------------------------------
+// LevelHistogramParamSerializer - used in JSGainPlugin.h to send the
+// histogram from the RT to the GUI
+//------------------------------------------------------------------------
+class LevelHistogramParamSerializer : public IParamSerializer<LevelHistogram>
+{
+public:
+  // a (corrupted) stream with more bins than this is rejected instead of being read
+  static constexpr int32 kMaxNumBins = 16 * LevelHistogram::kNumBins;
+
+  // deserialize / readFromStream
+  inline tresult readFromStream(IBStreamer &iStreamer, ParamType &oValue) const override
+  {
+    int32 numBins{};
+    tresult res = IBStreamHelper::readInt64(iStreamer, oValue.fSampleCount);
+    res |= IBStreamHelper::readInt32(iStreamer, numBins);
+    if(res != kResultOk || numBins < 0 || numBins > kMaxNumBins)
+      return kResultFalse;
+
+    // handles a different number of bins (the extra ones are added to the last one)
+    std::fill(std::begin(oValue.fCounts), std::end(oValue.fCounts), 0);
+    for(int32 i = 0; i < numBins && res == kResultOk; i++)
+    {
+      int32 count{};
+      res |= IBStreamHelper::readInt32(iStreamer, count);
+      oValue.fCounts[std::min(i, LevelHistogram::kNumBins - 1)] += static_cast<uint32>(count);
+    }
+    return res;
+  }
+
+  // serialize / writeToStream
+  inline tresult writeToStream(const ParamType &iValue, IBStreamer &oStreamer) const override
+  {
+    oStreamer.writeInt64(iValue.fSampleCount);
+    oStreamer.writeInt32(LevelHistogram::kNumBins);
+    for(auto count: iValue.fCounts)
+      oStreamer.writeInt32(static_cast<int32>(count));
+    return kResultOk;
+  }
+
+  // writeToStream (display)
+  void writeToStream(ParamType const &iValue, std::ostream &oStream) const override
+  {
+    oStream << iValue.fSampleCount << " samples";
+  }
+};
+
+}
@@ -0,0 +1,55 @@
+#include "JSGainMeterRegistry.h"
+
+namespace pongasoft::VST::JSGain {
+
+namespace {
+
+// 256 x 64 bytes = 16KB for the whole process
+MeterSlot gMeterSlots[MeterRegistry::kMaxSlots]{};
+
+}
+
+//------------------------------------------------------------------------
+// MeterRegistry::claim
+//------------------------------------------------------------------------
+MeterSlot *MeterRegistry::claim(InstanceToken iToken)
+{
+  for(auto &slot: gMeterSlots)
+  {
+    bool claimed = false;
+    if(slot.fClaimed.load(std::memory_order_relaxed) ||
+       !slot.fClaimed.compare_exchange_strong(claimed, true, std::memory_order_acq_rel))
+      continue;
+
+    slot.fPeak.store(0, std::memory_order_relaxed);
+    slot.fRMS.store(0, std::memory_order_relaxed);
+    slot.fClipCount.store(0, std::memory_order_relaxed);
+    slot.fUpdateCount.store(slot.fUpdateCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    slot.fInstanceId.store(iToken.fId, std::memory_order_release);
+    return &slot;
+  }
+
+  return nullptr;
+}
+
+//------------------------------------------------------------------------
+// MeterRegistry::release
+//------------------------------------------------------------------------
+void MeterRegistry::release(MeterSlot *iSlot)
+{
+  if(iSlot == nullptr)
+    return;
+
+  iSlot->fInstanceId.store(0, std::memory_order_relaxed);
+  iSlot->fClaimed.store(false, std::memory_order_release);
+}
+
+//------------------------------------------------------------------------
+// MeterRegistry::getSlots
+//------------------------------------------------------------------------
+MeterSlot const *MeterRegistry::getSlots()
+{
+  return gMeterSlots;
+}
+
+}
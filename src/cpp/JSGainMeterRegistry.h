@@ -0,0 +1,72 @@
+//------------------------------------------------------------------------------------------------------------
+// This file defines the (process wide) metering registry: every processor claims a slot (outside the RT) and
+// the RT publishes its levels into it with plain (relaxed) atomic stores. Any editor can then display all the
+// instances (mixer overview) by polling the slots at frame rate: no messaging, no lock, no allocation.
+//
+// Each slot is aligned on (and fills) a cache line so that instances running on different threads (hosts
+// process tracks in parallel) never write to the same cache line.
+//------------------------------------------------------------------------------------------------------------
+#pragma once
+
+#include "JSGainSharedInstance.h"
+#include "Concurrent/CacheLine.h"
+
+#include <atomic>
+
+namespace pongasoft::VST::JSGain {
+
+//------------------------------------------------------------------------
+// MeterSlot - written by the RT of the instance which claimed it (single
+// writer), read by any GUI thread. The values are published every metrics
+// interval (see JSGainProcessor::addMetricsStats).
+//------------------------------------------------------------------------
+struct alignas(Concurrent::kCacheLineSize) MeterSlot
+{
+  std::atomic<bool> fClaimed{false};
+  std::atomic<int64> fInstanceId{0};    // id (InstanceToken::fId) of the instance which claimed the slot
+  std::atomic<float> fPeak{0};          // peak during the last interval (sample)
+  std::atomic<float> fRMS{0};           // loudness (rms) during the last interval (sample)
+  std::atomic<uint32> fClipCount{0};    // number of clipped frames since the last reset (max)
+  std::atomic<uint32> fUpdateCount{0};  // incremented at every publish (the GUI redraws only when it changes)
+
+  // publish - RT only (single writer => no read-modify-write needed)
+  inline void publish(float iPeak, float iRMS, uint32 iNewClipCount)
+  {
+    fPeak.store(iPeak, std::memory_order_relaxed);
+    fRMS.store(iRMS, std::memory_order_relaxed);
+    if(iNewClipCount > 0)
+      fClipCount.store(fClipCount.load(std::memory_order_relaxed) + iNewClipCount, std::memory_order_relaxed);
+    fUpdateCount.store(fUpdateCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+
+  // resetClipCount - RT only
+  inline void resetClipCount()
+  {
+    fClipCount.store(0, std::memory_order_relaxed);
+    fUpdateCount.store(fUpdateCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+};
+
+static_assert(sizeof(MeterSlot) == Concurrent::kCacheLineSize, "a slot must fill exactly one cache line");
+
+//------------------------------------------------------------------------
+// MeterRegistry - the slots are preallocated (static storage) so reading
+// them never requires a lock. claim and release are thread safe but must
+// NOT be called from the RT.
+//------------------------------------------------------------------------
+class MeterRegistry
+{
+public:
+  static constexpr int32 kMaxSlots = 256;
+
+  // claims a free slot for the instance (nullptr when they are all in use)
+  static MeterSlot *claim(InstanceToken iToken);
+
+  // makes the slot available again
+  static void release(MeterSlot *iSlot);
+
+  // all the slots (kMaxSlots of them, check fClaimed)
+  static MeterSlot const *getSlots();
+};
+
+}
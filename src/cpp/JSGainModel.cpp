@@ -1,5 +1,9 @@
 #include "JSGainModel.h"
+#include "Replay/ProcessTrace.h"
 
+#include <algorithm>
+#include <iterator>
+#include <limits>
 #include <sstream>
 
 namespace pongasoft::VST::JSGain {
@@ -25,5 +29,95 @@ std::string toDbString(double iSample, int iPrecision)
   return s.str();
 }
 
+//------------------------------------------------------------------------
+// RoutingParamConverter::toRoutingString
+//------------------------------------------------------------------------
+char const *RoutingParamConverter::toRoutingString(ERouting iRouting)
+{
+  switch(iRouting)
+  {
+    case ERouting::kStereo: return "Stereo";
+    case ERouting::kSwap: return "Swap L/R";
+    case ERouting::kMono: return "Mono";
+    case ERouting::kLeftOnly: return "Left Only";
+    case ERouting::kRightOnly: return "Right Only";
+    case ERouting::kInvertLeft: return "Invert L";
+    case ERouting::kInvertRight: return "Invert R";
+    case ERouting::kInvertBoth: return "Invert L+R";
+    case ERouting::kMidSide: return "Mid/Side";
+  }
+  return "";
+}
+
+//------------------------------------------------------------------------
+// parseUICommands
+//------------------------------------------------------------------------
+int32 parseUICommands(std::string const &iText, UICommand *oCommands, int32 iMaxCommands)
+{
+  int32 count = 0;
+
+  std::istringstream s{iText};
+  std::string token;
+  while(count < iMaxCommands && std::getline(s, token, ';'))
+  {
+    // trim leading/trailing spaces
+    auto start = token.find_first_not_of(' ');
+    if(start == std::string::npos)
+      continue;
+    token = token.substr(start, token.find_last_not_of(' ') - start + 1);
+
+    UICommand command{};
+    if(token == "$reset")
+      command.fType = UICommand::Type::kResetMax;
+    else if(token == "$state" || token == "$rtState")
+      command.fType = UICommand::Type::kDumpState;
+    else if(token == "$vu" || token.rfind("$vu ", 0) == 0)
+    {
+      // missing arguments (NaN) => unchanged (see JSGainProcessor::handleUICommand)
+      command.fType = UICommand::Type::kConfigureVuPPM;
+      std::fill(std::begin(command.fArgs), std::end(command.fArgs), std::numeric_limits<double>::quiet_NaN());
+      std::istringstream args{token.substr(3)};
+      for(auto &arg: command.fArgs)
+      {
+        if(!(args >> arg))
+          break;
+      }
+    }
+    else if(token == "$capture" || token.rfind("$capture ", 0) == 0)
+    {
+      // post gain by default
+      command.fType = UICommand::Type::kCapture;
+      auto tap = token.size() > 9 ? token.substr(token.find_first_not_of(' ', 9)) : std::string{"post"};
+      if(tap == "pre")
+        command.fArgs[0] = static_cast<double>(ECaptureTap::kPreGain);
+      else if(tap == "post")
+        command.fArgs[0] = static_cast<double>(ECaptureTap::kPostGain);
+      else
+        command.fArgs[0] = static_cast<double>(ECaptureTap::kOff);
+    }
+    else if(token == "$record" || token.rfind("$record ", 0) == 0)
+    {
+      // no audio by default (the most compact trace)
+      command.fType = UICommand::Type::kRecordProcess;
+      auto audio = token.size() > 8 ? token.substr(token.find_first_not_of(' ', 8)) : std::string{};
+      command.fArgs[0] = audio == "off" ? 0 : 1;
+      if(audio == "hashes")
+        command.fArgs[1] = static_cast<double>(Replay::EAudioRecording::kHashes);
+      else if(audio == "samples")
+        command.fArgs[1] = static_cast<double>(Replay::EAudioRecording::kSamples);
+      else
+        command.fArgs[1] = static_cast<double>(Replay::EAudioRecording::kNone);
+    }
+    else
+      command.fType = UICommand::Type::kText;
+
+    token.copy(command.fText, sizeof(command.fText) / sizeof(command.fText[0]) - 1);
+
+    oCommands[count++] = command;
+  }
+
+  return count;
+}
+
 
 }
\ No newline at end of file
@@ -5,11 +5,15 @@
 //------------------------------------------------------------------------------------------------------------
 #pragma once
 
+#include "JSGainLatency.h"
+
 #include <pongasoft/VST/AudioUtils.h>
 #include <pongasoft/Utils/Clock/Clock.h>
 #include <pongasoft/VST/ParamSerializers.h>
 
 #include <pluginterfaces/base/ustring.h>
+#include <algorithm>
+#include <cmath>
 #include <string>
 #include <pongasoft/VST/ParamConverters.h>
 
@@ -95,6 +99,113 @@ public:
   }
 };
 
+//------------------------------------------------------------------------
+// ERouting - how the input channels are routed to the output channels
+// (before the gain is applied). Defined for stereo in/out: the other
+// layouts are derived from it (see RT/ChannelMatrix.h).
+//------------------------------------------------------------------------
+enum class ERouting : int32
+{
+  kStereo = 0,    // L -> L, R -> R (default)
+  kSwap,          // L -> R, R -> L
+  kMono,          // (L + R) / 2 -> L and R (downmix)
+  kLeftOnly,      // L -> L and R
+  kRightOnly,     // R -> L and R
+  kInvertLeft,    // -L -> L, R -> R (polarity)
+  kInvertRight,   // L -> L, -R -> R (polarity)
+  kInvertBoth,    // -L -> L, -R -> R (polarity)
+  kMidSide,       // (L + R) / 2 -> L, (L - R) / 2 -> R
+  kLast = kMidSide
+};
+
+//------------------------------------------------------------------------
+// RoutingParamConverter - discrete parameter (one step per ERouting value)
+//------------------------------------------------------------------------
+class RoutingParamConverter : public IParamConverter<ERouting>
+{
+public:
+  // makes toString available
+  using IParamConverter<ERouting>::toString;
+
+  static constexpr int32 kStepCount = static_cast<int32>(ERouting::kLast);
+
+  inline int32 getStepCount() const override { return kStepCount; }
+
+  ERouting denormalize(ParamValue value) const override
+  {
+    auto step = static_cast<int32>(std::floor(std::clamp(value, 0.0, 1.0) * (kStepCount + 1)));
+    return static_cast<ERouting>(std::min(step, kStepCount));
+  }
+
+  ParamValue normalize(ERouting const &iRouting) const override
+  {
+    return static_cast<ParamValue>(static_cast<int32>(iRouting)) / kStepCount;
+  }
+
+  inline void toString(ParamType const &iValue, String128 iString, int32 /* iPrecision */) const override
+  {
+    Steinberg::UString wrapper(iString, str16BufferSize(String128));
+    wrapper.fromAscii(toRoutingString(iValue));
+  }
+
+  // the name of each routing (as displayed by the host)
+  static char const *toRoutingString(ERouting iRouting);
+};
+
+//------------------------------------------------------------------------
+// ECaptureTap - what is captured to a file by the "$capture" command (see
+// Capture/AudioCapture.h and JSGainProcessor::genericProcessInputs)
+//------------------------------------------------------------------------
+enum class ECaptureTap : int32
+{
+  kOff = 0,
+  kPreGain = 1, // the input of the plugin (before routing and gain)
+  kPostGain = 2 // the output of the plugin
+};
+
+//------------------------------------------------------------------------
+// EModulationMode - how the samples of the modulation bus are interpreted
+// (see RT/GainModulation.h)
+//------------------------------------------------------------------------
+enum class EModulationMode : int32
+{
+  kLinear = 0, // gain multiplier (1.0 = unchanged)
+  kDecibels,   // gain in dB (0.0 = unchanged)
+  kLast = kDecibels
+};
+
+//------------------------------------------------------------------------
+// ModulationModeParamConverter - discrete parameter (one step per
+// EModulationMode value)
+//------------------------------------------------------------------------
+class ModulationModeParamConverter : public IParamConverter<EModulationMode>
+{
+public:
+  // makes toString available
+  using IParamConverter<EModulationMode>::toString;
+
+  static constexpr int32 kStepCount = static_cast<int32>(EModulationMode::kLast);
+
+  inline int32 getStepCount() const override { return kStepCount; }
+
+  EModulationMode denormalize(ParamValue value) const override
+  {
+    auto step = static_cast<int32>(std::floor(std::clamp(value, 0.0, 1.0) * (kStepCount + 1)));
+    return static_cast<EModulationMode>(std::min(step, kStepCount));
+  }
+
+  ParamValue normalize(EModulationMode const &iMode) const override
+  {
+    return static_cast<ParamValue>(static_cast<int32>(iMode)) / kStepCount;
+  }
+
+  inline void toString(ParamType const &iValue, String128 iString, int32 /* iPrecision */) const override
+  {
+    Steinberg::UString wrapper(iString, str16BufferSize(String128));
+    wrapper.fromAscii(iValue == EModulationMode::kDecibels ? "dB" : "Linear");
+  }
+};
+
 //------------------------------------------------------------------------
 // This structure is the information that the RT sends to the GUI whenever
 // the value changes.
@@ -108,12 +219,35 @@ struct Stats
   double fSampleRate{44100};
   double fMaxSinceReset{0};
   int64 fResetTime{Clock::getCurrentTimeMillis()};
+  int64 fSampleTime{0}; // sample clock (number of samples processed since activation) when the stats were taken
+  int64 fMaxProjectTimeSamples{-1}; // position of the max on the project timeline (in samples, -1 if unknown)
+
+  //------------------------------------------------------------------------
+  // Optional metrics (computed by the RT analysis since the previous
+  // snapshot which included them). fMetrics tells which ones are valid.
+  //------------------------------------------------------------------------
+  static constexpr uint8 kMetricRMS = 1 << 0;
+  static constexpr uint8 kMetricDCOffset = 1 << 1;
+  static constexpr uint8 kMetricClipCount = 1 << 2;
+  static constexpr uint8 kMetricCorrelation = 1 << 3;
+  static constexpr uint8 kMetricCrestFactor = 1 << 4;
+  static constexpr int kNumMetrics = 5;
+
+  uint8 fMetrics{0};
+  double fRMS{0};         // sample value
+  double fDCOffset{0};    // sample value
+  int64 fClipCount{0};    // number of frames >= 0dBFS
+  double fCorrelation{0}; // [-1, 1]
+  double fCrestFactor{0}; // peak / rms (ratio)
 };
 
 //------------------------------------------------------------------------
-// This class is the param serializer used in JSGainPlugin.h which defines
-// how to serialize/deserialize the Stats object so that it can be sent
-// in a message.
+// This class is a param serializer which defines how to serialize/
+// deserialize the Stats object so that it can be sent in a message.
+// Note that the Stats are now sent in batches with a more compact
+// encoding (see StatsBatchParamSerializer in JSGainStatsCodec.h) and this
+// serializer is kept as the reference (1 Stats per message) for
+// comparison (see test-JSGainBenchmark.cpp).
 //------------------------------------------------------------------------
 class StatsParamSerializer : public IParamSerializer<Stats>
 {
@@ -127,6 +261,7 @@ public:
     res |= IBStreamHelper::readDouble(iStreamer, oValue.fSampleRate);
     res |= IBStreamHelper::readDouble(iStreamer, oValue.fMaxSinceReset);
     res |= IBStreamHelper::readInt64(iStreamer, oValue.fResetTime);
+    res |= IBStreamHelper::readInt64(iStreamer, oValue.fSampleTime);
     return res;
   }
 
@@ -136,6 +271,7 @@ public:
     oStreamer.writeDouble(iValue.fSampleRate);
     oStreamer.writeDouble(iValue.fMaxSinceReset);
     oStreamer.writeInt64(iValue.fResetTime);
+    oStreamer.writeInt64(iValue.fSampleTime);
     return kResultOk;
   }
 
@@ -165,6 +301,7 @@ public:
 struct UIMessage
 {
   int64 fTimestamp{Clock::getCurrentTimeMillis()};
+  int64 fSendTimeNanos{0}; // monotonic time at which the GUI sent it (see JSGainLatency.h)
   char fText[64]{}; // NO memory allocation for RT!!
 };
 
@@ -183,6 +320,7 @@ public:
     tresult res = kResultOk;
 
     res |= IBStreamHelper::readInt64(iStreamer, oValue.fTimestamp);
+    res |= IBStreamHelper::readInt64(iStreamer, oValue.fSendTimeNanos);
     // fTextSerializer.readFromStream will ensure that the string is properly null terminated!
     res |= fTextSerializer.readFromStream(iStreamer, oValue.fText);
     return res;
@@ -192,6 +330,7 @@ public:
   inline tresult writeToStream(const ParamType &iValue, IBStreamer &oStreamer) const override
   {
     oStreamer.writeInt64(iValue.fTimestamp);
+    oStreamer.writeInt64(iValue.fSendTimeNanos);
     fTextSerializer.writeToStream(iValue.fText, oStreamer);
     return kResultOk;
   }
@@ -209,4 +348,286 @@ private:
   CStringParamSerializer<64> fTextSerializer{};
 };
 
+//------------------------------------------------------------------------
+// This structure is a copy of the RT state which the RT sends to the GUI
+// when asked to ("$state" or "$rtState" command). It contains the
+// normalized values of the RT parameters and some internal counters.
+// Like UIMessage, this is a fixed size structure because it is filled
+// by the RT (NO memory allocation) and the GUI formats it for display
+// (see JSGainSendMessageView).
+//------------------------------------------------------------------------
+struct RTStateSnapshot
+{
+  // must fit all the RT vst params (checked in JSGainProcessor::sendRTStateSnapshot)
+  static constexpr int32 kMaxParams = 8;
+
+  int64 fTimestamp{};             // time at which the snapshot was taken (ms)
+  int64 fFrameCount{};            // number of frames processed since activation
+  int32 fLastNumSamples{};        // number of samples in the last frame
+  double fSampleRate{};
+  double fMaxSinceReset{};
+  uint32 fDroppedUICommandsCount{};
+
+  // GUI -> RT latency of the commands (and messages) received since activation
+  LatencyHistogram fUICommandLatency{};
+
+  int32 fParamCount{};
+  ParamID fParamIDs[kMaxParams]{};
+  ParamValue fNormalizedValues[kMaxParams]{};
+
+  // adds the normalized value of a param (ignored when full)
+  inline void addParam(ParamID iParamID, ParamValue iNormalizedValue)
+  {
+    if(fParamCount < kMaxParams)
+    {
+      fParamIDs[fParamCount] = iParamID;
+      fNormalizedValues[fParamCount] = iNormalizedValue;
+      fParamCount++;
+    }
+  }
+};
+
+//------------------------------------------------------------------------
+// This class is the param serializer for RTStateSnapshot
+//------------------------------------------------------------------------
+class RTStateSnapshotParamSerializer : public IParamSerializer<RTStateSnapshot>
+{
+public:
+  // deserialize / readFromStream
+  inline tresult readFromStream(IBStreamer &iStreamer, ParamType &oValue) const override
+  {
+    tresult res = kResultOk;
+
+    int32 droppedUICommandsCount{};
+    res |= IBStreamHelper::readInt64(iStreamer, oValue.fTimestamp);
+    res |= IBStreamHelper::readInt64(iStreamer, oValue.fFrameCount);
+    res |= IBStreamHelper::readInt32(iStreamer, oValue.fLastNumSamples);
+    res |= IBStreamHelper::readDouble(iStreamer, oValue.fSampleRate);
+    res |= IBStreamHelper::readDouble(iStreamer, oValue.fMaxSinceReset);
+    res |= IBStreamHelper::readInt32(iStreamer, droppedUICommandsCount);
+    oValue.fDroppedUICommandsCount = static_cast<uint32>(droppedUICommandsCount);
+    res |= readLatencyHistogram(iStreamer, oValue.fUICommandLatency);
+
+    int32 paramCount{};
+    res |= IBStreamHelper::readInt32(iStreamer, paramCount);
+    oValue.fParamCount = 0;
+    for(int32 i = 0; i < std::min(paramCount, RTStateSnapshot::kMaxParams) && res == kResultOk; i++)
+    {
+      int32 paramID{};
+      ParamValue value{};
+      res |= IBStreamHelper::readInt32(iStreamer, paramID);
+      res |= IBStreamHelper::readDouble(iStreamer, value);
+      oValue.addParam(static_cast<ParamID>(paramID), value);
+    }
+    return res;
+  }
+
+  // serialize / writeToStream
+  inline tresult writeToStream(const ParamType &iValue, IBStreamer &oStreamer) const override
+  {
+    oStreamer.writeInt64(iValue.fTimestamp);
+    oStreamer.writeInt64(iValue.fFrameCount);
+    oStreamer.writeInt32(iValue.fLastNumSamples);
+    oStreamer.writeDouble(iValue.fSampleRate);
+    oStreamer.writeDouble(iValue.fMaxSinceReset);
+    oStreamer.writeInt32(static_cast<int32>(iValue.fDroppedUICommandsCount));
+    writeLatencyHistogram(iValue.fUICommandLatency, oStreamer);
+    oStreamer.writeInt32(iValue.fParamCount);
+    for(int32 i = 0; i < iValue.fParamCount; i++)
+    {
+      oStreamer.writeInt32(static_cast<int32>(iValue.fParamIDs[i]));
+      oStreamer.writeDouble(iValue.fNormalizedValues[i]);
+    }
+    return kResultOk;
+  }
+
+  //------------------------------------------------------------------------
+  // This optional method implementation allows the param to be displayed
+  // (see Debug::ParamTable or Debug::ParamLine classes)
+  //------------------------------------------------------------------------
+  void writeToStream(ParamType const &iValue, std::ostream &oStream) const override
+  {
+    oStream << "frame#" << iValue.fFrameCount;
+  }
+
+private:
+  static tresult readLatencyHistogram(IBStreamer &iStreamer, LatencyHistogram &oHistogram)
+  {
+    tresult res = kResultOk;
+    res |= IBStreamHelper::readInt64(iStreamer, oHistogram.fCount);
+    res |= IBStreamHelper::readInt64(iStreamer, oHistogram.fTotalNanos);
+    res |= IBStreamHelper::readInt64(iStreamer, oHistogram.fMaxNanos);
+    for(auto &count: oHistogram.fCounts)
+    {
+      int32 value{};
+      res |= IBStreamHelper::readInt32(iStreamer, value);
+      count = static_cast<uint32>(value);
+    }
+    return res;
+  }
+
+  static void writeLatencyHistogram(LatencyHistogram const &iHistogram, IBStreamer &oStreamer)
+  {
+    oStreamer.writeInt64(iHistogram.fCount);
+    oStreamer.writeInt64(iHistogram.fTotalNanos);
+    oStreamer.writeInt64(iHistogram.fMaxNanos);
+    for(auto count: iHistogram.fCounts)
+      oStreamer.writeInt32(static_cast<int32>(count));
+  }
+};
+
+//------------------------------------------------------------------------
+// UIMessage (above) is delivered through a Jmb param, which only ever
+// keeps the latest value: if the GUI sends 2 messages before the RT gets
+// a chance to process the next frame, the first one is lost. UICommand
+// is used when this is not acceptable (ex: a scripted burst of commands
+// like "$reset;$state"). Commands are sent in batches (one host message
+// per burst, see JSGainController::sendUICommands) and queued on the RT
+// side (see JSGainProcessor::notify) where they are all executed at the
+// beginning of the next frame.
+//
+// Like UIMessage, this is a fixed size structure (NO memory allocation).
+//------------------------------------------------------------------------
+struct UICommand
+{
+  enum class Type : int32
+  {
+    kText = 0,     // free form text (simply logged)
+    kResetMax = 1, // resets the stats ("$reset")
+    kDumpState = 2, // sends a copy of the RT state to the GUI ("$state" or "$rtState")
+    kEditorOpened = 3, // sent by the controller (see JSGainController::didOpen)
+    kEditorClosed = 4, // sent by the controller (see JSGainController::willClose)
+    kConfigureVuPPM = 5, // "$vu <thresholdDb> <maxUpdatesPerSecond> <onlyWhenEditorOpen (0|1)>" (see RT/VuPPMThrottle.h)
+    kCapture = 6, // "$capture [pre|post|off]" (fArgs[0] is the ECaptureTap, see Capture/AudioCapture.h)
+    kRecordProcess = 7 // "$record [hashes|samples|off]" (fArgs[0] is 1 (start) or 0 (stop), fArgs[1] the
+                       // Replay::EAudioRecording, see Replay/ProcessTrace.h)
+  };
+
+  static constexpr int32 kMaxArgs = 3;
+
+  Type fType{Type::kText};
+  int64 fTimestamp{Clock::getCurrentTimeMillis()};
+  int64 fSendTimeNanos{0}; // monotonic time at which the batch was sent (see JSGainController::sendUICommands)
+  char fText[64]{}; // NO memory allocation for RT!!
+  double fArgs[kMaxArgs]{}; // numeric arguments (parsed on the GUI side so that the RT does not have to)
+};
+
+// maximum number of commands that can be sent in one batch
+constexpr int32 MAX_UI_COMMANDS_PER_BATCH = 32;
+
+//------------------------------------------------------------------------
+// Parses iText as a burst of commands separated by ';' (ex:
+// "$reset;$state") and stores them in oCommands (up to iMaxCommands).
+// Returns the number of commands stored.
+//------------------------------------------------------------------------
+int32 parseUICommands(std::string const &iText, UICommand *oCommands, int32 iMaxCommands);
+
+//------------------------------------------------------------------------
+// This class is the serializer for a batch of UICommand: unlike the other
+// serializers it is not tied to a Jmb param because the batch is sent as
+// a "raw" message (see JSGainController::sendUICommands).
+//------------------------------------------------------------------------
+class UICommandSerializer
+{
+public:
+  // deserialize / readFromStream (one command)
+  inline tresult readFromStream(IBStreamer &iStreamer, UICommand &oValue) const
+  {
+    tresult res = kResultOk;
+
+    int32 type{};
+    res |= IBStreamHelper::readInt32(iStreamer, type);
+    oValue.fType = static_cast<UICommand::Type>(type);
+    res |= IBStreamHelper::readInt64(iStreamer, oValue.fTimestamp);
+    res |= IBStreamHelper::readInt64(iStreamer, oValue.fSendTimeNanos);
+    res |= fTextSerializer.readFromStream(iStreamer, oValue.fText);
+    for(auto &arg: oValue.fArgs)
+      res |= IBStreamHelper::readDouble(iStreamer, arg);
+    return res;
+  }
+
+  // serialize / writeToStream (one command)
+  inline tresult writeToStream(UICommand const &iValue, IBStreamer &oStreamer) const
+  {
+    oStreamer.writeInt32(static_cast<int32>(iValue.fType));
+    oStreamer.writeInt64(iValue.fTimestamp);
+    oStreamer.writeInt64(iValue.fSendTimeNanos);
+    fTextSerializer.writeToStream(iValue.fText, oStreamer);
+    for(auto arg: iValue.fArgs)
+      oStreamer.writeDouble(arg);
+    return kResultOk;
+  }
+
+private:
+  CStringParamSerializer<64> fTextSerializer{};
+};
+
+//------------------------------------------------------------------------
+// Implemented by the controller (which owns the connection to the
+// processor) and made available to the views via the GUI state.
+//------------------------------------------------------------------------
+class IUICommandSender
+{
+public:
+  virtual ~IUICommandSender() = default;
+
+  // sends all the commands to the RT in a single message
+  virtual tresult sendUICommands(UICommand const *iCommands, int32 iCount) = 0;
+};
+
+//------------------------------------------------------------------------
+// Implemented by the views which are redrawn at the pace of the frame
+// scheduler (see GUI/FrameScheduler.h)
+//------------------------------------------------------------------------
+class IFrameClient
+{
+public:
+  virtual ~IFrameClient() = default;
+
+  // called (on the UI thread) at the next frame following requestFrame
+  virtual void onFrame() = 0;
+};
+
+//------------------------------------------------------------------------
+// Provided by the controller and made available to the views via the GUI
+// state (see GUI/FrameScheduler.h)
+//------------------------------------------------------------------------
+class IFrameScheduler
+{
+public:
+  virtual ~IFrameScheduler() = default;
+
+  // the clients polling for changes (see poll) slow down after this many frames without change...
+  static constexpr int32 kMaxIdleFrames = 10;
+
+  // ...and then poll at this interval (instead of every frame)
+  static constexpr uint32 kIdlePollIntervalMs = 250;
+
+  // iClient::onFrame will be called once at the next frame (no matter how many times this is called until then)
+  virtual void requestFrame(IFrameClient *iClient) = 0;
+
+  // iClient::onFrame will be called once at the first frame at least iDelayMs from now (unless a frame is
+  // requested (requestFrame) in between which replaces it)
+  virtual void requestFrameIn(IFrameClient *iClient, uint32 iDelayMs) = 0;
+
+  // must be called before iClient is destroyed
+  virtual void cancelFrame(IFrameClient *iClient) = 0;
+
+  //------------------------------------------------------------------------
+  // poll - for the clients which have no way to be notified of a change and
+  // must poll for it (called from onFrame): the next frame is requested
+  // while there are changes, and once nothing changed for kMaxIdleFrames,
+  // only every iIdleIntervalMs. ioIdleFrames is the number of frames
+  // without change (kept by the client, starts at 0).
+  //------------------------------------------------------------------------
+  void poll(IFrameClient *iClient, bool iChanged, int32 &ioIdleFrames, uint32 iIdleIntervalMs = kIdlePollIntervalMs)
+  {
+    ioIdleFrames = iChanged ? 0 : std::min(ioIdleFrames + 1, kMaxIdleFrames);
+    if(ioIdleFrames < kMaxIdleFrames)
+      requestFrame(iClient);
+    else
+      requestFrameIn(iClient, iIdleIntervalMs);
+  }
+};
+
 }
@@ -0,0 +1,92 @@
+//------------------------------------------------------------------------------------------------------------
+// This file defines the (compile time) table which maps the ID of each vst parameter used by the RT to its
+// slot in JSGainRTState so that the parameter changes coming from the host (automation) are applied with an
+// array index instead of a lookup in a map (see JSGainRTState::applyParameterChanges).
+//------------------------------------------------------------------------------------------------------------
+#pragma once
+
+#include "JSGainCIDs.h"
+
+#include <array>
+#include <iterator>
+
+namespace pongasoft::VST::JSGain {
+
+using Steinberg::Vst::ParamID;
+using Steinberg::int8;
+using Steinberg::int32;
+
+//------------------------------------------------------------------------
+// The vst parameters used by the RT (the order defines the slot). Must
+// match the RTVstParam / RTRawVstParam of JSGainRTState (checked when
+// the state is created and by the tests).
+//------------------------------------------------------------------------
+constexpr ParamID kRTVstParamIDs[] = {
+  EJSGainParamID::kBypass,
+  EJSGainParamID::kVuPPM,
+  EJSGainParamID::kLeftGain,
+  EJSGainParamID::kRightGain,
+  EJSGainParamID::kResetMax,
+  EJSGainParamID::kRouting,
+  EJSGainParamID::kModulationMode,
+};
+
+//------------------------------------------------------------------------
+// ParamDispatchTable - ParamID -> slot (kNoSlot when the ID is not an RT
+// vst param). The IDs are small integers so the table is simply indexed
+// by (ID - kMinParamID).
+//------------------------------------------------------------------------
+class ParamDispatchTable
+{
+public:
+  static constexpr int32 kNoSlot = -1;
+  static constexpr int32 kNumSlots = static_cast<int32>(std::size(kRTVstParamIDs));
+
+  static constexpr ParamID kMinParamID = [] {
+    ParamID min = kRTVstParamIDs[0];
+    for(auto id: kRTVstParamIDs)
+      min = id < min ? id : min;
+    return min;
+  }();
+
+  static constexpr ParamID kMaxParamID = [] {
+    ParamID max = kRTVstParamIDs[0];
+    for(auto id: kRTVstParamIDs)
+      max = id > max ? id : max;
+    return max;
+  }();
+
+  // getSlot - the slot of iParamID (kNoSlot if not an RT vst param)
+  static constexpr int32 getSlot(ParamID iParamID)
+  {
+    if(iParamID < kMinParamID || iParamID > kMaxParamID)
+      return kNoSlot;
+    return kSlots[iParamID - kMinParamID];
+  }
+
+private:
+  using Slots = std::array<int8, kMaxParamID - kMinParamID + 1>;
+
+  static constexpr Slots kSlots = [] {
+    Slots slots{};
+    for(auto &slot: slots)
+      slot = kNoSlot;
+    for(int32 i = 0; i < kNumSlots; i++)
+      slots[kRTVstParamIDs[i] - kMinParamID] = static_cast<int8>(i);
+    return slots;
+  }();
+
+  static_assert(kNumSlots < 128, "slots are stored in int8");
+};
+
+// sanity checks (at compile time): every ID is unique (hence gets its own slot)
+static_assert([] {
+  for(int32 i = 0; i < ParamDispatchTable::kNumSlots; i++)
+  {
+    if(ParamDispatchTable::getSlot(kRTVstParamIDs[i]) != i)
+      return false;
+  }
+  return true;
+}(), "duplicate ID in kRTVstParamIDs");
+
+}
@@ -9,6 +9,11 @@
 
 #include "JSGainCIDs.h"
 #include "JSGainModel.h"
+#include "JSGainStatsCodec.h"
+#include "JSGainLevelHistogram.h"
+#include "JSGainSharedInstance.h"
+#include "JSGainParamDispatch.h"
+#include "Concurrent/CacheLine.h"
 
 #include <pongasoft/VST/Parameters.h>
 #include <pongasoft/VST/RT/RTState.h>
@@ -75,6 +80,8 @@ public:
   VstParam<Gain> fLeftGainParam;  // gain for left channel (typed because gain is not linear) - tied to GUI slider
   VstParam<Gain> fRightGainParam; // gain for right channel (typed because gain is not linear) - tied to GUI slider
   VstParam<bool> fResetMaxParam;  // the momentary button to reset the max value in the stats
+  VstParam<ERouting> fRoutingParam; // routing of the input channels to the output channels (see RT/ChannelMatrix.h)
+  VstParam<EModulationMode> fModulationModeParam; // how the modulation bus is interpreted (see RT/GainModulation.h)
 
   //------------------------------------------------------------------------
   // This parameter is transient, meaning it is NOT saved in the state
@@ -97,7 +104,7 @@ public:
   // This is an example of a Jmb param used to communicate data between
   // the RT and the GUI
   //------------------------------------------------------------------------
-  JmbParam<Stats> fStatsParam; // Stats is a type defined in JSGainModel.h (as well as its serializer)
+  JmbParam<StatsBatch> fStatsParam; // StatsBatch is a type defined in JSGainStatsCodec.h (as well as its serializer)
 
   //------------------------------------------------------------------------
   // This is an example of a Jmb param used to communicate data between
@@ -105,6 +112,21 @@ public:
   //------------------------------------------------------------------------
   JmbParam<UIMessage> fUIMessageParam; // UIMessage is a type defined in JSGainModel.h (as well as its serializer)
 
+  //------------------------------------------------------------------------
+  // Copy of the RT state sent to the GUI on demand (RT -> GUI)
+  //------------------------------------------------------------------------
+  JmbParam<RTStateSnapshot> fRTStateSnapshotParam;
+
+  //------------------------------------------------------------------------
+  // Distribution of the output levels (RT -> GUI) sent at a throttled rate
+  //------------------------------------------------------------------------
+  JmbParam<LevelHistogram> fLevelHistogramParam; // defined in JSGainLevelHistogram.h
+
+  //------------------------------------------------------------------------
+  // Token of the data shared directly between the RT and the GUI (RT -> GUI)
+  //------------------------------------------------------------------------
+  JmbParam<InstanceToken> fInstanceTokenParam; // defined in JSGainSharedInstance.h
+
 public:
   JSGainParameters()
   {
@@ -160,6 +182,20 @@ public:
         .shortTitle(STR16 ("Reset"))
         .add();
 
+    // channel routing (downmix, upmix, swap, polarity...)
+    fRoutingParam =
+      vst<RoutingParamConverter>(EJSGainParamID::kRouting, STR16 ("Routing"))
+        .defaultValue(ERouting::kStereo)
+        .shortTitle(STR16 ("Route"))
+        .add();
+
+    // modulation mode (only used when the modulation bus is connected)
+    fModulationModeParam =
+      vst<ModulationModeParamConverter>(EJSGainParamID::kModulationMode, STR16 ("Modulation Mode"))
+        .defaultValue(EModulationMode::kLinear)
+        .shortTitle(STR16 ("ModMode"))
+        .add();
+
     // vuPPM
     fVuPPMParam =
       raw(EJSGainParamID::kVuPPM, STR16 ("VuPPM"))
@@ -174,7 +210,7 @@ public:
     //------------------------------------------------------------------------
     // stats
     fStatsParam =
-      jmb<StatsParamSerializer>(EJSGainParamID::kStats, STR16("Stats"))
+      jmb<StatsBatchParamSerializer>(EJSGainParamID::kStats, STR16("Stats"))
         .transient() // does not make much sense to be saved part of the state (and rtOwned Jmb param CANNOT be saved)
         .rtOwned()   // by default jmb parameters are guiOwned => this makes this parameter owned by the RT
         .shared()    // enables RT -> GUI communication (rtOwned)
@@ -195,6 +231,30 @@ public:
         .shared()    // enables GUI -> RT communication (guiOwned)
         .add();
 
+    // RT state snapshot
+    fRTStateSnapshotParam =
+      jmb<RTStateSnapshotParamSerializer>(EJSGainParamID::kRTStateSnapshot, STR16("RTStateSnapshot"))
+        .transient()
+        .rtOwned()
+        .shared()    // enables RT -> GUI communication (rtOwned)
+        .add();
+
+    // level histogram
+    fLevelHistogramParam =
+      jmb<LevelHistogramParamSerializer>(EJSGainParamID::kLevelHistogram, STR16("LevelHistogram"))
+        .transient()
+        .rtOwned()
+        .shared()    // enables RT -> GUI communication (rtOwned)
+        .add();
+
+    // instance token
+    fInstanceTokenParam =
+      jmb<InstanceTokenParamSerializer>(EJSGainParamID::kInstanceToken, STR16("InstanceToken"))
+        .transient()
+        .rtOwned()
+        .shared()    // enables RT -> GUI communication (rtOwned)
+        .add();
+
     //------------------------------------------------------------------------
     // Although this step is optional, it is HIGHLY recommended (and a warning
     // will be logged) if the order in which the state should be saved is not
@@ -219,7 +279,9 @@ public:
                         fBypassParam,
                         fLeftGainParam,
                         fRightGainParam,
-                        fResetMaxParam);
+                        fResetMaxParam,
+                        fRoutingParam,
+                        fModulationModeParam);
 
     // same for GUI - note that if the GUI does not save anything then you don't need this
     setGUISaveStateOrder(CONTROLLER_STATE_VERSION,
@@ -240,6 +302,22 @@ public:
 using namespace RT;
 class JSGainRTState : public RTState
 {
+  //------------------------------------------------------------------------
+  // Layout: everything the RT touches at every frame (the dispatch table,
+  // the vst parameters and fMaxSinceReset) is grouped at the beginning of
+  // its own cache line(s) ("hot block"). The Jmb (messaging) parameters,
+  // which are only touched every now and then and also by the thread
+  // handling the messages, start on the next cache line. The parameters
+  // themselves are allocated on their own cache lines (see addSlot).
+  //------------------------------------------------------------------------
+private:
+  //------------------------------------------------------------------------
+  // The RT vst parameters indexed by their slot (see JSGainParamDispatch.h
+  // and applyParameterChanges). Declared first so that it is initialized
+  // before the parameters are added (see addSlot).
+  //------------------------------------------------------------------------
+  alignas(Concurrent::kCacheLineSize) RTRawVstParameter *fSlots[ParamDispatchTable::kNumSlots]{};
+
 public:
   //------------------------------------------------------------------------
   // These parameters are part of the saved state. Note how they are typed
@@ -253,6 +331,8 @@ public:
   RTVstParam<Gain> fLeftGain;
   RTVstParam<Gain> fRightGain;
   RTVstParam<bool> fResetMax;
+  RTVstParam<ERouting> fRouting;
+  RTVstParam<EModulationMode> fModulationMode;
 
   //------------------------------------------------------------------------
   // This parameter which is transient is using the Raw flavor (untyped)
@@ -260,21 +340,24 @@ public:
   //------------------------------------------------------------------------
   RTRawVstParam fVuPPM;
 
+  //------------------------------------------------------------------------
+  // This class is just a regular C++ class so you can also use it to store
+  // other parts of the state necessary for the plugin. Note that Jamba
+  // will not do anything about it.
+  //------------------------------------------------------------------------
+  double fMaxSinceReset{};
+
   //------------------------------------------------------------------------
   // These parameters are Jmb parameters and as a result use a different
   // wrapper class. There are 2 different wrappers depending on how the
   // parameter is being used because the requirements and usage are
   // completely different.
   //------------------------------------------------------------------------
-  RTJmbOutParam<Stats> fStats;         // RT sends the stats out (broadcast) => RTJmbOutParam
+  alignas(Concurrent::kCacheLineSize) RTJmbOutParam<StatsBatch> fStats; // RT sends the stats out (broadcast) => RTJmbOutParam
   RTJmbInParam<UIMessage> fUIMessage;  // RT receives UI message from GUI => RTJmbInParam
-
-  //------------------------------------------------------------------------
-  // This class is just a regular C++ class so you can also use it to store
-  // other parts of the state necessary for the plugin. Note that Jamba
-  // will not do anything about it.
-  //------------------------------------------------------------------------
-  double fMaxSinceReset{};
+  RTJmbOutParam<RTStateSnapshot> fRTStateSnapshot; // RT sends a copy of its state on demand
+  RTJmbOutParam<LevelHistogram> fLevelHistogram;   // RT sends the distribution of the output levels
+  RTJmbOutParam<InstanceToken> fInstanceToken;     // RT sends the token of its shared instance
 
 public:
   //------------------------------------------------------------------------
@@ -283,14 +366,111 @@ public:
   //------------------------------------------------------------------------
   explicit JSGainRTState(JSGainParameters const &iParams) :
     RTState(iParams),
-    fBypass{add(iParams.fBypassParam)},
-    fLeftGain{add(iParams.fLeftGainParam)},
-    fRightGain{add(iParams.fRightGainParam)},
-    fResetMax{add(iParams.fResetMaxParam)},
-    fVuPPM{add(iParams.fVuPPMParam)},
+    fBypass{addSlot(iParams.fBypassParam)},
+    fLeftGain{addSlot(iParams.fLeftGainParam)},
+    fRightGain{addSlot(iParams.fRightGainParam)},
+    fResetMax{addSlot(iParams.fResetMaxParam)},
+    fRouting{addSlot(iParams.fRoutingParam)},
+    fModulationMode{addSlot(iParams.fModulationModeParam)},
+    fVuPPM{addSlot(iParams.fVuPPMParam)},
     fStats{addJmbOut(iParams.fStatsParam)},
-    fUIMessage{addJmbIn(iParams.fUIMessageParam)}
+    fUIMessage{addJmbIn(iParams.fUIMessageParam)},
+    fRTStateSnapshot{addJmbOut(iParams.fRTStateSnapshotParam)},
+    fLevelHistogram{addJmbOut(iParams.fLevelHistogramParam)},
+    fInstanceToken{addJmbOut(iParams.fInstanceTokenParam)}
+  {
+    for(auto param: fSlots)
+      DCHECK_F(param != nullptr, "kRTVstParamIDs does not match the RT vst parameters");
+  }
+
+  //------------------------------------------------------------------------
+  // getSlotParam - the parameter found via the dispatch table (nullptr if
+  // iParamID is not an RT vst parameter)
+  //------------------------------------------------------------------------
+  inline RTRawVstParameter *getSlotParam(ParamID iParamID) const
+  {
+    auto slot = ParamDispatchTable::getSlot(iParamID);
+    return slot == ParamDispatchTable::kNoSlot ? nullptr : fSlots[slot];
+  }
+
+  //------------------------------------------------------------------------
+  // applyParameterChanges - same behavior as RTState::applyParameterChanges
+  // (only the last point of each queue is used) but each parameter is found
+  // with an array index (see JSGainParamDispatch.h) instead of a lookup
+  // in a map: under heavy automation this is called for every parameter
+  // at every block.
+  //------------------------------------------------------------------------
+  bool applyParameterChanges(IParameterChanges &inputParameterChanges) override
+  {
+    int32 numParamsChanged = inputParameterChanges.getParameterCount();
+    if(numParamsChanged <= 0)
+      return false;
+
+    bool stateChanged = false;
+
+    for(int32 i = 0; i < numParamsChanged; ++i)
+    {
+      auto paramQueue = inputParameterChanges.getParameterData(i);
+      if(paramQueue == nullptr)
+        continue;
+
+      auto param = getSlotParam(paramQueue->getParameterId());
+      if(param == nullptr)
+        continue;
+
+      ParamValue value;
+      int32 sampleOffset;
+      if(paramQueue->getPoint(paramQueue->getPointCount() - 1, sampleOffset, value) == kResultOk)
+        stateChanged |= param->updateNormalizedValue(value);
+    }
+
+    return stateChanged;
+  }
+
+private:
+  //------------------------------------------------------------------------
+  // addSlot - same as RTState::add but also keeps track of the parameter
+  // (and its converter since RTVstParameter<T> denormalizes the value) in
+  // its slot
+  //------------------------------------------------------------------------
+  template<typename T>
+  RTVstParam<T> addSlot(VstParam<T> iParamDef)
+  {
+    std::shared_ptr<RTVstParameter<T>> rtParam =
+      std::make_shared<CacheLineAligned<RTVstParameter<T>>>(std::move(iParamDef));
+    setSlot(rtParam.get());
+    addRawParameter(rtParam);
+    return rtParam;
+  }
+
+  RTRawVstParam addSlot(RawVstParam iParamDef)
+  {
+    std::shared_ptr<RTRawVstParameter> rtParam =
+      std::make_shared<CacheLineAligned<RTRawVstParameter>>(std::move(iParamDef));
+    setSlot(rtParam.get());
+    addRawParameter(rtParam);
+    return rtParam;
+  }
+
+  //------------------------------------------------------------------------
+  // CacheLineAligned - the parameters (written at every frame) are heap
+  // allocated: by default they could share a cache line with any other
+  // allocation, including the parameters of another instance processed by
+  // another thread (false sharing). Over-aligned types get their own cache
+  // line(s) (make_shared honors the alignment since C++17).
+  //------------------------------------------------------------------------
+  template<typename Param>
+  struct alignas(Concurrent::kCacheLineSize) CacheLineAligned : public Param
   {
+    using Param::Param;
+  };
+
+  inline void setSlot(RTRawVstParameter *iParam)
+  {
+    auto slot = ParamDispatchTable::getSlot(iParam->getParamID());
+    DCHECK_F(slot != ParamDispatchTable::kNoSlot, "Param %d missing from kRTVstParamIDs", iParam->getParamID());
+    if(slot != ParamDispatchTable::kNoSlot)
+      fSlots[slot] = iParam;
   }
 
 //------------------------------------------------------------------------
@@ -348,11 +528,40 @@ public:
   GUIJmbParam<UTF8String> fInputText;
 
   //------------------------------------------------------------------------
-  // These 2 parameters are used for messaging. Note that, unlike the RT
+  // These parameters are used for messaging. Note that, unlike the RT
   // version, they all use the same class.
   //------------------------------------------------------------------------
-  GUIJmbParam<Stats> fStats;
+  GUIJmbParam<StatsBatch> fStats;
   GUIJmbParam<UIMessage> fUIMessage;
+  GUIJmbParam<RTStateSnapshot> fRTStateSnapshot;
+  GUIJmbParam<LevelHistogram> fLevelHistogram;
+  GUIJmbParam<InstanceToken> fInstanceToken;
+
+  //------------------------------------------------------------------------
+  // This is not a parameter: it is provided by the controller so that
+  // views can send a burst of commands (UICommand) to the RT which, unlike
+  // fUIMessage, are all delivered (see sendUICommands below)
+  //------------------------------------------------------------------------
+  IUICommandSender *fUICommandSender{};
+
+  //------------------------------------------------------------------------
+  // Also provided by the controller: paces the redraws of the views (see
+  // GUI/FrameScheduler.h)
+  //------------------------------------------------------------------------
+  IFrameScheduler *fFrameScheduler{};
+
+  //------------------------------------------------------------------------
+  // Latency and throughput of the stats (RT -> GUI) measured by
+  // JSGainStatsView and displayed with the RT state ("$state")
+  //------------------------------------------------------------------------
+  MessagingStats fStatsMessaging{};
+
+  //------------------------------------------------------------------------
+  // Also provided by the controller: the data shared with the processor
+  // when it lives in the same process (nullptr otherwise). When set, the
+  // stats are read from it instead of fStats (see JSGainStatsView).
+  //------------------------------------------------------------------------
+  std::shared_ptr<JSGainSharedInstance> fSharedInstance{};
 
 public:
   //------------------------------------------------------------------------
@@ -363,9 +572,20 @@ public:
     GUIPluginState(iParams),
     fInputText{add(iParams.fInputTextParam)},
     fStats{add(iParams.fStatsParam)},
-    fUIMessage{add(iParams.fUIMessageParam)}
+    fUIMessage{add(iParams.fUIMessageParam)},
+    fRTStateSnapshot{add(iParams.fRTStateSnapshotParam)},
+    fLevelHistogram{add(iParams.fLevelHistogramParam)},
+    fInstanceToken{add(iParams.fInstanceTokenParam)}
   {};
 
+  //------------------------------------------------------------------------
+  // Sends the commands to the RT in a single message
+  //------------------------------------------------------------------------
+  tresult sendUICommands(UICommand const *iCommands, int32 iCount)
+  {
+    return fUICommandSender ? fUICommandSender->sendUICommands(iCommands, iCount) : kResultFalse;
+  }
+
 //------------------------------------------------------------------------
 // The following overrides will happen only in debug mode and will log
 // whenever the state is read or written in the GUI. Note that you could
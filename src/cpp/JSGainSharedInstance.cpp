@@ -0,0 +1,85 @@
+#include "JSGainSharedInstance.h"
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <random>
+
+namespace pongasoft::VST::JSGain {
+
+namespace {
+
+//------------------------------------------------------------------------
+// The registry only keeps weak references: the processor owns the
+// instance (and the GUI shares it while using it)
+//------------------------------------------------------------------------
+struct Registry
+{
+  std::mutex fMutex{};
+  int64 fLastId{0};
+  std::map<int64, std::weak_ptr<JSGainSharedInstance>> fInstances{};
+};
+
+Registry &registry()
+{
+  static Registry kRegistry{};
+  return kRegistry;
+}
+
+}
+
+//------------------------------------------------------------------------
+// JSGainInstanceRegistry::getProcessNonce
+// The random device is mixed with the clock in case it is not really
+// random on some platform.
+//------------------------------------------------------------------------
+uint64 JSGainInstanceRegistry::getProcessNonce()
+{
+  static const uint64 kNonce = [] {
+    std::random_device device{};
+    auto nonce = (static_cast<uint64>(device()) << 32) ^ static_cast<uint64>(device());
+    nonce ^= static_cast<uint64>(std::chrono::high_resolution_clock::now().time_since_epoch().count());
+    return nonce == 0 ? 1 : nonce;
+  }();
+  return kNonce;
+}
+
+//------------------------------------------------------------------------
+// JSGainInstanceRegistry::add
+//------------------------------------------------------------------------
+InstanceToken JSGainInstanceRegistry::add(std::shared_ptr<JSGainSharedInstance> iInstance)
+{
+  auto &r = registry();
+  std::lock_guard<std::mutex> lock{r.fMutex};
+  InstanceToken token{++r.fLastId, getProcessNonce()};
+  r.fInstances[token.fId] = std::move(iInstance);
+  return token;
+}
+
+//------------------------------------------------------------------------
+// JSGainInstanceRegistry::remove
+//------------------------------------------------------------------------
+void JSGainInstanceRegistry::remove(InstanceToken iToken)
+{
+  auto &r = registry();
+  std::lock_guard<std::mutex> lock{r.fMutex};
+  if(isLocal(iToken))
+    r.fInstances.erase(iToken.fId);
+}
+
+//------------------------------------------------------------------------
+// JSGainInstanceRegistry::find
+//------------------------------------------------------------------------
+std::shared_ptr<JSGainSharedInstance> JSGainInstanceRegistry::find(InstanceToken iToken)
+{
+  // the id of an instance created by another process means nothing here
+  if(!isLocal(iToken))
+    return nullptr;
+
+  auto &r = registry();
+  std::lock_guard<std::mutex> lock{r.fMutex};
+  auto iter = r.fInstances.find(iToken.fId);
+  return iter == r.fInstances.end() ? nullptr : iter->second.lock();
+}
+
+}
@@ -0,0 +1,134 @@
+//------------------------------------------------------------------------------------------------------------
+// This file defines the data that the RT and the GUI of the same plugin instance share directly (in memory)
+// instead of going through the host messaging (Jmb params) which is not designed for large amount of data
+// (like a continuous stream of samples).
+//
+// The processor creates (outside the RT) a JSGainSharedInstance, adds it to the (process wide) registry and
+// sends the token to the GUI through a regular Jmb param. The GUI then uses the token to find the instance.
+// Note that the VST3 spec allows the processor and the controller to live in different processes, in
+// which case the lookup simply fails and the features relying on it are disabled: the token carries a
+// nonce unique to the process which created it so that the id of an instance of another process can never
+// be mistaken for the id of a local one.
+//------------------------------------------------------------------------------------------------------------
+#pragma once
+
+#include "Concurrent/SampleRing.h"
+#include "Concurrent/SeqLock.h"
+#include "Concurrent/CacheLine.h"
+#include "JSGainStatsCodec.h"
+
+#include <pongasoft/VST/ParamSerializers.h>
+
+#include <atomic>
+#include <memory>
+
+namespace pongasoft::VST::JSGain {
+
+//------------------------------------------------------------------------
+// InstanceToken - identifies a JSGainSharedInstance in the registry
+//------------------------------------------------------------------------
+struct InstanceToken
+{
+  int64 fId{0};     // unique in the process which created it (0 means none)
+  uint64 fNonce{0}; // unique to the process which created it (see JSGainInstanceRegistry::getProcessNonce)
+
+  inline bool isValid() const { return fId != 0; }
+
+  inline bool operator==(InstanceToken const &iOther) const { return fId == iOther.fId && fNonce == iOther.fNonce; }
+  inline bool operator!=(InstanceToken const &iOther) const { return !(*this == iOther); }
+};
+
+//------------------------------------------------------------------------
+// JSGainSharedInstance
+//------------------------------------------------------------------------
+struct JSGainSharedInstance
+{
+  //------------------------------------------------------------------------
+  // Output of the plugin (mixed down to mono) written by the RT and read
+  // by the spectrum analyzer (see Spectrum/SpectrumAnalyzer.h) as long as
+  // at least one analyzer is attached (see JSGainProcessor::genericProcessInputs)
+  //------------------------------------------------------------------------
+  static constexpr size_t kSpectrumRingSize = 16384;
+  Concurrent::SampleRing<float, kSpectrumRingSize> fSpectrumRing{};
+  std::atomic<double> fSampleRate{0};
+  std::atomic<int32> fSpectrumReaderCount{0};
+
+  // attachSpectrumReader / detachSpectrumReader - NOT from the RT (analyzer)
+  inline void attachSpectrumReader() { fSpectrumReaderCount.fetch_add(1, std::memory_order_acq_rel); }
+  inline void detachSpectrumReader() { fSpectrumReaderCount.fetch_sub(1, std::memory_order_acq_rel); }
+
+  // hasSpectrumReader - RT
+  inline bool hasSpectrumReader() const { return fSpectrumReaderCount.load(std::memory_order_acquire) > 0; }
+
+  //------------------------------------------------------------------------
+  // The stats, written by the RT in place of the (serialized) message as
+  // long as at least one reader (the controller of this instance, which
+  // can only find the instance if it lives in the same process) is
+  // attached. See JSGainProcessor::flushStats.
+  //------------------------------------------------------------------------
+  alignas(Concurrent::kCacheLineSize) Concurrent::SeqLock<StatsBatch> fStats{};
+  alignas(Concurrent::kCacheLineSize) std::atomic<int32> fStatsReaderCount{0};
+
+  // attachStatsReader / detachStatsReader - NOT from the RT (GUI)
+  inline void attachStatsReader() { fStatsReaderCount.fetch_add(1, std::memory_order_acq_rel); }
+  inline void detachStatsReader() { fStatsReaderCount.fetch_sub(1, std::memory_order_acq_rel); }
+
+  // hasStatsReader - RT
+  inline bool hasStatsReader() const { return fStatsReaderCount.load(std::memory_order_acquire) > 0; }
+};
+
+//------------------------------------------------------------------------
+// JSGainInstanceRegistry - all methods are thread safe (they lock) and
+// as a result must NOT be called from the RT
+//------------------------------------------------------------------------
+class JSGainInstanceRegistry
+{
+public:
+  // adds the instance to the registry and returns its (unique) token
+  static InstanceToken add(std::shared_ptr<JSGainSharedInstance> iInstance);
+
+  // whether the token was created by this process (does not lock)
+  static bool isLocal(InstanceToken const &iToken) { return iToken.isValid() && iToken.fNonce == getProcessNonce(); }
+
+  // random number generated once per process (never 0, does not lock)
+  static uint64 getProcessNonce();
+
+  // removes the instance from the registry (the GUI may still hold it)
+  static void remove(InstanceToken iToken);
+
+  // returns nullptr if not found (or if the instance does not exist anymore or belongs to another process)
+  static std::shared_ptr<JSGainSharedInstance> find(InstanceToken iToken);
+};
+
+//------------------------------------------------------------------------
+// InstanceTokenParamSerializer - used to send the token to the GUI
+//------------------------------------------------------------------------
+class InstanceTokenParamSerializer : public IParamSerializer<InstanceToken>
+{
+public:
+  // deserialize / readFromStream
+  inline tresult readFromStream(IBStreamer &iStreamer, ParamType &oValue) const override
+  {
+    int64 nonce{};
+    tresult res = IBStreamHelper::readInt64(iStreamer, oValue.fId);
+    res |= IBStreamHelper::readInt64(iStreamer, nonce);
+    oValue.fNonce = static_cast<uint64>(nonce);
+    return res;
+  }
+
+  // serialize / writeToStream
+  inline tresult writeToStream(const ParamType &iValue, IBStreamer &oStreamer) const override
+  {
+    oStreamer.writeInt64(iValue.fId);
+    oStreamer.writeInt64(static_cast<int64>(iValue.fNonce));
+    return kResultOk;
+  }
+
+  // writeToStream (display)
+  void writeToStream(ParamType const &iValue, std::ostream &oStream) const override
+  {
+    oStream << iValue.fId;
+  }
+};
+
+}
@@ -0,0 +1,263 @@
+#include "JSGainStatsCodec.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace pongasoft::VST::JSGain {
+
+namespace {
+
+//------------------------------------------------------------------------
+// Writer - writes little endian values in a fixed size buffer (all writes
+// are ignored once the buffer is full and fOverflow is set)
+//------------------------------------------------------------------------
+struct Writer
+{
+  uint8 *fBuffer;
+  int32 fSize;
+  int32 fPosition{0};
+  bool fOverflow{false};
+
+  inline void writeUInt8(uint8 iValue)
+  {
+    if(fPosition < fSize)
+      fBuffer[fPosition++] = iValue;
+    else
+      fOverflow = true;
+  }
+
+  inline void writeFloat(float iValue)
+  {
+    uint32 bits;
+    std::memcpy(&bits, &iValue, sizeof(bits));
+    for(int i = 0; i < 4; i++)
+      writeUInt8(static_cast<uint8>(bits >> (i * 8)));
+  }
+
+  inline void writeVarUInt(uint64 iValue)
+  {
+    while(iValue >= 0x80)
+    {
+      writeUInt8(static_cast<uint8>(iValue | 0x80));
+      iValue >>= 7;
+    }
+    writeUInt8(static_cast<uint8>(iValue));
+  }
+
+  // zigzag encoding so that small negative values use few bytes as well
+  inline void writeVarInt(int64 iValue)
+  {
+    writeVarUInt((static_cast<uint64>(iValue) << 1) ^ static_cast<uint64>(iValue >> 63));
+  }
+};
+
+//------------------------------------------------------------------------
+// Reader - the counterpart of Writer (fError is set when reading past
+// the end of the buffer)
+//------------------------------------------------------------------------
+struct Reader
+{
+  uint8 const *fBuffer;
+  int32 fSize;
+  int32 fPosition{0};
+  bool fError{false};
+
+  inline uint8 readUInt8()
+  {
+    if(fPosition < fSize)
+      return fBuffer[fPosition++];
+    fError = true;
+    return 0;
+  }
+
+  inline float readFloat()
+  {
+    uint32 bits = 0;
+    for(int i = 0; i < 4; i++)
+      bits |= static_cast<uint32>(readUInt8()) << (i * 8);
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  inline uint64 readVarUInt()
+  {
+    uint64 value = 0;
+    for(int shift = 0; shift < 64 && !fError; shift += 7)
+    {
+      auto byte = readUInt8();
+      value |= static_cast<uint64>(byte & 0x7f) << shift;
+      if((byte & 0x80) == 0)
+        return value;
+    }
+    fError = true;
+    return 0;
+  }
+
+  inline int64 readVarInt()
+  {
+    auto value = readVarUInt();
+    return static_cast<int64>(value >> 1) ^ -static_cast<int64>(value & 1);
+  }
+};
+
+//------------------------------------------------------------------------
+// The optional metrics in the order of their bits (Stats::kMetricXXX)
+//------------------------------------------------------------------------
+inline double getMetric(Stats const &iStats, int iMetric)
+{
+  switch(iMetric)
+  {
+    case 0: return iStats.fRMS;
+    case 1: return iStats.fDCOffset;
+    case 2: return static_cast<double>(iStats.fClipCount);
+    case 3: return iStats.fCorrelation;
+    default: return iStats.fCrestFactor;
+  }
+}
+
+inline void setMetric(Stats &oStats, int iMetric, double iValue)
+{
+  switch(iMetric)
+  {
+    case 0: oStats.fRMS = iValue; break;
+    case 1: oStats.fDCOffset = iValue; break;
+    case 2: oStats.fClipCount = static_cast<int64>(iValue); break;
+    case 3: oStats.fCorrelation = iValue; break;
+    default: oStats.fCrestFactor = iValue; break;
+  }
+}
+
+// bit (in the flags) of the first optional metric
+constexpr int kFirstMetricBit = 1;
+
+}
+
+//------------------------------------------------------------------------
+// StatsCodec::encode
+//------------------------------------------------------------------------
+int32 StatsCodec::encode(Stats const *iStats, int32 iCount, uint8 *oBuffer, int32 iBufferSize)
+{
+  if(iCount < 0 || iCount > StatsBatch::kMaxStats)
+    return -1;
+
+  Writer writer{oBuffer, iBufferSize};
+
+  writer.writeUInt8(kVersion);
+  writer.writeUInt8(static_cast<uint8>(iCount));
+  writer.writeFloat(static_cast<float>(iCount > 0 ? iStats[0].fSampleRate : 0));
+
+  int64 previousSampleTime = 0;
+  int64 previousResetTime = 0;
+  int64 previousMaxProjectTimeSamples = 0;
+
+  for(int32 i = 0; i < iCount; i++)
+  {
+    auto const &stats = iStats[i];
+
+    // the reset time (and max position) rarely change => only sent when they do (always for the first one)
+    uint8 flags = 0;
+    if(i == 0 || stats.fResetTime != previousResetTime || stats.fMaxProjectTimeSamples != previousMaxProjectTimeSamples)
+      flags |= kFlagResetTime;
+    flags |= static_cast<uint8>(stats.fMetrics << kFirstMetricBit) & kOptionalMetricsMask;
+
+    writer.writeUInt8(flags);
+    writer.writeFloat(static_cast<float>(sampleToDb(stats.fMaxSinceReset)));
+    writer.writeVarUInt(static_cast<uint64>(stats.fSampleTime - previousSampleTime));
+    if(flags & kFlagResetTime)
+    {
+      writer.writeVarInt(stats.fResetTime - previousResetTime);
+      writer.writeVarInt(stats.fMaxProjectTimeSamples - previousMaxProjectTimeSamples);
+    }
+    for(int metric = 0; metric < Stats::kNumMetrics; metric++)
+    {
+      if(flags & (1 << (metric + kFirstMetricBit)))
+        writer.writeFloat(static_cast<float>(getMetric(stats, metric)));
+    }
+
+    previousSampleTime = stats.fSampleTime;
+    previousResetTime = stats.fResetTime;
+    previousMaxProjectTimeSamples = stats.fMaxProjectTimeSamples;
+  }
+
+  return writer.fOverflow ? -1 : writer.fPosition;
+}
+
+//------------------------------------------------------------------------
+// StatsCodec::decode
+//------------------------------------------------------------------------
+int32 StatsCodec::decode(uint8 const *iBuffer, int32 iSize, Stats *oStats, int32 iMaxCount)
+{
+  Reader reader{iBuffer, iSize};
+
+  if(reader.readUInt8() != kVersion)
+    return -1;
+
+  int32 count = reader.readUInt8();
+  double sampleRate = reader.readFloat();
+
+  int64 sampleTime = 0;
+  int64 resetTime = 0;
+  int64 maxProjectTimeSamples = 0;
+
+  int32 decoded = 0;
+  for(int32 i = 0; i < count && !reader.fError; i++)
+  {
+    auto flags = reader.readUInt8();
+    auto maxSinceResetInDb = reader.readFloat();
+    sampleTime += static_cast<int64>(reader.readVarUInt());
+    if(flags & kFlagResetTime)
+    {
+      resetTime += reader.readVarInt();
+      maxProjectTimeSamples += reader.readVarInt();
+    }
+
+    // the metrics unknown to this version are read and ignored
+    Stats metrics{};
+    metrics.fMetrics = 0;
+    for(int bit = kFirstMetricBit; bit < 8; bit++)
+    {
+      if(flags & (1 << bit))
+      {
+        auto value = reader.readFloat();
+        auto metric = bit - kFirstMetricBit;
+        if(metric < Stats::kNumMetrics)
+        {
+          setMetric(metrics, metric, value);
+          metrics.fMetrics |= static_cast<uint8>(1 << metric);
+        }
+      }
+    }
+
+    if(reader.fError)
+      break;
+
+    // keeping the most recent snapshots if there is not enough room
+    if(decoded == iMaxCount)
+    {
+      for(int32 j = 1; j < iMaxCount; j++)
+        oStats[j - 1] = oStats[j];
+      decoded--;
+    }
+
+    if(iMaxCount > 0)
+    {
+      auto &stats = oStats[decoded++];
+      stats.fSampleRate = sampleRate;
+      stats.fMaxSinceReset = std::isinf(maxSinceResetInDb) ? 0 : dbToSample<double>(maxSinceResetInDb);
+      stats.fSampleTime = sampleTime;
+      stats.fResetTime = resetTime;
+      stats.fMaxProjectTimeSamples = maxProjectTimeSamples;
+      stats.fMetrics = metrics.fMetrics;
+      stats.fRMS = metrics.fRMS;
+      stats.fDCOffset = metrics.fDCOffset;
+      stats.fClipCount = metrics.fClipCount;
+      stats.fCorrelation = metrics.fCorrelation;
+      stats.fCrestFactor = metrics.fCrestFactor;
+    }
+  }
+
+  return reader.fError ? -1 : decoded;
+}
+
+}
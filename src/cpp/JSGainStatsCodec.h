@@ -0,0 +1,159 @@
+//------------------------------------------------------------------------------------------------------------
+// This file defines the compact (versioned) binary encoding used to send the Stats from the RT to the GUI
+// and the batch of Stats which lets several snapshots travel in a single message (every message goes
+// through the host IConnectionPoint which is costly).
+//
+// Encoding (version 3) - all multi-byte values are little endian:
+//   uint8    version
+//   uint8    count (number of snapshots)
+//   float32  sample rate (shared by all the snapshots of the batch)
+//   count x snapshot:
+//     uint8    flags (see StatsCodec::kFlagXXX)
+//     float32  max since reset in dB
+//     varint   sample time (delta from previous snapshot, the first one being relative to 0)
+//     varint   reset time (zigzag delta from the previous snapshot) [only if kFlagResetTime]
+//     varint   max project time samples (zigzag delta from the previous snapshot) [only if kFlagResetTime
+//              which is set when either one changes: they both change when the max does]
+//     float32  optional metric for each bit set in kOptionalMetricsMask (in bit order): bit 1 is the
+//              first metric of Stats (Stats::kMetricRMS), bit 2 the second one, etc...
+//
+// Every optional metric is encoded as a float32 so that a decoder which does not know about a (newer)
+// metric can still skip it.
+//------------------------------------------------------------------------------------------------------------
+#pragma once
+
+#include "JSGainModel.h"
+
+namespace pongasoft::VST::JSGain {
+
+//------------------------------------------------------------------------
+// StatsBatch - the snapshots taken by the RT since the last message
+// (oldest first). Fixed size (NO memory allocation in RT).
+//------------------------------------------------------------------------
+struct StatsBatch
+{
+  static constexpr int32 kMaxStats = 16;
+
+  int32 fCount{0};
+  Stats fStats[kMaxStats]{};
+
+  // monotonic time at which the RT sent the batch (see JSGainLatency.h)
+  int64 fSendTimeNanos{0};
+
+  // latest - the most recent snapshot (default Stats if empty)
+  inline Stats const &latest() const { return fCount > 0 ? fStats[fCount - 1] : fStats[0]; }
+
+  inline bool isFull() const { return fCount == kMaxStats; }
+
+  //------------------------------------------------------------------------
+  // add - when full, the oldest snapshot is dropped: the latest one is
+  // always the most important one
+  //------------------------------------------------------------------------
+  inline void add(Stats const &iStats)
+  {
+    if(isFull())
+    {
+      for(int32 i = 1; i < kMaxStats; i++)
+        fStats[i - 1] = fStats[i];
+      fCount--;
+    }
+    fStats[fCount++] = iStats;
+  }
+
+  inline void clear() { fCount = 0; }
+};
+
+//------------------------------------------------------------------------
+// StatsCodec - encodes/decodes Stats to/from a byte buffer (no memory
+// allocation)
+//------------------------------------------------------------------------
+class StatsCodec
+{
+public:
+  static constexpr uint8 kVersion = 3;
+
+  // flags
+  static constexpr uint8 kFlagResetTime = 1 << 0;
+  static constexpr uint8 kOptionalMetricsMask = 0xfe; // bits 1-7 reserved for (float32) metrics
+
+  // size of the header (version, count, sample rate)
+  static constexpr int32 kHeaderSize = 1 + 1 + 4;
+
+  // flags + dB + 3 varints (max 10 bytes each) + 7 optional metrics
+  static constexpr int32 kMaxSnapshotSize = 1 + 4 + 10 + 10 + 10 + 7 * 4;
+
+  // maximum size of an encoded batch
+  static constexpr int32 kMaxBatchSize = kHeaderSize + StatsBatch::kMaxStats * kMaxSnapshotSize;
+
+  //------------------------------------------------------------------------
+  // Encodes iCount snapshots into oBuffer and returns the number of bytes
+  // written (or -1 if iBufferSize is too small or iCount is invalid)
+  //------------------------------------------------------------------------
+  static int32 encode(Stats const *iStats, int32 iCount, uint8 *oBuffer, int32 iBufferSize);
+
+  //------------------------------------------------------------------------
+  // Decodes the snapshots from iBuffer into oStats (up to iMaxCount) and
+  // returns how many were decoded (or -1 if the buffer is invalid or
+  // encoded with an unsupported version)
+  //------------------------------------------------------------------------
+  static int32 decode(uint8 const *iBuffer, int32 iSize, Stats *oStats, int32 iMaxCount);
+};
+
+//------------------------------------------------------------------------
+// This class is the param serializer used in JSGainPlugin.h which defines
+// how to serialize/deserialize a StatsBatch (using StatsCodec) so that it
+// can be sent in a message. The send time travels next to the encoded
+// snapshots: it belongs to the message, not to the snapshots.
+//------------------------------------------------------------------------
+class StatsBatchParamSerializer : public IParamSerializer<StatsBatch>
+{
+public:
+  // deserialize / readFromStream
+  inline tresult readFromStream(IBStreamer &iStreamer, ParamType &oValue) const override
+  {
+    int64 sendTimeNanos{};
+    if(IBStreamHelper::readInt64(iStreamer, sendTimeNanos) != kResultOk)
+      return kResultFalse;
+
+    int32 size{};
+    if(IBStreamHelper::readInt32(iStreamer, size) != kResultOk || size <= 0 || size > StatsCodec::kMaxBatchSize)
+      return kResultFalse;
+
+    uint8 buffer[StatsCodec::kMaxBatchSize];
+    if(!iStreamer.readRaw(buffer, size))
+      return kResultFalse;
+
+    auto count = StatsCodec::decode(buffer, size, oValue.fStats, StatsBatch::kMaxStats);
+    if(count < 0)
+      return kResultFalse;
+
+    oValue.fCount = count;
+    oValue.fSendTimeNanos = sendTimeNanos;
+    return kResultOk;
+  }
+
+  // serialize / writeToStream
+  inline tresult writeToStream(const ParamType &iValue, IBStreamer &oStreamer) const override
+  {
+    uint8 buffer[StatsCodec::kMaxBatchSize];
+    auto size = StatsCodec::encode(iValue.fStats, iValue.fCount, buffer, StatsCodec::kMaxBatchSize);
+    if(size < 0)
+      return kResultFalse;
+
+    oStreamer.writeInt64(iValue.fSendTimeNanos);
+    oStreamer.writeInt32(size);
+    oStreamer.writeRaw(buffer, size);
+    return kResultOk;
+  }
+
+  //------------------------------------------------------------------------
+  // This optional method implementation allows the param to be displayed
+  // (see Debug::ParamTable or Debug::ParamLine classes)
+  //------------------------------------------------------------------------
+  void writeToStream(ParamType const &iValue, std::ostream &oStream) const override
+  {
+    oStream << toDbString(iValue.latest().fMaxSinceReset);
+  }
+};
+
+}
@@ -0,0 +1,284 @@
+//------------------------------------------------------------------------
+// This file contains the implementation of the RT logger (formatting and
+// background thread writing the messages of all the loggers)
+//------------------------------------------------------------------------
+#include "RTLogger.h"
+
+#include <pongasoft/logging/logging.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pongasoft::VST::JSGain::Log {
+
+namespace {
+
+// how often the background thread writes the messages (the RT never wakes it up: it would need a lock)
+constexpr auto kFlushInterval = std::chrono::milliseconds{20};
+
+//------------------------------------------------------------------------
+// defaultSink
+//------------------------------------------------------------------------
+void defaultSink(std::string const &iName, std::string const &iMessage)
+{
+  LOG_F(INFO, "[%s] %s", iName.c_str(), iMessage.c_str());
+}
+
+//------------------------------------------------------------------------
+// Writer - the background thread. It only runs while at least one logger
+// is started. fLifecycleMutex serializes add/remove (so that a thread
+// being stopped is never mistaken for a running one) while fMutex protects
+// the loggers and the sink (held while flushing).
+//------------------------------------------------------------------------
+class Writer
+{
+public:
+  ~Writer()
+  {
+    std::lock_guard<std::mutex> lifecycle{fLifecycleMutex};
+    stopThread();
+  }
+
+  // add
+  void add(RTLogger *iLogger)
+  {
+    std::lock_guard<std::mutex> lifecycle{fLifecycleMutex};
+    {
+      std::lock_guard<std::mutex> lock{fMutex};
+      fLoggers.emplace_back(iLogger);
+    }
+    if(!fThread.joinable())
+    {
+      fStopRequested = false;
+      fThread = std::thread{[this] { run(); }};
+    }
+  }
+
+  // remove - writes what is left in the logger
+  void remove(RTLogger *iLogger)
+  {
+    std::lock_guard<std::mutex> lifecycle{fLifecycleMutex};
+    bool empty;
+    {
+      std::lock_guard<std::mutex> lock{fMutex};
+      fLoggers.erase(std::remove(fLoggers.begin(), fLoggers.end(), iLogger), fLoggers.end());
+      iLogger->flush(fSink);
+      empty = fLoggers.empty();
+    }
+    if(empty)
+      stopThread();
+  }
+
+  // setSink
+  void setSink(RTLogger::Sink iSink)
+  {
+    std::lock_guard<std::mutex> lock{fMutex};
+    fSink = iSink ? std::move(iSink) : RTLogger::Sink{defaultSink};
+  }
+
+private:
+  // run - the loop of the background thread
+  void run()
+  {
+    std::unique_lock<std::mutex> lock{fMutex};
+    while(!fStopRequested)
+    {
+      fCondition.wait_for(lock, kFlushInterval, [this] { return fStopRequested; });
+      for(auto logger: fLoggers)
+        logger->flush(fSink);
+    }
+  }
+
+  // stopThread - requires fLifecycleMutex
+  void stopThread()
+  {
+    if(!fThread.joinable())
+      return;
+
+    {
+      std::lock_guard<std::mutex> lock{fMutex};
+      fStopRequested = true;
+    }
+    fCondition.notify_one();
+    fThread.join();
+  }
+
+private:
+  std::mutex fLifecycleMutex{};
+  std::thread fThread{};
+
+  std::mutex fMutex{};
+  std::condition_variable fCondition{};
+  bool fStopRequested{false};
+  std::vector<RTLogger *> fLoggers{};
+  RTLogger::Sink fSink{defaultSink};
+};
+
+// getWriter
+Writer &getWriter()
+{
+  static Writer sWriter{};
+  return sWriter;
+}
+
+//------------------------------------------------------------------------
+// isOneOf
+//------------------------------------------------------------------------
+inline bool isOneOf(char c, char const *iChars)
+{
+  return c != '\0' && std::strchr(iChars, c) != nullptr;
+}
+
+//------------------------------------------------------------------------
+// appendArg - formats one argument with the conversion iSpec (ex: "%-8.3")
+// and iConversion (ex: 'f')
+//------------------------------------------------------------------------
+void appendArg(std::string &oMessage, std::string &ioSpec, char iConversion, Arg const &iArg, char const *iText)
+{
+  char buffer[128];
+  int size = 0;
+
+  switch(iArg.fType)
+  {
+    case Arg::Type::kInt:
+      if(isOneOf(iConversion, "fFeEgGaA"))
+      {
+        ioSpec += iConversion;
+        size = std::snprintf(buffer, sizeof(buffer), ioSpec.c_str(), static_cast<double>(iArg.fInt));
+      }
+      else if(isOneOf(iConversion, "ouxX"))
+      {
+        ioSpec += "ll";
+        ioSpec += iConversion;
+        size = std::snprintf(buffer, sizeof(buffer), ioSpec.c_str(), static_cast<unsigned long long>(iArg.fInt));
+      }
+      else if(iConversion == 'c')
+      {
+        ioSpec += 'c';
+        size = std::snprintf(buffer, sizeof(buffer), ioSpec.c_str(), static_cast<int>(iArg.fInt));
+      }
+      else
+      {
+        ioSpec += "lld";
+        size = std::snprintf(buffer, sizeof(buffer), ioSpec.c_str(), static_cast<long long>(iArg.fInt));
+      }
+      break;
+
+    case Arg::Type::kDouble:
+      ioSpec += isOneOf(iConversion, "fFeEgGaA") ? iConversion : 'g';
+      size = std::snprintf(buffer, sizeof(buffer), ioSpec.c_str(), iArg.fDouble);
+      break;
+
+    case Arg::Type::kText:
+      ioSpec += 's';
+      size = std::snprintf(buffer, sizeof(buffer), ioSpec.c_str(), iText + iArg.fTextOffset);
+      break;
+  }
+
+  if(size > 0)
+    oMessage.append(buffer, std::min<size_t>(static_cast<size_t>(size), sizeof(buffer) - 1));
+}
+
+}
+
+//------------------------------------------------------------------------
+// Record::format
+//------------------------------------------------------------------------
+void Record::format(std::string &oMessage) const
+{
+  oMessage.clear();
+
+  int argIndex = 0;
+  std::string spec{};
+  for(auto c = fFormat; *c; c++)
+  {
+    if(*c != '%')
+    {
+      oMessage += *c;
+      continue;
+    }
+
+    if(c[1] == '%')
+    {
+      oMessage += '%';
+      c++;
+      continue;
+    }
+
+    // flags, width and precision are kept, length modifiers are dropped
+    spec = "%";
+    for(c++; isOneOf(*c, "-+ #0123456789."); c++)
+      spec += *c;
+    while(isOneOf(*c, "hlLqjzt"))
+      c++;
+
+    if(*c == '\0')
+      break;
+
+    if(argIndex < fNumArgs)
+      appendArg(oMessage, spec, *c, fArgs[argIndex++], fText);
+    else
+      oMessage += "<?>";
+  }
+}
+
+//------------------------------------------------------------------------
+// RTLogger::start
+//------------------------------------------------------------------------
+void RTLogger::start(std::string iName)
+{
+  if(fStarted)
+    return;
+
+  fName = std::move(iName);
+  fStarted = true;
+  getWriter().add(this);
+}
+
+//------------------------------------------------------------------------
+// RTLogger::stop
+//------------------------------------------------------------------------
+void RTLogger::stop()
+{
+  if(!fStarted)
+    return;
+
+  getWriter().remove(this);
+  fStarted = false;
+}
+
+//------------------------------------------------------------------------
+// RTLogger::flush
+//------------------------------------------------------------------------
+size_t RTLogger::flush(Sink const &iSink)
+{
+  auto count = fQueue.drain([this, &iSink](Record const &iRecord) {
+    iRecord.format(fMessage);
+    iSink(fName, fMessage);
+  });
+
+  auto droppedCount = getDroppedCount();
+  if(droppedCount != fReportedDroppedCount)
+  {
+    iSink(fName, std::to_string(droppedCount - fReportedDroppedCount) + " message(s) dropped (queue full)");
+    fReportedDroppedCount = droppedCount;
+  }
+
+  return count;
+}
+
+//------------------------------------------------------------------------
+// RTLogger::setSink
+//------------------------------------------------------------------------
+void RTLogger::setSink(Sink iSink)
+{
+  getWriter().setSink(std::move(iSink));
+}
+
+}
@@ -0,0 +1,192 @@
+//------------------------------------------------------------------------------------------------------------
+// This file defines the logger used by the RT. Formatting a message (snprintf, locale...) and writing it to
+// the log (file, console, mutex in loguru) can take an unbounded amount of time, which is why DLOG_F was only
+// used in debug builds on the audio thread. Instead:
+//
+// - the RT pushes a fixed size binary record (the format, which must be a literal, and up to kMaxArgs
+//   arguments, strings being copied) in a lock-free queue owned by the logger (no allocation, no lock)
+// - a background thread (shared by all the loggers of the process) regularly pops the records, formats them
+//   and writes them with LOG_F (so they also show up in release builds)
+// - when the queue is full, the record is dropped and counted (reported with the next message written)
+//
+// RTLogger::log is the only method which can be called from the RT (and only from one thread: the queue is
+// single producer). Everything else (start, stop, flush) must be called outside the RT.
+//------------------------------------------------------------------------------------------------------------
+#pragma once
+
+#include "../Concurrent/SPSCQueue.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <type_traits>
+
+namespace pongasoft::VST::JSGain::Log {
+
+constexpr int kMaxArgs = 4;
+constexpr size_t kMaxTextSize = 96; // for all the string arguments of one record (truncated otherwise)
+constexpr size_t kQueueCapacity = 256; // records per logger (power of 2)
+
+//------------------------------------------------------------------------
+// Arg - one argument of a record (strings are stored in Record::fText)
+//------------------------------------------------------------------------
+struct Arg
+{
+  enum class Type : uint8_t
+  {
+    kInt,
+    kDouble,
+    kText
+  };
+
+  Type fType;
+  union
+  {
+    int64_t fInt;
+    double fDouble;
+    uint32_t fTextOffset;
+  };
+};
+
+//------------------------------------------------------------------------
+// Record - what the RT pushes in the queue (trivially copyable)
+//------------------------------------------------------------------------
+struct Record
+{
+  char const *fFormat; // printf like format (must be a literal: only the pointer is recorded)
+  uint8_t fNumArgs;
+  uint8_t fTextSize;
+  Arg fArgs[kMaxArgs];
+  char fText[kMaxTextSize];
+
+  // add - adds one argument (integral, enum, floating point or C string)
+  template<typename T>
+  inline void add(T iValue)
+  {
+    auto &arg = fArgs[fNumArgs++];
+    if constexpr(std::is_same_v<T, char const *> || std::is_same_v<T, char *>)
+    {
+      arg.fType = Arg::Type::kText;
+      addText(arg, iValue);
+    }
+    else if constexpr(std::is_floating_point_v<T>)
+    {
+      arg.fType = Arg::Type::kDouble;
+      arg.fDouble = iValue;
+    }
+    else
+    {
+      static_assert(std::is_integral_v<T> || std::is_enum_v<T>, "Unsupported log argument type");
+      arg.fType = Arg::Type::kInt;
+      arg.fInt = static_cast<int64_t>(iValue);
+    }
+  }
+
+  //------------------------------------------------------------------------
+  // format - formats the message: the conversions of fFormat are applied to
+  // the arguments (the length modifiers are ignored: the type is the one of
+  // the argument). NOT RT safe.
+  //------------------------------------------------------------------------
+  void format(std::string &oMessage) const;
+
+private:
+  // copies iText in fText (truncated when there is no room left)
+  inline void addText(Arg &oArg, char const *iText)
+  {
+    if(fTextSize == kMaxTextSize)
+    {
+      oArg.fTextOffset = kMaxTextSize - 1; // the terminator of the previous string
+      return;
+    }
+
+    oArg.fTextOffset = fTextSize;
+    auto size = fTextSize;
+    for(auto c = iText ? iText : "(null)"; *c && size < kMaxTextSize - 1; c++)
+      fText[size++] = *c;
+    fText[size++] = '\0';
+    fTextSize = static_cast<uint8_t>(size);
+  }
+};
+
+static_assert(kMaxTextSize < 256, "fTextSize is 8 bits");
+
+//------------------------------------------------------------------------
+// RTLogger - one per processor (see class comment at the top)
+//------------------------------------------------------------------------
+class RTLogger
+{
+public:
+  // where the formatted messages are written (iName is the name of the logger)
+  using Sink = std::function<void(std::string const &iName, std::string const &iMessage)>;
+
+  RTLogger() = default;
+  ~RTLogger() { stop(); }
+
+  RTLogger(RTLogger const &) = delete;
+  RTLogger &operator=(RTLogger const &) = delete;
+
+  //------------------------------------------------------------------------
+  // log - RT safe: records the message to be formatted and written later by
+  // the background thread. Returns false when it was dropped (queue full).
+  // iFormat must be a literal. Strings are copied (they can be a buffer
+  // reused right after).
+  //------------------------------------------------------------------------
+  template<typename... Args>
+  inline bool log(char const *iFormat, Args... iArgs)
+  {
+    static_assert(sizeof...(Args) <= kMaxArgs, "Too many log arguments");
+
+    Record record;
+    record.fFormat = iFormat;
+    record.fNumArgs = 0;
+    record.fTextSize = 0;
+    (record.add(iArgs), ...);
+
+    if(!fQueue.push(record))
+    {
+      fDroppedCount.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    return true;
+  }
+
+  // start - the background thread writes the messages of this logger (until stop). NOT RT safe.
+  void start(std::string iName);
+
+  // stop - writes the messages still in the queue and detaches from the background thread. NOT RT safe.
+  void stop();
+
+  bool isStarted() const { return fStarted; }
+  std::string const &getName() const { return fName; }
+
+  //------------------------------------------------------------------------
+  // flush - formats and writes (to iSink) all the messages in the queue.
+  // Called by the background thread: only call it directly when the logger
+  // is not started (single consumer). Returns the number of messages.
+  //------------------------------------------------------------------------
+  size_t flush(Sink const &iSink);
+
+  // number of messages dropped since the logger was created
+  uint64_t getDroppedCount() const { return fDroppedCount.load(std::memory_order_relaxed); }
+
+  //------------------------------------------------------------------------
+  // setSink - changes where all the loggers write (nullptr restores the
+  // default: LOG_F). Mostly for testing. NOT RT safe.
+  //------------------------------------------------------------------------
+  static void setSink(Sink iSink);
+
+private:
+  Concurrent::SPSCQueue<Record, kQueueCapacity> fQueue{};
+
+  // incremented by the RT, read by the background thread
+  alignas(Concurrent::kCacheLineSize) std::atomic<uint64_t> fDroppedCount{0};
+
+  // the rest is only accessed outside the RT
+  uint64_t fReportedDroppedCount{0};
+  std::string fName{};
+  bool fStarted{false};
+  std::string fMessage{};
+};
+
+}
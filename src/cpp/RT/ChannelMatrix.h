@@ -0,0 +1,190 @@
+//------------------------------------------------------------------------------------------------------------
+// This file defines the routing stage applied before the gain: an N (inputs) x M (outputs) gain matrix built
+// from the routing parameter (see ERouting) and the actual channel layout of the buses.
+//
+// The matrix is classified when it is built so that the processor only pays for what the routing needs:
+// - identity: the inputs are used as is (same cost as no routing at all)
+// - sparse: every output is a single input times a coefficient (swap, polarity invert, upmix...). No mixing
+//   happens: the processor simply reads from another input and folds the coefficient into the gain
+// - dense: the outputs are a weighted sum of several inputs (downmix, mid/side...) computed by mix
+//------------------------------------------------------------------------------------------------------------
+#pragma once
+
+#include "../JSGainModel.h"
+
+#include <algorithm>
+
+namespace pongasoft::VST::JSGain::RT {
+
+class ChannelMatrix
+{
+public:
+  // the buses are (at most) stereo
+  static constexpr int32 kMaxChannels = 2;
+
+  // number of frames mixed at a time (per channel) by mix (see below)
+  static constexpr int32 kTileFrames = 64;
+
+  enum class Kind
+  {
+    kIdentity,
+    kSparse,
+    kDense
+  };
+
+  // Constructor (identity)
+  explicit ChannelMatrix(int32 iNumInputs = kMaxChannels, int32 iNumOutputs = kMaxChannels) :
+    fNumInputs{std::clamp(iNumInputs, 1, kMaxChannels)},
+    fNumOutputs{std::clamp(iNumOutputs, 1, kMaxChannels)}
+  {
+    for(int32 out = 0; out < fNumOutputs; out++)
+      fGains[out][std::min(out, fNumInputs - 1)] = 1.0;
+    classify();
+  }
+
+  //------------------------------------------------------------------------
+  // fromRouting - the routing is defined for stereo (P). The matrix for the
+  // actual layout is D x P x U where U duplicates a mono input on both
+  // channels and D averages both channels into a mono output. For example
+  // stereo in / mono out is a downmix, mono in / stereo out an upmix.
+  //------------------------------------------------------------------------
+  static ChannelMatrix fromRouting(ERouting iRouting, int32 iNumInputs, int32 iNumOutputs)
+  {
+    double P[kMaxChannels][kMaxChannels]{};
+    switch(iRouting)
+    {
+      case ERouting::kStereo:      P[0][0] = 1.0;  P[1][1] = 1.0;  break;
+      case ERouting::kSwap:        P[0][1] = 1.0;  P[1][0] = 1.0;  break;
+      case ERouting::kMono:        P[0][0] = 0.5;  P[0][1] = 0.5;  P[1][0] = 0.5; P[1][1] = 0.5; break;
+      case ERouting::kLeftOnly:    P[0][0] = 1.0;  P[1][0] = 1.0;  break;
+      case ERouting::kRightOnly:   P[0][1] = 1.0;  P[1][1] = 1.0;  break;
+      case ERouting::kInvertLeft:  P[0][0] = -1.0; P[1][1] = 1.0;  break;
+      case ERouting::kInvertRight: P[0][0] = 1.0;  P[1][1] = -1.0; break;
+      case ERouting::kInvertBoth:  P[0][0] = -1.0; P[1][1] = -1.0; break;
+      case ERouting::kMidSide:     P[0][0] = 0.5;  P[0][1] = 0.5;  P[1][0] = 0.5; P[1][1] = -0.5; break;
+    }
+
+    ChannelMatrix matrix{iNumInputs, iNumOutputs};
+
+    for(int32 out = 0; out < matrix.fNumOutputs; out++)
+    {
+      for(int32 in = 0; in < matrix.fNumInputs; in++)
+      {
+        double gain = 0;
+        for(int32 i = 0; i < kMaxChannels; i++)
+        {
+          // D: a mono output is the average of both (stereo) channels
+          auto d = matrix.fNumOutputs == 1 ? 0.5 : (i == out ? 1.0 : 0.0);
+          for(int32 j = 0; j < kMaxChannels; j++)
+          {
+            // U: a mono input feeds both (stereo) channels
+            auto u = matrix.fNumInputs == 1 ? 1.0 : (j == in ? 1.0 : 0.0);
+            gain += d * P[i][j] * u;
+          }
+        }
+        matrix.fGains[out][in] = gain;
+      }
+    }
+
+    matrix.classify();
+    return matrix;
+  }
+
+  inline Kind getKind() const { return fKind; }
+  inline int32 getNumInputs() const { return fNumInputs; }
+  inline int32 getNumOutputs() const { return fNumOutputs; }
+  inline double getGain(int32 iOutput, int32 iInput) const { return fGains[iOutput][iInput]; }
+
+  // sparse (or identity) only: the (single) input feeding iOutput and its coefficient
+  inline int32 getSource(int32 iOutput) const { return fSources[iOutput]; }
+  inline double getCoefficient(int32 iOutput) const { return fCoefficients[iOutput]; }
+
+  //------------------------------------------------------------------------
+  // mix - oOut[out] = sum(gain[out][in] * iIn[in]) for every output. The
+  // frames are processed kTileFrames at a time: every input tile is read
+  // while it is in L1 for all the outputs, and the outputs are accumulated
+  // in a local tile (no aliasing => vectorized) before being copied out.
+  // This also means that oOut may be the same buffers as iIn (in place
+  // processing, which some hosts do).
+  //------------------------------------------------------------------------
+  template<typename SampleType>
+  void mix(SampleType const * const *iIn, SampleType * const *oOut, int32 iNumFrames) const
+  {
+    SampleType tile[kMaxChannels][kTileFrames];
+
+    for(int32 offset = 0; offset < iNumFrames; offset += kTileFrames)
+    {
+      auto numFrames = std::min(kTileFrames, iNumFrames - offset);
+
+      for(int32 out = 0; out < fNumOutputs; out++)
+      {
+        auto t = tile[out];
+        std::fill(t, t + numFrames, SampleType{0});
+        for(int32 in = 0; in < fNumInputs; in++)
+        {
+          auto gain = static_cast<SampleType>(fGains[out][in]);
+          if(gain == 0)
+            continue;
+          auto s = iIn[in] + offset;
+          for(int32 i = 0; i < numFrames; i++)
+            t[i] += gain * s[i];
+        }
+      }
+
+      for(int32 out = 0; out < fNumOutputs; out++)
+        std::copy(tile[out], tile[out] + numFrames, oOut[out] + offset);
+    }
+  }
+
+  // equality (used by the processor to rebuild the matrix only when something changes)
+  inline bool operator==(ChannelMatrix const &iOther) const
+  {
+    if(fNumInputs != iOther.fNumInputs || fNumOutputs != iOther.fNumOutputs)
+      return false;
+    for(int32 out = 0; out < fNumOutputs; out++)
+      for(int32 in = 0; in < fNumInputs; in++)
+        if(fGains[out][in] != iOther.fGains[out][in])
+          return false;
+    return true;
+  }
+
+private:
+  void classify()
+  {
+    bool identity = fNumInputs == fNumOutputs;
+    bool sparse = true;
+
+    for(int32 out = 0; out < fNumOutputs; out++)
+    {
+      int32 numSources = 0;
+      fSources[out] = 0;
+      fCoefficients[out] = 0;
+      for(int32 in = 0; in < fNumInputs; in++)
+      {
+        auto gain = fGains[out][in];
+        if(gain != (in == out ? 1.0 : 0.0))
+          identity = false;
+        if(gain != 0)
+        {
+          numSources++;
+          fSources[out] = in;
+          fCoefficients[out] = gain;
+        }
+      }
+      if(numSources > 1)
+        sparse = false;
+    }
+
+    fKind = identity ? Kind::kIdentity : (sparse ? Kind::kSparse : Kind::kDense);
+  }
+
+  int32 fNumInputs;
+  int32 fNumOutputs;
+  double fGains[kMaxChannels][kMaxChannels]{}; // [output][input]
+
+  Kind fKind{Kind::kIdentity};
+  int32 fSources[kMaxChannels]{};
+  double fCoefficients[kMaxChannels]{};
+};
+
+}
@@ -0,0 +1,51 @@
+//------------------------------------------------------------------------------------------------------------
+// This file defines the gain modulation: the samples of the (optional) "Modulation In" auxiliary bus are a per
+// sample gain multiplier, either linear or in dB (see EModulationMode), applied on top of the gain parameters.
+// This lets an external envelope (ex: a ducking signal from another plugin) drive the gain at audio rate
+// instead of going through parameter automation (limited resolution, floods the parameter queue).
+//
+// The modulations are functors passed to the fused gain + analysis loop (see Reducers.h) so that the
+// multiplier is computed in the same pass. When the bus is not connected, the loop is the unmodulated one.
+//------------------------------------------------------------------------------------------------------------
+#pragma once
+
+#include "../JSGainModel.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace pongasoft::VST::JSGain::RT {
+
+//------------------------------------------------------------------------
+// LinearModulation - the sample is the multiplier (1.0 = unchanged)
+//------------------------------------------------------------------------
+template<typename SampleType>
+struct LinearModulation
+{
+  SampleType const *fBuffer;
+
+  inline SampleType operator()(int32 iFrame) const { return fBuffer[iFrame]; }
+};
+
+//------------------------------------------------------------------------
+// DecibelModulation - the sample is the gain in dB (0.0 = unchanged,
+// -oo = silence). Capped at kMaxDb so that a bogus signal (ex: full scale
+// audio routed to the bus by mistake) cannot blow up the output.
+//------------------------------------------------------------------------
+template<typename SampleType>
+struct DecibelModulation
+{
+  static constexpr SampleType kMaxDb = 24;
+
+  // 10^(dB/20) = e^(dB * ln(10) / 20)
+  static constexpr SampleType kDbToExponent = static_cast<SampleType>(0.11512925464970228);
+
+  SampleType const *fBuffer;
+
+  inline SampleType operator()(int32 iFrame) const
+  {
+    return std::exp(std::min(fBuffer[iFrame], kMaxDb) * kDbToExponent);
+  }
+};
+
+}
@@ -4,10 +4,18 @@
 #include <pongasoft/VST/AudioBuffer.h>
 #include <pongasoft/VST/Debug/ParamTable.h>
 #include <pongasoft/VST/Debug/ParamLine.h>
+#include <base/source/fstreamer.h>
+#include <public.sdk/source/common/memorystream.h>
 
 
 #include "JSGainProcessor.h"
 
+#include <cstdio>
+#include <cstring>
+#if JSGAIN_ENABLE_TELEMETRY
+#include <chrono>
+#endif
+
 #include "version.h"
 #include "jamba_version.h"
 
@@ -64,6 +72,33 @@ tresult JSGainProcessor::initialize(FUnknown *context)
   addAudioInput(STR16 ("Stereo In"), SpeakerArr::kStereo);
   addAudioOutput(STR16 ("Stereo Out"), SpeakerArr::kStereo);
 
+  // optional per sample gain multiplier (not active by default, see activateBus)
+  addAudioInput(STR16 ("Modulation In"), SpeakerArr::kMono, kAux, 0);
+
+  //------------------------------------------------------------------------
+  // The data shared directly with the GUI (see JSGainSharedInstance.h).
+  // Allocating memory and locking (registry) is ok here (not the RT).
+  //------------------------------------------------------------------------
+  fSharedInstance = std::make_shared<JSGainSharedInstance>();
+  fInstanceToken = JSGainInstanceRegistry::add(fSharedInstance);
+
+  // starts (if necessary) the thread writing the messages logged by the RT
+  fLogger.start("JSGain#" + std::to_string(fInstanceToken.fId));
+
+  // the levels of this instance are published for the mixer overview (see JSGainMeterRegistry.h)
+  fMeterSlot = MeterRegistry::claim(fInstanceToken);
+  if(!fMeterSlot)
+    DLOG_F(WARNING, "No meter slot available (more than %d instances)", MeterRegistry::kMaxSlots);
+
+#if JSGAIN_ENABLE_TELEMETRY
+  //------------------------------------------------------------------------
+  // The state of this instance is published in shared memory (see
+  // Telemetry.h). Opening the segment uses syscalls => this cannot be done
+  // in the RT.
+  //------------------------------------------------------------------------
+  fTelemetry.open();
+#endif
+
   //------------------------------------------------------------------------
   // In debug mode this code displays the order in which the RT parameters
   // will be saved
@@ -85,6 +120,30 @@ tresult JSGainProcessor::terminate()
 {
   DLOG_F(INFO, "JSGainProcessor::terminate()");
 
+#if JSGAIN_ENABLE_TELEMETRY
+  fTelemetry.close();
+#endif
+
+  // the GUI may still be using it (shared_ptr) but it won't be found anymore
+  JSGainInstanceRegistry::remove(fInstanceToken);
+  fInstanceToken = {};
+
+  MeterRegistry::release(fMeterSlot);
+  fMeterSlot = nullptr;
+
+  // the RT is not processing anymore: the writer thread writes what is left and closes the file
+  fRTCaptureWriter = nullptr;
+  fCaptureTap = ECaptureTap::kOff;
+  fCaptureRequested = false;
+  fCaptureWriter = nullptr;
+
+  fRTProcessRecorder = nullptr;
+  fProcessRecordingRequested = false;
+  fProcessRecorder = nullptr;
+
+  // writes what is left
+  fLogger.stop();
+
   return RTProcessor::terminate();
 }
 
@@ -107,6 +166,13 @@ tresult JSGainProcessor::setupProcessing(ProcessSetup &setup)
          setup.maxSamplesPerBlock,
          setup.sampleRate);
 
+  fStatsFlushIntervalSamples = static_cast<int64>(setup.sampleRate * kStatsFlushIntervalMs / 1000.0);
+  fLevelHistogramIntervalSamples = static_cast<int64>(setup.sampleRate * kLevelHistogramIntervalMs / 1000.0);
+  fVuPPMThrottle.setup(fVuPPMThrottle.getConfig(), setup.sampleRate);
+
+  if(fSharedInstance)
+    fSharedInstance->fSampleRate.store(setup.sampleRate, std::memory_order_relaxed);
+
   return result;
 }
 
@@ -126,6 +192,21 @@ tresult JSGainProcessor::setActive(TBool iActive)
   //------------------------------------------------------------------------
   if(iActive)
   {
+    fFrameCount = 0;
+    fSampleClock = 0;
+    fLastStatsFlushSampleClock = 0;
+    fLastLevelHistogramSampleClock = 0;
+    fAnalysis = JSGainAnalysis{};
+    fIntervalPeak = 0;
+    fLastMetrics = Stats{};
+    fVuPPMThrottle.reset();
+    fUICommandLatency.clear();
+
+    // lets the GUI know where to find the shared instance
+    fState.fInstanceToken.broadcast(fInstanceToken);
+#if JSGAIN_ENABLE_TELEMETRY
+    fMaxBlockDurationNanos = 0;
+#endif
     resetStats();
   }
 
@@ -137,65 +218,399 @@ tresult JSGainProcessor::setActive(TBool iActive)
 //------------------------------------------------------------------------
 void JSGainProcessor::resetStats()
 {
+  JSGAIN_TRACE_ZONE("resetStats");
+
   // we reset the max
   fState.fMaxSinceReset = 0;
+  fResetTime = Clock::getCurrentTimeMillis();
+  fMaxProjectTimeSamples = -1;
+
+  if(fMeterSlot)
+    fMeterSlot->resetClipCount();
+
+  addStats();
+
+  // the GUI should know about a reset right away
+  flushStats();
+}
 
+//------------------------------------------------------------------------
+// JSGainProcessor::addStats - adds a snapshot of the stats to the batch
+// which will be sent to the GUI (see flushStats)
+//------------------------------------------------------------------------
+void JSGainProcessor::addStats()
+{
+  fPendingStats.add(makeStats());
+}
+
+//------------------------------------------------------------------------
+// JSGainProcessor::makeStats
+//------------------------------------------------------------------------
+Stats JSGainProcessor::makeStats() const
+{
   Stats stats{};
   stats.fSampleRate = processSetup.sampleRate;
   stats.fMaxSinceReset = fState.fMaxSinceReset;
-  stats.fResetTime = Clock::getCurrentTimeMillis();
+  stats.fResetTime = fResetTime;
+  stats.fSampleTime = fSampleClock;
+  stats.fMaxProjectTimeSamples = fMaxProjectTimeSamples;
+  return stats;
+}
 
+//------------------------------------------------------------------------
+// JSGainProcessor::flushStats - sends all the snapshots accumulated since
+// the previous flush at once (one message or one write in the shared slot)
+//------------------------------------------------------------------------
+void JSGainProcessor::flushStats()
+{
   //------------------------------------------------------------------------
-  // This is how easy it is to send the stats to the GUI...
+  // Writes the batch in place (lambda version of the broadcast API or
+  // seqlock update) so there is no additional copy of the batch (only the
+  // snapshots in use are copied)
   //------------------------------------------------------------------------
-  fState.fStats.broadcast(stats);
+  auto copyPendingStats = [this](StatsBatch &oBatch) {
+    oBatch.fCount = fPendingStats.fCount;
+    std::copy(fPendingStats.fStats, fPendingStats.fStats + fPendingStats.fCount, oBatch.fStats);
+    oBatch.fSendTimeNanos = getMonotonicTimeNanos();
+  };
+
+  //------------------------------------------------------------------------
+  // When the GUI lives in the same process (it found the shared instance,
+  // see JSGainController::attachSharedInstance) the stats are simply
+  // written in the shared seqlock slot: no serialization, no message, no
+  // host. Otherwise they go through the host like any other Jmb param.
+  //------------------------------------------------------------------------
+  if(fSharedInstance && fSharedInstance->hasStatsReader())
+    fSharedInstance->fStats.update(copyPendingStats);
+  else
+    fState.fStats.broadcast([&copyPendingStats](StatsBatch *oBatch) { copyPendingStats(*oBatch); });
+
+  fPendingStats.clear();
+  fLastStatsFlushSampleClock = fSampleClock;
+  scheduleHousekeeping();
 }
 
 //------------------------------------------------------------------------
-// processChannel => implements the business logic on a single channel
-// (left or right). Uses the AudioBuffers and Channel helper classes
-// provided by Jamba. The logic is pretty simple: iterate over each sample,
-// multiply by the gain and keep track of the absolute max (peak value) and
-// silence flag.
+// JSGainProcessor::scheduleHousekeeping - computes the next time (sample
+// clock) at which one of the periodic tasks is due
 //------------------------------------------------------------------------
-template<typename SampleType>
-SampleType processChannel(typename AudioBuffers<SampleType>::Channel const &iIn,
-                          typename AudioBuffers<SampleType>::Channel iOut,
-                          Gain const &iGain)
+void JSGainProcessor::scheduleHousekeeping()
 {
-  DCHECK_F(iIn.getNumSamples() == iOut.getNumSamples(), "sanity check on number of samples");
+  fNextHousekeepingSampleClock = std::min(fLastStatsFlushSampleClock + fStatsFlushIntervalSamples,
+                                          fLastLevelHistogramSampleClock + fLevelHistogramIntervalSamples);
+}
 
-  SampleType max = 0;
+//------------------------------------------------------------------------
+// JSGainProcessor::handleHousekeeping
+// The periodic (non audio) tasks: the metrics (only when they changed)
+// and the stats batch are sent every kStatsFlushIntervalMs, the level
+// histogram every kLevelHistogramIntervalMs. Called only when one of them is due (see
+// genericProcessInputs) so that a frame where nothing is due costs a
+// single comparison.
+//------------------------------------------------------------------------
+void JSGainProcessor::handleHousekeeping()
+{
+  //------------------------------------------------------------------------
+  // Every broadcast ends up being a message going through the host, so
+  // instead of sending each snapshot separately, they are batched and
+  // sent at most every kStatsFlushIntervalMs (or when the batch is full,
+  // see handleMax). The metrics are added once per interval.
+  //------------------------------------------------------------------------
+  if(fSampleClock - fLastStatsFlushSampleClock >= fStatsFlushIntervalSamples)
+  {
+    addMetricsStats();
+    if(fPendingStats.fCount > 0)
+      flushStats();
+    else
+      fLastStatsFlushSampleClock = fSampleClock; // nothing to send: not due before the next interval
+  }
 
-  bool silent = true;
+  handleLevelHistogram();
 
-  auto numSamples = iIn.getNumSamples();
-  auto inPtr = iIn.getBuffer();
-  auto outPtr = iOut.getBuffer();
-  auto gain = iGain.getValueInSample();
+  scheduleHousekeeping();
+}
 
-  for(int i = 0; i < numSamples; ++i, inPtr++, outPtr++)
+//------------------------------------------------------------------------
+// sameMetrics - whether the 2 stats have the same metrics (the other
+// fields are ignored)
+//------------------------------------------------------------------------
+inline bool sameMetrics(Stats const &iStats1, Stats const &iStats2)
+{
+  return iStats1.fMetrics == iStats2.fMetrics &&
+         iStats1.fRMS == iStats2.fRMS &&
+         iStats1.fDCOffset == iStats2.fDCOffset &&
+         iStats1.fClipCount == iStats2.fClipCount &&
+         iStats1.fCorrelation == iStats2.fCorrelation &&
+         iStats1.fCrestFactor == iStats2.fCrestFactor;
+}
+
+//------------------------------------------------------------------------
+// fillMetrics - copies the results of the reducers computed since the
+// previous call into the stats (only for the reducers which are part of
+// the analysis) and resets them
+//------------------------------------------------------------------------
+template<typename Analysis>
+void fillMetrics(Analysis &ioAnalysis, double iPeak, Stats &oStats)
+{
+  if constexpr(Analysis::template has<Reducers::RMS>())
   {
-    SampleType sample = *inPtr;
+    auto rms = ioAnalysis.template get<Reducers::RMS>().getRMS();
+    oStats.fMetrics |= Stats::kMetricRMS;
+    oStats.fRMS = rms;
 
-    if(gain != Gain::Unity)
-      sample *= gain;
+    // crest factor = peak / rms
+    oStats.fMetrics |= Stats::kMetricCrestFactor;
+    oStats.fCrestFactor = rms > 0 ? iPeak / rms : 0;
+  }
 
-    if(silent && !pongasoft::VST::isSilent(sample))
-      silent = false;
+  if constexpr(Analysis::template has<Reducers::DCOffset>())
+  {
+    oStats.fMetrics |= Stats::kMetricDCOffset;
+    oStats.fDCOffset = ioAnalysis.template get<Reducers::DCOffset>().getDCOffset();
+  }
 
-    *outPtr = sample;
+  if constexpr(Analysis::template has<Reducers::ClipCount>())
+  {
+    oStats.fMetrics |= Stats::kMetricClipCount;
+    oStats.fClipCount = ioAnalysis.template get<Reducers::ClipCount>().getClipCount();
+  }
 
-    if(sample < 0)
-      sample = -sample;
+  if constexpr(Analysis::template has<Reducers::Correlation>())
+  {
+    oStats.fMetrics |= Stats::kMetricCorrelation;
+    oStats.fCorrelation = ioAnalysis.template get<Reducers::Correlation>().getCorrelation();
+  }
 
-    max = std::max(sample, max);
+  ioAnalysis.template reset<Reducers::RMS>();
+  ioAnalysis.template reset<Reducers::DCOffset>();
+  ioAnalysis.template reset<Reducers::ClipCount>();
+  ioAnalysis.template reset<Reducers::Correlation>();
+}
+
+//------------------------------------------------------------------------
+// JSGainProcessor::addMetricsStats - adds a snapshot with the metrics
+// computed since the previous flush (only when they differ from the ones
+// previously sent)
+//------------------------------------------------------------------------
+void JSGainProcessor::addMetricsStats()
+{
+  Stats stats = makeStats();
+  fillMetrics(fAnalysis, fIntervalPeak, stats);
+
+  // mixer overview: relaxed stores in the slot of this instance (no message)
+  if(fMeterSlot)
+    fMeterSlot->publish(static_cast<float>(fIntervalPeak),
+                        static_cast<float>(stats.fRMS),
+                        static_cast<uint32>(stats.fClipCount));
+
+  fIntervalPeak = 0;
+
+  // none of the metrics is enabled
+  if(stats.fMetrics == 0)
+    return;
+
+  // nothing new for the GUI (ex: silence): no need to send the same metrics again
+  if(sameMetrics(stats, fLastMetrics))
+    return;
+
+  fLastMetrics = stats;
+  fPendingStats.add(stats);
+}
+
+//------------------------------------------------------------------------
+// JSGainProcessor::notify
+//------------------------------------------------------------------------
+tresult JSGainProcessor::notify(IMessage *iMessage)
+{
+  if(!iMessage || !iMessage->getMessageID() || strcmp(iMessage->getMessageID(), kUICommandsMessageID) != 0)
+    return RTProcessor::notify(iMessage);
+
+  void const *data = nullptr;
+  uint32 size = 0;
+  if(iMessage->getAttributes()->getBinary(kUICommandsAttrID, data, size) != kResultOk)
+    return kResultFalse;
+
+  //------------------------------------------------------------------------
+  // This is NOT the RT thread so it is ok to deserialize here: the RT only
+  // sees fixed size UICommand structures (copied in the preallocated queue)
+  //------------------------------------------------------------------------
+  MemoryStream stream{const_cast<void *>(data), static_cast<TSize>(size)};
+  IBStreamer streamer{&stream, kLittleEndian};
+
+  int32 count = 0;
+  if(IBStreamHelper::readInt32(streamer, count) != kResultOk)
+    return kResultFalse;
+
+  UICommandSerializer serializer{};
+  for(int32 i = 0; i < std::min(count, MAX_UI_COMMANDS_PER_BATCH); i++)
+  {
+    UICommand command{};
+    if(serializer.readFromStream(streamer, command) != kResultOk)
+      return kResultFalse;
+
+    // the capture file is created here (the RT only gets the writer)
+    auto captureRequested = fCaptureRequested;
+    if(command.fType == UICommand::Type::kCapture && !prepareCapture(command))
+      continue;
+
+    // same for the process trace
+    auto processRecordingRequested = fProcessRecordingRequested;
+    if(command.fType == UICommand::Type::kRecordProcess && !prepareProcessRecording(command))
+      continue;
+
+    if(!fUICommandQueue.push(command))
+    {
+      fDroppedUICommandsCount.fetch_add(1, std::memory_order_relaxed);
+
+      // the RT will never see this command => back to the state before it was prepared
+      if(command.fType == UICommand::Type::kCapture)
+        cancelCapture(captureRequested);
+      if(command.fType == UICommand::Type::kRecordProcess)
+        cancelProcessRecording(processRecordingRequested);
+    }
   }
 
-  // use convenient call on the buffer to set the silence flag appropriately
-  iOut.setSilenceFlag(silent);
+  return kResultOk;
+}
+
+//------------------------------------------------------------------------
+// JSGainProcessor::prepareCapture - returns false when the command must
+// not be sent to the RT (nothing to do or the file cannot be created)
+//------------------------------------------------------------------------
+bool JSGainProcessor::prepareCapture(UICommand const &iCommand)
+{
+  auto tap = static_cast<ECaptureTap>(static_cast<int32>(iCommand.fArgs[0]));
+
+  if(tap == ECaptureTap::kOff)
+  {
+    if(!fCaptureRequested)
+      return false;
+    fCaptureRequested = false;
+    return true;
+  }
+
+  // already capturing: the RT simply switches the tap
+  if(fCaptureRequested)
+    return true;
+
+  // the RT has not handled the end of the previous capture yet (ex: not processing)
+  if(fCaptureWriter && !fCaptureWriter->isFinished())
+  {
+    LOG_F(WARNING, "Capture - the previous capture (%s) is not finished", fCaptureWriter->getPath().c_str());
+    return false;
+  }
+
+  auto path = Capture::makeCapturePath("jsgain-capture-" + std::to_string(fInstanceToken.fId));
+  fCaptureWriter = Capture::CaptureWriter::create(path, processSetup.sampleRate);
+  if(!fCaptureWriter)
+    return false;
+
+  LOG_F(INFO, "Capture - %s gain to %s", tap == ECaptureTap::kPreGain ? "pre" : "post", fCaptureWriter->getPath().c_str());
+  fCaptureRequested = true;
+  return true;
+}
+
+//------------------------------------------------------------------------
+// JSGainProcessor::cancelCapture - iCaptureRequested is the state before
+// prepareCapture. A writer created for the dropped command was never seen
+// by the RT so it is simply destroyed (and its empty file removed).
+//------------------------------------------------------------------------
+void JSGainProcessor::cancelCapture(bool iCaptureRequested)
+{
+  if(!iCaptureRequested && fCaptureRequested && fCaptureWriter)
+  {
+    auto path = fCaptureWriter->getPath();
+    LOG_F(WARNING, "Capture - the command could not be sent to the RT (%s discarded)", path.c_str());
+    fCaptureWriter = nullptr;
+    std::remove(path.c_str());
+  }
+
+  fCaptureRequested = iCaptureRequested;
+}
+
+//------------------------------------------------------------------------
+// JSGainProcessor::prepareProcessRecording - returns false when the command
+// must not be sent to the RT (nothing to do or the file cannot be created)
+//------------------------------------------------------------------------
+bool JSGainProcessor::prepareProcessRecording(UICommand const &iCommand)
+{
+  if(iCommand.fArgs[0] == 0)
+  {
+    if(!fProcessRecordingRequested)
+      return false;
+    fProcessRecordingRequested = false;
+    return true;
+  }
+
+  // already recording (what is recorded of the audio cannot change in the middle of a trace)
+  if(fProcessRecordingRequested)
+    return false;
+
+  // the RT has not handled the end of the previous recording yet (ex: not processing)
+  if(fProcessRecorder && !fProcessRecorder->isFinished())
+  {
+    LOG_F(WARNING, "ProcessTrace - the previous recording (%s) is not finished", fProcessRecorder->getPath().c_str());
+    return false;
+  }
+
+  auto audio = static_cast<Replay::EAudioRecording>(static_cast<uint32>(iCommand.fArgs[1]));
+  auto path = Capture::makeCapturePath("jsgain-process-" + std::to_string(fInstanceToken.fId), ".jsgt");
+  fProcessRecorder = Replay::ProcessTraceRecorder::create(path, processSetup, audio);
+  if(!fProcessRecorder)
+    return false;
+
+  LOG_F(INFO, "ProcessTrace - recording to %s", fProcessRecorder->getPath().c_str());
+  fProcessRecordingRequested = true;
+  return true;
+}
+
+//------------------------------------------------------------------------
+// JSGainProcessor::cancelProcessRecording - same as cancelCapture for the
+// process trace
+//------------------------------------------------------------------------
+void JSGainProcessor::cancelProcessRecording(bool iProcessRecordingRequested)
+{
+  if(!iProcessRecordingRequested && fProcessRecordingRequested && fProcessRecorder)
+  {
+    auto path = fProcessRecorder->getPath();
+    LOG_F(WARNING, "ProcessTrace - the command could not be sent to the RT (%s discarded)", path.c_str());
+    fProcessRecorder = nullptr;
+    std::remove(path.c_str());
+  }
+
+  fProcessRecordingRequested = iProcessRecordingRequested;
+}
+
+//------------------------------------------------------------------------
+// JSGainProcessor::process
+// The recording starts and stops in the middle of a call (the commands are
+// handled in processInputs) so the recorder is the one in use when the call
+// started: the call which stops the recording is the last one recorded.
+//------------------------------------------------------------------------
+tresult JSGainProcessor::process(ProcessData &data)
+{
+  JSGAIN_TRACE_THREAD("rt");
+  JSGAIN_TRACE_FRAME("rt.frame");
+  JSGAIN_TRACE_ZONE("process");
+
+  auto recorder = fRTProcessRecorder;
+  if(!recorder)
+    return RTProcessor::process(data);
+
+  auto start = getMonotonicTimeNanos();
+  recorder->beginProcess(data, start);
+  auto res = RTProcessor::process(data);
+  recorder->endProcess(data, getMonotonicTimeNanos() - start);
 
-  return max;
+  if(fRTProcessRecorder != recorder)
+  {
+    // the recorder can be destroyed as soon as endOfStream is called
+    auto droppedRecordsCount = recorder->getDroppedRecordsCount();
+    recorder->endOfStream();
+    fLogger.log("Process recording stopped (%llu calls dropped)", droppedRecordsCount);
+  }
+
+  return res;
 }
 
 //------------------------------------------------------------------------
@@ -203,30 +618,252 @@ SampleType processChannel(typename AudioBuffers<SampleType>::Channel const &iIn,
 //------------------------------------------------------------------------
 tresult JSGainProcessor::processInputs(ProcessData &data)
 {
-  // Detect the fact that the GUI has sent a message to the RT.
+  JSGAIN_TRACE_ZONE("processInputs");
+  JSGAIN_TRACE_COUNTER("numSamples", data.numSamples);
+
+  //------------------------------------------------------------------------
+  // Detect the fact that the GUI has sent a message to the RT. The message
+  // is only logged: the RT logger copies it and returns right away (the
+  // formatting and writing happens in the background) so this is also
+  // done in release.
+  //------------------------------------------------------------------------
   auto uiMessage = fState.fUIMessage.pop();
   if(uiMessage)
   {
-    DLOG_F(INFO, "Received message from UI <%s> / timestamp = %lld", uiMessage->fText, uiMessage->fTimestamp);
+    fUICommandLatency.recordSince(uiMessage->fSendTimeNanos, getMonotonicTimeNanos());
+    fLogger.log("Received message from UI <%s> / timestamp = %lld", uiMessage->fText, uiMessage->fTimestamp);
+  }
 
-    //------------------------------------------------------------------------
-    // For a bit of "fun", the message is interpreted as a command to display
-    // the current RT state. Note how this block is being executed only in
-    // Debug mode as this is allocating memory in RT!
-    //------------------------------------------------------------------------
-#ifndef NDEBUG
-    auto command = std::string(uiMessage->fText);
+  //------------------------------------------------------------------------
+  // Executes all the commands received since the last frame (in order).
+  // The clock is only read when there is at least one command (to record
+  // how long it took to get here, see JSGainLatency.h).
+  //------------------------------------------------------------------------
+  int64 now = 0;
+  fUICommandQueue.drain([this, &now](UICommand const &iCommand) {
+    if(now == 0)
+      now = getMonotonicTimeNanos();
+    fUICommandLatency.recordSince(iCommand.fSendTimeNanos, now);
+    handleUICommand(iCommand);
+  });
+
+  fFrameCount++;
+  fLastNumSamples = data.numSamples;
+  fSampleClock += data.numSamples;
+
+#if JSGAIN_ENABLE_TELEMETRY
+  //------------------------------------------------------------------------
+  // steady_clock::now() does not make a syscall (vDSO on Linux, commpage
+  // on macOS) so it is ok to call it in the RT
+  //------------------------------------------------------------------------
+  auto start = std::chrono::steady_clock::now();
+  auto res = RTProcessor::processInputs(data);
+  auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+  updateTelemetry(data, duration.count());
+  return res;
+#else
+  return RTProcessor::processInputs(data);
+#endif
+}
+
+#if JSGAIN_ENABLE_TELEMETRY
+//------------------------------------------------------------------------
+// JSGainProcessor::updateTelemetry
+// Only plain stores in the (already mapped) shared memory
+//------------------------------------------------------------------------
+void JSGainProcessor::updateTelemetry(ProcessData const &iData, int64 iBlockDurationNanos)
+{
+  fMaxBlockDurationNanos = std::max(fMaxBlockDurationNanos, iBlockDurationNanos);
 
-    if(command == "$state" || command == "$rtState")
+  // silent when all the channels of the main output are flagged silent (the flags only cover 64 channels)
+  bool silent = false;
+  if(iData.numOutputs > 0 && iData.outputs[0].numChannels > 0)
+  {
+    auto numChannels = std::min(iData.outputs[0].numChannels, 64);
+    auto allChannels = numChannels == 64 ? ~static_cast<uint64>(0) : (static_cast<uint64>(1) << numChannels) - 1;
+    silent = (iData.outputs[0].silenceFlags & allChannels) == allChannels;
+  }
+
+  fTelemetry.update([&](Telemetry::Record &oRecord) {
+    oRecord.fUpdateTimeNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+    oRecord.fFrameCount = fFrameCount;
+    oRecord.fSampleRate = processSetup.sampleRate;
+    oRecord.fPeak = fLastPeak;
+    oRecord.fMaxSinceReset = fState.fMaxSinceReset;
+    oRecord.fLastBlockDurationNanos = iBlockDurationNanos;
+    oRecord.fMaxBlockDurationNanos = fMaxBlockDurationNanos;
+    oRecord.fLastNumSamples = iData.numSamples;
+    oRecord.fSilent = silent ? 1 : 0;
+    oRecord.fBypass = *fState.fBypass ? 1 : 0;
+  });
+}
+#endif
+
+//------------------------------------------------------------------------
+// JSGainProcessor::handleUICommand
+//------------------------------------------------------------------------
+void JSGainProcessor::handleUICommand(UICommand const &iCommand)
+{
+  switch(iCommand.fType)
+  {
+    case UICommand::Type::kResetMax:
+      resetStats();
+      break;
+
+    case UICommand::Type::kDumpState:
+      sendRTStateSnapshot();
+      break;
+
+    case UICommand::Type::kEditorOpened:
+    case UICommand::Type::kEditorClosed:
+      fVuPPMThrottle.setEditorOpen(iCommand.fType == UICommand::Type::kEditorOpened);
+      break;
+
+    case UICommand::Type::kConfigureVuPPM:
     {
-      DLOG_F(INFO, "rt - command=%s --->\n%s",
-             uiMessage->fText,
-             Debug::ParamTable::from(getRTState()).full().toString().c_str());
+      // NaN => unchanged (see parseUICommands)
+      auto config = fVuPPMThrottle.getConfig();
+      if(!std::isnan(iCommand.fArgs[0]))
+        config.fThresholdDb = std::max(iCommand.fArgs[0], 0.0);
+      if(!std::isnan(iCommand.fArgs[1]))
+        config.fMaxUpdatesPerSecond = std::max(iCommand.fArgs[1], 0.0);
+      if(!std::isnan(iCommand.fArgs[2]))
+        config.fOnlyWhenEditorOpen = iCommand.fArgs[2] != 0;
+      fVuPPMThrottle.configure(config);
+      fLogger.log("VU meter output: threshold = %.2fdB / max = %.0f/s / only when editor open = %d",
+                  config.fThresholdDb, config.fMaxUpdatesPerSecond, config.fOnlyWhenEditorOpen);
+      break;
     }
-#endif
+
+    case UICommand::Type::kCapture:
+    {
+      auto tap = static_cast<ECaptureTap>(static_cast<int32>(iCommand.fArgs[0]));
+      if(tap == ECaptureTap::kOff)
+      {
+        if(fRTCaptureWriter)
+        {
+          // the writer can be destroyed as soon as endOfStream is called
+          auto droppedBlocksCount = fRTCaptureWriter->getDroppedBlocksCount();
+          fRTCaptureWriter->endOfStream();
+          fRTCaptureWriter = nullptr;
+          fLogger.log("Capture stopped (%llu blocks dropped)", droppedBlocksCount);
+        }
+      }
+      else if(!fRTCaptureWriter)
+        fRTCaptureWriter = fCaptureWriter.get(); // created in prepareCapture
+      fCaptureTap = fRTCaptureWriter ? tap : ECaptureTap::kOff;
+      break;
+    }
+
+    case UICommand::Type::kRecordProcess:
+    {
+      if(iCommand.fArgs[0] == 0)
+        fRTProcessRecorder = nullptr; // ends with the current call (see process)
+      else if(!fRTProcessRecorder && fProcessRecorder)
+      {
+        fRTProcessRecorder = fProcessRecorder.get(); // created in prepareProcessRecording
+        recordParameters(fRTProcessRecorder);
+        fLogger.log("Process recording started");
+      }
+      break;
+    }
+
+    default:
+      fLogger.log("Received command from UI <%s> / timestamp = %lld", iCommand.fText, iCommand.fTimestamp);
+      break;
   }
+}
 
-  return RTProcessor::processInputs(data);
+//------------------------------------------------------------------------
+// JSGainProcessor::sendRTStateSnapshot
+// This used to be a debug only feature (Debug::ParamTable allocates
+// memory). Instead the RT only copies the normalized values and counters
+// into the snapshot and the GUI does the formatting (see
+// JSGainSendMessageView). Note that, like in handleMax, the lambda
+// version of broadcast is used so that the snapshot is filled directly
+// in the (preallocated and double buffered) storage of the Jmb param:
+// no copy and no allocation.
+//------------------------------------------------------------------------
+void JSGainProcessor::sendRTStateSnapshot()
+{
+  fState.fRTStateSnapshot.broadcast([this](RTStateSnapshot *oSnapshot) {
+    oSnapshot->fTimestamp = Clock::getCurrentTimeMillis();
+    oSnapshot->fFrameCount = fFrameCount;
+    oSnapshot->fLastNumSamples = fLastNumSamples;
+    oSnapshot->fSampleRate = processSetup.sampleRate;
+    oSnapshot->fMaxSinceReset = fState.fMaxSinceReset;
+    oSnapshot->fDroppedUICommandsCount = fDroppedUICommandsCount.load(std::memory_order_relaxed);
+    oSnapshot->fUICommandLatency = fUICommandLatency;
+
+    // every RT vst param (addParam silently ignores the ones which do not fit)
+    static_assert(ParamDispatchTable::kNumSlots <= RTStateSnapshot::kMaxParams,
+                  "RTStateSnapshot::kMaxParams is too small for all the RT params");
+    oSnapshot->fParamCount = 0;
+    for(auto paramID: kRTVstParamIDs)
+      oSnapshot->addParam(paramID, fState.getSlotParam(paramID)->getNormalizedValue());
+  });
+}
+
+//------------------------------------------------------------------------
+// JSGainProcessor::recordParameters
+// The parameters are applied at the beginning of a call so the values at
+// this point are the ones the next (first recorded) call starts with.
+//------------------------------------------------------------------------
+void JSGainProcessor::recordParameters(Replay::ProcessTraceRecorder *iRecorder)
+{
+  Replay::ParamPoint params[] = {
+    {fState.fBypass.getParamID(), 0, fState.fBypass.getNormalizedValue()},
+    {fState.fLeftGain.getParamID(), 0, fState.fLeftGain.getNormalizedValue()},
+    {fState.fRightGain.getParamID(), 0, fState.fRightGain.getNormalizedValue()},
+    {fState.fResetMax.getParamID(), 0, fState.fResetMax.getNormalizedValue()},
+    {fState.fRouting.getParamID(), 0, fState.fRouting.getNormalizedValue()},
+    {fState.fModulationMode.getParamID(), 0, fState.fModulationMode.getNormalizedValue()}
+  };
+  iRecorder->recordParameters(params, sizeof(params) / sizeof(params[0]), fModulationBusActive);
+}
+
+//------------------------------------------------------------------------
+// JSGainProcessor::handleLevelHistogram
+// The histogram is accumulated every frame by the analysis (see
+// genericProcessInputs) but only sent every kLevelHistogramIntervalMs (the
+// GUI does not need more) after which the counters start over (see
+// handleHousekeeping).
+//------------------------------------------------------------------------
+void JSGainProcessor::handleLevelHistogram()
+{
+  if constexpr(JSGainAnalysis::has<LevelHistogramAccumulator>())
+  {
+    if(fSampleClock - fLastLevelHistogramSampleClock < fLevelHistogramIntervalSamples)
+      return;
+
+    auto &histogram = fAnalysis.get<LevelHistogramAccumulator>();
+
+    fState.fLevelHistogram.broadcast([&histogram](LevelHistogram *oHistogram) {
+      histogram.mergeInto(*oHistogram);
+    });
+
+    histogram.clear();
+    fLastLevelHistogramSampleClock = fSampleClock;
+  }
+}
+
+//------------------------------------------------------------------------
+// JSGainProcessor::getModulationBuffer
+// Only the first channel is used (the bus is mono but the host may have
+// negotiated something else).
+//------------------------------------------------------------------------
+template<typename SampleType>
+SampleType const *JSGainProcessor::getModulationBuffer(ProcessData const &data) const
+{
+  if(!fModulationBusActive || data.numInputs <= kModulationBusIndex)
+    return nullptr;
+
+  AudioBuffers<SampleType> modulation(data.inputs[kModulationBusIndex], data.numSamples);
+  if(modulation.getNumChannels() < 1)
+    return nullptr;
+
+  return modulation.getLeftChannel().getBuffer();
 }
 
 //------------------------------------------------------------------------
@@ -238,6 +875,8 @@ tresult JSGainProcessor::processInputs(ProcessData &data)
 template<typename SampleType>
 tresult JSGainProcessor::genericProcessInputs(ProcessData &data)
 {
+  JSGAIN_TRACE_ZONE("genericProcessInputs");
+
   if(data.numInputs == 0 || data.numOutputs == 0)
   {
     // nothing to do
@@ -252,40 +891,184 @@ tresult JSGainProcessor::genericProcessInputs(ProcessData &data)
      out.getNumChannels() < 1 || out.getNumChannels() > 2)
     return kNotImplemented;
 
+  //------------------------------------------------------------------------
+  // Routing (see ChannelMatrix.h): the matrix is only rebuilt when the
+  // routing or the layout changes. Bypass keeps the default routing (only
+  // adapted to the layout).
+  //------------------------------------------------------------------------
+  auto routing = *fState.fBypass ? ERouting::kStereo : *fState.fRouting;
+  if(routing != fRouting ||
+     in.getNumChannels() != fChannelMatrix.getNumInputs() ||
+     out.getNumChannels() != fChannelMatrix.getNumOutputs())
+  {
+    fRouting = routing;
+    fChannelMatrix = ChannelMatrix::fromRouting(routing, in.getNumChannels(), out.getNumChannels());
+  }
+
   // in mono case there could be only one channel
   auto leftChannel = out.getLeftChannel();
-  SampleType leftMax = processChannel<SampleType>(in.getLeftChannel(),
-                                                  leftChannel,
-                                                  *fState.fBypass ? UNITY_GAIN : *fState.fLeftGain);
-  SampleType rightMax = 0;
-  if(in.getNumChannels() == 2 && out.getNumChannels() == 2)
+  bool stereoOut = out.getNumChannels() == 2;
+
+  SampleType const *inputs[ChannelMatrix::kMaxChannels] = {
+    in.getLeftChannel().getBuffer(),
+    in.getNumChannels() == 2 ? in.getRightChannel().getBuffer() : nullptr
+  };
+  SampleType *outputs[ChannelMatrix::kMaxChannels] = {
+    leftChannel.getBuffer(),
+    stereoOut ? out.getRightChannel().getBuffer() : nullptr
+  };
+
+  // capture (pre gain) before anything is written in the outputs (the host may process in place)
+  if(fCaptureTap == ECaptureTap::kPreGain)
+    fRTCaptureWriter->write(inputs[0], inputs[1], data.numSamples);
+
+  // the gain stays a double: the multiplication is done in double (see Reducers::Analysis)
+  double gains[ChannelMatrix::kMaxChannels] = {
+    (*fState.fBypass ? UNITY_GAIN : *fState.fLeftGain).getValueInSample(),
+    (*fState.fBypass ? UNITY_GAIN : *fState.fRightGain).getValueInSample()
+  };
+
+  //------------------------------------------------------------------------
+  // Identity/sparse: no mixing, each output reads from its (single) input
+  // and the coefficient (polarity...) is folded into the gain. Dense: the
+  // mix is computed in the output buffers and the gain is applied in place.
+  //------------------------------------------------------------------------
+  SampleType const *sources[ChannelMatrix::kMaxChannels]{};
+  if(fChannelMatrix.getKind() == ChannelMatrix::Kind::kDense)
+  {
+    fChannelMatrix.mix(inputs, outputs, data.numSamples);
+    for(int32 i = 0; i < fChannelMatrix.getNumOutputs(); i++)
+      sources[i] = outputs[i];
+  }
+  else
+  {
+    for(int32 i = 0; i < fChannelMatrix.getNumOutputs(); i++)
+    {
+      sources[i] = inputs[fChannelMatrix.getSource(i)];
+      gains[i] *= fChannelMatrix.getCoefficient(i);
+    }
+  }
+
+  //------------------------------------------------------------------------
+  // The gain (and the modulation if any) and all the reducers of the
+  // analysis (including the level histogram) are computed in a single loop
+  // (see Reducers.h). Peak and Silence are per frame, the others are reset
+  // when sent to the GUI (see addMetricsStats and handleLevelHistogram).
+  //------------------------------------------------------------------------
+  fAnalysis.reset<Reducers::Peak>();
+  fAnalysis.reset<Reducers::Silence>();
+
+  auto applyGain = [&](auto const &iModulation) {
+    if(stereoOut)
+      fAnalysis.processStereo(sources[0], sources[1], outputs[0], outputs[1], data.numSamples, gains[0], gains[1],
+                              iModulation);
+    else
+      fAnalysis.processMono(sources[0], outputs[0], data.numSamples, gains[0], iModulation);
+  };
+
+  // bypass also bypasses the modulation
+  auto modulation = *fState.fBypass ? nullptr : getModulationBuffer<SampleType>(data);
+  if(!modulation)
+    applyGain(Reducers::Unmodulated<SampleType>{});
+  else if(*fState.fModulationMode == EModulationMode::kDecibels)
+    applyGain(DecibelModulation<SampleType>{modulation});
+  else
+    applyGain(LinearModulation<SampleType>{modulation});
+
+  // capture (post gain): a block which does not fit in the ring is dropped (never waits)
+  if(fCaptureTap == ECaptureTap::kPostGain)
+    fRTCaptureWriter->write(outputs[0], outputs[1], data.numSamples);
+
+  if(stereoOut)
   {
-    rightMax = processChannel<SampleType>(in.getRightChannel(),
-                                          out.getRightChannel(),
-                                          *fState.fBypass ? UNITY_GAIN : *fState.fRightGain);
+    auto rightChannel = out.getRightChannel();
+    rightChannel.setSilenceFlag(fAnalysis.get<Reducers::Silence>().isRightSilent());
   }
 
-  handleMax(data, std::max(leftMax, rightMax));
+  // use convenient call on the buffer to set the silence flag appropriately
+  leftChannel.setSilenceFlag(fAnalysis.get<Reducers::Silence>().isLeftSilent());
+
+  handleMax(data, fAnalysis.get<Reducers::Peak>().getPeak(), fAnalysis.get<Reducers::Peak>().getPeakFrame());
+
+  // with small blocks, most frames have no periodic task due
+  if(fSampleClock >= fNextHousekeepingSampleClock)
+    handleHousekeeping();
+
+  //------------------------------------------------------------------------
+  // The spectrum analyzer (GUI worker thread) does all the work: the RT
+  // only copies the output (mono) into the ring, and only while an
+  // analyzer is attached (no spectrum view open => nothing to do)
+  //------------------------------------------------------------------------
+  if(fSharedInstance && fSharedInstance->hasSpectrumReader())
+  {
+    auto leftPtr = leftChannel.getBuffer();
+    if(out.getNumChannels() == 2)
+    {
+      auto rightPtr = out.getRightChannel().getBuffer();
+      fSharedInstance->fSpectrumRing.write(data.numSamples, [leftPtr, rightPtr](int32 i) {
+        return static_cast<float>((leftPtr[i] + rightPtr[i]) * 0.5);
+      });
+    }
+    else
+    {
+      fSharedInstance->fSpectrumRing.write(data.numSamples, [leftPtr](int32 i) {
+        return static_cast<float>(leftPtr[i]);
+      });
+    }
+  }
 
   return kResultOk;
 }
 
+//------------------------------------------------------------------------
+// JSGainProcessor::activateBus
+//------------------------------------------------------------------------
+tresult JSGainProcessor::activateBus(MediaType type, BusDirection dir, int32 index, TBool state)
+{
+  tresult result = RTProcessor::activateBus(type, dir, index, state);
+
+  if(result == kResultOk && type == kAudio && dir == kInput && index == kModulationBusIndex)
+  {
+    DLOG_F(INFO, "JSGainProcessor::activateBus - modulation bus %s", state ? "active" : "inactive");
+    fModulationBusActive = state;
+  }
+
+  return result;
+}
+
 //------------------------------------------------------------------------
 // JSGainProcessor::handleMax
 //------------------------------------------------------------------------
-void JSGainProcessor::handleMax(ProcessData &data, double iCurrentMax)
+void JSGainProcessor::handleMax(ProcessData &data, double iCurrentMax, int32 iCurrentMaxFrame)
 {
-  fState.fVuPPM.update(iCurrentMax);
+  JSGAIN_TRACE_ZONE("handleMax");
+
+  fIntervalPeak = std::max(fIntervalPeak, iCurrentMax);
+
+#if JSGAIN_ENABLE_TELEMETRY
+  fLastPeak = iCurrentMax;
+#endif
 
   //------------------------------------------------------------------------
-  // Vst params keep the previous (meaning the value the last time the
-  // process method was called) so that it is easy to see if it has changed
-  // during this frame. Jamba automatically update previous at the end of
-  // the current frame.
+  // Writing the output parameter is a call into the host and every value
+  // is then queued, forwarded and often recorded by the host. The peak is
+  // held and only published when it moved by more than the threshold (in
+  // dB) and at most at the configured rate (see VuPPMThrottle.h).
   //------------------------------------------------------------------------
+  double vuPPMPeak{};
+  if(fVuPPMThrottle.process(iCurrentMax, data.numSamples, vuPPMPeak))
+  {
+    fState.fVuPPM.update(vuPPMPeak);
 
-  if(fState.fVuPPM.hasChanged())
-    fState.fVuPPM.addToOutput(data);
+    //------------------------------------------------------------------------
+    // Vst params keep the previous (meaning the value the last time the
+    // process method was called) so that it is easy to see if it has changed
+    // during this frame. Jamba automatically update previous at the end of
+    // the current frame.
+    //------------------------------------------------------------------------
+    if(fState.fVuPPM.hasChanged())
+      fState.fVuPPM.addToOutput(data);
+  }
 
   if(*fState.fResetMax)
   {
@@ -296,16 +1079,14 @@ void JSGainProcessor::handleMax(ProcessData &data, double iCurrentMax)
     if(fState.fMaxSinceReset < iCurrentMax)
     {
       fState.fMaxSinceReset = iCurrentMax;
+      fResetTime = Clock::getCurrentTimeMillis();
+      // projectTimeSamples is always valid (when there is a context) and is the position of the first frame
+      fMaxProjectTimeSamples = data.processContext ? data.processContext->projectTimeSamples + iCurrentMaxFrame : -1;
+      addStats();
 
-      //------------------------------------------------------------------------
-      // This is another way to use the broadcast API which does not incur an
-      // additional copy (like the one used in resetStats)
-      //------------------------------------------------------------------------
-      fState.fStats.broadcast([this](Stats *oStats) {
-        oStats->fSampleRate = processSetup.sampleRate;
-        oStats->fMaxSinceReset = fState.fMaxSinceReset;
-        oStats->fResetTime = Clock::getCurrentTimeMillis();
-      });
+      // the batch is sent when full (otherwise periodically, see handleHousekeeping)
+      if(fPendingStats.isFull())
+        flushStats();
     }
   }
 }
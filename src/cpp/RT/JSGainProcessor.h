@@ -9,6 +9,24 @@
 
 #include <pongasoft/VST/RT/RTProcessor.h>
 #include "../JSGainPlugin.h"
+#include "../JSGainSharedInstance.h"
+#include "../JSGainMeterRegistry.h"
+#include "../Capture/AudioCapture.h"
+#include "../Concurrent/SPSCQueue.h"
+#include "../Log/RTLogger.h"
+#include "../Replay/ProcessTrace.h"
+#include "../Trace/Trace.h"
+#include "ChannelMatrix.h"
+#include "GainModulation.h"
+#include "Reducers.h"
+#include "VuPPMThrottle.h"
+
+#include <atomic>
+#include <memory>
+
+#if JSGAIN_ENABLE_TELEMETRY
+#include "../Telemetry/Telemetry.h"
+#endif
 
 namespace pongasoft::VST::JSGain::RT {
 
@@ -45,6 +63,9 @@ public:
   //------------------------------------------------------------------------
   RTState *getRTState() override { return &fState; }
 
+  // the token of the data shared with the GUI (see JSGainSharedInstance.h)
+  InstanceToken getInstanceToken() const { return fInstanceToken; }
+
   //------------------------------------------------------------------------
   // This method should be implemented as this is where you define the
   // inputs and outputs (addAudioInput / addAudioOutput)
@@ -65,6 +86,27 @@ public:
   //------------------------------------------------------------------------
   tresult PLUGIN_API setActive(TBool iActive) override;
 
+  //------------------------------------------------------------------------
+  // This method is called (NOT on the RT thread) when the GUI sends a
+  // message. It is overridden to handle the batch of UICommand sent by
+  // JSGainController::sendUICommands and delegates to the framework for
+  // every other message (Jmb params).
+  //------------------------------------------------------------------------
+  tresult PLUGIN_API notify(IMessage *iMessage) override;
+
+  //------------------------------------------------------------------------
+  // Called (NOT on the RT thread, while inactive) when the host (de)activates
+  // a bus: keeps track of the modulation bus (see getModulationBuffer)
+  //------------------------------------------------------------------------
+  tresult PLUGIN_API activateBus(MediaType type, BusDirection dir, int32 index, TBool state) override;
+
+  //------------------------------------------------------------------------
+  // Overridden to trace the whole frame (parameters, processing and
+  // outputs) and to record the call when "$record" is on (see
+  // Replay/ProcessTrace.h)
+  //------------------------------------------------------------------------
+  tresult PLUGIN_API process(ProcessData &data) override;
+
 protected:
 
   //------------------------------------------------------------------------
@@ -90,18 +132,168 @@ protected:
   // processInputs64Bits - simply delegate to generic implementation
   tresult processInputs64Bits(ProcessData &data) override { return genericProcessInputs<Sample64>(data); }
 
-  // handleMax -- internal method which will update the stats
-  void handleMax(ProcessData &data, double iCurrentMax);
+  // handleMax -- internal method which will update the stats (iCurrentMaxFrame is the index of the max in the block)
+  void handleMax(ProcessData &data, double iCurrentMax, int32 iCurrentMaxFrame);
 
   // internal call to reset the stats
   void resetStats();
 
+  // internal calls to batch the stats and send them to the GUI
+  void addStats();
+  void addMetricsStats();
+  void flushStats();
+  Stats makeStats() const;
+
+  // executes a command sent by the GUI (always called from processInputs)
+  void handleUICommand(UICommand const &iCommand);
+
+  // creates the capture file before the command reaches the RT (called from notify, NOT the RT)
+  bool prepareCapture(UICommand const &iCommand);
+
+  // undoes prepareCapture when the command could not be queued for the RT (called from notify, NOT the RT)
+  void cancelCapture(bool iCaptureRequested);
+
+  // creates the process trace before the command reaches the RT (called from notify, NOT the RT)
+  bool prepareProcessRecording(UICommand const &iCommand);
+
+  // undoes prepareProcessRecording when the command could not be queued for the RT (called from notify, NOT the RT)
+  void cancelProcessRecording(bool iProcessRecordingRequested);
+
+  // records the current value of the parameters (first record of a process trace)
+  void recordParameters(Replay::ProcessTraceRecorder *iRecorder);
+
+  // sends a copy of the RT state to the GUI (no memory allocation)
+  void sendRTStateSnapshot();
+
+  // sends the level histogram to the GUI (at most every kLevelHistogramIntervalMs)
+  void handleLevelHistogram();
+
+  // the periodic tasks (stats, level histogram) and when they are due next
+  void handleHousekeeping();
+  void scheduleHousekeeping();
+
 private:
+  //------------------------------------------------------------------------
+  // The analysis computed in the same loop as the gain (see Reducers.h).
+  // Peak and Silence are required, the other reducers are optional: remove
+  // one from the list and the corresponding metric is simply not computed
+  // nor sent to the GUI.
+  //------------------------------------------------------------------------
+  using JSGainAnalysis = Reducers::Analysis<Reducers::Peak,
+                                            Reducers::Silence,
+                                            Reducers::RMS,
+                                            Reducers::DCOffset,
+                                            Reducers::ClipCount,
+                                            Reducers::Correlation,
+                                            LevelHistogramAccumulator>;
+  static_assert(JSGainAnalysis::has<Reducers::Peak>() && JSGainAnalysis::has<Reducers::Silence>(),
+                "Peak and Silence are required");
+
   // The processor gets its own copy of the parameters (defined in JSGainPlugin.h)
   JSGainParameters fParameters;
 
   // The state (also defined in JSGainPlugin.h) is readily accessible in the implementation
   JSGainRTState fState;
+
+  // routing of the input channels to the output channels (see genericProcessInputs)
+  ERouting fRouting{ERouting::kStereo};
+  ChannelMatrix fChannelMatrix{};
+
+  //------------------------------------------------------------------------
+  // The (optional) auxiliary input bus carrying the gain modulation (see
+  // GainModulation.h). Inactive by default: the host activates it when
+  // something is connected.
+  //------------------------------------------------------------------------
+  static constexpr int32 kModulationBusIndex = 1;
+  bool fModulationBusActive{false};
+
+  // getModulationBuffer - the modulation samples for this frame (nullptr when not connected)
+  template<typename SampleType>
+  SampleType const *getModulationBuffer(ProcessData const &data) const;
+
+  //------------------------------------------------------------------------
+  // The commands sent by the GUI (pushed in notify, drained at the
+  // beginning of every frame in processInputs). 64 slots = 2 full batches.
+  //------------------------------------------------------------------------
+  Concurrent::SPSCQueue<UICommand, 64> fUICommandQueue{};
+
+  // number of commands dropped because the queue was full (on its own cache line: incremented by notify)
+  alignas(Concurrent::kCacheLineSize) std::atomic<uint32> fDroppedUICommandsCount{0};
+
+  // how long the commands took to get from the GUI to the RT (included in the RT state snapshot)
+  alignas(Concurrent::kCacheLineSize) LatencyHistogram fUICommandLatency{};
+
+  // the messages logged by the RT are formatted and written by a background thread (see RTLogger.h)
+  Log::RTLogger fLogger{};
+
+  // internal counters (included in the RT state snapshot)
+  int64 fFrameCount{0};
+  int32 fLastNumSamples{0};
+
+  //------------------------------------------------------------------------
+  // Stats are accumulated in fPendingStats and sent to the GUI in batches
+  // (see handleMax). fSampleClock is the number of samples processed since
+  // activation (used to timestamp the stats).
+  //------------------------------------------------------------------------
+  static constexpr int kStatsFlushIntervalMs = 50;
+  StatsBatch fPendingStats{};
+  JSGainAnalysis fAnalysis{};
+  double fIntervalPeak{0}; // peak since the last metrics (for the crest factor)
+  Stats fLastMetrics{}; // the metrics last added to the batch (only sent again when they change)
+  int64 fResetTime{0};
+  int64 fMaxProjectTimeSamples{-1}; // position of fMaxSinceReset on the project timeline (-1 if unknown)
+  int64 fSampleClock{0};
+  int64 fLastStatsFlushSampleClock{0};
+  int64 fStatsFlushIntervalSamples{0};
+
+  // distribution of the output levels (accumulated by fAnalysis) is sent to the GUI every interval
+  static constexpr int kLevelHistogramIntervalMs = 100;
+  int64 fLevelHistogramIntervalSamples{0};
+  int64 fLastLevelHistogramSampleClock{0};
+
+  // sample clock at which the next periodic task is due (see handleHousekeeping)
+  int64 fNextHousekeepingSampleClock{0};
+
+  // decides when the VU meter (output parameter) is updated (see handleMax)
+  VuPPMThrottle fVuPPMThrottle{};
+
+  //------------------------------------------------------------------------
+  // Capture of the audio in a file ("$capture", see AudioCapture.h). The
+  // writer is created in notify (see prepareCapture) and handed to the RT
+  // by the kCapture command: the RT uses it (fRTCaptureWriter) until it
+  // handles the command stopping the capture (endOfStream). A writer is
+  // only replaced once finished (the RT is not using it anymore).
+  //------------------------------------------------------------------------
+  std::unique_ptr<Capture::CaptureWriter> fCaptureWriter{};
+  bool fCaptureRequested{false}; // notify side
+  Capture::CaptureWriter *fRTCaptureWriter{nullptr};
+  ECaptureTap fCaptureTap{ECaptureTap::kOff};
+
+  //------------------------------------------------------------------------
+  // Recording of the process calls ("$record", see ProcessTrace.h). Same
+  // handoff as the capture: created in notify (prepareProcessRecording),
+  // used by the RT (fRTProcessRecorder) from the kRecordProcess command
+  // until the end of the call which stops the recording (see process).
+  //------------------------------------------------------------------------
+  std::unique_ptr<Replay::ProcessTraceRecorder> fProcessRecorder{};
+  bool fProcessRecordingRequested{false}; // notify side
+  Replay::ProcessTraceRecorder *fRTProcessRecorder{nullptr};
+
+  // data shared directly with the GUI (created in initialize)
+  std::shared_ptr<JSGainSharedInstance> fSharedInstance{};
+  InstanceToken fInstanceToken{};
+
+  // slot in the (process wide) metering registry (claimed in initialize, nullptr if none available)
+  MeterSlot *fMeterSlot{nullptr};
+
+#if JSGAIN_ENABLE_TELEMETRY
+  // publishes the state of this instance in shared memory (see Telemetry.h)
+  void updateTelemetry(ProcessData const &iData, int64 iBlockDurationNanos);
+
+  Telemetry::TelemetryWriter fTelemetry{};
+  double fLastPeak{};
+  int64 fMaxBlockDurationNanos{};
+#endif
 };
 
 }
@@ -0,0 +1,398 @@
+//------------------------------------------------------------------------------------------------------------
+// This file defines the analysis pipeline used by the processor: a set of "reducers" (peak, silence, rms,
+// etc...) chosen at compile time (template parameter pack) which are all fed from the same loop that applies
+// the gain. No matter how many reducers are enabled, each sample is read once and written once.
+//
+// A reducer is a struct which provides:
+// - template<typename SampleType> void add(int32 iLane, int32 iFrame, SampleType iLeft, SampleType iRight)
+//   called for every frame (iFrame is the index of the frame in the block, in mono iLeft and iRight are the
+//   same sample)
+// - optionally template<typename SampleType> void addMono(int32 iLane, int32 iFrame, SampleType iSample)
+//   called instead of add in mono (for the reducers which must not count the same sample twice)
+// - void endBlock(int32 iNumFrames) called at the end of every call to process
+// - void reset()
+//
+// Every reducer keeps kNumLanes independent accumulators and the main loop feeds frame i to lane
+// (i % kNumLanes): there is no dependency between consecutive frames so the compiler can vectorize the loop
+// without reordering floating point operations (no need for -ffast-math). The lanes are combined when the
+// result is read.
+//------------------------------------------------------------------------------------------------------------
+#pragma once
+
+#include <pongasoft/VST/AudioUtils.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace pongasoft::VST::JSGain::RT::Reducers {
+
+constexpr int32 kNumLanes = 8;
+
+//------------------------------------------------------------------------
+// Peak - max(|left|, |right|) and the frame where it happens (first one
+// in case of tie). The comparison is a select (no branch) so that the
+// argmax does not prevent the loop from being vectorized.
+//------------------------------------------------------------------------
+struct Peak
+{
+  template<typename SampleType>
+  inline void add(int32 iLane, int32 iFrame, SampleType iLeft, SampleType iRight)
+  {
+    auto peak = static_cast<double>(std::max(std::abs(iLeft), std::abs(iRight)));
+    auto isNewPeak = peak > fLanes[iLane];
+    fFrames[iLane] = isNewPeak ? iFrame : fFrames[iLane];
+    fLanes[iLane] = isNewPeak ? peak : fLanes[iLane];
+  }
+
+  inline void endBlock(int32 /* iNumFrames */) {}
+
+  inline double getPeak() const { return fLanes[getPeakLane()]; }
+
+  // index of the frame (in the block) of the peak (0 when silent)
+  inline int32 getPeakFrame() const { return fFrames[getPeakLane()]; }
+
+  inline void reset()
+  {
+    std::fill(std::begin(fLanes), std::end(fLanes), 0.0);
+    std::fill(std::begin(fFrames), std::end(fFrames), 0);
+  }
+
+  double fLanes[kNumLanes]{};
+  int32 fFrames[kNumLanes]{};
+
+private:
+  inline int32 getPeakLane() const
+  {
+    int32 peakLane = 0;
+    for(int32 lane = 1; lane < kNumLanes; lane++)
+    {
+      if(fLanes[lane] > fLanes[peakLane] || (fLanes[lane] == fLanes[peakLane] && fFrames[lane] < fFrames[peakLane]))
+        peakLane = lane;
+    }
+    return peakLane;
+  }
+};
+
+//------------------------------------------------------------------------
+// Silence - whether each channel is silent (see pongasoft::VST::isSilent).
+// Keeps track of max(|sample|) per channel (a channel is silent when
+// its loudest sample is) which, unlike a flag, vectorizes.
+//------------------------------------------------------------------------
+struct Silence
+{
+  template<typename SampleType>
+  inline void add(int32 iLane, int32 /* iFrame */, SampleType iLeft, SampleType iRight)
+  {
+    fLeftLanes[iLane] = std::max(fLeftLanes[iLane], static_cast<double>(std::abs(iLeft)));
+    fRightLanes[iLane] = std::max(fRightLanes[iLane], static_cast<double>(std::abs(iRight)));
+  }
+
+  inline void endBlock(int32 /* iNumFrames */) {}
+
+  inline bool isLeftSilent() const { return isSilent(fLeftLanes); }
+  inline bool isRightSilent() const { return isSilent(fRightLanes); }
+
+  inline void reset()
+  {
+    std::fill(std::begin(fLeftLanes), std::end(fLeftLanes), 0.0);
+    std::fill(std::begin(fRightLanes), std::end(fRightLanes), 0.0);
+  }
+
+  double fLeftLanes[kNumLanes]{};
+  double fRightLanes[kNumLanes]{};
+
+private:
+  static inline bool isSilent(double const (&iLanes)[kNumLanes])
+  {
+    return pongasoft::VST::isSilent(*std::max_element(std::begin(iLanes), std::end(iLanes)));
+  }
+};
+
+//------------------------------------------------------------------------
+// RMS - sqrt(mean(left^2 + right^2) / 2)
+//------------------------------------------------------------------------
+struct RMS
+{
+  template<typename SampleType>
+  inline void add(int32 iLane, int32 /* iFrame */, SampleType iLeft, SampleType iRight)
+  {
+    auto left = static_cast<double>(iLeft);
+    auto right = static_cast<double>(iRight);
+    fLanes[iLane] += left * left + right * right;
+  }
+
+  inline void endBlock(int32 iNumFrames) { fNumFrames += iNumFrames; }
+
+  inline double getRMS() const
+  {
+    if(fNumFrames == 0)
+      return 0;
+    double sum = 0;
+    for(auto lane: fLanes)
+      sum += lane;
+    return std::sqrt(sum / (2.0 * fNumFrames));
+  }
+
+  inline void reset() { std::fill(std::begin(fLanes), std::end(fLanes), 0.0); fNumFrames = 0; }
+
+  double fLanes[kNumLanes]{};
+  int64 fNumFrames{0};
+};
+
+//------------------------------------------------------------------------
+// DCOffset - mean((left + right) / 2)
+//------------------------------------------------------------------------
+struct DCOffset
+{
+  template<typename SampleType>
+  inline void add(int32 iLane, int32 /* iFrame */, SampleType iLeft, SampleType iRight)
+  {
+    fLanes[iLane] += static_cast<double>(iLeft) + static_cast<double>(iRight);
+  }
+
+  inline void endBlock(int32 iNumFrames) { fNumFrames += iNumFrames; }
+
+  inline double getDCOffset() const
+  {
+    if(fNumFrames == 0)
+      return 0;
+    double sum = 0;
+    for(auto lane: fLanes)
+      sum += lane;
+    return sum / (2.0 * fNumFrames);
+  }
+
+  inline void reset() { std::fill(std::begin(fLanes), std::end(fLanes), 0.0); fNumFrames = 0; }
+
+  double fLanes[kNumLanes]{};
+  int64 fNumFrames{0};
+};
+
+//------------------------------------------------------------------------
+// ClipCount - number of frames where at least one channel is >= 0dBFS
+//------------------------------------------------------------------------
+struct ClipCount
+{
+  template<typename SampleType>
+  inline void add(int32 iLane, int32 /* iFrame */, SampleType iLeft, SampleType iRight)
+  {
+    fLanes[iLane] += std::max(std::abs(iLeft), std::abs(iRight)) >= 1 ? 1 : 0;
+  }
+
+  inline void endBlock(int32 /* iNumFrames */) {}
+
+  inline int64 getClipCount() const
+  {
+    int64 count = 0;
+    for(auto lane: fLanes)
+      count += lane;
+    return count;
+  }
+
+  inline void reset() { std::fill(std::begin(fLanes), std::end(fLanes), 0); }
+
+  int64 fLanes[kNumLanes]{};
+};
+
+//------------------------------------------------------------------------
+// Correlation - stereo correlation in [-1, 1] (1 = mono, 0 = unrelated,
+// -1 = out of phase)
+//------------------------------------------------------------------------
+struct Correlation
+{
+  template<typename SampleType>
+  inline void add(int32 iLane, int32 /* iFrame */, SampleType iLeft, SampleType iRight)
+  {
+    auto left = static_cast<double>(iLeft);
+    auto right = static_cast<double>(iRight);
+    fLeftRightLanes[iLane] += left * right;
+    fLeftLeftLanes[iLane] += left * left;
+    fRightRightLanes[iLane] += right * right;
+  }
+
+  inline void endBlock(int32 /* iNumFrames */) {}
+
+  inline double getCorrelation() const
+  {
+    double leftRight = 0, leftLeft = 0, rightRight = 0;
+    for(int32 lane = 0; lane < kNumLanes; lane++)
+    {
+      leftRight += fLeftRightLanes[lane];
+      leftLeft += fLeftLeftLanes[lane];
+      rightRight += fRightRightLanes[lane];
+    }
+    auto energy = std::sqrt(leftLeft * rightRight);
+    return energy > 0 ? leftRight / energy : 0;
+  }
+
+  inline void reset()
+  {
+    std::fill(std::begin(fLeftRightLanes), std::end(fLeftRightLanes), 0.0);
+    std::fill(std::begin(fLeftLeftLanes), std::end(fLeftLeftLanes), 0.0);
+    std::fill(std::begin(fRightRightLanes), std::end(fRightRightLanes), 0.0);
+  }
+
+  double fLeftRightLanes[kNumLanes]{};
+  double fLeftLeftLanes[kNumLanes]{};
+  double fRightRightLanes[kNumLanes]{};
+};
+
+//------------------------------------------------------------------------
+// Unmodulated - the (default) modulation of Analysis::processXXX: since
+// x * 1.0 == x (exact) the compiler simply drops the multiplication and
+// the loop is the same as without modulation (see GainModulation.h)
+//------------------------------------------------------------------------
+template<typename SampleType>
+struct Unmodulated
+{
+  constexpr SampleType operator()(int32 /* iFrame */) const { return SampleType{1}; }
+};
+
+//------------------------------------------------------------------------
+// Analysis - the set of reducers (each type must appear only once) and the
+// fused loop. Note that the gain multiplication is always applied (even
+// for unity gain, x * 1.0 == x) so that the loop has no branch. The gain
+// is a double and the multiplication is done in double (the result is
+// then narrowed to SampleType) like the original processChannel so that
+// the output is bit exact with it.
+//------------------------------------------------------------------------
+namespace Impl {
+
+template<typename R, typename SampleType, typename = void>
+struct HasAddMono : std::false_type {};
+
+template<typename R, typename SampleType>
+struct HasAddMono<R, SampleType,
+                  std::void_t<decltype(std::declval<R &>().addMono(int32{}, int32{}, SampleType{}))>> : std::true_type {};
+
+// addMono - R::addMono when defined, R::add with the same sample on both channels otherwise
+template<typename R, typename SampleType>
+inline void addMono(R &iReducer, int32 iLane, int32 iFrame, SampleType iSample)
+{
+  if constexpr(HasAddMono<R, SampleType>::value)
+    iReducer.addMono(iLane, iFrame, iSample);
+  else
+    iReducer.add(iLane, iFrame, iSample, iSample);
+}
+
+}
+
+template<typename... Reducers>
+class Analysis
+{
+public:
+  // whether the reducer R is part of this analysis
+  template<typename R>
+  static constexpr bool has() { return (std::is_same_v<R, Reducers> || ...); }
+
+  template<typename R>
+  inline R &get() { return std::get<R>(fReducers); }
+
+  template<typename R>
+  inline R const &get() const { return std::get<R>(fReducers); }
+
+  // resets R only if it is part of this analysis
+  template<typename R>
+  inline void reset() { if constexpr(has<R>()) get<R>().reset(); }
+
+  //------------------------------------------------------------------------
+  // processStereo - oLeftOut[i] = iLeftIn[i] * iLeftGain (same for right)
+  // and feeds every frame to all the reducers
+  //------------------------------------------------------------------------
+  template<typename SampleType>
+  void processStereo(SampleType const *iLeftIn, SampleType const *iRightIn,
+                     SampleType *oLeftOut, SampleType *oRightOut,
+                     int32 iNumFrames,
+                     double iLeftGain, double iRightGain)
+  {
+    processStereo(iLeftIn, iRightIn, oLeftOut, oRightOut, iNumFrames, iLeftGain, iRightGain, Unmodulated<SampleType>{});
+  }
+
+  //------------------------------------------------------------------------
+  // processStereo - same as above with a per frame gain multiplier:
+  // oLeftOut[i] = iLeftIn[i] * iLeftGain * iModulation(i) (same for right).
+  // iModulation is a functor (inlined) so the modulation is fused in the
+  // same loop (see GainModulation.h).
+  //------------------------------------------------------------------------
+  template<typename SampleType, typename Modulation>
+  void processStereo(SampleType const *iLeftIn, SampleType const *iRightIn,
+                     SampleType *oLeftOut, SampleType *oRightOut,
+                     int32 iNumFrames,
+                     double iLeftGain, double iRightGain,
+                     Modulation const &iModulation)
+  {
+    int32 i = 0;
+
+    for(; i + kNumLanes <= iNumFrames; i += kNumLanes)
+    {
+      for(int32 lane = 0; lane < kNumLanes; lane++)
+      {
+        auto modulation = iModulation(i + lane);
+        auto left = static_cast<SampleType>(iLeftIn[i + lane] * iLeftGain * modulation);
+        auto right = static_cast<SampleType>(iRightIn[i + lane] * iRightGain * modulation);
+        oLeftOut[i + lane] = left;
+        oRightOut[i + lane] = right;
+        (std::get<Reducers>(fReducers).add(lane, i + lane, left, right), ...);
+      }
+    }
+
+    // remainder
+    for(; i < iNumFrames; i++)
+    {
+      auto modulation = iModulation(i);
+      auto left = static_cast<SampleType>(iLeftIn[i] * iLeftGain * modulation);
+      auto right = static_cast<SampleType>(iRightIn[i] * iRightGain * modulation);
+      oLeftOut[i] = left;
+      oRightOut[i] = right;
+      (std::get<Reducers>(fReducers).add(0, i, left, right), ...);
+    }
+
+    (std::get<Reducers>(fReducers).endBlock(iNumFrames), ...);
+  }
+
+  //------------------------------------------------------------------------
+  // processMono - same as processStereo for 1 channel (the reducers see
+  // the same sample on both channels unless they define addMono)
+  //------------------------------------------------------------------------
+  template<typename SampleType>
+  void processMono(SampleType const *iIn, SampleType *oOut, int32 iNumFrames, double iGain)
+  {
+    processMono(iIn, oOut, iNumFrames, iGain, Unmodulated<SampleType>{});
+  }
+
+  template<typename SampleType, typename Modulation>
+  void processMono(SampleType const *iIn, SampleType *oOut, int32 iNumFrames, double iGain,
+                   Modulation const &iModulation)
+  {
+    int32 i = 0;
+
+    for(; i + kNumLanes <= iNumFrames; i += kNumLanes)
+    {
+      for(int32 lane = 0; lane < kNumLanes; lane++)
+      {
+        auto sample = static_cast<SampleType>(iIn[i + lane] * iGain * iModulation(i + lane));
+        oOut[i + lane] = sample;
+        (Impl::addMono(std::get<Reducers>(fReducers), lane, i + lane, sample), ...);
+      }
+    }
+
+    // remainder
+    for(; i < iNumFrames; i++)
+    {
+      auto sample = static_cast<SampleType>(iIn[i] * iGain * iModulation(i));
+      oOut[i] = sample;
+      (Impl::addMono(std::get<Reducers>(fReducers), 0, i, sample), ...);
+    }
+
+    (std::get<Reducers>(fReducers).endBlock(iNumFrames), ...);
+  }
+
+private:
+  std::tuple<Reducers...> fReducers{};
+};
+
+}
@@ -0,0 +1,147 @@
+//------------------------------------------------------------------------------------------------------------
+// This file defines how often the VU meter output parameter (fVuPPM) is written. Every write is an output
+// parameter change that the host has to queue, forward to the controller and often record: on live audio the
+// peak changes at every block so, with hundreds of instances, this is a lot of (mostly invisible) traffic.
+//
+// - the peak is held over an interval of at least 1 / fMaxUpdatesPerSecond (and kMinIntervalSamples)
+// - at the end of the interval the held peak is only published if it moved by at least fThresholdDb from the
+//   previously published one (the dB values are quantized in steps of fThresholdDb)
+// - optionally (fOnlyWhenEditorOpen) nothing is published while no editor is open: the only consumer of the
+//   parameter is the VU meter view. When an editor opens, the next value is always published.
+//------------------------------------------------------------------------------------------------------------
+#pragma once
+
+#include "../JSGainModel.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace pongasoft::VST::JSGain::RT {
+
+//------------------------------------------------------------------------
+// VuPPMOutputConfig - can be changed at runtime with the "$vu" command
+// (see parseUICommands)
+//------------------------------------------------------------------------
+struct VuPPMOutputConfig
+{
+  double fThresholdDb{0.25};          // 0 => any change is published
+  double fMaxUpdatesPerSecond{60};    // 0 => no limit (other than kMinIntervalSamples)
+  bool fOnlyWhenEditorOpen{false};
+};
+
+class VuPPMThrottle
+{
+public:
+  // the peak is never published more often than every kMinIntervalSamples (small blocks)
+  static constexpr int32 kMinIntervalSamples = 64;
+
+  // anything below is silence (all quantized to the same step)
+  static constexpr double kFloorDb = -96.0;
+
+  //------------------------------------------------------------------------
+  // setup - called from setupProcessing (the interval depends on the
+  // sample rate). No allocation.
+  //------------------------------------------------------------------------
+  void setup(VuPPMOutputConfig const &iConfig, double iSampleRate)
+  {
+    fConfig = iConfig;
+    fSampleRate = iSampleRate;
+
+    fIntervalSamples = kMinIntervalSamples;
+    if(fConfig.fMaxUpdatesPerSecond > 0 && iSampleRate > 0)
+      fIntervalSamples = std::max(fIntervalSamples, static_cast<int32>(std::ceil(iSampleRate / fConfig.fMaxUpdatesPerSecond)));
+
+    reset();
+  }
+
+  // configure - keeps the sample rate (RT: called when handling the "$vu" command)
+  void configure(VuPPMOutputConfig const &iConfig) { setup(iConfig, fSampleRate); }
+
+  VuPPMOutputConfig const &getConfig() const { return fConfig; }
+  int32 getIntervalSamples() const { return fIntervalSamples; }
+
+  //------------------------------------------------------------------------
+  // reset - clears the held peak and makes sure the next value is published
+  //------------------------------------------------------------------------
+  void reset()
+  {
+    fHeldPeak = 0;
+    fNumSamples = 0;
+    fForcePublish = true;
+  }
+
+  // setEditorOpen - an editor opening forces the next value to be published (the meter shows an old value)
+  void setEditorOpen(bool iOpen)
+  {
+    if(iOpen && !fEditorOpen)
+      fForcePublish = true;
+    fEditorOpen = iOpen;
+  }
+
+  bool isEditorOpen() const { return fEditorOpen; }
+
+  //------------------------------------------------------------------------
+  // process - called every frame with the peak of the frame. Returns true
+  // when oPeak (the held peak) should be published.
+  //------------------------------------------------------------------------
+  inline bool process(double iPeak, int32 iNumSamples, double &oPeak)
+  {
+    fHeldPeak = std::max(fHeldPeak, iPeak);
+    fNumSamples += iNumSamples;
+    if(fNumSamples < fIntervalSamples)
+      return false;
+
+    oPeak = fHeldPeak;
+    fHeldPeak = 0;
+    fNumSamples = 0;
+
+    if(fConfig.fOnlyWhenEditorOpen && !fEditorOpen)
+    {
+      fSuppressedCount++;
+      return false;
+    }
+
+    auto step = quantize(oPeak);
+    auto changed = fConfig.fThresholdDb > 0 ? step != fLastStep : oPeak != fLastPeak;
+    if(!changed && !fForcePublish)
+    {
+      fSuppressedCount++;
+      return false;
+    }
+
+    fLastStep = step;
+    fLastPeak = oPeak;
+    fForcePublish = false;
+    return true;
+  }
+
+  // number of intervals which ended without publishing (change below the threshold or no editor)
+  int64 getSuppressedCount() const { return fSuppressedCount; }
+
+  //------------------------------------------------------------------------
+  // quantize - the step (of fThresholdDb) of iPeak in dB (0 when there is
+  // no threshold)
+  //------------------------------------------------------------------------
+  inline int32 quantize(double iPeak) const
+  {
+    if(fConfig.fThresholdDb <= 0)
+      return 0;
+    auto db = iPeak > 0 ? std::max(20.0 * std::log10(iPeak), kFloorDb) : kFloorDb;
+    return static_cast<int32>(std::lround(db / fConfig.fThresholdDb));
+  }
+
+private:
+  VuPPMOutputConfig fConfig{};
+  double fSampleRate{0};
+  int32 fIntervalSamples{kMinIntervalSamples};
+  bool fEditorOpen{false};
+
+  double fHeldPeak{0};
+  int32 fNumSamples{0};
+  int32 fLastStep{0};
+  double fLastPeak{0};
+  bool fForcePublish{true};
+  int64 fSuppressedCount{0};
+};
+
+}
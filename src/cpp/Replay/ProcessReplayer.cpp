@@ -0,0 +1,341 @@
+//------------------------------------------------------------------------
+// This file contains the implementation of the replay of a process trace
+//------------------------------------------------------------------------
+#include "ProcessReplayer.h"
+#include "../RT/JSGainProcessor.h"
+
+#include <pongasoft/logging/logging.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <limits>
+
+namespace pongasoft::VST::JSGain::Replay {
+
+namespace {
+
+//------------------------------------------------------------------------
+// ParamValueQueue - the (read only) points of one parameter in a call
+//------------------------------------------------------------------------
+class ParamValueQueue : public IParamValueQueue
+{
+public:
+  ParamValueQueue(ParamPoint const *iPoints, int32 iCount) : fPoints{iPoints}, fCount{iCount} {}
+
+  ParamID PLUGIN_API getParameterId() override { return fCount > 0 ? fPoints[0].fParamID : 0; }
+  int32 PLUGIN_API getPointCount() override { return fCount; }
+
+  tresult PLUGIN_API getPoint(int32 index, int32 &sampleOffset, ParamValue &value) override
+  {
+    if(index < 0 || index >= fCount)
+      return kResultFalse;
+    sampleOffset = fPoints[index].fSampleOffset;
+    value = fPoints[index].fValue;
+    return kResultOk;
+  }
+
+  // the output parameters (ex: VU meter) are not replayed
+  tresult PLUGIN_API addPoint(int32 /* sampleOffset */, ParamValue /* value */, int32 &index) override
+  {
+    index = 0;
+    return kResultOk;
+  }
+
+  tresult PLUGIN_API queryInterface(const TUID /* iid */, void **obj) override { *obj = nullptr; return kNoInterface; }
+  uint32 PLUGIN_API addRef() override { return 1; }
+  uint32 PLUGIN_API release() override { return 1; }
+
+private:
+  ParamPoint const *fPoints;
+  int32 fCount;
+};
+
+//------------------------------------------------------------------------
+// ParameterChanges - the parameter changes of one call (the points of a
+// queue were recorded one after the other, see ProcessTraceRecorder).
+// Also used (empty) for the output parameter changes.
+//------------------------------------------------------------------------
+class ParameterChanges : public IParameterChanges
+{
+public:
+  ParameterChanges() = default;
+
+  explicit ParameterChanges(std::vector<ParamPoint> const &iPoints)
+  {
+    for(size_t i = 0; i < iPoints.size();)
+    {
+      auto j = i + 1;
+      while(j < iPoints.size() && iPoints[j].fParamID == iPoints[i].fParamID)
+        j++;
+      fQueues.emplace_back(&iPoints[i], static_cast<int32>(j - i));
+      i = j;
+    }
+  }
+
+  int32 PLUGIN_API getParameterCount() override { return static_cast<int32>(fQueues.size()); }
+
+  IParamValueQueue *PLUGIN_API getParameterData(int32 index) override
+  {
+    return index >= 0 && index < getParameterCount() ? &fQueues[index] : nullptr;
+  }
+
+  // the output parameters all go to the same (discarding) queue
+  IParamValueQueue *PLUGIN_API addParameterData(const ParamID & /* id */, int32 &index) override
+  {
+    index = 0;
+    return &fDiscard;
+  }
+
+  tresult PLUGIN_API queryInterface(const TUID /* iid */, void **obj) override { *obj = nullptr; return kNoInterface; }
+  uint32 PLUGIN_API addRef() override { return 1; }
+  uint32 PLUGIN_API release() override { return 1; }
+
+private:
+  std::vector<ParamValueQueue> fQueues{};
+  ParamValueQueue fDiscard{nullptr, 0};
+};
+
+//------------------------------------------------------------------------
+// Buses - the (preallocated) buffers of one direction
+//------------------------------------------------------------------------
+class Buses
+{
+public:
+  Buses(std::vector<int32> const &iMaxChannels, int32 iMaxSamples)
+  {
+    int32 numChannels = 0;
+    for(auto maxChannels: iMaxChannels)
+      numChannels += maxChannels;
+
+    fSamples32.assign(numChannels, std::vector<Sample32>(iMaxSamples));
+    fSamples64.assign(numChannels, std::vector<Sample64>(iMaxSamples));
+    fChannels32.resize(numChannels);
+    fChannels64.resize(numChannels);
+    for(int32 c = 0; c < numChannels; c++)
+    {
+      fChannels32[c] = fSamples32[c].data();
+      fChannels64[c] = fSamples64[c].data();
+    }
+
+    int32 first = 0;
+    fBuses.resize(iMaxChannels.size());
+    for(size_t b = 0; b < iMaxChannels.size(); b++)
+    {
+      fBuses[b].channelBuffers32 = fChannels32.data() + first;
+      fBuses[b].channelBuffers64 = fChannels64.data() + first;
+      first += iMaxChannels[b];
+    }
+  }
+
+  // setup - as recorded (the silence flags are the recorded ones)
+  void setup(std::vector<BusRecord> const &iBuses)
+  {
+    for(size_t b = 0; b < iBuses.size(); b++)
+    {
+      fBuses[b].numChannels = iBuses[b].fNumChannels;
+      fBuses[b].silenceFlags = iBuses[b].fSilenceFlags;
+    }
+  }
+
+  // channel iChannel of bus iBus (raw bytes)
+  void *getChannel(size_t iBus, int32 iChannel, int32 iSymbolicSampleSize)
+  {
+    if(iSymbolicSampleSize == kSample64)
+      return fBuses[iBus].channelBuffers64[iChannel];
+    return fBuses[iBus].channelBuffers32[iChannel];
+  }
+
+  AudioBusBuffers *data() { return fBuses.data(); }
+  AudioBusBuffers const &operator[](size_t iBus) const { return fBuses[iBus]; }
+
+private:
+  std::vector<std::vector<Sample32>> fSamples32{};
+  std::vector<std::vector<Sample64>> fSamples64{};
+  std::vector<Sample32 *> fChannels32{};
+  std::vector<Sample64 *> fChannels64{};
+  std::vector<AudioBusBuffers> fBuses{};
+};
+
+// the maximum number of channels of each bus over all the calls (false if a call is above the limits)
+bool computeMaxChannels(ProcessTrace const &iTrace, bool iInputs, std::vector<int32> &oMaxChannels)
+{
+  auto &maxChannels = oMaxChannels;
+  for(auto const &call: iTrace.fCalls)
+  {
+    auto const &buses = iInputs ? call.fInputBuses : call.fOutputBuses;
+    int32 numChannels = 0;
+    for(size_t b = 0; b < buses.size(); b++)
+    {
+      if(buses[b].fNumChannels < 0)
+        return false;
+      numChannels += buses[b].fNumChannels;
+      if(maxChannels.size() <= b)
+        maxChannels.resize(b + 1, 0);
+      maxChannels[b] = std::max(maxChannels[b], buses[b].fNumChannels);
+    }
+    if(buses.size() > ProcessTraceRecorder::kMaxBuses || numChannels > ProcessTraceRecorder::kMaxChannels)
+      return false;
+  }
+  return true;
+}
+
+// noise - deterministic white noise in [-0.5, 0.5) (LCG)
+template<typename SampleType>
+inline SampleType noise(uint32 &ioState)
+{
+  ioState = ioState * 1664525u + 1013904223u;
+  return static_cast<SampleType>(static_cast<int32>(ioState) / 4294967296.0);
+}
+
+//------------------------------------------------------------------------
+// fillInputs - the recorded samples or the noise (same noise every replay)
+//------------------------------------------------------------------------
+template<typename SampleType>
+void fillInputs(Buses &oInputs, ProcessCall const &iCall, int64 iCallIndex)
+{
+  auto numSamples = iCall.fRecord.fNumSamples;
+  auto samples = iCall.fInputSamples.data();
+  auto channelSize = static_cast<size_t>(numSamples) * sizeof(SampleType);
+
+  for(size_t b = 0; b < iCall.fInputBuses.size(); b++)
+  {
+    auto const &bus = iCall.fInputBuses[b];
+    for(int32 c = 0; c < bus.fNumChannels; c++)
+    {
+      auto channel = static_cast<SampleType *>(oInputs.getChannel(b, c, iCall.fRecord.fSymbolicSampleSize));
+      if(!iCall.fInputSamples.empty())
+      {
+        std::memcpy(channel, samples, channelSize);
+        samples += channelSize;
+      }
+      else if(bus.fSilenceFlags & (static_cast<uint64>(1) << c))
+        std::fill(channel, channel + numSamples, SampleType{0});
+      else
+      {
+        auto state = static_cast<uint32>(iCallIndex * 31 + b * 8 + c);
+        std::generate(channel, channel + numSamples, [&state] { return noise<SampleType>(state); });
+      }
+    }
+  }
+}
+
+}
+
+//------------------------------------------------------------------------
+// replay
+//------------------------------------------------------------------------
+std::unique_ptr<ReplayResult> replay(ProcessTrace const &iTrace, int32 iRepetitions)
+{
+  auto const &header = iTrace.fHeader;
+  auto numCalls = iTrace.fCalls.size();
+
+  std::vector<int32> maxInputChannels{}, maxOutputChannels{};
+  if(!computeMaxChannels(iTrace, true, maxInputChannels) || !computeMaxChannels(iTrace, false, maxOutputChannels))
+  {
+    LOG_F(WARNING, "Replay - the buses of the trace are above the limits");
+    return nullptr;
+  }
+
+  int32 maxSamples = std::max(header.fMaxSamplesPerBlock, 1);
+  for(auto const &call: iTrace.fCalls)
+    maxSamples = std::max(maxSamples, call.fRecord.fNumSamples);
+
+  // everything is allocated before the calls are timed
+  Buses inputs{maxInputChannels, maxSamples};
+  Buses outputs{maxOutputChannels, maxSamples};
+
+  ParameterChanges initialChanges{iTrace.fParameters};
+  std::vector<ParameterChanges> changes{};
+  changes.reserve(numCalls);
+  for(auto const &call: iTrace.fCalls)
+    changes.emplace_back(call.fParamPoints);
+  ParameterChanges outputChanges{};
+
+  auto result = std::make_unique<ReplayResult>();
+  result->fDurationsNanos.assign(numCalls, std::numeric_limits<int64>::max());
+
+  for(int32 repetition = 0; repetition < std::max(iRepetitions, 1); repetition++)
+  {
+    RT::JSGainProcessor processor{};
+    if(processor.initialize(nullptr) != kResultOk)
+      return nullptr;
+
+    ProcessSetup setup{header.fProcessMode, header.fSymbolicSampleSize, maxSamples, header.fSampleRate};
+    if(iTrace.fModulationBusActive)
+      processor.activateBus(kAudio, kInput, 1, true);
+    if(processor.setupProcessing(setup) != kResultOk || processor.setActive(true) != kResultOk)
+    {
+      LOG_F(WARNING, "Replay - the processor cannot be set up like the recorded one");
+      processor.terminate();
+      return nullptr;
+    }
+
+    ProcessData data{};
+    data.processMode = header.fProcessMode;
+    data.symbolicSampleSize = header.fSymbolicSampleSize;
+    data.inputs = inputs.data();
+    data.outputs = outputs.data();
+    data.outputParameterChanges = &outputChanges;
+
+    // the state when the recording started (a call with no audio only applies the parameters)
+    data.inputParameterChanges = &initialChanges;
+    processor.process(data);
+
+    for(size_t i = 0; i < numCalls; i++)
+    {
+      auto const &call = iTrace.fCalls[i];
+      auto const &record = call.fRecord;
+
+      data.numSamples = record.fNumSamples;
+      data.processMode = record.fProcessMode;
+      data.symbolicSampleSize = record.fSymbolicSampleSize;
+      data.numInputs = record.fNumInputs;
+      data.numOutputs = record.fNumOutputs;
+      data.inputParameterChanges = &changes[i];
+      inputs.setup(call.fInputBuses);
+      outputs.setup(call.fOutputBuses);
+
+      if(record.fSymbolicSampleSize == kSample64)
+        fillInputs<Sample64>(inputs, call, static_cast<int64>(i));
+      else
+        fillInputs<Sample32>(inputs, call, static_cast<int64>(i));
+
+      auto start = std::chrono::steady_clock::now();
+      processor.process(data);
+      auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+      result->fDurationsNanos[i] = std::min<int64>(result->fDurationsNanos[i], duration.count());
+
+      // the output can only be compared when the input is the recorded one
+      if(repetition > 0 || call.fInputSamples.empty() || record.fNumSamples <= 0)
+        continue;
+
+      result->fNumVerifiedCalls++;
+      size_t hashIndex = 0;
+      bool match = true;
+      for(size_t b = 0; b < call.fOutputBuses.size(); b++)
+      {
+        for(int32 c = 0; c < call.fOutputBuses[b].fNumChannels; c++)
+        {
+          auto hash = hashChannel(outputs[b], c, record.fNumSamples, record.fSymbolicSampleSize);
+          match = match && hashIndex < call.fOutputHashes.size() && call.fOutputHashes[hashIndex] == hash;
+          hashIndex++;
+        }
+      }
+
+      if(!match)
+      {
+        if(result->fNumMismatchedCalls == 0)
+          result->fFirstMismatchedCall = static_cast<int64>(i);
+        result->fNumMismatchedCalls++;
+      }
+    }
+
+    processor.setActive(false);
+    processor.terminate();
+  }
+
+  return result;
+}
+
+}
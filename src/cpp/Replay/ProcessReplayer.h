@@ -0,0 +1,38 @@
+//------------------------------------------------------------------------------------------------------------
+// This file defines the headless replay of a process trace (see ProcessTrace.h): a new JSGainProcessor is set
+// up like the recorded one and driven with the same sequence of calls (block sizes, sample sizes, process
+// modes, parameter changes and silence flags) outside of any host, which makes an RT problem observed in a
+// production session (ex: a spike with a specific automation pattern) reproducible and measurable.
+//
+// The input audio is the recorded one when the trace contains the samples (EAudioRecording::kSamples) in which
+// case the output is also checked against the recorded hashes: the replay is then bit exact. Otherwise the
+// input is a deterministic noise (silent channels stay silent).
+//------------------------------------------------------------------------------------------------------------
+#pragma once
+
+#include "ProcessTrace.h"
+
+#include <memory>
+#include <vector>
+
+namespace pongasoft::VST::JSGain::Replay {
+
+//------------------------------------------------------------------------
+// ReplayResult
+//------------------------------------------------------------------------
+struct ReplayResult
+{
+  std::vector<int64> fDurationsNanos{}; // one per call (the fastest of all the repetitions)
+  int64 fNumVerifiedCalls{0};          // calls whose output was checked (kSamples only)
+  int64 fNumMismatchedCalls{0};        // calls whose output differs from the recorded one
+  int64 fFirstMismatchedCall{-1};
+};
+
+//------------------------------------------------------------------------
+// replay - replays iTrace iRepetitions times (a new processor every time).
+// Returns nullptr when the processor cannot be set up like the recorded
+// one. Everything is allocated before the calls are timed.
+//------------------------------------------------------------------------
+std::unique_ptr<ReplayResult> replay(ProcessTrace const &iTrace, int32 iRepetitions = 1);
+
+}
@@ -0,0 +1,487 @@
+//------------------------------------------------------------------------
+// This file contains the implementation of the process trace (recorder
+// and reader)
+//------------------------------------------------------------------------
+#include "ProcessTrace.h"
+
+#include <pongasoft/logging/logging.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace pongasoft::VST::JSGain::Replay {
+
+namespace {
+
+// how often the writer thread checks the ring (the RT never wakes it up: it would need a lock)
+constexpr auto kPollInterval = std::chrono::milliseconds{20};
+
+// size of the stdio buffer of the file (the records are small)
+constexpr size_t kFileBufferSize = 1 << 20;
+
+// the samples of one channel
+inline void const *getChannel(AudioBusBuffers const &iBus, int32 iChannel, int32 iSymbolicSampleSize)
+{
+  if(iSymbolicSampleSize == kSample64)
+    return iBus.channelBuffers64 ? iBus.channelBuffers64[iChannel] : nullptr;
+  return iBus.channelBuffers32 ? iBus.channelBuffers32[iChannel] : nullptr;
+}
+
+inline size_t getSampleSize(int32 iSymbolicSampleSize)
+{
+  return iSymbolicSampleSize == kSample64 ? sizeof(Sample64) : sizeof(Sample32);
+}
+
+// countChannels - total number of channels of the buses (-1 when above the limits)
+inline int32 countChannels(AudioBusBuffers const *iBuses, int32 iNumBuses)
+{
+  if(iNumBuses > ProcessTraceRecorder::kMaxBuses || (iNumBuses > 0 && !iBuses))
+    return -1;
+  int32 count = 0;
+  for(int32 i = 0; i < iNumBuses; i++)
+    count += iBuses[i].numChannels;
+  return count <= ProcessTraceRecorder::kMaxChannels ? count : -1;
+}
+
+//------------------------------------------------------------------------
+// Reader - reads the trace (which is loaded in memory)
+//------------------------------------------------------------------------
+class Reader
+{
+public:
+  Reader(uint8 const *iBytes, size_t iSize) : fBytes{iBytes}, fSize{iSize} {}
+
+  template<typename T>
+  bool read(T &oValue)
+  {
+    return read(&oValue, sizeof(T));
+  }
+
+  template<typename T>
+  bool read(std::vector<T> &oValues, size_t iCount)
+  {
+    oValues.resize(iCount);
+    return read(oValues.data(), iCount * sizeof(T));
+  }
+
+  bool read(void *oBytes, size_t iSize)
+  {
+    if(fSize - fOffset < iSize)
+      return false;
+    if(iSize > 0)
+      std::memcpy(oBytes, fBytes + fOffset, iSize);
+    fOffset += iSize;
+    return true;
+  }
+
+  void skip(size_t iSize) { fOffset += std::min(iSize, getRemaining()); }
+
+  size_t getOffset() const { return fOffset; }
+  size_t getRemaining() const { return fSize - fOffset; }
+
+private:
+  uint8 const *fBytes;
+  size_t fSize;
+  size_t fOffset{0};
+};
+
+}
+
+//------------------------------------------------------------------------
+// hashChannel
+//------------------------------------------------------------------------
+uint64 hashChannel(AudioBusBuffers const &iBus, int32 iChannel, int32 iNumSamples, int32 iSymbolicSampleSize)
+{
+  auto channel = getChannel(iBus, iChannel, iSymbolicSampleSize);
+  if(!channel)
+    return 0;
+  if(iSymbolicSampleSize == kSample64)
+    return hashSamples(static_cast<Sample64 const *>(channel), iNumSamples);
+  return hashSamples(static_cast<Sample32 const *>(channel), iNumSamples);
+}
+
+//------------------------------------------------------------------------
+// ProcessTraceRecorder::create
+//------------------------------------------------------------------------
+std::unique_ptr<ProcessTraceRecorder> ProcessTraceRecorder::create(std::string iPath,
+                                                                   ProcessSetup const &iSetup,
+                                                                   EAudioRecording iAudio)
+{
+  auto file = std::fopen(iPath.c_str(), "wb");
+  if(!file)
+  {
+    LOG_F(WARNING, "ProcessTrace - cannot create %s", iPath.c_str());
+    return nullptr;
+  }
+
+  std::setvbuf(file, nullptr, _IOFBF, kFileBufferSize);
+
+  TraceHeader header{};
+  header.fSampleRate = iSetup.sampleRate;
+  header.fMaxSamplesPerBlock = iSetup.maxSamplesPerBlock;
+  header.fSymbolicSampleSize = iSetup.symbolicSampleSize;
+  header.fProcessMode = iSetup.processMode;
+  header.fAudio = iAudio;
+
+  if(std::fwrite(&header, sizeof(header), 1, file) != 1)
+  {
+    LOG_F(WARNING, "ProcessTrace - cannot write %s", iPath.c_str());
+    std::fclose(file);
+    return nullptr;
+  }
+
+  return std::unique_ptr<ProcessTraceRecorder>(new ProcessTraceRecorder(file, std::move(iPath), header));
+}
+
+//------------------------------------------------------------------------
+// ProcessTraceRecorder::ProcessTraceRecorder
+//------------------------------------------------------------------------
+ProcessTraceRecorder::ProcessTraceRecorder(std::FILE *iFile, std::string iPath, TraceHeader const &iHeader) :
+  fFile{iFile},
+  fPath{std::move(iPath)},
+  fHeader{iHeader}
+{
+  // the biggest record accepted (the RT drops the calls which do not fit)
+  fRecordCapacity = sizeof(RecordHeader) + sizeof(ProcessRecord) +
+                    kMaxParamPoints * sizeof(ParamPoint) +
+                    2 * kMaxBuses * sizeof(BusRecord) +
+                    2 * kMaxChannels * sizeof(uint64);
+  if(fHeader.fAudio == EAudioRecording::kSamples)
+    fRecordCapacity += kMaxChannels * static_cast<size_t>(std::max(fHeader.fMaxSamplesPerBlock, 0)) * sizeof(Sample64);
+  fRecordCapacity = std::max(fRecordCapacity, sizeof(RecordHeader) + sizeof(ParametersRecord) + kMaxParamPoints * sizeof(ParamPoint));
+
+  fRecord.reset(new uint8[fRecordCapacity]());
+
+  fThread = std::thread{[this] { run(); }};
+}
+
+//------------------------------------------------------------------------
+// ProcessTraceRecorder::~ProcessTraceRecorder
+//------------------------------------------------------------------------
+ProcessTraceRecorder::~ProcessTraceRecorder()
+{
+  {
+    std::lock_guard<std::mutex> lock{fMutex};
+    fStopRequested = true;
+  }
+  fCondition.notify_one();
+  fThread.join();
+}
+
+//------------------------------------------------------------------------
+// ProcessTraceRecorder::append
+//------------------------------------------------------------------------
+void ProcessTraceRecorder::append(void const *iBytes, size_t iSize)
+{
+  if(!fRecordValid || fRecordCapacity - fRecordSize < iSize)
+  {
+    fRecordValid = false;
+    return;
+  }
+  std::memcpy(fRecord.get() + fRecordSize, iBytes, iSize);
+  fRecordSize += iSize;
+}
+
+//------------------------------------------------------------------------
+// ProcessTraceRecorder::push
+//------------------------------------------------------------------------
+void ProcessTraceRecorder::push()
+{
+  if(fRecordValid)
+  {
+    auto size = static_cast<uint32>(fRecordSize);
+    std::memcpy(fRecord.get() + offsetof(RecordHeader, fSize), &size, sizeof(size));
+    if(fRing.write(fRecord.get(), fRecordSize))
+    {
+      fRecordValid = false;
+      return;
+    }
+  }
+
+  fDroppedRecordsCount.fetch_add(1, std::memory_order_relaxed);
+  fRecordValid = false;
+}
+
+//------------------------------------------------------------------------
+// ProcessTraceRecorder::recordParameters
+//------------------------------------------------------------------------
+void ProcessTraceRecorder::recordParameters(ParamPoint const *iParams, uint32 iNumParams, bool iModulationBusActive)
+{
+  fRecordSize = 0;
+  fRecordValid = true;
+
+  RecordHeader header{0, ERecordType::kParameters};
+  append(&header, sizeof(header));
+
+  ParametersRecord record{iNumParams, iModulationBusActive ? 1u : 0u};
+  append(&record, sizeof(record));
+  append(iParams, iNumParams * sizeof(ParamPoint));
+
+  push();
+}
+
+//------------------------------------------------------------------------
+// ProcessTraceRecorder::beginProcess
+//------------------------------------------------------------------------
+void ProcessTraceRecorder::beginProcess(ProcessData const &iData, int64 iTimeNanos)
+{
+  fRecordSize = 0;
+  fRecordValid = true;
+
+  auto numInputChannels = countChannels(iData.inputs, iData.numInputs);
+  auto numOutputChannels = countChannels(iData.outputs, iData.numOutputs);
+  if(numInputChannels < 0 || numOutputChannels < 0)
+  {
+    fRecordValid = false;
+    return;
+  }
+
+  RecordHeader header{0, ERecordType::kProcess};
+  append(&header, sizeof(header));
+
+  ProcessRecord record{};
+  record.fTimeNanos = iTimeNanos;
+  record.fNumSamples = iData.numSamples;
+  record.fProcessMode = iData.processMode;
+  record.fSymbolicSampleSize = iData.symbolicSampleSize;
+  record.fNumInputs = iData.numInputs;
+  record.fNumOutputs = iData.numOutputs;
+  record.fNumParamPoints = 0;
+  auto recordOffset = fRecordSize;
+  append(&record, sizeof(record));
+
+  // parameter changes (queue after queue)
+  if(auto changes = iData.inputParameterChanges)
+  {
+    auto numQueues = changes->getParameterCount();
+    for(int32 i = 0; i < numQueues; i++)
+    {
+      auto queue = changes->getParameterData(i);
+      if(!queue)
+        continue;
+      ParamPoint point{queue->getParameterId(), 0, 0};
+      auto numPoints = queue->getPointCount();
+      for(int32 j = 0; j < numPoints; j++)
+      {
+        if(queue->getPoint(j, point.fSampleOffset, point.fValue) != kResultOk)
+          continue;
+        append(&point, sizeof(point));
+        record.fNumParamPoints++;
+      }
+    }
+    if(fRecordValid)
+      std::memcpy(fRecord.get() + recordOffset, &record, sizeof(record));
+  }
+
+  for(int32 i = 0; i < iData.numInputs; i++)
+  {
+    BusRecord bus{iData.inputs[i].numChannels, 0, iData.inputs[i].silenceFlags};
+    append(&bus, sizeof(bus));
+  }
+
+  // the silence flags of the outputs are only known at the end (see endProcess)
+  fOutputBusesOffset = fRecordSize;
+  for(int32 i = 0; i < iData.numOutputs; i++)
+  {
+    BusRecord bus{iData.outputs[i].numChannels, 0, 0};
+    append(&bus, sizeof(bus));
+  }
+
+  if(fHeader.fAudio == EAudioRecording::kNone || iData.numSamples <= 0)
+    return;
+
+  auto sampleSize = getSampleSize(iData.symbolicSampleSize);
+  for(int32 i = 0; i < iData.numInputs; i++)
+  {
+    for(int32 c = 0; c < iData.inputs[i].numChannels; c++)
+    {
+      if(fHeader.fAudio == EAudioRecording::kHashes)
+      {
+        auto hash = hashChannel(iData.inputs[i], c, iData.numSamples, iData.symbolicSampleSize);
+        append(&hash, sizeof(hash));
+      }
+      else
+      {
+        auto channel = getChannel(iData.inputs[i], c, iData.symbolicSampleSize);
+        if(channel)
+          append(channel, iData.numSamples * sampleSize);
+        else
+          fRecordValid = false;
+      }
+    }
+  }
+}
+
+//------------------------------------------------------------------------
+// ProcessTraceRecorder::endProcess
+//------------------------------------------------------------------------
+void ProcessTraceRecorder::endProcess(ProcessData const &iData, int64 iDurationNanos)
+{
+  if(!fRecordValid)
+  {
+    push(); // counts the dropped call
+    return;
+  }
+
+  auto recordOffset = sizeof(RecordHeader);
+  std::memcpy(fRecord.get() + recordOffset + offsetof(ProcessRecord, fDurationNanos), &iDurationNanos, sizeof(int64));
+
+  for(int32 i = 0; i < iData.numOutputs; i++)
+  {
+    auto offset = fOutputBusesOffset + i * sizeof(BusRecord) + offsetof(BusRecord, fSilenceFlags);
+    std::memcpy(fRecord.get() + offset, &iData.outputs[i].silenceFlags, sizeof(uint64));
+  }
+
+  if(fHeader.fAudio != EAudioRecording::kNone && iData.numSamples > 0)
+  {
+    for(int32 i = 0; i < iData.numOutputs; i++)
+    {
+      for(int32 c = 0; c < iData.outputs[i].numChannels; c++)
+      {
+        auto hash = hashChannel(iData.outputs[i], c, iData.numSamples, iData.symbolicSampleSize);
+        append(&hash, sizeof(hash));
+      }
+    }
+  }
+
+  push();
+}
+
+//------------------------------------------------------------------------
+// ProcessTraceRecorder::run
+//------------------------------------------------------------------------
+void ProcessTraceRecorder::run()
+{
+  bool writeError = false;
+  auto write = [this, &writeError](uint8 const *iBytes, size_t iSize) {
+    if(!writeError && std::fwrite(iBytes, 1, iSize, fFile) != iSize)
+    {
+      LOG_F(WARNING, "ProcessTrace - error while writing %s", fPath.c_str());
+      writeError = true;
+    }
+  };
+
+  std::unique_lock<std::mutex> lock{fMutex};
+  while(!fStopRequested)
+  {
+    // read before draining so that all the records pushed before the end are drained
+    bool endOfStream = fEndOfStream.load(std::memory_order_acquire);
+
+    fRing.read(write);
+
+    if(endOfStream)
+      break;
+
+    fCondition.wait_for(lock, kPollInterval, [this] { return fStopRequested; });
+  }
+
+  // stop requested (the RT is not processing anymore): what is in the ring is all there is
+  fRing.read(write);
+
+  std::fclose(fFile);
+  fFile = nullptr;
+
+  LOG_F(INFO, "ProcessTrace - %s closed (%llu calls dropped)",
+        fPath.c_str(),
+        static_cast<unsigned long long>(getDroppedRecordsCount()));
+
+  fFinished.store(true, std::memory_order_release);
+}
+
+//------------------------------------------------------------------------
+// ProcessTrace::load
+//------------------------------------------------------------------------
+std::unique_ptr<ProcessTrace> ProcessTrace::load(std::string const &iPath)
+{
+  std::ifstream file{iPath, std::ios::binary};
+  if(!file)
+  {
+    LOG_F(WARNING, "ProcessTrace - cannot open %s", iPath.c_str());
+    return nullptr;
+  }
+
+  std::vector<uint8> bytes{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+  Reader reader{bytes.data(), bytes.size()};
+
+  auto trace = std::make_unique<ProcessTrace>();
+  if(!reader.read(trace->fHeader) || trace->fHeader.fMagic != kTraceMagic || trace->fHeader.fVersion != kTraceVersion)
+  {
+    LOG_F(WARNING, "ProcessTrace - %s is not a (supported) trace", iPath.c_str());
+    return nullptr;
+  }
+
+  RecordHeader header{};
+  while(reader.getRemaining() >= sizeof(RecordHeader))
+  {
+    auto start = reader.getOffset();
+    reader.read(header);
+    if(header.fSize < sizeof(RecordHeader) || header.fSize - sizeof(RecordHeader) > reader.getRemaining())
+    {
+      LOG_F(WARNING, "ProcessTrace - %s is truncated (%zu calls)", iPath.c_str(), trace->fCalls.size());
+      break;
+    }
+
+    Reader record{bytes.data() + reader.getOffset(), header.fSize - sizeof(RecordHeader)};
+    bool ok = true;
+
+    switch(header.fType)
+    {
+      case ERecordType::kParameters:
+      {
+        ParametersRecord parameters{};
+        ok = record.read(parameters) && record.read(trace->fParameters, parameters.fNumParams);
+        trace->fModulationBusActive = parameters.fModulationBusActive != 0;
+        break;
+      }
+
+      case ERecordType::kProcess:
+      {
+        ProcessCall call{};
+        ok = record.read(call.fRecord) &&
+             record.read(call.fParamPoints, call.fRecord.fNumParamPoints) &&
+             record.read(call.fInputBuses, static_cast<size_t>(call.fRecord.fNumInputs)) &&
+             record.read(call.fOutputBuses, static_cast<size_t>(call.fRecord.fNumOutputs));
+
+        size_t numInputChannels = 0, numOutputChannels = 0;
+        for(auto const &bus: call.fInputBuses)
+          numInputChannels += bus.fNumChannels;
+        for(auto const &bus: call.fOutputBuses)
+          numOutputChannels += bus.fNumChannels;
+
+        if(ok && trace->fHeader.fAudio != EAudioRecording::kNone && call.fRecord.fNumSamples > 0)
+        {
+          if(trace->fHeader.fAudio == EAudioRecording::kHashes)
+            ok = record.read(call.fInputHashes, numInputChannels);
+          else
+            ok = record.read(call.fInputSamples, numInputChannels * call.fRecord.fNumSamples *
+                                                 getSampleSize(call.fRecord.fSymbolicSampleSize));
+          ok = ok && record.read(call.fOutputHashes, numOutputChannels);
+        }
+
+        if(ok)
+          trace->fCalls.emplace_back(std::move(call));
+        break;
+      }
+
+      default:
+        // unknown record: skipped (size is known)
+        break;
+    }
+
+    if(!ok)
+    {
+      LOG_F(WARNING, "ProcessTrace - %s: invalid record at offset %zu", iPath.c_str(), start);
+      break;
+    }
+
+    reader.skip(header.fSize - sizeof(RecordHeader));
+  }
+
+  return trace;
+}
+
+}
@@ -0,0 +1,239 @@
+//------------------------------------------------------------------------------------------------------------
+// This file defines the recording of the process calls made by the host ("$record" command, see
+// parseUICommands) in a compact binary trace which can then be replayed (see ProcessReplayer.h and
+// tools/jsgain-replay.cpp) to reproduce, and profile, the exact call pattern of a production session.
+//
+// - ProcessTraceRecorder::create (NOT RT) opens the file, writes the TraceHeader and starts the writer thread
+// - the RT serializes every call in a preallocated record (block size, sample size, process mode, parameter
+//   changes, silence flags, duration and optionally the hashes or the samples of the audio) which is pushed
+//   in a lock-free ring: no allocation, no lock, no syscall. A call which does not fit (ring full or bigger
+//   than the limits) is dropped and counted: the RT never waits
+// - the writer thread appends the records to the file
+//
+// File format (native endianness, little endian on all the supported platforms): TraceHeader followed by
+// records, each one starting with a RecordHeader:
+// - kParameters: ParametersRecord + fNumParams x ParamPoint (the state when the recording started)
+// - kProcess: ProcessRecord + fNumParamPoints x ParamPoint + fNumInputs x BusRecord + fNumOutputs x BusRecord
+//   + audio (kHashes: one hash per input channel, kSamples: the samples of each input channel) + one hash per
+//   output channel (kHashes and kSamples)
+//------------------------------------------------------------------------------------------------------------
+#pragma once
+
+#include <pluginterfaces/vst/ivstaudioprocessor.h>
+#include <pluginterfaces/vst/ivstparameterchanges.h>
+#include "../Concurrent/ByteRing.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace pongasoft::VST::JSGain::Replay {
+
+using namespace Steinberg;
+using namespace Steinberg::Vst;
+
+constexpr uint32 kTraceMagic = 0x5447534A; // "JSGT"
+constexpr uint32 kTraceVersion = 1;
+
+// what is recorded of the audio
+enum class EAudioRecording : uint32
+{
+  kNone = 0,    // nothing (the most compact)
+  kHashes = 1,  // a hash of every input and output channel
+  kSamples = 2  // the input samples (and the output hashes): the replay can check the output
+};
+
+struct TraceHeader
+{
+  uint32 fMagic{kTraceMagic};
+  uint32 fVersion{kTraceVersion};
+  double fSampleRate{0};
+  int32 fMaxSamplesPerBlock{0};
+  int32 fSymbolicSampleSize{kSample32};
+  int32 fProcessMode{kRealtime};
+  EAudioRecording fAudio{EAudioRecording::kNone};
+};
+
+enum class ERecordType : uint32
+{
+  kParameters = 1,
+  kProcess = 2
+};
+
+struct RecordHeader
+{
+  uint32 fSize; // of the whole record (including this header)
+  ERecordType fType;
+};
+
+struct ParamPoint
+{
+  uint32 fParamID;
+  int32 fSampleOffset;
+  double fValue;
+};
+
+struct ParametersRecord
+{
+  uint32 fNumParams;
+  uint32 fModulationBusActive;
+};
+
+struct ProcessRecord
+{
+  int64 fTimeNanos;     // monotonic clock when the host called process
+  int64 fDurationNanos; // how long the call took
+  int32 fNumSamples;
+  int32 fProcessMode;
+  int32 fSymbolicSampleSize;
+  int32 fNumInputs;
+  int32 fNumOutputs;
+  uint32 fNumParamPoints; // all the queues, one after the other (in order)
+};
+
+struct BusRecord
+{
+  int32 fNumChannels;
+  int32 fPadding;
+  uint64 fSilenceFlags;
+};
+
+static_assert(sizeof(TraceHeader) == 32 && sizeof(RecordHeader) == 8 && sizeof(ParamPoint) == 16 &&
+              sizeof(ParametersRecord) == 8 && sizeof(ProcessRecord) == 40 && sizeof(BusRecord) == 16,
+              "The layout of the file must not depend on the compiler");
+
+//------------------------------------------------------------------------
+// hashSamples - FNV-1a (64 bits) of the bytes of iNumSamples samples
+//------------------------------------------------------------------------
+template<typename SampleType>
+inline uint64 hashSamples(SampleType const *iSamples, int32 iNumSamples)
+{
+  uint64 hash = 0xcbf29ce484222325ULL;
+  auto bytes = reinterpret_cast<uint8 const *>(iSamples);
+  for(size_t i = 0; i < static_cast<size_t>(iNumSamples) * sizeof(SampleType); i++)
+    hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+  return hash;
+}
+
+// hashChannel - hash of one channel of a bus (depends on the sample size of the call)
+uint64 hashChannel(AudioBusBuffers const &iBus, int32 iChannel, int32 iNumSamples, int32 iSymbolicSampleSize);
+
+//------------------------------------------------------------------------
+// ProcessTraceRecorder - one per recording (the thread stops when the
+// recording ends)
+//------------------------------------------------------------------------
+class ProcessTraceRecorder
+{
+public:
+  static constexpr size_t kRingSize = 1 << 24; // 16MB (power of 2)
+  static constexpr int32 kMaxBuses = 4;       // per direction
+  static constexpr int32 kMaxChannels = 8;    // all the buses of one direction
+  static constexpr uint32 kMaxParamPoints = 1024;
+
+  //------------------------------------------------------------------------
+  // create - opens iPath (writes the header) and starts the writer thread.
+  // Returns nullptr when the file cannot be created. NOT RT safe.
+  //------------------------------------------------------------------------
+  static std::unique_ptr<ProcessTraceRecorder> create(std::string iPath,
+                                                      ProcessSetup const &iSetup,
+                                                      EAudioRecording iAudio);
+
+  // the writer thread writes what is left in the ring before closing the file
+  ~ProcessTraceRecorder();
+
+  ProcessTraceRecorder(ProcessTraceRecorder const &) = delete;
+  ProcessTraceRecorder &operator=(ProcessTraceRecorder const &) = delete;
+
+  // recordParameters - RT: the state when the recording starts (before the first call)
+  void recordParameters(ParamPoint const *iParams, uint32 iNumParams, bool iModulationBusActive);
+
+  // beginProcess - RT: records everything known before the call is processed (the input may be overwritten)
+  void beginProcess(ProcessData const &iData, int64 iTimeNanos);
+
+  // endProcess - RT: completes the record (output and duration) and pushes it (or drops it)
+  void endProcess(ProcessData const &iData, int64 iDurationNanos);
+
+  // endOfStream - RT: no more records (the writer thread closes the file once the ring is empty)
+  inline void endOfStream() { fEndOfStream.store(true, std::memory_order_release); }
+
+  // isFinished - true when the file is closed (the RT is not using this recorder anymore)
+  bool isFinished() const { return fFinished.load(std::memory_order_acquire); }
+
+  std::string const &getPath() const { return fPath; }
+  EAudioRecording getAudioRecording() const { return fHeader.fAudio; }
+  uint64 getDroppedRecordsCount() const { return fDroppedRecordsCount.load(std::memory_order_relaxed); }
+
+private:
+  ProcessTraceRecorder(std::FILE *iFile, std::string iPath, TraceHeader const &iHeader);
+
+  // append - adds iSize bytes to the current record (invalidates it when it does not fit)
+  inline void append(void const *iBytes, size_t iSize);
+
+  // push - pushes the current record in the ring (or drops it)
+  void push();
+
+  // the loop of the writer thread
+  void run();
+
+private:
+  // RT side
+  std::unique_ptr<uint8[]> fRecord;
+  size_t fRecordCapacity;
+  size_t fRecordSize{0};
+  bool fRecordValid{false};
+  size_t fOutputBusesOffset{0};
+  std::atomic<uint64> fDroppedRecordsCount{0};
+  std::atomic<bool> fEndOfStream{false};
+
+  Concurrent::ByteRing<kRingSize> fRing{};
+
+  // writer thread side
+  std::FILE *fFile;
+  std::string const fPath;
+  TraceHeader const fHeader;
+  std::atomic<bool> fFinished{false};
+
+  std::mutex fMutex{};
+  std::condition_variable fCondition{};
+  bool fStopRequested{false};
+  std::thread fThread{};
+};
+
+//------------------------------------------------------------------------
+// ProcessCall - one kProcess record (read from a trace)
+//------------------------------------------------------------------------
+struct ProcessCall
+{
+  ProcessRecord fRecord{};
+  std::vector<ParamPoint> fParamPoints{};
+  std::vector<BusRecord> fInputBuses{};
+  std::vector<BusRecord> fOutputBuses{};
+  std::vector<uint64> fInputHashes{};     // kHashes: one per input channel (all buses)
+  std::vector<uint8> fInputSamples{};     // kSamples: the input channels (all buses) one after the other
+  std::vector<uint64> fOutputHashes{};    // kHashes and kSamples: one per output channel (all buses)
+};
+
+//------------------------------------------------------------------------
+// ProcessTrace - a whole trace (read in memory). NOT RT safe.
+//------------------------------------------------------------------------
+struct ProcessTrace
+{
+  TraceHeader fHeader{};
+  std::vector<ParamPoint> fParameters{};
+  bool fModulationBusActive{false};
+  std::vector<ProcessCall> fCalls{};
+
+  //------------------------------------------------------------------------
+  // load - reads the trace in iPath. Returns nullptr if the file cannot be
+  // read or is not a trace. A truncated trace (ex: the host crashed) is
+  // loaded up to the last complete record.
+  //------------------------------------------------------------------------
+  static std::unique_ptr<ProcessTrace> load(std::string const &iPath);
+};
+
+}
@@ -0,0 +1,102 @@
+//------------------------------------------------------------------------------------------------------------
+// This file defines a (forward, complex) radix-2 FFT used by the spectrum analyzer. The data is stored as 2
+// separate arrays (real and imaginary parts) and the twiddle factors of each stage are precomputed in
+// contiguous arrays so that the inner loop of every stage reads and writes contiguous memory (which the
+// compiler can vectorize). All the memory is allocated in the constructor.
+//------------------------------------------------------------------------------------------------------------
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace pongasoft::VST::JSGain::Spectrum {
+
+constexpr double kPi = 3.14159265358979323846;
+
+class FFT
+{
+public:
+  // iSize must be a power of 2
+  explicit FFT(int32_t iSize) :
+    fSize{iSize},
+    fBitReversal(iSize),
+    fTwiddleReal(iSize > 1 ? iSize - 1 : 1),
+    fTwiddleImag(iSize > 1 ? iSize - 1 : 1)
+  {
+    int32_t numBits = 0;
+    while((1 << numBits) < iSize)
+      numBits++;
+
+    for(int32_t i = 0; i < iSize; i++)
+    {
+      int32_t reversed = 0;
+      for(int32_t bit = 0; bit < numBits; bit++)
+        reversed |= ((i >> bit) & 1) << (numBits - 1 - bit);
+      fBitReversal[i] = reversed;
+    }
+
+    // stage with half size h uses exp(-i * pi * k / h) for k in [0, h) stored at offset h - 1
+    for(int32_t h = 1; h < iSize; h <<= 1)
+    {
+      for(int32_t k = 0; k < h; k++)
+      {
+        auto angle = kPi * k / h;
+        fTwiddleReal[h - 1 + k] = static_cast<float>(std::cos(angle));
+        fTwiddleImag[h - 1 + k] = static_cast<float>(-std::sin(angle));
+      }
+    }
+  }
+
+  inline int32_t getSize() const { return fSize; }
+
+  //------------------------------------------------------------------------
+  // forward - in place transform (ioReal and ioImag must contain getSize()
+  // elements)
+  //------------------------------------------------------------------------
+  void forward(float *ioReal, float *ioImag) const
+  {
+    for(int32_t i = 0; i < fSize; i++)
+    {
+      auto j = fBitReversal[i];
+      if(i < j)
+      {
+        std::swap(ioReal[i], ioReal[j]);
+        std::swap(ioImag[i], ioImag[j]);
+      }
+    }
+
+    for(int32_t h = 1; h < fSize; h <<= 1)
+    {
+      auto const *twiddleReal = fTwiddleReal.data() + h - 1;
+      auto const *twiddleImag = fTwiddleImag.data() + h - 1;
+
+      for(int32_t start = 0; start < fSize; start += 2 * h)
+      {
+        auto *aReal = ioReal + start;
+        auto *aImag = ioImag + start;
+        auto *bReal = aReal + h;
+        auto *bImag = aImag + h;
+
+        for(int32_t k = 0; k < h; k++)
+        {
+          auto xReal = bReal[k] * twiddleReal[k] - bImag[k] * twiddleImag[k];
+          auto xImag = bReal[k] * twiddleImag[k] + bImag[k] * twiddleReal[k];
+          bReal[k] = aReal[k] - xReal;
+          bImag[k] = aImag[k] - xImag;
+          aReal[k] += xReal;
+          aImag[k] += xImag;
+        }
+      }
+    }
+  }
+
+private:
+  int32_t fSize;
+  std::vector<int32_t> fBitReversal;
+  std::vector<float> fTwiddleReal;
+  std::vector<float> fTwiddleImag;
+};
+
+}
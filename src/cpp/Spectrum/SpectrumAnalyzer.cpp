@@ -0,0 +1,175 @@
+#include "SpectrumAnalyzer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace pongasoft::VST::JSGain::Spectrum {
+
+//------------------------------------------------------------------------
+// SpectrumProcessor::SpectrumProcessor
+//------------------------------------------------------------------------
+SpectrumProcessor::SpectrumProcessor(float iAveraging) :
+  fAveraging{iAveraging},
+  fWindow(kFFTSize),
+  fReal(kFFTSize),
+  fImag(kFFTSize),
+  fAveragePower(kFFTSize / 2 + 1)
+{
+  // Hann window
+  double sum = 0;
+  for(int32_t i = 0; i < kFFTSize; i++)
+  {
+    fWindow[i] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * kPi * i / kFFTSize));
+    sum += fWindow[i];
+  }
+
+  // a full scale sine wave ends up at 0dB
+  fWindowGain = static_cast<float>(2.0 / sum);
+}
+
+//------------------------------------------------------------------------
+// SpectrumProcessor::computeBands - the bands are evenly spaced on a log
+// scale between kMinFrequency and kMaxFrequency (or Nyquist)
+//------------------------------------------------------------------------
+void SpectrumProcessor::computeBands(double iSampleRate)
+{
+  fSampleRate = iSampleRate;
+  fMaxFrequency = std::min(kMaxFrequency, static_cast<float>(iSampleRate / 2.0));
+
+  auto binWidth = iSampleRate / kFFTSize;
+  auto ratio = std::log(fMaxFrequency / kMinFrequency) / SpectrumBands::kNumBands;
+  constexpr int32_t maxBin = kFFTSize / 2;
+
+  for(int32_t band = 0; band < SpectrumBands::kNumBands; band++)
+  {
+    auto low = kMinFrequency * std::exp(ratio * band);
+    auto high = kMinFrequency * std::exp(ratio * (band + 1));
+
+    auto first = static_cast<int32_t>(std::ceil(low / binWidth));
+    auto last = static_cast<int32_t>(std::ceil(high / binWidth)) - 1;
+
+    // low frequency bands are narrower than a bin => use the bin containing the center
+    if(last < first)
+      first = last = static_cast<int32_t>(std::lround(std::sqrt(low * high) / binWidth));
+
+    fBandFirstBin[band] = std::clamp(first, 0, maxBin);
+    fBandLastBin[band] = std::clamp(last, 0, maxBin);
+  }
+
+  std::fill(fAveragePower.begin(), fAveragePower.end(), 0.0f);
+}
+
+//------------------------------------------------------------------------
+// SpectrumProcessor::process
+//------------------------------------------------------------------------
+void SpectrumProcessor::process(float const *iSamples, double iSampleRate, SpectrumBands &oBands)
+{
+  if(iSampleRate != fSampleRate)
+    computeBands(iSampleRate);
+
+  for(int32_t i = 0; i < kFFTSize; i++)
+  {
+    fReal[i] = iSamples[i] * fWindow[i];
+    fImag[i] = 0;
+  }
+
+  fFFT.forward(fReal.data(), fImag.data());
+
+  // power (normalized) averaged over time
+  auto const gain2 = fWindowGain * fWindowGain;
+  for(int32_t bin = 0; bin <= kFFTSize / 2; bin++)
+  {
+    auto power = (fReal[bin] * fReal[bin] + fImag[bin] * fImag[bin]) * gain2;
+    fAveragePower[bin] = fAveraging * fAveragePower[bin] + (1.0f - fAveraging) * power;
+  }
+
+  oBands.fSampleRate = iSampleRate;
+  oBands.fMinFrequency = kMinFrequency;
+  oBands.fMaxFrequency = fMaxFrequency;
+
+  // each band shows the loudest bin it contains
+  constexpr float minPower = 1e-12f; // -120dB
+  for(int32_t band = 0; band < SpectrumBands::kNumBands; band++)
+  {
+    auto power = minPower;
+    for(int32_t bin = fBandFirstBin[band]; bin <= fBandLastBin[band]; bin++)
+      power = std::max(power, fAveragePower[bin]);
+    oBands.fLevelsInDb[band] = 10.0f * std::log10(power);
+  }
+}
+
+//------------------------------------------------------------------------
+// SpectrumAnalyzer::SpectrumAnalyzer
+//------------------------------------------------------------------------
+SpectrumAnalyzer::SpectrumAnalyzer(std::shared_ptr<JSGainSharedInstance> iInstance,
+                                   std::chrono::milliseconds iInterval) :
+  fInstance{std::move(iInstance)},
+  fInterval{iInterval},
+  fSamples(SpectrumProcessor::kFFTSize)
+{
+  // the RT only writes the ring while an analyzer is attached => what it contains now may be (very) old
+  fInstance->attachSpectrumReader();
+  fMinWriteIndex = fInstance->fSpectrumRing.getWriteIndex() + SpectrumProcessor::kFFTSize;
+
+  fThread = std::thread{&SpectrumAnalyzer::run, this};
+}
+
+//------------------------------------------------------------------------
+// SpectrumAnalyzer::~SpectrumAnalyzer
+//------------------------------------------------------------------------
+SpectrumAnalyzer::~SpectrumAnalyzer()
+{
+  {
+    std::lock_guard<std::mutex> lock{fMutex};
+    fStopped = true;
+  }
+  fCondition.notify_one();
+  if(fThread.joinable())
+    fThread.join();
+
+  fInstance->detachSpectrumReader();
+}
+
+//------------------------------------------------------------------------
+// SpectrumAnalyzer::run - the worker thread
+//------------------------------------------------------------------------
+void SpectrumAnalyzer::run()
+{
+  std::unique_lock<std::mutex> lock{fMutex};
+  while(!fStopped)
+  {
+    lock.unlock();
+    analyze();
+    lock.lock();
+    fCondition.wait_for(lock, fInterval, [this] { return fStopped; });
+  }
+}
+
+//------------------------------------------------------------------------
+// SpectrumAnalyzer::analyze
+//------------------------------------------------------------------------
+void SpectrumAnalyzer::analyze()
+{
+  auto &ring = fInstance->fSpectrumRing;
+
+  // nothing new (ex: the plugin is not processing) or not enough samples written since attached
+  auto writeIndex = ring.getWriteIndex();
+  if(writeIndex == fLastWriteIndex || writeIndex < fMinWriteIndex)
+    return;
+
+  auto sampleRate = fInstance->fSampleRate.load(std::memory_order_relaxed);
+  if(sampleRate <= 0)
+    return;
+
+  // overwritten during the copy => will try again next time
+  if(!ring.readLatest(fSamples.data(), SpectrumProcessor::kFFTSize))
+    return;
+
+  fLastWriteIndex = writeIndex;
+
+  SpectrumBands bands{};
+  fProcessor.process(fSamples.data(), sampleRate, bands);
+  fBands.write(bands);
+}
+
+}
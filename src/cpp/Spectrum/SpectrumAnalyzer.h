@@ -0,0 +1,120 @@
+//------------------------------------------------------------------------------------------------------------
+// This file defines the spectrum analyzer which runs entirely outside the RT and the UI thread:
+// - the RT only copies its output in a ring (JSGainSharedInstance::fSpectrumRing)
+// - SpectrumAnalyzer owns a worker thread which periodically reads the most recent samples from the ring and
+//   uses SpectrumProcessor (windowed FFT, averaging and log frequency binning) to compute the bands
+// - the bands are published in a SeqLock so that the view (UI thread) only copies and draws them
+//------------------------------------------------------------------------------------------------------------
+#pragma once
+
+#include "FFT.h"
+#include "../JSGainSharedInstance.h"
+#include "../Concurrent/SeqLock.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pongasoft::VST::JSGain::Spectrum {
+
+//------------------------------------------------------------------------
+// SpectrumBands - the result of the analysis (what the view draws)
+//------------------------------------------------------------------------
+struct SpectrumBands
+{
+  static constexpr int32_t kNumBands = 64;
+  static constexpr float kMinDb = -120.0f;
+
+  double fSampleRate{0};
+  float fMinFrequency{0};
+  float fMaxFrequency{0};
+  float fLevelsInDb[kNumBands]{};
+};
+
+//------------------------------------------------------------------------
+// SpectrumProcessor - the computation itself (no thread, no lock)
+//------------------------------------------------------------------------
+class SpectrumProcessor
+{
+public:
+  static constexpr int32_t kFFTSize = 4096;
+  static constexpr float kMinFrequency = 20.0f;
+  static constexpr float kMaxFrequency = 20000.0f;
+
+  //------------------------------------------------------------------------
+  // iAveraging is the weight of the previous spectrum in the (exponential)
+  // average: 0 means no averaging
+  //------------------------------------------------------------------------
+  explicit SpectrumProcessor(float iAveraging = 0.6f);
+
+  //------------------------------------------------------------------------
+  // process - iSamples must contain kFFTSize samples (oldest first)
+  //------------------------------------------------------------------------
+  void process(float const *iSamples, double iSampleRate, SpectrumBands &oBands);
+
+private:
+  // computes the range of FFT bins of each band (when the sample rate changes)
+  void computeBands(double iSampleRate);
+
+private:
+  float const fAveraging;
+  FFT fFFT{kFFTSize};
+  std::vector<float> fWindow;
+  float fWindowGain{};
+  std::vector<float> fReal;
+  std::vector<float> fImag;
+  std::vector<float> fAveragePower;
+
+  double fSampleRate{0};
+  int32_t fBandFirstBin[SpectrumBands::kNumBands]{};
+  int32_t fBandLastBin[SpectrumBands::kNumBands]{};
+  float fMaxFrequency{};
+};
+
+//------------------------------------------------------------------------
+// SpectrumAnalyzer - starts the worker thread in the constructor and
+// stops it in the destructor. The RT only writes the samples while at
+// least one analyzer is alive (see JSGainSharedInstance::hasSpectrumReader)
+//------------------------------------------------------------------------
+class SpectrumAnalyzer
+{
+public:
+  explicit SpectrumAnalyzer(std::shared_ptr<JSGainSharedInstance> iInstance,
+                            std::chrono::milliseconds iInterval = std::chrono::milliseconds{30});
+  ~SpectrumAnalyzer();
+
+  SpectrumAnalyzer(SpectrumAnalyzer const &) = delete;
+  SpectrumAnalyzer &operator=(SpectrumAnalyzer const &) = delete;
+
+  // changes every time new bands are available
+  inline uint32_t getSequence() const { return fBands.sequence(); }
+
+  // copies the latest bands (any thread)
+  inline bool readBands(SpectrumBands &oBands) const { return fBands.read(oBands); }
+
+private:
+  void run();
+  void analyze();
+
+private:
+  std::shared_ptr<JSGainSharedInstance> fInstance;
+  std::chrono::milliseconds const fInterval;
+
+  // only used by the worker thread
+  SpectrumProcessor fProcessor{};
+  std::vector<float> fSamples;
+  uint64_t fLastWriteIndex{0};
+  uint64_t fMinWriteIndex{0}; // the samples before it were written before the analyzer was attached
+
+  Concurrent::SeqLock<SpectrumBands> fBands{};
+
+  std::mutex fMutex{};
+  std::condition_variable fCondition{};
+  bool fStopped{false};
+  std::thread fThread{};
+};
+
+}
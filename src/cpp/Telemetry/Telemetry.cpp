@@ -0,0 +1,213 @@
+//------------------------------------------------------------------------
+// This file contains the implementation of the telemetry writer/reader
+// (POSIX shared memory)
+//------------------------------------------------------------------------
+#include "Telemetry.h"
+
+#include <pongasoft/logging/logging.h>
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace pongasoft::VST::JSGain::Telemetry {
+
+namespace {
+
+//------------------------------------------------------------------------
+// mapSegment - opens (and creates when iWritable) and maps the segment
+//------------------------------------------------------------------------
+void *mapSegment(std::string const &iSegmentName, bool iWritable)
+{
+  auto fd = shm_open(iSegmentName.c_str(), iWritable ? (O_RDWR | O_CREAT) : O_RDONLY, 0666);
+  if(fd < 0)
+  {
+    DLOG_F(WARNING, "Telemetry - cannot open segment %s (%s)", iSegmentName.c_str(), strerror(errno));
+    return nullptr;
+  }
+
+  if(iWritable)
+  {
+    // a new segment has a size of 0 => grow it (memory is zero filled)
+    struct stat info{};
+    if(fstat(fd, &info) != 0 ||
+       (info.st_size < static_cast<off_t>(sizeof(Segment)) && ftruncate(fd, sizeof(Segment)) != 0))
+    {
+      DLOG_F(WARNING, "Telemetry - cannot size segment %s (%s)", iSegmentName.c_str(), strerror(errno));
+      ::close(fd);
+      return nullptr;
+    }
+  }
+
+  auto memory = mmap(nullptr, sizeof(Segment), iWritable ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, fd, 0);
+
+  // the mapping stays valid after closing the file descriptor
+  ::close(fd);
+
+  if(memory == MAP_FAILED)
+  {
+    DLOG_F(WARNING, "Telemetry - cannot map segment %s (%s)", iSegmentName.c_str(), strerror(errno));
+    return nullptr;
+  }
+
+  return memory;
+}
+
+//------------------------------------------------------------------------
+// isValid - checks the header
+//------------------------------------------------------------------------
+bool isValid(Header const &iHeader)
+{
+  return iHeader.fMagic.load(std::memory_order_acquire) == kMagic &&
+         iHeader.fVersion == kVersion &&
+         iHeader.fSlotCount == kMaxInstances &&
+         iHeader.fSlotSize == sizeof(Slot);
+}
+
+//------------------------------------------------------------------------
+// isProcessAlive - used to reclaim the slots of a process which crashed
+//------------------------------------------------------------------------
+bool isProcessAlive(int32_t iPID)
+{
+  return kill(iPID, 0) == 0 || errno == EPERM;
+}
+
+// used to generate a unique instance id within the process
+std::atomic<uint32_t> gInstanceCounter{0};
+
+}
+
+//------------------------------------------------------------------------
+// TelemetryWriter::open
+//------------------------------------------------------------------------
+bool TelemetryWriter::open(std::string const &iSegmentName)
+{
+  close();
+
+  auto segment = static_cast<Segment *>(mapSegment(iSegmentName, true));
+  if(!segment)
+    return false;
+
+  // first writer initializes the header (all writers write the same values) and publishes it with fMagic
+  if(segment->fHeader.fMagic.load(std::memory_order_acquire) == 0)
+  {
+    segment->fHeader.fVersion = kVersion;
+    segment->fHeader.fSlotCount = kMaxInstances;
+    segment->fHeader.fSlotSize = sizeof(Slot);
+    segment->fHeader.fMagic.store(kMagic, std::memory_order_release);
+  }
+
+  if(!isValid(segment->fHeader))
+  {
+    DLOG_F(WARNING, "Telemetry - incompatible segment %s", iSegmentName.c_str());
+    munmap(segment, sizeof(Segment));
+    return false;
+  }
+
+  auto pid = static_cast<int32_t>(getpid());
+
+  for(auto &slot: segment->fSlots)
+  {
+    auto owner = slot.fOwnerPID.load(std::memory_order_acquire);
+    if((owner == 0 || (owner != pid && !isProcessAlive(owner))) &&
+       slot.fOwnerPID.compare_exchange_strong(owner, pid, std::memory_order_acq_rel))
+    {
+      fSegment = segment;
+      fSlot = &slot;
+      fInstanceID = (static_cast<uint64_t>(pid) << 32) | gInstanceCounter.fetch_add(1);
+      fSlot->fRecord.update([this](Record &oRecord) {
+        std::memset(&oRecord, 0, sizeof(Record));
+        oRecord.fInstanceID = fInstanceID;
+      });
+      DLOG_F(INFO, "Telemetry - claimed slot %d in %s", static_cast<int>(&slot - segment->fSlots), iSegmentName.c_str());
+      return true;
+    }
+  }
+
+  DLOG_F(WARNING, "Telemetry - no free slot in %s", iSegmentName.c_str());
+  munmap(segment, sizeof(Segment));
+  return false;
+}
+
+//------------------------------------------------------------------------
+// TelemetryWriter::close
+//------------------------------------------------------------------------
+void TelemetryWriter::close()
+{
+  if(fSlot)
+  {
+    fSlot->fOwnerPID.store(0, std::memory_order_release);
+    fSlot = nullptr;
+  }
+
+  if(fSegment)
+  {
+    munmap(fSegment, sizeof(Segment));
+    fSegment = nullptr;
+  }
+}
+
+//------------------------------------------------------------------------
+// TelemetryReader::open
+//------------------------------------------------------------------------
+bool TelemetryReader::open(std::string const &iSegmentName)
+{
+  close();
+
+  auto segment = static_cast<Segment const *>(mapSegment(iSegmentName, false));
+  if(!segment)
+    return false;
+
+  if(!isValid(segment->fHeader))
+  {
+    munmap(const_cast<Segment *>(segment), sizeof(Segment));
+    return false;
+  }
+
+  fSegment = segment;
+  return true;
+}
+
+//------------------------------------------------------------------------
+// TelemetryReader::close
+//------------------------------------------------------------------------
+void TelemetryReader::close()
+{
+  if(fSegment)
+  {
+    munmap(const_cast<Segment *>(fSegment), sizeof(Segment));
+    fSegment = nullptr;
+  }
+}
+
+//------------------------------------------------------------------------
+// TelemetryReader::forEachInstance
+//------------------------------------------------------------------------
+int TelemetryReader::forEachInstance(std::function<void(uint32_t, int32_t, Record const &)> const &iCallback) const
+{
+  if(!fSegment)
+    return 0;
+
+  int count = 0;
+  for(uint32_t i = 0; i < kMaxInstances; i++)
+  {
+    auto const &slot = fSegment->fSlots[i];
+    auto owner = slot.fOwnerPID.load(std::memory_order_acquire);
+    if(owner == 0)
+      continue;
+
+    Record record{};
+    if(slot.fRecord.read(record))
+    {
+      iCallback(i, owner, record);
+      count++;
+    }
+  }
+  return count;
+}
+
+}
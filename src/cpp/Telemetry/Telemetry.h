@@ -0,0 +1,152 @@
+//------------------------------------------------------------------------------------------------------------
+// This file defines the (optional) telemetry which lets an external process (ex: a monitoring daemon) read
+// the state of every running instance of the plugin without going through the host. Each instance owns a
+// slot (a fixed layout record protected by a seqlock) in a POSIX shared memory segment.
+//
+// - opening/closing the segment and claiming/releasing a slot happen outside the RT (initialize/terminate)
+// - the RT only updates its record with plain stores (TelemetryWriter::update): no syscall, no lock
+// - readers (TelemetryReader, tools/jsgain-telemetry-reader.cpp) map the segment read only
+//
+// This code is only compiled when the CMake option JSGAIN_ENABLE_TELEMETRY is ON (not available on Windows).
+// Note that the record uses fixed width types (not the vst sdk types) because the layout is shared with
+// processes which are not built with the sdk.
+//------------------------------------------------------------------------------------------------------------
+#pragma once
+
+#include "../Concurrent/CacheLine.h"
+#include "../Concurrent/SeqLock.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace pongasoft::VST::JSGain::Telemetry {
+
+constexpr uint32_t kMagic = 0x4a534754; // "JSGT"
+constexpr uint32_t kVersion = 1;
+constexpr uint32_t kMaxInstances = 256;
+constexpr char const *kDefaultSegmentName = "/jsgain-telemetry";
+
+//------------------------------------------------------------------------
+// The record published by each instance (bump kVersion when changing it)
+//------------------------------------------------------------------------
+struct Record
+{
+  uint64_t fInstanceID;          // unique per instance (pid + counter)
+  int64_t fUpdateTimeNanos;      // steady clock time of the last update
+  int64_t fFrameCount;           // number of frames processed since activation
+  double fSampleRate;
+  double fPeak;                  // peak of the last frame (sample value)
+  double fMaxSinceReset;         // see JSGainRTState::fMaxSinceReset (sample value)
+  int64_t fLastBlockDurationNanos;
+  int64_t fMaxBlockDurationNanos;
+  int32_t fLastNumSamples;
+  uint8_t fSilent;               // 1 if the output of the last frame was silent
+  uint8_t fBypass;               // 1 if bypassed
+  uint8_t fPadding[2];
+};
+
+//------------------------------------------------------------------------
+// A slot: fOwnerPID is 0 when the slot is free
+//------------------------------------------------------------------------
+struct alignas(Concurrent::kCacheLineSize) Slot
+{
+  std::atomic<int32_t> fOwnerPID;
+  Concurrent::SeqLock<Record> fRecord;
+};
+
+//------------------------------------------------------------------------
+// The header (first cache line of the segment). fMagic is stored last
+// (release) by the writer which initializes the header: the other fields
+// are only read once it is seen (acquire).
+//------------------------------------------------------------------------
+struct alignas(Concurrent::kCacheLineSize) Header
+{
+  std::atomic<uint32_t> fMagic;
+  uint32_t fVersion;
+  uint32_t fSlotCount;
+  uint32_t fSlotSize;
+};
+
+//------------------------------------------------------------------------
+// The full segment (what gets mapped in memory)
+//------------------------------------------------------------------------
+struct Segment
+{
+  Header fHeader;
+  Slot fSlots[kMaxInstances];
+};
+
+//------------------------------------------------------------------------
+// TelemetryWriter - used by the processor (1 per instance)
+//------------------------------------------------------------------------
+class TelemetryWriter
+{
+public:
+  TelemetryWriter() = default;
+  ~TelemetryWriter() { close(); }
+
+  TelemetryWriter(TelemetryWriter const &) = delete;
+  TelemetryWriter &operator=(TelemetryWriter const &) = delete;
+
+  //------------------------------------------------------------------------
+  // Opens (creates if necessary) the segment and claims a free slot.
+  // NOT to be called from the RT (syscalls). Returns false if the segment
+  // cannot be opened or if there is no free slot in which case update
+  // is a noop.
+  //------------------------------------------------------------------------
+  bool open(std::string const &iSegmentName = kDefaultSegmentName);
+
+  // Releases the slot and unmaps the segment (NOT to be called from the RT)
+  void close();
+
+  bool isOpen() const { return fSlot != nullptr; }
+
+  //------------------------------------------------------------------------
+  // Updates the record: iUpdater is called with Record & (RT safe: plain
+  // stores in the mapped memory, no syscall)
+  //------------------------------------------------------------------------
+  template<typename Updater>
+  inline void update(Updater &&iUpdater)
+  {
+    if(fSlot)
+      fSlot->fRecord.update(std::forward<Updater>(iUpdater));
+  }
+
+  uint64_t getInstanceID() const { return fInstanceID; }
+
+private:
+  Segment *fSegment{};
+  Slot *fSlot{};
+  uint64_t fInstanceID{};
+};
+
+//------------------------------------------------------------------------
+// TelemetryReader - used by the monitoring tool (and tests)
+//------------------------------------------------------------------------
+class TelemetryReader
+{
+public:
+  TelemetryReader() = default;
+  ~TelemetryReader() { close(); }
+
+  TelemetryReader(TelemetryReader const &) = delete;
+  TelemetryReader &operator=(TelemetryReader const &) = delete;
+
+  // Maps the segment read only. Returns false if it does not exist (yet)
+  bool open(std::string const &iSegmentName = kDefaultSegmentName);
+
+  void close();
+
+  //------------------------------------------------------------------------
+  // Calls iCallback(slotIndex, ownerPID, record) for every slot in use
+  // (a consistent copy of the record) and returns the number of instances
+  //------------------------------------------------------------------------
+  int forEachInstance(std::function<void(uint32_t, int32_t, Record const &)> const &iCallback) const;
+
+private:
+  Segment const *fSegment{};
+};
+
+}
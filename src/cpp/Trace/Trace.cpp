@@ -0,0 +1,251 @@
+//------------------------------------------------------------------------
+// This file contains the implementation of the tracing (per thread ring
+// buffers and Chrome trace JSON output)
+//------------------------------------------------------------------------
+#include "Trace.h"
+#include "../Concurrent/CacheLine.h"
+
+#include <pongasoft/logging/logging.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <vector>
+
+namespace pongasoft::VST::JSGain::Trace {
+
+namespace {
+
+//------------------------------------------------------------------------
+// ThreadBuffer - written by the thread which claimed it only (fHead is
+// the total number of events recorded, the ring keeps the last ones)
+//------------------------------------------------------------------------
+struct alignas(Concurrent::kCacheLineSize) ThreadBuffer
+{
+  std::atomic<bool> fClaimed{false};
+  std::atomic<char const *> fThreadName{nullptr};
+  alignas(Concurrent::kCacheLineSize) std::atomic<uint64_t> fHead{0};
+  Event fEvents[kEventsPerThread]{};
+};
+
+// 32 x 16K events (~16MB): only touched (paged in) by the threads which actually record
+ThreadBuffer gBuffers[kMaxThreads]{};
+
+std::atomic<uint64_t> gDroppedEventsCount{0};
+
+// the buffer of the calling thread (never released: the threads tracing the plugin live as long as the host)
+thread_local ThreadBuffer *tBuffer = nullptr;
+thread_local bool tNoBufferAvailable = false;
+
+//------------------------------------------------------------------------
+// getThreadBuffer - claims a buffer the first time (nullptr if none left)
+//------------------------------------------------------------------------
+inline ThreadBuffer *getThreadBuffer()
+{
+  if(tBuffer || tNoBufferAvailable)
+    return tBuffer;
+
+  for(auto &buffer: gBuffers)
+  {
+    bool claimed = false;
+    if(!buffer.fClaimed.load(std::memory_order_relaxed) &&
+       buffer.fClaimed.compare_exchange_strong(claimed, true, std::memory_order_acq_rel))
+    {
+      tBuffer = &buffer;
+      return tBuffer;
+    }
+  }
+
+  tNoBufferAvailable = true;
+  return nullptr;
+}
+
+//------------------------------------------------------------------------
+// copyEvents - copies the events still in the ring. The owner thread keeps
+// on recording so the events which may have been overwritten during the
+// copy (as determined by the head after the copy, including the one which
+// may be in the middle of being written) are discarded.
+//------------------------------------------------------------------------
+void copyEvents(ThreadBuffer const &iBuffer, std::vector<Event> &oEvents)
+{
+  auto head = iBuffer.fHead.load(std::memory_order_acquire);
+  auto first = head > kEventsPerThread ? head - kEventsPerThread : 0;
+
+  std::vector<Event> events{};
+  events.reserve(head - first);
+  for(auto i = first; i < head; i++)
+    events.emplace_back(iBuffer.fEvents[i & (kEventsPerThread - 1)]);
+
+  // event i was (possibly) overwritten if the writer reached i + kEventsPerThread
+  auto newHead = iBuffer.fHead.load(std::memory_order_acquire);
+  auto firstValid = newHead >= kEventsPerThread ? newHead - kEventsPerThread + 1 : 0;
+  auto skip = firstValid > first ? std::min<uint64_t>(firstValid - first, events.size()) : 0;
+
+  oEvents.assign(events.begin() + static_cast<std::ptrdiff_t>(skip), events.end());
+}
+
+//------------------------------------------------------------------------
+// writeString - the names are literals from the code but escaping costs
+// nothing and guarantees valid JSON
+//------------------------------------------------------------------------
+void writeString(std::ostream &oStream, char const *iString)
+{
+  oStream << '"';
+  for(auto c = iString ? iString : "?"; *c; c++)
+  {
+    if(*c == '"' || *c == '\\')
+      oStream << '\\';
+    if(static_cast<unsigned char>(*c) >= 0x20)
+      oStream << *c;
+  }
+  oStream << '"';
+}
+
+// writeMicros - Chrome trace timestamps are in microseconds (fractions allowed)
+void writeMicros(std::ostream &oStream, int64_t iNanos)
+{
+  oStream << iNanos / 1000 << '.' << static_cast<char>('0' + (iNanos % 1000) / 100)
+          << static_cast<char>('0' + (iNanos % 100) / 10) << static_cast<char>('0' + iNanos % 10);
+}
+
+}
+
+//------------------------------------------------------------------------
+// getTimeNanos
+//------------------------------------------------------------------------
+int64_t getTimeNanos()
+{
+  using namespace std::chrono;
+  return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+//------------------------------------------------------------------------
+// record
+//------------------------------------------------------------------------
+void record(EventType iType, char const *iName, int64_t iTimeNanos, int64_t iValue)
+{
+  auto buffer = getThreadBuffer();
+  if(!buffer)
+  {
+    gDroppedEventsCount.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  auto head = buffer->fHead.load(std::memory_order_relaxed);
+  buffer->fEvents[head & (kEventsPerThread - 1)] = Event{iName, iTimeNanos, iValue, iType};
+  buffer->fHead.store(head + 1, std::memory_order_release);
+}
+
+//------------------------------------------------------------------------
+// setThreadName
+//------------------------------------------------------------------------
+void setThreadName(char const *iName)
+{
+  auto buffer = getThreadBuffer();
+  if(buffer && buffer->fThreadName.load(std::memory_order_relaxed) != iName)
+    buffer->fThreadName.store(iName, std::memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------
+// getDroppedEventsCount
+//------------------------------------------------------------------------
+uint64_t getDroppedEventsCount()
+{
+  return gDroppedEventsCount.load(std::memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------
+// dumpChromeTrace
+//------------------------------------------------------------------------
+void dumpChromeTrace(std::ostream &oStream)
+{
+  // a single process: the thread id is the index of the buffer
+  constexpr int kPID = 1;
+
+  oStream << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+  bool first = true;
+  auto separator = [&first, &oStream]() {
+    if(!first)
+      oStream << ",\n";
+    first = false;
+  };
+
+  std::vector<Event> events{};
+  for(uint32_t tid = 0; tid < kMaxThreads; tid++)
+  {
+    auto const &buffer = gBuffers[tid];
+    if(!buffer.fClaimed.load(std::memory_order_acquire))
+      continue;
+
+    if(auto name = buffer.fThreadName.load(std::memory_order_relaxed))
+    {
+      separator();
+      oStream << R"({"name":"thread_name","ph":"M","pid":)" << kPID << ",\"tid\":" << tid << ",\"args\":{\"name\":";
+      writeString(oStream, name);
+      oStream << "}}";
+    }
+
+    copyEvents(buffer, events);
+    for(auto const &event: events)
+    {
+      separator();
+      oStream << "{\"name\":";
+      writeString(oStream, event.fName);
+      oStream << ",\"pid\":" << kPID << ",\"tid\":" << tid << ",\"ts\":";
+      writeMicros(oStream, event.fTimeNanos);
+      switch(event.fType)
+      {
+        case EventType::kZone:
+          oStream << ",\"ph\":\"X\",\"dur\":";
+          writeMicros(oStream, event.fValue);
+          break;
+
+        case EventType::kCounter:
+          oStream << ",\"ph\":\"C\",\"args\":{\"value\":" << event.fValue << "}";
+          break;
+
+        case EventType::kFrame:
+          oStream << ",\"ph\":\"i\",\"s\":\"t\"";
+          break;
+      }
+      oStream << "}";
+    }
+  }
+
+  oStream << "]}\n";
+}
+
+//------------------------------------------------------------------------
+// dumpChromeTraceToFile
+//------------------------------------------------------------------------
+std::string dumpChromeTraceToFile()
+{
+  std::string path{};
+  if(auto file = std::getenv("JSGAIN_TRACE_FILE"))
+    path = file;
+  else
+  {
+    char const *directory = nullptr;
+    for(auto variable: {"TMPDIR", "TEMP", "TMP"})
+    {
+      if((directory = std::getenv(variable)) != nullptr)
+        break;
+    }
+    path = std::string{directory ? directory : "."} + "/jsgain-trace-" + std::to_string(getTimeNanos()) + ".json";
+  }
+
+  std::ofstream stream{path};
+  if(!stream)
+  {
+    DLOG_F(WARNING, "Trace - cannot open %s", path.c_str());
+    return {};
+  }
+
+  dumpChromeTrace(stream);
+  return stream ? path : std::string{};
+}
+
+}
@@ -0,0 +1,111 @@
+//------------------------------------------------------------------------------------------------------------
+// This file defines the (optional) tracing used to attribute time inside the plugin: scoped zones, counters
+// and frame marks, recorded in a per thread buffer and dumped in the Chrome trace (JSON) format which can be
+// opened with chrome://tracing or https://ui.perfetto.dev.
+//
+// - each thread claims (once, lock-free) one of the preallocated buffers the first time it records an event:
+//   recording is then a clock read and a few stores (no lock, no allocation) so it is ok to trace the RT
+// - a buffer is a ring: only the last kEventsPerThread events of each thread are kept
+// - dumping (outside the RT, see dumpChromeTrace) copies the events while the threads keep on recording
+//
+// The code is only compiled when the CMake option JSGAIN_ENABLE_TRACE is ON. Otherwise the JSGAIN_TRACE_XXX
+// macros (the only API the rest of the code uses) compile to nothing.
+//------------------------------------------------------------------------------------------------------------
+#pragma once
+
+#if JSGAIN_ENABLE_TRACE
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace pongasoft::VST::JSGain::Trace {
+
+constexpr uint32_t kMaxThreads = 32;
+constexpr uint32_t kEventsPerThread = 1 << 14; // power of 2
+
+enum class EventType : uint8_t
+{
+  kZone,    // fValue is the duration (ns)
+  kCounter, // fValue is the value of the counter
+  kFrame    // instant
+};
+
+//------------------------------------------------------------------------
+// Event - fName must be a static string (a literal): only the pointer is
+// recorded
+//------------------------------------------------------------------------
+struct Event
+{
+  char const *fName;
+  int64_t fTimeNanos;
+  int64_t fValue;
+  EventType fType;
+};
+
+// the clock used for all the events (steady clock)
+int64_t getTimeNanos();
+
+// records an event in the buffer of the calling thread (dropped when all the buffers are in use)
+void record(EventType iType, char const *iName, int64_t iTimeNanos, int64_t iValue);
+
+// names the calling thread in the trace (iName must be a static string)
+void setThreadName(char const *iName);
+
+// number of events dropped because no buffer was available
+uint64_t getDroppedEventsCount();
+
+//------------------------------------------------------------------------
+// Writes the events of all the threads in the Chrome trace JSON format.
+// NOT RT safe (allocates memory).
+//------------------------------------------------------------------------
+void dumpChromeTrace(std::ostream &oStream);
+
+//------------------------------------------------------------------------
+// Same as dumpChromeTrace but in a file: the path is given by the
+// JSGAIN_TRACE_FILE environment variable, or is a file in the temporary
+// directory. Returns the path (empty when the file could not be written).
+//------------------------------------------------------------------------
+std::string dumpChromeTraceToFile();
+
+//------------------------------------------------------------------------
+// Zone - records the time spent in the scope
+//------------------------------------------------------------------------
+class Zone
+{
+public:
+  explicit Zone(char const *iName) : fName{iName}, fStartNanos{getTimeNanos()} {}
+  ~Zone() { record(EventType::kZone, fName, fStartNanos, getTimeNanos() - fStartNanos); }
+
+  Zone(Zone const &) = delete;
+  Zone &operator=(Zone const &) = delete;
+
+private:
+  char const *fName;
+  int64_t fStartNanos;
+};
+
+}
+
+#define JSGAIN_TRACE_CONCAT_IMPL(a, b) a##b
+#define JSGAIN_TRACE_CONCAT(a, b) JSGAIN_TRACE_CONCAT_IMPL(a, b)
+
+#define JSGAIN_TRACE_ZONE(name) \
+  ::pongasoft::VST::JSGain::Trace::Zone JSGAIN_TRACE_CONCAT(jsgainTraceZone, __LINE__){name}
+#define JSGAIN_TRACE_COUNTER(name, value) \
+  ::pongasoft::VST::JSGain::Trace::record(::pongasoft::VST::JSGain::Trace::EventType::kCounter, name, \
+                                          ::pongasoft::VST::JSGain::Trace::getTimeNanos(), \
+                                          static_cast<int64_t>(value))
+#define JSGAIN_TRACE_FRAME(name) \
+  ::pongasoft::VST::JSGain::Trace::record(::pongasoft::VST::JSGain::Trace::EventType::kFrame, name, \
+                                          ::pongasoft::VST::JSGain::Trace::getTimeNanos(), 0)
+#define JSGAIN_TRACE_THREAD(name) ::pongasoft::VST::JSGain::Trace::setThreadName(name)
+
+#else
+
+#define JSGAIN_TRACE_ZONE(name)
+#define JSGAIN_TRACE_COUNTER(name, value)
+#define JSGAIN_TRACE_FRAME(name)
+#define JSGAIN_TRACE_THREAD(name)
+
+#endif
@@ -0,0 +1,36 @@
+//------------------------------------------------------------------------------------------------------------
+// This file contains the helpers shared by several test files.
+//------------------------------------------------------------------------------------------------------------
+#pragma once
+
+#include "src/cpp/JSGainStatsCodec.h"
+
+namespace pongasoft::VST::JSGain::Test {
+
+// generates a realistic batch (max increasing, reset in the middle)
+inline StatsBatch generateBatch(int32 iCount)
+{
+  StatsBatch batch{};
+  int64 resetTime = 1560000000000;
+  for(int32 i = 0; i < iCount; i++)
+  {
+    if(i == iCount / 2)
+      resetTime += 12345;
+    Stats stats{};
+    stats.fSampleRate = 44100;
+    stats.fMaxSinceReset = 0.01 * (i + 1);
+    stats.fResetTime = resetTime;
+    stats.fMaxProjectTimeSamples = i == iCount / 2 ? -1 : 88200 + 300 * i;
+    stats.fSampleTime = 512 * (i + 1);
+    if(i % 4 == 3)
+    {
+      stats.fMetrics = Stats::kMetricRMS | Stats::kMetricClipCount;
+      stats.fRMS = 0.005 * (i + 1);
+      stats.fClipCount = i;
+    }
+    batch.add(stats);
+  }
+  return batch;
+}
+
+}
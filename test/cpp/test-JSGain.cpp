@@ -5,7 +5,30 @@
 #include <pongasoft/logging/logging.h>
 #include <gtest/gtest.h>
 
+#include <base/source/fstreamer.h>
+#include <public.sdk/source/common/memorystream.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
 #include "src/cpp/JSGainModel.h"
+#include "src/cpp/JSGainPlugin.h"
+#include "src/cpp/JSGainLevelHistogram.h"
+#include "src/cpp/JSGainMeterRegistry.h"
+#include "src/cpp/JSGainSharedInstance.h"
+#include "src/cpp/Spectrum/SpectrumAnalyzer.h"
+#include "src/cpp/Concurrent/SPSCQueue.h"
+#include "src/cpp/Concurrent/SeqLock.h"
+#include "src/cpp/Concurrent/SampleRing.h"
+#include "src/cpp/Replay/ProcessTrace.h"
+#include "src/cpp/RT/Reducers.h"
+#include "src/cpp/RT/ChannelMatrix.h"
+#include "src/cpp/RT/VuPPMThrottle.h"
+#include "src/cpp/RT/GainModulation.h"
+#include "src/cpp/JSGainStatsCodec.h"
+#include "JSGainTestUtils.h"
 
 namespace pongasoft {
 namespace VST {
@@ -27,6 +50,875 @@ TEST(JSGainModelTest, GainParamConverter)
   ASSERT_EQ(std::string{"+0.00dB"}, converter.toString(unityGain, 2));
 }
 
+// JSGainModelTest - parseUICommands
+TEST(JSGainModelTest, parseUICommands)
+{
+  UICommand commands[4];
+
+  auto count = parseUICommands("$reset; $state ;hello;;$rtState;extra", commands, 4);
+  ASSERT_EQ(4, count);
+  ASSERT_EQ(UICommand::Type::kResetMax, commands[0].fType);
+  ASSERT_EQ(UICommand::Type::kDumpState, commands[1].fType);
+  ASSERT_EQ(std::string{"$state"}, std::string{commands[1].fText});
+  ASSERT_EQ(UICommand::Type::kText, commands[2].fType);
+  ASSERT_EQ(std::string{"hello"}, std::string{commands[2].fText});
+  ASSERT_EQ(UICommand::Type::kDumpState, commands[3].fType);
+
+  ASSERT_EQ(0, parseUICommands("", commands, 4));
+
+  // missing arguments are NaN (unchanged)
+  count = parseUICommands("$vu 0.5 30;$vu", commands, 4);
+  ASSERT_EQ(2, count);
+  ASSERT_EQ(UICommand::Type::kConfigureVuPPM, commands[0].fType);
+  ASSERT_EQ(0.5, commands[0].fArgs[0]);
+  ASSERT_EQ(30, commands[0].fArgs[1]);
+  ASSERT_TRUE(std::isnan(commands[0].fArgs[2]));
+  ASSERT_EQ(UICommand::Type::kConfigureVuPPM, commands[1].fType);
+  ASSERT_TRUE(std::isnan(commands[1].fArgs[0]));
+
+  // capture: post gain by default, anything else than pre/post stops it
+  count = parseUICommands("$capture;$capture pre;$capture off;$captured", commands, 4);
+  ASSERT_EQ(4, count);
+  ASSERT_EQ(UICommand::Type::kCapture, commands[0].fType);
+  ASSERT_EQ(static_cast<double>(ECaptureTap::kPostGain), commands[0].fArgs[0]);
+  ASSERT_EQ(UICommand::Type::kCapture, commands[1].fType);
+  ASSERT_EQ(static_cast<double>(ECaptureTap::kPreGain), commands[1].fArgs[0]);
+  ASSERT_EQ(UICommand::Type::kCapture, commands[2].fType);
+  ASSERT_EQ(static_cast<double>(ECaptureTap::kOff), commands[2].fArgs[0]);
+  ASSERT_EQ(UICommand::Type::kText, commands[3].fType);
+
+  // record: no audio by default
+  count = parseUICommands("$record;$record samples;$record hashes;$record off", commands, 4);
+  ASSERT_EQ(4, count);
+  for(int32 i = 0; i < count; i++)
+    ASSERT_EQ(UICommand::Type::kRecordProcess, commands[i].fType);
+  ASSERT_EQ(1, commands[0].fArgs[0]);
+  ASSERT_EQ(static_cast<double>(Replay::EAudioRecording::kNone), commands[0].fArgs[1]);
+  ASSERT_EQ(static_cast<double>(Replay::EAudioRecording::kSamples), commands[1].fArgs[1]);
+  ASSERT_EQ(static_cast<double>(Replay::EAudioRecording::kHashes), commands[2].fArgs[1]);
+  ASSERT_EQ(0, commands[3].fArgs[0]);
+}
+
+// StatsCodecTest - encode/decode round trip
+TEST(StatsCodecTest, RoundTrip)
+{
+  auto batch = generateBatch(StatsBatch::kMaxStats);
+
+  uint8 buffer[StatsCodec::kMaxBatchSize];
+  auto size = StatsCodec::encode(batch.fStats, batch.fCount, buffer, StatsCodec::kMaxBatchSize);
+  ASSERT_GT(size, 0);
+
+  Stats decoded[StatsBatch::kMaxStats];
+  ASSERT_EQ(batch.fCount, StatsCodec::decode(buffer, size, decoded, StatsBatch::kMaxStats));
+
+  for(int32 i = 0; i < batch.fCount; i++)
+  {
+    ASSERT_EQ(batch.fStats[i].fSampleRate, decoded[i].fSampleRate);
+    ASSERT_NEAR(batch.fStats[i].fMaxSinceReset, decoded[i].fMaxSinceReset, 1e-6);
+    ASSERT_EQ(batch.fStats[i].fResetTime, decoded[i].fResetTime);
+    ASSERT_EQ(batch.fStats[i].fMaxProjectTimeSamples, decoded[i].fMaxProjectTimeSamples);
+    ASSERT_EQ(batch.fStats[i].fSampleTime, decoded[i].fSampleTime);
+    ASSERT_EQ(batch.fStats[i].fMetrics, decoded[i].fMetrics);
+    ASSERT_NEAR(batch.fStats[i].fRMS, decoded[i].fRMS, 1e-6);
+    ASSERT_EQ(batch.fStats[i].fClipCount, decoded[i].fClipCount);
+  }
+
+  // not enough room => keeps the most recent ones
+  Stats latest[2];
+  ASSERT_EQ(2, StatsCodec::decode(buffer, size, latest, 2));
+  ASSERT_EQ(batch.latest().fSampleTime, latest[1].fSampleTime);
+
+  // buffer too small / truncated / wrong version
+  ASSERT_EQ(-1, StatsCodec::encode(batch.fStats, batch.fCount, buffer, 10));
+  ASSERT_EQ(-1, StatsCodec::decode(buffer, size - 1, decoded, StatsBatch::kMaxStats));
+  buffer[0] = StatsCodec::kVersion + 1;
+  ASSERT_EQ(-1, StatsCodec::decode(buffer, size, decoded, StatsBatch::kMaxStats));
+}
+
+// StatsCodecTest - unknown optional metrics are skipped
+TEST(StatsCodecTest, SkipOptionalMetrics)
+{
+  // version, count=1, sample rate, flags (reset time + 1 unknown metric), dB, sample time, reset time,
+  // max project time samples, metric
+  uint8 buffer[] = { StatsCodec::kVersion, 1, 0, 0x44, 0x2c, 0x47,
+                     StatsCodec::kFlagResetTime | (1 << 7), 0, 0, 0, 0, 0x80, 0x04, 0x02, 0x01, 0, 0, 0x80, 0x3f };
+  Stats stats{};
+  ASSERT_EQ(1, StatsCodec::decode(buffer, sizeof(buffer), &stats, 1));
+  ASSERT_EQ(44100, stats.fSampleRate);
+  ASSERT_EQ(1.0, stats.fMaxSinceReset);
+  ASSERT_EQ(512, stats.fSampleTime);
+  ASSERT_EQ(1, stats.fResetTime);
+  ASSERT_EQ(-1, stats.fMaxProjectTimeSamples);
+}
+
+// JSGainParamDispatchTest - the dispatch table matches the parameters registered in the RT state
+TEST(JSGainParamDispatchTest, MatchesRegistrations)
+{
+  JSGainParameters parameters{};
+  JSGainRTState state{parameters};
+
+  // each slot is the parameter registered with the same ID (on its own cache line)
+  for(auto paramID: kRTVstParamIDs)
+  {
+    auto param = state.getSlotParam(paramID);
+    ASSERT_NE(nullptr, param);
+    ASSERT_EQ(paramID, param->getParamID());
+    ASSERT_EQ(0u, reinterpret_cast<uintptr_t>(param) % Concurrent::kCacheLineSize);
+  }
+
+  // the hot block is before the messaging parameters which start on a new cache line
+  ASSERT_LT(reinterpret_cast<char const *>(&state.fMaxSinceReset), reinterpret_cast<char const *>(&state.fStats));
+  ASSERT_EQ(0u, reinterpret_cast<uintptr_t>(&state.fStats) % Concurrent::kCacheLineSize);
+
+  // going through the slot updates the (typed) parameter using its converter
+  state.getSlotParam(EJSGainParamID::kLeftGain)->updateNormalizedValue(0.5);
+  ASSERT_EQ(GainParamConverter{}.denormalize(0.5).getValueInSample(), state.fLeftGain->getValueInSample());
+  state.getSlotParam(EJSGainParamID::kBypass)->updateNormalizedValue(1.0);
+  ASSERT_TRUE(*state.fBypass);
+
+  // not RT vst parameters
+  for(ParamID paramID: {EJSGainParamID::kLink, EJSGainParamID::kInputText, EJSGainParamID::kStats,
+                        EJSGainParamID::kUIMessage, EJSGainParamID::kRTStateSnapshot,
+                        EJSGainParamID::kLevelHistogram, EJSGainParamID::kInstanceToken})
+  {
+    ASSERT_EQ(nullptr, state.getSlotParam(paramID));
+  }
+  ASSERT_EQ(nullptr, state.getSlotParam(0));
+  ASSERT_EQ(nullptr, state.getSlotParam(ParamDispatchTable::kMaxParamID + 1));
+}
+
+// JSGainModelTest - RTStateSnapshotParamSerializer (write/read round trip of a snapshot filled with all the RT
+// vst params, like JSGainProcessor::sendRTStateSnapshot does)
+TEST(JSGainModelTest, RTStateSnapshotParamSerializer)
+{
+  JSGainParameters parameters{};
+  JSGainRTState state{parameters};
+  state.getSlotParam(EJSGainParamID::kLeftGain)->updateNormalizedValue(0.5);
+  state.getSlotParam(EJSGainParamID::kBypass)->updateNormalizedValue(1.0);
+
+  RTStateSnapshot snapshot{};
+  snapshot.fTimestamp = 1560000000000;
+  snapshot.fFrameCount = 123456789012;
+  snapshot.fLastNumSamples = 512;
+  snapshot.fSampleRate = 48000;
+  snapshot.fMaxSinceReset = 0.75;
+  snapshot.fDroppedUICommandsCount = 3;
+  snapshot.fUICommandLatency.record(500000);
+  snapshot.fUICommandLatency.record(3000000);
+  snapshot.fUICommandLatency.record(40000000);
+
+  // all the RT vst params fit in the snapshot
+  ASSERT_LE(ParamDispatchTable::kNumSlots, RTStateSnapshot::kMaxParams);
+  for(auto paramID: kRTVstParamIDs)
+    snapshot.addParam(paramID, state.getSlotParam(paramID)->getNormalizedValue());
+  ASSERT_EQ(ParamDispatchTable::kNumSlots, snapshot.fParamCount);
+
+  RTStateSnapshotParamSerializer serializer{};
+  Steinberg::MemoryStream stream{};
+  IBStreamer streamer{&stream, kLittleEndian};
+  ASSERT_EQ(kResultOk, serializer.writeToStream(snapshot, streamer));
+  stream.seek(0, IBStream::kIBSeekSet, nullptr);
+  RTStateSnapshot read{};
+  read.fParamCount = 5; // reset by readFromStream
+  ASSERT_EQ(kResultOk, serializer.readFromStream(streamer, read));
+
+  ASSERT_EQ(snapshot.fTimestamp, read.fTimestamp);
+  ASSERT_EQ(snapshot.fFrameCount, read.fFrameCount);
+  ASSERT_EQ(snapshot.fLastNumSamples, read.fLastNumSamples);
+  ASSERT_EQ(snapshot.fSampleRate, read.fSampleRate);
+  ASSERT_EQ(snapshot.fMaxSinceReset, read.fMaxSinceReset);
+  ASSERT_EQ(snapshot.fDroppedUICommandsCount, read.fDroppedUICommandsCount);
+
+  ASSERT_EQ(snapshot.fUICommandLatency.fCount, read.fUICommandLatency.fCount);
+  ASSERT_EQ(snapshot.fUICommandLatency.fTotalNanos, read.fUICommandLatency.fTotalNanos);
+  ASSERT_EQ(snapshot.fUICommandLatency.fMaxNanos, read.fUICommandLatency.fMaxNanos);
+  for(int32 i = 0; i < LatencyHistogram::kNumBins; i++)
+    ASSERT_EQ(snapshot.fUICommandLatency.fCounts[i], read.fUICommandLatency.fCounts[i]) << i;
+
+  ASSERT_EQ(snapshot.fParamCount, read.fParamCount);
+  for(int32 i = 0; i < read.fParamCount; i++)
+  {
+    ASSERT_EQ(kRTVstParamIDs[i], read.fParamIDs[i]);
+    ASSERT_EQ(state.getSlotParam(kRTVstParamIDs[i])->getNormalizedValue(), read.fNormalizedValues[i]);
+  }
+  ASSERT_EQ(EJSGainParamID::kBypass, read.fParamIDs[0]);
+  ASSERT_EQ(1.0, read.fNormalizedValues[0]);
+
+  // truncated => error
+  stream.setSize(stream.getSize() - 4);
+  stream.seek(0, IBStream::kIBSeekSet, nullptr);
+  ASSERT_NE(kResultOk, serializer.readFromStream(streamer, read));
+}
+
+// JSGainModelTest - LevelHistogramAccumulator (bins computed from the exponent bits match the levels in dB)
+TEST(JSGainModelTest, LevelHistogramAccumulator)
+{
+  LevelHistogramAccumulator accumulator{};
+
+  Sample32 samples32[] = { 1.0f, -2.0f, 0.9f, -0.6f, 0.4f, 0.0f, 1e-9f };
+  accumulator.accumulate(samples32, 7);
+
+  Sample64 samples64[] = { -0.9, 0.3 };
+  accumulator.accumulate(samples64, 2);
+
+  LevelHistogram histogram{};
+  accumulator.mergeInto(histogram);
+
+  ASSERT_EQ(9, histogram.fSampleCount);
+  ASSERT_EQ(2u, histogram.fCounts[0]); // >= 0dBFS
+  ASSERT_EQ(2u, histogram.fCounts[1]); // [0.75, 1.0)
+  ASSERT_EQ(1u, histogram.fCounts[2]); // [0.5, 0.75)
+  ASSERT_EQ(1u, histogram.fCounts[3]); // [0.375, 0.5)
+  ASSERT_EQ(1u, histogram.fCounts[4]); // [0.25, 0.375)
+  ASSERT_EQ(2u, histogram.fCounts[LevelHistogram::kNumBins - 1]); // silence
+
+  ASSERT_EQ(0.375, LevelHistogram::getBinLowerBound(3));
+  ASSERT_EQ(0.25, LevelHistogram::getBinLowerBound(4));
+
+  accumulator.clear();
+  accumulator.mergeInto(histogram);
+  ASSERT_EQ(0, histogram.fSampleCount);
+  ASSERT_EQ(0u, histogram.fCounts[0]);
+}
+
+// JSGainModelTest - LevelHistogramParamSerializer (round trip, different number of bins, corrupted streams)
+TEST(JSGainModelTest, LevelHistogramParamSerializer)
+{
+  LevelHistogramParamSerializer serializer{};
+
+  LevelHistogram histogram{};
+  histogram.fSampleCount = 1234567890123;
+  for(int32 i = 0; i < LevelHistogram::kNumBins; i++)
+    histogram.fCounts[i] = static_cast<uint32>(i * 1000 + 1);
+
+  {
+    Steinberg::MemoryStream stream{};
+    IBStreamer streamer{&stream, kLittleEndian};
+    ASSERT_EQ(kResultOk, serializer.writeToStream(histogram, streamer));
+    stream.seek(0, IBStream::kIBSeekSet, nullptr);
+    LevelHistogram read{};
+    ASSERT_EQ(kResultOk, serializer.readFromStream(streamer, read));
+    ASSERT_EQ(histogram.fSampleCount, read.fSampleCount);
+    for(int32 i = 0; i < LevelHistogram::kNumBins; i++)
+      ASSERT_EQ(histogram.fCounts[i], read.fCounts[i]) << i;
+  }
+
+  // more bins (ex: newer version) => the extra ones are added to the last one
+  {
+    Steinberg::MemoryStream stream{};
+    IBStreamer streamer{&stream, kLittleEndian};
+    streamer.writeInt64(10);
+    streamer.writeInt32(LevelHistogram::kNumBins + 2);
+    for(int32 i = 0; i < LevelHistogram::kNumBins + 2; i++)
+      streamer.writeInt32(1);
+    stream.seek(0, IBStream::kIBSeekSet, nullptr);
+    LevelHistogram read{};
+    ASSERT_EQ(kResultOk, serializer.readFromStream(streamer, read));
+    ASSERT_EQ(1u, read.fCounts[0]);
+    ASSERT_EQ(3u, read.fCounts[LevelHistogram::kNumBins - 1]);
+  }
+
+  // implausible number of bins => rejected without reading them
+  {
+    Steinberg::MemoryStream stream{};
+    IBStreamer streamer{&stream, kLittleEndian};
+    streamer.writeInt64(10);
+    streamer.writeInt32(LevelHistogramParamSerializer::kMaxNumBins + 1);
+    stream.seek(0, IBStream::kIBSeekSet, nullptr);
+    LevelHistogram read{};
+    ASSERT_NE(kResultOk, serializer.readFromStream(streamer, read));
+  }
+
+  // truncated => error
+  {
+    Steinberg::MemoryStream stream{};
+    IBStreamer streamer{&stream, kLittleEndian};
+    streamer.writeInt64(10);
+    streamer.writeInt32(LevelHistogram::kNumBins);
+    streamer.writeInt32(1);
+    stream.seek(0, IBStream::kIBSeekSet, nullptr);
+    LevelHistogram read{};
+    ASSERT_NE(kResultOk, serializer.readFromStream(streamer, read));
+    ASSERT_EQ(1u, read.fCounts[0]);
+  }
+}
+
+// VuPPMThrottleTest - the peak is held for the interval and only published when it moved by the threshold
+TEST(VuPPMThrottleTest, ThresholdAndRate)
+{
+  RT::VuPPMThrottle throttle{};
+  throttle.setup({1.0, 100, false}, 48000);
+  ASSERT_EQ(480, throttle.getIntervalSamples());
+
+  double peak{};
+
+  // held over the interval (the first value is always published)
+  ASSERT_FALSE(throttle.process(0.5, 240, peak));
+  ASSERT_TRUE(throttle.process(0.25, 240, peak));
+  ASSERT_EQ(0.5, peak);
+
+  // less than 1dB away => not published
+  ASSERT_FALSE(throttle.process(0.51, 480, peak));
+  ASSERT_EQ(1, throttle.getSuppressedCount());
+
+  // a few dB away => published
+  ASSERT_TRUE(throttle.process(0.3, 480, peak));
+  ASSERT_EQ(0.3, peak);
+
+  // silence is published (once)
+  ASSERT_TRUE(throttle.process(0, 480, peak));
+  ASSERT_FALSE(throttle.process(1e-9, 480, peak));
+
+  // small blocks: never more often than kMinIntervalSamples
+  throttle.setup({0, 0, false}, 48000);
+  ASSERT_EQ(RT::VuPPMThrottle::kMinIntervalSamples, throttle.getIntervalSamples());
+  ASSERT_FALSE(throttle.process(0.1, 32, peak));
+  ASSERT_TRUE(throttle.process(0.1, 32, peak));
+  ASSERT_FALSE(throttle.process(0.1, 64, peak)); // no threshold but same value
+  ASSERT_TRUE(throttle.process(0.1001, 64, peak));
+
+  // only when an editor is open (opening it publishes the current value right away)
+  throttle.configure({1.0, 0, true});
+  ASSERT_FALSE(throttle.process(0.8, 64, peak));
+  throttle.setEditorOpen(true);
+  ASSERT_TRUE(throttle.process(0.1, 64, peak));
+  ASSERT_EQ(0.1, peak);
+  throttle.setEditorOpen(false);
+  ASSERT_FALSE(throttle.process(0.9, 64, peak));
+}
+
+// JSGainModelTest - LatencyHistogram (power of 2 bins in us, percentiles capped by the max)
+TEST(JSGainModelTest, LatencyHistogram)
+{
+  ASSERT_EQ(0, LatencyHistogram::getBin(-5));
+  ASSERT_EQ(0, LatencyHistogram::getBin(1999));
+  ASSERT_EQ(1, LatencyHistogram::getBin(2000));
+  ASSERT_EQ(1, LatencyHistogram::getBin(3999));
+  ASSERT_EQ(10, LatencyHistogram::getBin(1500000)); // 1.5ms in [1024us, 2048us)
+  ASSERT_EQ(LatencyHistogram::kNumBins - 1, LatencyHistogram::getBin(3600 * 1000000000LL));
+
+  LatencyHistogram histogram{};
+  ASSERT_EQ(0, histogram.getPercentileNanos(0.5));
+
+  for(int i = 0; i < 98; i++)
+    histogram.record(500000); // 0.5ms
+  histogram.record(3000000); // 3ms
+  histogram.record(40000000); // 40ms
+
+  ASSERT_EQ(100, histogram.fCount);
+  ASSERT_EQ(40000000, histogram.fMaxNanos);
+  ASSERT_EQ((98 * 500000 + 3000000 + 40000000) / 100, histogram.getMeanNanos());
+  ASSERT_EQ(512000, histogram.getPercentileNanos(0.5));
+  ASSERT_EQ(4096000, histogram.getPercentileNanos(0.99));
+  ASSERT_EQ(40000000, histogram.getPercentileNanos(1.0));
+
+  // not stamped => ignored
+  histogram.recordSince(0, 12345);
+  ASSERT_EQ(100, histogram.fCount);
+
+  MessagingStats stats{};
+  stats.onReceive(1000, 3, 2000);
+  stats.onReceive(1000000000, 2, 1000002000);
+  stats.onReceive(2000000000, 2, 2000002000);
+  ASSERT_EQ(3, stats.fMessageCount);
+  ASSERT_EQ(7, stats.fItemCount);
+  ASSERT_NEAR(1.0, stats.getMessagesPerSecond(), 1e-6);
+  ASSERT_NEAR(2.0, stats.getItemsPerSecond(), 1e-6);
+  ASSERT_EQ(3, stats.fReceiveLatency.fCount);
+  ASSERT_EQ(2000, stats.fReceiveLatency.fMaxNanos);
+}
+
+// SpectrumTest - a full scale sine wave shows up at 0dB in the band containing its frequency
+TEST(SpectrumTest, SpectrumProcessor)
+{
+  using namespace Spectrum;
+
+  constexpr double sampleRate = 48000;
+  constexpr double frequency = 1000;
+
+  // the ring (written by the RT) wraps around several times
+  JSGainSharedInstance instance{};
+  for(int block = 0; block < 10; block++)
+  {
+    instance.fSpectrumRing.write(4800, [block](int32_t i) {
+      return static_cast<float>(std::sin(2.0 * kPi * frequency * (block * 4800 + i) / sampleRate));
+    });
+  }
+
+  std::vector<float> samples(SpectrumProcessor::kFFTSize);
+  ASSERT_TRUE(instance.fSpectrumRing.readLatest(samples.data(), SpectrumProcessor::kFFTSize));
+
+  SpectrumProcessor processor{0};
+  SpectrumBands bands{};
+  processor.process(samples.data(), sampleRate, bands);
+
+  auto loudest = std::max_element(std::begin(bands.fLevelsInDb), std::end(bands.fLevelsInDb)) - std::begin(bands.fLevelsInDb);
+  auto ratio = std::log(bands.fMaxFrequency / bands.fMinFrequency) / SpectrumBands::kNumBands;
+  ASSERT_LE(bands.fMinFrequency * std::exp(ratio * loudest), frequency);
+  ASSERT_GT(bands.fMinFrequency * std::exp(ratio * (loudest + 1)), frequency);
+  ASSERT_NEAR(0.0, bands.fLevelsInDb[loudest], 1.5); // Hann window scalloping loss
+  ASSERT_LT(bands.fLevelsInDb[0], -60.0);
+}
+
+// SpectrumTest - the analyzer is attached while alive (the RT only writes the ring then) and ignores the samples
+// written before it was attached
+TEST(SpectrumTest, SpectrumAnalyzer)
+{
+  using namespace Spectrum;
+
+  auto writeSamples = [](JSGainSharedInstance &ioInstance, int32_t iNumSamples) {
+    ioInstance.fSpectrumRing.write(iNumSamples, [](int32_t i) { return static_cast<float>(std::sin(i * 0.1)); });
+  };
+
+  auto instance = std::make_shared<JSGainSharedInstance>();
+  instance->fSampleRate = 48000;
+  writeSamples(*instance, SpectrumProcessor::kFFTSize); // left over from a previous analyzer
+  ASSERT_FALSE(instance->hasSpectrumReader());
+
+  {
+    SpectrumAnalyzer analyzer{instance, std::chrono::milliseconds{1}};
+    ASSERT_TRUE(instance->hasSpectrumReader());
+
+    // not enough samples written since attached
+    writeSamples(*instance, SpectrumProcessor::kFFTSize - 1);
+    std::this_thread::sleep_for(std::chrono::milliseconds{20});
+    ASSERT_EQ(0u, analyzer.getSequence());
+
+    writeSamples(*instance, 1);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while(analyzer.getSequence() == 0 && std::chrono::steady_clock::now() < deadline)
+      std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    ASSERT_NE(0u, analyzer.getSequence());
+  }
+
+  ASSERT_FALSE(instance->hasSpectrumReader());
+}
+
+// ReducersTest - the fused loop computes the same values as the naive (one pass per metric) computation
+TEST(ReducersTest, Analysis)
+{
+  using namespace RT::Reducers;
+
+  constexpr int32 kNumFrames = 203; // not a multiple of kNumLanes => remainder loop
+
+  std::vector<Sample32> left(kNumFrames), right(kNumFrames), leftOut(kNumFrames), rightOut(kNumFrames);
+  for(int32 i = 0; i < kNumFrames; i++)
+  {
+    left[i] = static_cast<Sample32>(0.8 * std::sin(i * 0.1) + 0.05);
+    right[i] = static_cast<Sample32>(-0.6 * std::sin(i * 0.1));
+  }
+
+  Analysis<Peak, Silence, RMS, DCOffset, ClipCount, Correlation> analysis{};
+  ASSERT_TRUE((analysis.has<Peak>()));
+  ASSERT_FALSE((Analysis<Peak>::has<RMS>()));
+
+  analysis.processStereo(left.data(), right.data(), leftOut.data(), rightOut.data(), kNumFrames, 2.0f, 1.0f);
+
+  int32 peakFrame = 0;
+  double peak = 0, sumSquares = 0, sum = 0, leftRight = 0, leftLeft = 0, rightRight = 0;
+  int64 clipCount = 0;
+  for(int32 i = 0; i < kNumFrames; i++)
+  {
+    double l = left[i] * 2.0f;
+    double r = right[i];
+    ASSERT_EQ(left[i] * 2.0f, leftOut[i]);
+    ASSERT_EQ(right[i], rightOut[i]);
+    if(std::max(std::abs(l), std::abs(r)) > peak)
+    {
+      peak = std::max(std::abs(l), std::abs(r));
+      peakFrame = i;
+    }
+    sumSquares += l * l + r * r;
+    sum += l + r;
+    leftRight += l * r;
+    leftLeft += l * l;
+    rightRight += r * r;
+    if(std::abs(l) >= 1 || std::abs(r) >= 1)
+      clipCount++;
+  }
+
+  ASSERT_EQ(peak, analysis.get<Peak>().getPeak());
+  ASSERT_EQ(peakFrame, analysis.get<Peak>().getPeakFrame());
+  ASSERT_FALSE(analysis.get<Silence>().isLeftSilent());
+  ASSERT_FALSE(analysis.get<Silence>().isRightSilent());
+  ASSERT_NEAR(std::sqrt(sumSquares / (2.0 * kNumFrames)), analysis.get<RMS>().getRMS(), 1e-9);
+  ASSERT_NEAR(sum / (2.0 * kNumFrames), analysis.get<DCOffset>().getDCOffset(), 1e-9);
+  ASSERT_EQ(clipCount, analysis.get<ClipCount>().getClipCount());
+  ASSERT_NEAR(leftRight / std::sqrt(leftLeft * rightRight), analysis.get<Correlation>().getCorrelation(), 1e-9);
+
+  // silence (mono)
+  std::fill(left.begin(), left.end(), 0);
+  analysis.reset<Silence>();
+  analysis.processMono(left.data(), leftOut.data(), kNumFrames, 1.0f);
+  ASSERT_TRUE(analysis.get<Silence>().isLeftSilent());
+
+  // the gain is applied in double (then narrowed) like the original processChannel
+  analysis.processMono(right.data(), leftOut.data(), kNumFrames, 0.3);
+  for(int32 i = 0; i < kNumFrames; i++)
+    ASSERT_EQ(static_cast<Sample32>(right[i] * 0.3), leftOut[i]);
+}
+
+// ReducersTest - the level histogram filled in the fused loop is the same as the one computed from the output
+TEST(ReducersTest, LevelHistogram)
+{
+  using namespace RT::Reducers;
+
+  constexpr int32 kNumFrames = 45; // not a multiple of kNumLanes => remainder loop
+
+  std::vector<Sample64> left(kNumFrames), right(kNumFrames), leftOut(kNumFrames), rightOut(kNumFrames);
+  for(int32 i = 0; i < kNumFrames; i++)
+  {
+    left[i] = 1.2 * std::sin(i * 0.2);
+    right[i] = std::pow(0.5, i % 20);
+  }
+
+  Analysis<Peak, LevelHistogramAccumulator> analysis{};
+  LevelHistogramAccumulator expected{};
+  LevelHistogram actualHistogram{}, expectedHistogram{};
+
+  // stereo: 2 samples per frame
+  analysis.processStereo(left.data(), right.data(), leftOut.data(), rightOut.data(), kNumFrames, 0.5, 1.0);
+  expected.accumulate(leftOut.data(), kNumFrames);
+  expected.accumulate(rightOut.data(), kNumFrames);
+
+  analysis.get<LevelHistogramAccumulator>().mergeInto(actualHistogram);
+  expected.mergeInto(expectedHistogram);
+  ASSERT_EQ(2 * kNumFrames, actualHistogram.fSampleCount);
+  for(int32 bin = 0; bin < LevelHistogram::kNumBins; bin++)
+    ASSERT_EQ(expectedHistogram.fCounts[bin], actualHistogram.fCounts[bin]);
+
+  // mono: the sample is counted once
+  analysis.reset<LevelHistogramAccumulator>();
+  expected.clear();
+  analysis.processMono(left.data(), leftOut.data(), kNumFrames, 1.0);
+  expected.accumulate(leftOut.data(), kNumFrames);
+
+  analysis.get<LevelHistogramAccumulator>().mergeInto(actualHistogram);
+  expected.mergeInto(expectedHistogram);
+  ASSERT_EQ(kNumFrames, actualHistogram.fSampleCount);
+  for(int32 bin = 0; bin < LevelHistogram::kNumBins; bin++)
+    ASSERT_EQ(expectedHistogram.fCounts[bin], actualHistogram.fCounts[bin]);
+}
+
+// ReducersTest - the modulation (linear or dB) is applied on top of the gain in the same loop
+TEST(ReducersTest, Modulation)
+{
+  using namespace RT::Reducers;
+
+  constexpr int32 kNumFrames = 37; // not a multiple of kNumLanes => remainder loop
+
+  std::vector<Sample32> left(kNumFrames), right(kNumFrames), modulation(kNumFrames);
+  std::vector<Sample32> leftOut(kNumFrames), rightOut(kNumFrames);
+  for(int32 i = 0; i < kNumFrames; i++)
+  {
+    left[i] = static_cast<Sample32>(0.8 * std::sin(i * 0.3));
+    right[i] = static_cast<Sample32>(-0.6 * std::cos(i * 0.3));
+    modulation[i] = static_cast<Sample32>(i) / kNumFrames;
+  }
+
+  Analysis<Peak, Silence> analysis{};
+
+  // linear
+  analysis.processStereo(left.data(), right.data(), leftOut.data(), rightOut.data(), kNumFrames, 0.5f, 2.0f,
+                         RT::LinearModulation<Sample32>{modulation.data()});
+  double peak = 0;
+  for(int32 i = 0; i < kNumFrames; i++)
+  {
+    ASSERT_EQ(left[i] * 0.5f * modulation[i], leftOut[i]);
+    ASSERT_EQ(right[i] * 2.0f * modulation[i], rightOut[i]);
+    peak = std::max({peak, static_cast<double>(std::abs(leftOut[i])), static_cast<double>(std::abs(rightOut[i]))});
+  }
+  ASSERT_EQ(peak, analysis.get<Peak>().getPeak());
+
+  // unmodulated is the same as a modulation of 1.0 (and as no modulation at all)
+  std::vector<Sample32> unity(kNumFrames, 1.0f), unityOut(kNumFrames);
+  analysis.processMono(left.data(), leftOut.data(), kNumFrames, 0.7f);
+  analysis.processMono(left.data(), unityOut.data(), kNumFrames, 0.7f, RT::LinearModulation<Sample32>{unity.data()});
+  ASSERT_EQ(leftOut, unityOut);
+
+  // dB (capped at +24dB)
+  Sample32 db[] = {0.0f, -6.0206f, -20.0f, -200.0f, 100.0f};
+  analysis.processMono(left.data() + 1, leftOut.data(), 5, 1.0f, RT::DecibelModulation<Sample32>{db});
+  ASSERT_NEAR(left[1], leftOut[0], 1e-6);
+  ASSERT_NEAR(left[2] * 0.5, leftOut[1], 1e-6);
+  ASSERT_NEAR(left[3] * 0.1, leftOut[2], 1e-6);
+  ASSERT_NEAR(0.0, leftOut[3], 1e-9);
+  ASSERT_NEAR(left[5] * std::pow(10.0, 24.0 / 20.0), leftOut[4], 1e-4);
+}
+
+// ChannelMatrixTest - the routing matrix is classified (identity/sparse/dense) and mixes properly
+TEST(ChannelMatrixTest, Routing)
+{
+  using RT::ChannelMatrix;
+  using Kind = ChannelMatrix::Kind;
+
+  // stereo
+  ASSERT_EQ(Kind::kIdentity, ChannelMatrix::fromRouting(ERouting::kStereo, 2, 2).getKind());
+  ASSERT_EQ(Kind::kSparse, ChannelMatrix::fromRouting(ERouting::kSwap, 2, 2).getKind());
+  ASSERT_EQ(Kind::kSparse, ChannelMatrix::fromRouting(ERouting::kInvertLeft, 2, 2).getKind());
+  ASSERT_EQ(Kind::kSparse, ChannelMatrix::fromRouting(ERouting::kRightOnly, 2, 2).getKind());
+  ASSERT_EQ(Kind::kDense, ChannelMatrix::fromRouting(ERouting::kMono, 2, 2).getKind());
+  ASSERT_EQ(Kind::kDense, ChannelMatrix::fromRouting(ERouting::kMidSide, 2, 2).getKind());
+
+  auto swap = ChannelMatrix::fromRouting(ERouting::kSwap, 2, 2);
+  ASSERT_EQ(1, swap.getSource(0));
+  ASSERT_EQ(0, swap.getSource(1));
+  auto invert = ChannelMatrix::fromRouting(ERouting::kInvertRight, 2, 2);
+  ASSERT_EQ(1.0, invert.getCoefficient(0));
+  ASSERT_EQ(-1.0, invert.getCoefficient(1));
+
+  // other layouts: upmix (mono -> stereo), downmix (stereo -> mono)
+  auto upmix = ChannelMatrix::fromRouting(ERouting::kStereo, 1, 2);
+  ASSERT_EQ(Kind::kSparse, upmix.getKind());
+  ASSERT_EQ(0, upmix.getSource(0));
+  ASSERT_EQ(0, upmix.getSource(1));
+  ASSERT_EQ(1.0, upmix.getCoefficient(1));
+  auto downmix = ChannelMatrix::fromRouting(ERouting::kStereo, 2, 1);
+  ASSERT_EQ(Kind::kDense, downmix.getKind());
+  ASSERT_EQ(0.5, downmix.getGain(0, 0));
+  ASSERT_EQ(0.5, downmix.getGain(0, 1));
+  ASSERT_EQ(Kind::kIdentity, ChannelMatrix::fromRouting(ERouting::kSwap, 1, 1).getKind());
+  ASSERT_EQ(Kind::kSparse, ChannelMatrix::fromRouting(ERouting::kLeftOnly, 2, 1).getKind());
+
+  // mix (more frames than a tile and not a multiple of it), in place (output buffers = input buffers)
+  constexpr int32 kNumFrames = ChannelMatrix::kTileFrames * 3 + 5;
+  std::vector<Sample32> left(kNumFrames), right(kNumFrames);
+  for(int32 i = 0; i < kNumFrames; i++)
+  {
+    left[i] = static_cast<Sample32>(i) / kNumFrames;
+    right[i] = 1.0f - left[i];
+  }
+  auto expectedLeft = left;
+  auto expectedRight = right;
+
+  Sample32 const *inputs[] = {left.data(), right.data()};
+  Sample32 *outputs[] = {left.data(), right.data()};
+  ChannelMatrix::fromRouting(ERouting::kMidSide, 2, 2).mix(inputs, outputs, kNumFrames);
+  for(int32 i = 0; i < kNumFrames; i++)
+  {
+    ASSERT_FLOAT_EQ(0.5f * (expectedLeft[i] + expectedRight[i]), left[i]);
+    ASSERT_FLOAT_EQ(0.5f * (expectedLeft[i] - expectedRight[i]), right[i]);
+  }
+}
+
+// routing parameter (discrete: one step per value)
+TEST(ChannelMatrixTest, RoutingParamConverter)
+{
+  RoutingParamConverter converter{};
+  ASSERT_EQ(static_cast<int32>(ERouting::kLast), converter.getStepCount());
+  for(int32 i = 0; i <= converter.getStepCount(); i++)
+  {
+    auto routing = static_cast<ERouting>(i);
+    ASSERT_EQ(routing, converter.denormalize(converter.normalize(routing)));
+  }
+  ASSERT_EQ(ERouting::kStereo, converter.denormalize(0.0));
+  ASSERT_EQ(ERouting::kLast, converter.denormalize(1.0));
+}
+
+// SharedInstanceTest - an instance is only found with the token of this process (same id, other process => none)
+TEST(SharedInstanceTest, TokenIsProcessUnique)
+{
+  auto instance = std::make_shared<JSGainSharedInstance>();
+  auto token = JSGainInstanceRegistry::add(instance);
+  ASSERT_TRUE(token.isValid());
+  ASSERT_NE(0u, token.fNonce);
+  ASSERT_TRUE(JSGainInstanceRegistry::isLocal(token));
+  ASSERT_EQ(instance, JSGainInstanceRegistry::find(token));
+
+  // what a processor of another process would send (its counter may very well be at the same value)
+  auto otherProcessToken = InstanceToken{token.fId, token.fNonce + 1};
+  ASSERT_FALSE(JSGainInstanceRegistry::isLocal(otherProcessToken));
+  ASSERT_EQ(nullptr, JSGainInstanceRegistry::find(otherProcessToken));
+  ASSERT_EQ(nullptr, JSGainInstanceRegistry::find(InstanceToken{}));
+
+  // the token goes through the Jmb param unchanged
+  InstanceTokenParamSerializer serializer{};
+  Steinberg::MemoryStream stream{};
+  IBStreamer streamer{&stream, kLittleEndian};
+  ASSERT_EQ(kResultOk, serializer.writeToStream(token, streamer));
+  stream.seek(0, IBStream::kIBSeekSet, nullptr);
+  InstanceToken read{};
+  ASSERT_EQ(kResultOk, serializer.readFromStream(streamer, read));
+  ASSERT_EQ(token, read);
+
+  JSGainInstanceRegistry::remove(token);
+  ASSERT_EQ(nullptr, JSGainInstanceRegistry::find(token));
+}
+
+// MeterRegistryTest - slots are claimed/released and published values are visible to the readers
+TEST(MeterRegistryTest, ClaimPublishRelease)
+{
+  auto slot = MeterRegistry::claim(InstanceToken{42});
+  ASSERT_NE(nullptr, slot);
+  ASSERT_TRUE(slot->fClaimed.load());
+  ASSERT_EQ(42, slot->fInstanceId.load());
+  ASSERT_EQ(0, reinterpret_cast<uintptr_t>(slot) % Concurrent::kCacheLineSize);
+
+  auto updateCount = slot->fUpdateCount.load();
+  slot->publish(0.5f, 0.25f, 3);
+  slot->publish(0.75f, 0.5f, 2);
+  ASSERT_EQ(0.75f, slot->fPeak.load());
+  ASSERT_EQ(0.5f, slot->fRMS.load());
+  ASSERT_EQ(5, slot->fClipCount.load());
+  ASSERT_EQ(updateCount + 2, slot->fUpdateCount.load());
+  slot->resetClipCount();
+  ASSERT_EQ(0, slot->fClipCount.load());
+
+  // the readers see the slot among all the slots
+  auto slots = MeterRegistry::getSlots();
+  ASSERT_TRUE(slot >= slots && slot < slots + MeterRegistry::kMaxSlots);
+
+  // claiming all the other slots => no more available
+  std::vector<MeterSlot *> others{};
+  while(auto other = MeterRegistry::claim(InstanceToken{43}))
+    others.emplace_back(other);
+  ASSERT_LE(others.size(), MeterRegistry::kMaxSlots - 1);
+  ASSERT_EQ(nullptr, MeterRegistry::claim(InstanceToken{44}));
+
+  // a released slot can be claimed again (and starts from scratch)
+  MeterRegistry::release(slot);
+  ASSERT_FALSE(slot->fClaimed.load());
+  ASSERT_EQ(slot, MeterRegistry::claim(InstanceToken{45}));
+  ASSERT_EQ(0.0f, slot->fPeak.load());
+
+  MeterRegistry::release(slot);
+  for(auto other: others)
+    MeterRegistry::release(other);
+}
+
+// ConcurrentTest - SPSCQueue (burst is not lost and is drained in order)
+TEST(ConcurrentTest, SPSCQueue)
+{
+  Concurrent::SPSCQueue<UICommand, 4> queue{};
+
+  UICommand command{};
+  for(int i = 0; i < 4; i++)
+  {
+    command.fTimestamp = i;
+    ASSERT_TRUE(queue.push(command));
+  }
+  // full
+  ASSERT_FALSE(queue.push(command));
+
+  int64 expected = 0;
+  ASSERT_EQ(4u, queue.drain([&expected](UICommand const &iCommand) { ASSERT_EQ(expected++, iCommand.fTimestamp); }));
+  ASSERT_TRUE(queue.empty());
+  ASSERT_FALSE(queue.pop(command));
+
+  // wraps around
+  command.fTimestamp = 10;
+  ASSERT_TRUE(queue.push(command));
+  ASSERT_TRUE(queue.pop(command));
+  ASSERT_EQ(10, command.fTimestamp);
+}
+
+// ConcurrentTest - SeqLock (the sequence returned by read is the one of the value read, not of an earlier check)
+TEST(ConcurrentTest, SeqLockSequence)
+{
+  Concurrent::SeqLock<int64> lock{};
+
+  lock.write(1);
+  auto checked = lock.sequence();
+
+  // a new value is written between the check and the read
+  lock.write(2);
+
+  int64 value = 0;
+  uint32_t sequence = 0;
+  ASSERT_TRUE(lock.read(value, sequence));
+  ASSERT_EQ(2, value);
+  ASSERT_NE(checked, sequence);
+  ASSERT_EQ(lock.sequence(), sequence);
+
+  // nothing new => same sequence
+  ASSERT_TRUE(lock.tryRead(value, sequence));
+  ASSERT_EQ(lock.sequence(), sequence);
+}
+
+// ConcurrentTest - SampleRing (a read happening while a block is being written, deterministically interleaved by
+// reading from the sample generator, rejects the copy as soon as it includes a sample already overwritten)
+TEST(ConcurrentTest, SampleRingReadDuringWrite)
+{
+  constexpr int32_t kBlockSize = 48;
+  constexpr int32_t kNumSamples = 240; // the block being written overwrites the oldest 32 samples of the copy
+  Concurrent::SampleRing<uint64_t, 256> ring{};
+
+  ring.write(256, [](int32_t i) { return static_cast<uint64_t>(i); });
+
+  std::vector<uint64_t> samples(kNumSamples);
+  int validCopies = 0, rejectedCopies = 0;
+  uint64_t next = 256;
+  for(int block = 0; block < 4; block++)
+  {
+    ring.write(kBlockSize, [&](int32_t i) {
+      // samples [next, next + i) have already been overwritten at this point
+      if(ring.readLatest(samples.data(), kNumSamples))
+      {
+        validCopies++;
+        for(int32_t j = 1; j < kNumSamples; j++)
+          EXPECT_EQ(samples[j - 1] + 1, samples[j]);
+      }
+      else
+        rejectedCopies++;
+      return next + i;
+    });
+    next += kBlockSize;
+  }
+
+  // the reader cannot tell how far the write in progress went: the ring conservatively rejects all of them
+  // (including the first 16 reads in each block for which the overwritten samples are not part of the copy yet)
+  ASSERT_EQ(4 * kBlockSize, rejectedCopies);
+  ASSERT_EQ(0, validCopies);
+
+  // once the write is complete, the copy is valid again
+  ASSERT_TRUE(ring.readLatest(samples.data(), kNumSamples));
+  ASSERT_EQ(next - kNumSamples, samples[0]);
+}
+
+// ConcurrentTest - SampleRing (a writer running concurrently with the reader never produces a torn copy which is
+// reported as valid). The values are consecutive integers so any overwritten sample breaks the sequence.
+TEST(ConcurrentTest, SampleRingConcurrentWriter)
+{
+  constexpr int32_t kBlockSize = 48;
+  constexpr int32_t kNumSamples = 200; // close to the capacity => the writer often overwrites the copy
+  Concurrent::SampleRing<uint64_t, 256> ring{};
+
+  std::atomic<bool> stop{false};
+  std::thread writer{[&ring, &stop] {
+    uint64_t next = 0;
+    while(!stop.load(std::memory_order_relaxed))
+    {
+      ring.write(kBlockSize, [&next](int32_t i) { return next + i; });
+      next += kBlockSize;
+    }
+  }};
+
+  // reads until enough copies made it through (bounded in time in case the writer starves the reader)
+  std::vector<uint64_t> samples(kNumSamples);
+  int validCopies = 0, tornCopies = 0;
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+  while(validCopies < 10000 && std::chrono::steady_clock::now() < deadline)
+  {
+    if(!ring.readLatest(samples.data(), kNumSamples))
+      continue;
+    validCopies++;
+    for(int32_t i = 1; i < kNumSamples; i++)
+    {
+      if(samples[i] != samples[i - 1] + 1)
+      {
+        tornCopies++;
+        break;
+      }
+    }
+  }
+
+  stop.store(true);
+  writer.join();
+
+  ASSERT_EQ(0, tornCopies);
+  ASSERT_GT(validCopies, 0);
+}
+
 }
 }
 }
@@ -0,0 +1,830 @@
+//------------------------------------------------------------------------------------------------------------
+// This file contains tests which also act as (simple) benchmarks: they log the measured numbers (see LOG_F)
+// but only assert on correctness so that they never fail on a slow/busy machine.
+//------------------------------------------------------------------------------------------------------------
+#include <pongasoft/logging/logging.h>
+#include <gtest/gtest.h>
+
+#include <base/source/fstreamer.h>
+#include <public.sdk/source/common/memorystream.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "src/cpp/JSGainStatsCodec.h"
+#include "src/cpp/Concurrent/SPSCQueue.h"
+#include "src/cpp/RT/JSGainProcessor.h"
+#include "src/cpp/GUI/UIDescriptionCache.h"
+#include "JSGainTestUtils.h"
+
+namespace pongasoft {
+namespace VST {
+namespace JSGain {
+namespace Test {
+
+using namespace std::chrono;
+
+namespace {
+
+//------------------------------------------------------------------------
+// ParamValueQueue - minimal (fixed size, no allocation) implementation of
+// the queue of points the host sends for one parameter
+//------------------------------------------------------------------------
+class ParamValueQueue : public IParamValueQueue
+{
+public:
+  static constexpr int32 kMaxPoints = 16;
+
+  void reset(ParamID iParamID) { fParamID = iParamID; fCount = 0; }
+
+  ParamID PLUGIN_API getParameterId() override { return fParamID; }
+  int32 PLUGIN_API getPointCount() override { return fCount; }
+
+  tresult PLUGIN_API getPoint(int32 index, int32 &sampleOffset, ParamValue &value) override
+  {
+    if(index < 0 || index >= fCount)
+      return kResultFalse;
+    sampleOffset = fOffsets[index];
+    value = fValues[index];
+    return kResultOk;
+  }
+
+  tresult PLUGIN_API addPoint(int32 sampleOffset, ParamValue value, int32 &index) override
+  {
+    if(fCount == kMaxPoints)
+      return kResultFalse;
+    index = fCount++;
+    fOffsets[index] = sampleOffset;
+    fValues[index] = value;
+    return kResultOk;
+  }
+
+  tresult PLUGIN_API queryInterface(const TUID /* iid */, void **obj) override { *obj = nullptr; return kNoInterface; }
+  uint32 PLUGIN_API addRef() override { return 1; }
+  uint32 PLUGIN_API release() override { return 1; }
+
+private:
+  ParamID fParamID{};
+  int32 fCount{0};
+  int32 fOffsets[kMaxPoints]{};
+  ParamValue fValues[kMaxPoints]{};
+};
+
+//------------------------------------------------------------------------
+// ParameterChanges - minimal implementation of IParameterChanges (also
+// used for the output parameter changes)
+//------------------------------------------------------------------------
+class ParameterChanges : public IParameterChanges
+{
+public:
+  static constexpr int32 kMaxQueues = 8;
+
+  void clear() { fCount = 0; }
+
+  int32 PLUGIN_API getParameterCount() override { return fCount; }
+
+  IParamValueQueue *PLUGIN_API getParameterData(int32 index) override
+  {
+    return index >= 0 && index < fCount ? &fQueues[index] : nullptr;
+  }
+
+  IParamValueQueue *PLUGIN_API addParameterData(const ParamID &id, int32 &index) override
+  {
+    for(index = 0; index < fCount; index++)
+    {
+      if(fQueues[index].getParameterId() == id)
+        return &fQueues[index];
+    }
+    if(fCount == kMaxQueues)
+      return nullptr;
+    index = fCount++;
+    fQueues[index].reset(id);
+    return &fQueues[index];
+  }
+
+  tresult PLUGIN_API queryInterface(const TUID /* iid */, void **obj) override { *obj = nullptr; return kNoInterface; }
+  uint32 PLUGIN_API addRef() override { return 1; }
+  uint32 PLUGIN_API release() override { return 1; }
+
+private:
+  int32 fCount{0};
+  ParamValueQueue fQueues[kMaxQueues]{};
+};
+
+//------------------------------------------------------------------------
+// generateAutomation - every parameter gets iPointsPerQueue points
+// spread over the block (the values change at every block)
+//------------------------------------------------------------------------
+void generateAutomation(ParameterChanges &oChanges, int32 iBlock, int32 iBlockSize, int32 iPointsPerQueue)
+{
+  oChanges.clear();
+  for(ParamID paramID: {EJSGainParamID::kBypass, EJSGainParamID::kLeftGain, EJSGainParamID::kRightGain, EJSGainParamID::kResetMax})
+  {
+    int32 index;
+    auto queue = oChanges.addParameterData(paramID, index);
+    for(int32 point = 0; point < iPointsPerQueue; point++)
+    {
+      ParamValue value;
+      switch(paramID)
+      {
+        case EJSGainParamID::kBypass:
+        case EJSGainParamID::kResetMax:
+          value = (iBlock + point) % 2 == 0 ? 0.0 : 1.0;
+          break;
+        default:
+          value = 0.2 + 0.6 * ((iBlock * iPointsPerQueue + point) % 97) / 97.0;
+          break;
+      }
+      queue->addPoint(point * iBlockSize / iPointsPerQueue, value, index);
+    }
+  }
+}
+}
+
+// StatsCodecTest - compares the legacy serializer (1 message per snapshot) with the batched codec
+TEST(StatsCodecTest, Benchmark)
+{
+  constexpr int kIterations = 10000;
+
+  auto batch = generateBatch(StatsBatch::kMaxStats);
+
+  // legacy: every snapshot is serialized on its own
+  StatsParamSerializer legacySerializer{};
+  int64 legacyBytes = 0;
+  auto start = steady_clock::now();
+  for(int i = 0; i < kIterations; i++)
+  {
+    for(int32 j = 0; j < batch.fCount; j++)
+    {
+      Steinberg::MemoryStream stream{};
+      IBStreamer streamer{&stream, kLittleEndian};
+      ASSERT_EQ(kResultOk, legacySerializer.writeToStream(batch.fStats[j], streamer));
+      stream.seek(0, IBStream::kIBSeekSet, nullptr);
+      Stats stats{};
+      ASSERT_EQ(kResultOk, legacySerializer.readFromStream(streamer, stats));
+      legacyBytes += stream.getSize();
+    }
+  }
+  auto legacyDuration = duration_cast<microseconds>(steady_clock::now() - start).count();
+
+  // codec: the whole batch in one buffer
+  StatsBatchParamSerializer batchSerializer{};
+  int64 batchBytes = 0;
+  start = steady_clock::now();
+  for(int i = 0; i < kIterations; i++)
+  {
+    Steinberg::MemoryStream stream{};
+    IBStreamer streamer{&stream, kLittleEndian};
+    ASSERT_EQ(kResultOk, batchSerializer.writeToStream(batch, streamer));
+    stream.seek(0, IBStream::kIBSeekSet, nullptr);
+    StatsBatch decoded{};
+    ASSERT_EQ(kResultOk, batchSerializer.readFromStream(streamer, decoded));
+    ASSERT_EQ(batch.fCount, decoded.fCount);
+    batchBytes += stream.getSize();
+  }
+  auto batchDuration = duration_cast<microseconds>(steady_clock::now() - start).count();
+
+  ASSERT_LT(batchBytes, legacyBytes);
+
+  LOG_F(INFO, "Stats - legacy: %lld bytes, %lld messages, %lldus | batched: %lld bytes, %d messages, %lldus",
+        static_cast<long long>(legacyBytes / kIterations), static_cast<long long>(batch.fCount),
+        static_cast<long long>(legacyDuration),
+        static_cast<long long>(batchBytes / kIterations), 1,
+        static_cast<long long>(batchDuration));
+}
+
+
+// ParameterChangesTest - "automation storm": every RT parameter gets several points in every block. Measures
+// the cost of the parameter path (on its own and on top of the DSP in JSGainProcessor).
+TEST(ParameterChangesTest, AutomationStormBenchmark)
+{
+  constexpr int32 kBlockSize = 32;
+  constexpr int32 kNumBlocks = 20000;
+  constexpr int32 kPointsPerQueue = 4;
+
+  // pre-generating the automation so that generating it is not measured
+  std::vector<ParameterChanges> automation(64);
+  for(int32 i = 0; i < static_cast<int32>(automation.size()); i++)
+    generateAutomation(automation[i], i, kBlockSize, kPointsPerQueue);
+
+  // 1. GainParamConverter::denormalize on its own (2 gains per block)
+  GainParamConverter converter{};
+  double sum = 0;
+  auto start = steady_clock::now();
+  for(int32 block = 0; block < kNumBlocks; block++)
+  {
+    sum += converter.denormalize(0.2 + 0.6 * (block % 97) / 97.0).getValueInSample();
+    sum += converter.denormalize(0.8 - 0.6 * (block % 89) / 89.0).getValueInSample();
+  }
+  auto denormalizeDuration = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+  ASSERT_GT(sum, 0);
+
+  // 2. applying the changes to the RT state (parameter path only)
+  JSGainParameters parameters{};
+  JSGainRTState state{parameters};
+  start = steady_clock::now();
+  for(int32 block = 0; block < kNumBlocks; block++)
+    state.applyParameterChanges(automation[block % automation.size()]);
+  auto applyDuration = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+
+  // the last point of each queue wins
+  auto &lastChanges = automation[(kNumBlocks - 1) % automation.size()];
+  ParamValue lastLeftGain{};
+  int32 sampleOffset{};
+  lastChanges.getParameterData(1)->getPoint(kPointsPerQueue - 1, sampleOffset, lastLeftGain);
+  ASSERT_EQ(converter.denormalize(lastLeftGain).getValueInSample(), state.fLeftGain->getValueInSample());
+
+  // 3. JSGainProcessor with and without automation
+  RT::JSGainProcessor processor{};
+  ASSERT_EQ(kResultOk, processor.initialize(nullptr));
+  ProcessSetup setup{kRealtime, kSample32, kBlockSize, 48000};
+  ASSERT_EQ(kResultOk, processor.setupProcessing(setup));
+  ASSERT_EQ(kResultOk, processor.setActive(true));
+
+  std::vector<Sample32> leftIn(kBlockSize, 0.25f), rightIn(kBlockSize, -0.25f), leftOut(kBlockSize), rightOut(kBlockSize);
+  Sample32 *inputs[] = {leftIn.data(), rightIn.data()};
+  Sample32 *outputs[] = {leftOut.data(), rightOut.data()};
+  AudioBusBuffers inputBus{};
+  inputBus.numChannels = 2;
+  inputBus.channelBuffers32 = inputs;
+  AudioBusBuffers outputBus{};
+  outputBus.numChannels = 2;
+  outputBus.channelBuffers32 = outputs;
+  ParameterChanges outputChanges{};
+
+  ProcessData data{};
+  data.processMode = kRealtime;
+  data.symbolicSampleSize = kSample32;
+  data.numSamples = kBlockSize;
+  data.numInputs = 1;
+  data.numOutputs = 1;
+  data.inputs = &inputBus;
+  data.outputs = &outputBus;
+  data.outputParameterChanges = &outputChanges;
+
+  auto process = [&](bool iAutomation) {
+    auto processStart = steady_clock::now();
+    for(int32 block = 0; block < kNumBlocks; block++)
+    {
+      data.inputParameterChanges = iAutomation ? &automation[block % automation.size()] : nullptr;
+      outputChanges.clear();
+      processor.process(data);
+    }
+    return duration_cast<nanoseconds>(steady_clock::now() - processStart).count();
+  };
+
+  auto dspDuration = process(false);
+  auto dspWithAutomationDuration = process(true);
+
+  // sanity check: the gain of the last block was applied in double (bypass is off in the last block)
+  ASSERT_FALSE(*state.fBypass);
+  ASSERT_EQ(static_cast<Sample32>(leftIn[0] * state.fLeftGain->getValueInSample()), leftOut[0]);
+
+  processor.setActive(false);
+  processor.terminate();
+
+  LOG_F(INFO, "Automation storm (%d params x %d points, block=%d) - per block: denormalize x2 %.1fns | apply %.1fns | "
+              "process %.1fns | process + automation %.1fns (overhead %.1fns)",
+        4, kPointsPerQueue, kBlockSize,
+        static_cast<double>(denormalizeDuration) / kNumBlocks,
+        static_cast<double>(applyDuration) / kNumBlocks,
+        static_cast<double>(dspDuration) / kNumBlocks,
+        static_cast<double>(dspWithAutomationDuration) / kNumBlocks,
+        static_cast<double>(dspWithAutomationDuration - dspDuration) / kNumBlocks);
+}
+
+// ProcessorTest - micro blocks (low latency tracking sessions): measures the cost of a frame (ns/block) for
+// several block sizes and, by comparison with the kernel alone (gain + analysis), the fixed (non audio) cost
+TEST(ProcessorTest, MicroBlockBenchmark)
+{
+  constexpr int32 kNumSamples = 16 * 40000;
+
+  RT::JSGainProcessor processor{};
+  ASSERT_EQ(kResultOk, processor.initialize(nullptr));
+
+  for(int32 blockSize: {16, 32, 64, 512})
+  {
+    auto numBlocks = kNumSamples / blockSize;
+
+    ProcessSetup setup{kRealtime, kSample32, blockSize, 48000};
+    ASSERT_EQ(kResultOk, processor.setupProcessing(setup));
+    ASSERT_EQ(kResultOk, processor.setActive(true));
+
+    std::vector<Sample32> leftIn(blockSize), rightIn(blockSize), leftOut(blockSize), rightOut(blockSize);
+    Sample32 *inputs[] = {leftIn.data(), rightIn.data()};
+    Sample32 *outputs[] = {leftOut.data(), rightOut.data()};
+    AudioBusBuffers inputBus{};
+    inputBus.numChannels = 2;
+    inputBus.channelBuffers32 = inputs;
+    AudioBusBuffers outputBus{};
+    outputBus.numChannels = 2;
+    outputBus.channelBuffers32 = outputs;
+    ParameterChanges outputChanges{};
+
+    ProcessData data{};
+    data.processMode = kRealtime;
+    data.symbolicSampleSize = kSample32;
+    data.numSamples = blockSize;
+    data.numInputs = 1;
+    data.numOutputs = 1;
+    data.inputs = &inputBus;
+    data.outputs = &outputBus;
+    data.outputParameterChanges = &outputChanges;
+
+    // the level changes at every block so that the VU meter always has a new value to publish
+    auto fillBlock = [&](int32 iBlock) {
+      auto level = 0.1f + 0.8f * static_cast<float>(iBlock % 101) / 101.0f;
+      for(int32 i = 0; i < blockSize; i++)
+      {
+        leftIn[i] = i % 2 == 0 ? level : -level;
+        rightIn[i] = -leftIn[i];
+      }
+    };
+
+    // 1. the processor (all the fixed costs included)
+    int32 vuPPMWrites = 0;
+    nanoseconds::rep processDuration = 0;
+    for(int32 block = 0; block < numBlocks; block++)
+    {
+      fillBlock(block);
+      outputChanges.clear();
+      auto start = steady_clock::now();
+      processor.process(data);
+      processDuration += duration_cast<nanoseconds>(steady_clock::now() - start).count();
+      for(int32 i = 0; i < outputChanges.getParameterCount(); i++)
+      {
+        if(outputChanges.getParameterData(i)->getParameterId() == EJSGainParamID::kVuPPM)
+          vuPPMWrites++;
+      }
+    }
+
+    // sanity check: the gain was applied (default gain is unity)
+    ASSERT_EQ(leftIn[0], leftOut[0]);
+    ASSERT_EQ(rightIn[blockSize - 1], rightOut[blockSize - 1]);
+
+    // the VU meter is published at most every 64 samples (every frame for bigger blocks)
+    ASSERT_GT(vuPPMWrites, 0);
+    ASSERT_LE(vuPPMWrites, std::max(numBlocks * blockSize / 64, numBlocks));
+    if(blockSize < 64)
+      ASSERT_LE(vuPPMWrites, numBlocks * blockSize / 64);
+
+    // 2. the kernel only (same work as the audio part of genericProcessInputs)
+    RT::Reducers::Analysis<RT::Reducers::Peak,
+                           RT::Reducers::Silence,
+                           RT::Reducers::RMS,
+                           RT::Reducers::DCOffset,
+                           RT::Reducers::ClipCount,
+                           RT::Reducers::Correlation,
+                           LevelHistogramAccumulator> analysis{};
+    nanoseconds::rep kernelDuration = 0;
+    for(int32 block = 0; block < numBlocks; block++)
+    {
+      fillBlock(block);
+      auto start = steady_clock::now();
+      analysis.reset<RT::Reducers::Peak>();
+      analysis.reset<RT::Reducers::Silence>();
+      analysis.processStereo(leftIn.data(), rightIn.data(), leftOut.data(), rightOut.data(), blockSize, 1.0f, 1.0f);
+      kernelDuration += duration_cast<nanoseconds>(steady_clock::now() - start).count();
+    }
+    ASSERT_GT(analysis.get<RT::Reducers::Peak>().getPeak(), 0);
+
+    processor.setActive(false);
+
+    LOG_F(INFO, "Micro blocks (block=%d) - per block: process %.1fns | kernel %.1fns | fixed cost %.1fns | "
+                "VU meter writes %d/%d blocks",
+          blockSize,
+          static_cast<double>(processDuration) / numBlocks,
+          static_cast<double>(kernelDuration) / numBlocks,
+          static_cast<double>(processDuration - kernelDuration) / numBlocks,
+          vuPPMWrites,
+          numBlocks);
+  }
+
+  processor.terminate();
+}
+
+// ProcessorTest - same process: once the GUI attached as a reader, the stats are written in the shared slot (and
+// no longer broadcast). Back to messages when it detaches.
+TEST(ProcessorTest, SharedStatsChannel)
+{
+  constexpr int32 kBlockSize = 64;
+  constexpr int32 kNumBlocks = 48000 / 10 / kBlockSize; // 100ms (2 flush intervals)
+
+  RT::JSGainProcessor processor{};
+  ASSERT_EQ(kResultOk, processor.initialize(nullptr));
+  ProcessSetup setup{kRealtime, kSample32, kBlockSize, 48000};
+  ASSERT_EQ(kResultOk, processor.setupProcessing(setup));
+  ASSERT_EQ(kResultOk, processor.setActive(true));
+
+  auto sharedInstance = JSGainInstanceRegistry::find(processor.getInstanceToken());
+  ASSERT_TRUE(sharedInstance != nullptr);
+
+  std::vector<Sample32> leftIn(kBlockSize), rightIn(kBlockSize), leftOut(kBlockSize), rightOut(kBlockSize);
+  Sample32 *inputs[] = {leftIn.data(), rightIn.data()};
+  Sample32 *outputs[] = {leftOut.data(), rightOut.data()};
+  AudioBusBuffers inputBus{};
+  inputBus.numChannels = 2;
+  inputBus.channelBuffers32 = inputs;
+  AudioBusBuffers outputBus{};
+  outputBus.numChannels = 2;
+  outputBus.channelBuffers32 = outputs;
+  ParameterChanges outputChanges{};
+
+  ProcessData data{};
+  data.processMode = kRealtime;
+  data.symbolicSampleSize = kSample32;
+  data.numSamples = kBlockSize;
+  data.numInputs = 1;
+  data.numOutputs = 1;
+  data.inputs = &inputBus;
+  data.outputs = &outputBus;
+  data.outputParameterChanges = &outputChanges;
+
+  // the level increases so that the max keeps on changing
+  int32 block = 0;
+  auto process = [&]() {
+    for(int32 i = 0; i < kNumBlocks; i++, block++)
+    {
+      auto level = std::min(0.01f * static_cast<float>(block + 1), 1.0f);
+      std::fill(leftIn.begin(), leftIn.end(), level);
+      std::fill(rightIn.begin(), rightIn.end(), -level);
+      outputChanges.clear();
+      processor.process(data);
+    }
+  };
+
+  // 1. no reader => messages only
+  process();
+  ASSERT_EQ(0u, sharedInstance->fStats.sequence());
+
+  // 2. reader => shared slot
+  sharedInstance->attachStatsReader();
+  process();
+  auto sequence = sharedInstance->fStats.sequence();
+  ASSERT_GT(sequence, 0u);
+  ASSERT_EQ(0u, sequence & 1);
+
+  StatsBatch batch{};
+  ASSERT_TRUE(sharedInstance->fStats.read(batch));
+  ASSERT_GT(batch.fCount, 0);
+  ASSERT_GT(batch.fSendTimeNanos, 0);
+  ASSERT_EQ(48000, batch.latest().fSampleRate);
+  ASSERT_GT(batch.latest().fMaxSinceReset, 0);
+
+  // 3. reader gone => back to messages
+  sharedInstance->detachStatsReader();
+  process();
+  ASSERT_EQ(sequence, sharedInstance->fStats.sequence());
+
+  processor.setActive(false);
+  processor.terminate();
+}
+
+// ProcessorTest - many instances processed by a pool of threads (like a host with several worker threads): each
+// thread owns kInstancesPerThread instances and processes them in turn. Reports the throughput (blocks/s) for
+// 1, 2, 4... threads (up to the number of cores) and the efficiency compared to 1 thread (1.0 = linear scaling).
+TEST(ProcessorTest, MultiInstanceScalingBenchmark)
+{
+  constexpr int32 kBlockSize = 128;
+  constexpr int32 kInstancesPerThread = 4;
+  constexpr int32 kNumBlocks = 1500; // per instance
+
+  struct Instance
+  {
+    RT::JSGainProcessor fProcessor{};
+    std::vector<Sample32> fLeftIn = std::vector<Sample32>(kBlockSize);
+    std::vector<Sample32> fRightIn = std::vector<Sample32>(kBlockSize);
+    std::vector<Sample32> fLeftOut = std::vector<Sample32>(kBlockSize);
+    std::vector<Sample32> fRightOut = std::vector<Sample32>(kBlockSize);
+    Sample32 *fInputs[2]{fLeftIn.data(), fRightIn.data()};
+    Sample32 *fOutputs[2]{fLeftOut.data(), fRightOut.data()};
+    AudioBusBuffers fInputBus{};
+    AudioBusBuffers fOutputBus{};
+    ParameterChanges fOutputChanges{};
+    ProcessData fData{};
+
+    Instance()
+    {
+      fInputBus.numChannels = 2;
+      fInputBus.channelBuffers32 = fInputs;
+      fOutputBus.numChannels = 2;
+      fOutputBus.channelBuffers32 = fOutputs;
+      fData.processMode = kRealtime;
+      fData.symbolicSampleSize = kSample32;
+      fData.numSamples = kBlockSize;
+      fData.numInputs = 1;
+      fData.numOutputs = 1;
+      fData.inputs = &fInputBus;
+      fData.outputs = &fOutputBus;
+      fData.outputParameterChanges = &fOutputChanges;
+    }
+
+    void process(int32 iBlock)
+    {
+      auto level = 0.1f + 0.8f * static_cast<float>(iBlock % 101) / 101.0f;
+      for(int32 i = 0; i < kBlockSize; i++)
+      {
+        fLeftIn[i] = i % 2 == 0 ? level : -level;
+        fRightIn[i] = -fLeftIn[i];
+      }
+      fOutputChanges.clear();
+      fProcessor.process(fData);
+    }
+  };
+
+  auto numCores = static_cast<int32>(std::max(1u, std::thread::hardware_concurrency()));
+  std::vector<int32> threadCounts{};
+  for(int32 numThreads = 1; numThreads < numCores; numThreads *= 2)
+    threadCounts.emplace_back(numThreads);
+  threadCounts.emplace_back(numCores);
+
+  double singleThreadBlocksPerSecond = 0;
+  for(auto numThreads: threadCounts)
+  {
+    // the instances are created (and activated) by this thread like a host would do
+    std::vector<std::unique_ptr<Instance>> instances{};
+    for(int32 i = 0; i < numThreads * kInstancesPerThread; i++)
+    {
+      auto instance = std::make_unique<Instance>();
+      ASSERT_EQ(kResultOk, instance->fProcessor.initialize(nullptr));
+      ProcessSetup setup{kRealtime, kSample32, kBlockSize, 48000};
+      ASSERT_EQ(kResultOk, instance->fProcessor.setupProcessing(setup));
+      ASSERT_EQ(kResultOk, instance->fProcessor.setActive(true));
+      instances.emplace_back(std::move(instance));
+    }
+
+    // all the threads start at the same time
+    std::atomic<int32> ready{0};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> threads{};
+    for(int32 t = 0; t < numThreads; t++)
+    {
+      threads.emplace_back([&, t]() {
+        ready.fetch_add(1);
+        while(!go.load())
+          std::this_thread::yield();
+        for(int32 block = 0; block < kNumBlocks; block++)
+        {
+          for(int32 i = 0; i < kInstancesPerThread; i++)
+            instances[t * kInstancesPerThread + i]->process(block);
+        }
+      });
+    }
+    while(ready.load() < numThreads)
+      std::this_thread::yield();
+
+    auto start = steady_clock::now();
+    go.store(true);
+    for(auto &thread: threads)
+      thread.join();
+    auto duration = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+
+    // sanity check: the gain was applied (default gain is unity) by every instance
+    for(auto &instance: instances)
+    {
+      ASSERT_EQ(instance->fLeftIn[0], instance->fLeftOut[0]);
+      ASSERT_EQ(instance->fRightIn[kBlockSize - 1], instance->fRightOut[kBlockSize - 1]);
+      instance->fProcessor.setActive(false);
+      instance->fProcessor.terminate();
+    }
+
+    auto numBlocks = static_cast<double>(numThreads) * kInstancesPerThread * kNumBlocks;
+    auto blocksPerSecond = numBlocks * 1e9 / static_cast<double>(duration);
+    if(numThreads == 1)
+      singleThreadBlocksPerSecond = blocksPerSecond;
+
+    LOG_F(INFO, "Multi instance scaling (block=%d) - %d thread(s) x %d instances: %.0f blocks/s | "
+                "%.1fx realtime per core | efficiency %.2f",
+          kBlockSize, numThreads, kInstancesPerThread,
+          blocksPerSecond,
+          blocksPerSecond * kBlockSize / 48000.0 / numThreads,
+          blocksPerSecond / (singleThreadBlocksPerSecond * numThreads));
+  }
+}
+
+// UIDescriptionCacheTest - repeated editor creation: checks what is shared between the editors (as long as one
+// controller holds the resources, the file is read and the resources description parsed once) and what is
+// not (every editor gets its own description, parsed from the content in memory). The bitmaps are not decoded
+// in the tests (no platform) so instead of comparing timings, this counts the reads of the file (the loader
+// stands in for the plugin resources) and the descriptions providing the resources. The time it takes to
+// create the description of an editor (the cost left per editor) is logged.
+TEST(UIDescriptionCacheTest, RepeatedEditorCreationBenchmark)
+{
+  constexpr int kNumEditors = 50;
+
+  // resource/JSGain.uidesc (relative to this file: test/cpp/...)
+  std::string path{__FILE__};
+  path = path.substr(0, path.rfind("test")) + "resource/JSGain.uidesc";
+  std::ifstream file{path, std::ios::binary};
+  ASSERT_TRUE(file.good()) << path;
+  std::string content{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+
+  int reads = 0;
+  auto loader = [&content, &reads](char const * /* iXmlFile */, std::string &oContent) {
+    reads++;
+    oContent = content;
+    return true;
+  };
+
+  constexpr char const *kXmlFile = "JSGain.uidesc (test)";
+
+  // 1. no controller holds the resources between 2 editors => read every time
+  for(int i = 0; i < kNumEditors; i++)
+  {
+    auto resources = GUI::UIDescriptionCache::acquireResources(kXmlFile, loader);
+    ASSERT_TRUE(resources != nullptr);
+    ASSERT_TRUE(resources->fDescription != nullptr);
+  }
+  ASSERT_EQ(kNumEditors, reads);
+
+  // 2. another controller holds them => read once, every editor gets its own description but they all share the
+  // same resources
+  reads = 0;
+  auto holder = GUI::UIDescriptionCache::acquireResources(kXmlFile, loader);
+  ASSERT_EQ(1, reads);
+  std::vector<VSTGUI::SharedPointer<VSTGUI::UIDescription>> descriptions{};
+  auto start = steady_clock::now();
+  for(int i = 0; i < kNumEditors; i++)
+  {
+    auto resources = GUI::UIDescriptionCache::acquireResources(kXmlFile, loader);
+    ASSERT_EQ(holder.get(), resources.get());
+    auto description = GUI::UIDescriptionCache::createDescription(resources);
+    ASSERT_TRUE(description != nullptr);
+    ASSERT_NE(holder->fDescription.get(), description.get());
+    ASSERT_EQ(holder->fDescription.get(), description->getSharedResources().get());
+    descriptions.emplace_back(description);
+  }
+  auto perEditorDuration = duration_cast<microseconds>(steady_clock::now() - start).count() / kNumEditors;
+  ASSERT_EQ(1, reads);
+  for(int i = 1; i < kNumEditors; i++)
+    ASSERT_NE(descriptions[i - 1].get(), descriptions[i].get());
+
+  // the resources are released with the last holder (the editor descriptions keep their own reference)
+  descriptions.clear();
+  holder.reset();
+  reads = 0;
+  GUI::UIDescriptionCache::acquireResources(kXmlFile, loader);
+  ASSERT_EQ(1, reads);
+
+  LOG_F(INFO, "UIDescription - %d editors: file read 1 time (instead of %d) | 1 resources description | "
+              "%lldus per editor description (parsed from memory)",
+        kNumEditors,
+        kNumEditors,
+        static_cast<long long>(perEditorDuration));
+}
+
+// MessagingTest - floods both directions at the same time (no pacing) to measure how many messages per second
+// the path can carry and the latency under load. The host messaging (IConnectionPoint) is not available in
+// tests so it is replaced by a queue of serialized messages: everything else is the production code path
+// (stamping, serializers, the UICommand queue of the processor and the latency histograms).
+TEST(MessagingTest, FloodBothDirections)
+{
+  constexpr int32 kNumCommandBatches = 20000;
+  constexpr int32 kCommandsPerBatch = 4;
+  constexpr int32 kSnapshotsPerBatch = 4;
+
+  // a serialized message "in flight" (the host copies it, the queue does too)
+  struct Message
+  {
+    int32 fSize{0};
+    uint8 fData[StatsCodec::kMaxBatchSize + 16]{};
+  };
+
+  Concurrent::SPSCQueue<UICommand, 64> commandQueue{};  // GUI -> RT (see JSGainProcessor::notify)
+  Concurrent::SPSCQueue<Message, 64> statsQueue{};      // RT -> GUI (stands for the host)
+  std::atomic<bool> guiDone{false};
+  std::atomic<bool> rtDone{false};
+
+  // RT side
+  LatencyHistogram commandLatency{};
+  int64 receivedCommands = 0;
+  int64 sentStatsBatches = 0;
+  int64 droppedStatsBatches = 0;
+  int64 blocks = 0;
+
+  std::thread rt{[&]() {
+    StatsBatchParamSerializer serializer{};
+    StatsBatch batch{};
+    while(!guiDone.load(std::memory_order_acquire) || !commandQueue.empty())
+    {
+      int64 now = 0;
+      commandQueue.drain([&](UICommand const &iCommand) {
+        if(now == 0)
+          now = getMonotonicTimeNanos();
+        commandLatency.recordSince(iCommand.fSendTimeNanos, now);
+        receivedCommands++;
+      });
+
+      Stats stats{};
+      stats.fSampleTime = ++blocks * 64;
+      stats.fMaxSinceReset = 0.5;
+      batch.add(stats);
+      if(batch.fCount == kSnapshotsPerBatch)
+      {
+        batch.fSendTimeNanos = getMonotonicTimeNanos();
+        Steinberg::MemoryStream stream{};
+        IBStreamer streamer{&stream, kLittleEndian};
+        EXPECT_EQ(kResultOk, serializer.writeToStream(batch, streamer));
+        Message message{};
+        message.fSize = static_cast<int32>(stream.getSize());
+        std::copy(stream.getData(), stream.getData() + message.fSize, message.fData);
+        if(statsQueue.push(message))
+          sentStatsBatches++;
+        else
+          droppedStatsBatches++;
+        batch.clear();
+      }
+    }
+    rtDone.store(true, std::memory_order_release);
+  }};
+
+  // GUI side (this thread)
+  MessagingStats statsMessaging{};
+  int64 droppedCommands = 0;
+  UICommandSerializer commandSerializer{};
+  StatsBatchParamSerializer statsSerializer{};
+
+  auto receiveStats = [&]() {
+    Message message{};
+    while(statsQueue.pop(message))
+    {
+      Steinberg::MemoryStream stream{message.fData, message.fSize};
+      IBStreamer streamer{&stream, kLittleEndian};
+      StatsBatch batch{};
+      ASSERT_EQ(kResultOk, statsSerializer.readFromStream(streamer, batch));
+      statsMessaging.onReceive(batch.fSendTimeNanos, batch.fCount, getMonotonicTimeNanos());
+    }
+  };
+
+  auto start = steady_clock::now();
+  for(int32 i = 0; i < kNumCommandBatches; i++)
+  {
+    // what JSGainController::sendUICommands does...
+    Steinberg::MemoryStream stream{};
+    IBStreamer streamer{&stream, kLittleEndian};
+    auto sendTimeNanos = getMonotonicTimeNanos();
+    for(int32 j = 0; j < kCommandsPerBatch; j++)
+    {
+      UICommand command{};
+      command.fSendTimeNanos = sendTimeNanos;
+      commandSerializer.writeToStream(command, streamer);
+    }
+
+    // ... and JSGainProcessor::notify
+    stream.seek(0, IBStream::kIBSeekSet, nullptr);
+    for(int32 j = 0; j < kCommandsPerBatch; j++)
+    {
+      UICommand command{};
+      ASSERT_EQ(kResultOk, commandSerializer.readFromStream(streamer, command));
+      ASSERT_EQ(sendTimeNanos, command.fSendTimeNanos);
+      if(!commandQueue.push(command))
+        droppedCommands++;
+    }
+
+    receiveStats();
+  }
+  guiDone.store(true, std::memory_order_release);
+
+  while(!rtDone.load(std::memory_order_acquire))
+    receiveStats();
+  rt.join();
+  receiveStats();
+
+  auto duration = duration_cast<microseconds>(steady_clock::now() - start).count();
+
+  // nothing is lost without being accounted for
+  ASSERT_EQ(kNumCommandBatches * kCommandsPerBatch, receivedCommands + droppedCommands);
+  ASSERT_EQ(receivedCommands, commandLatency.fCount);
+  ASSERT_EQ(sentStatsBatches, statsMessaging.fMessageCount);
+  ASSERT_EQ(sentStatsBatches * kSnapshotsPerBatch, statsMessaging.fItemCount);
+  ASSERT_EQ(statsMessaging.fMessageCount, statsMessaging.fReceiveLatency.fCount);
+
+  auto perSecond = [duration](int64 iCount) { return duration > 0 ? static_cast<double>(iCount) * 1e6 / duration : 0; };
+
+  LOG_F(INFO, "Flood (%lldus) - gui -> rt: %lld commands (%.0f/s, %lld dropped) latency p50<=%lldus p99<=%lldus "
+              "max=%lldus | rt -> gui: %lld batches (%.0f/s, %lld dropped) latency p50<=%lldus p99<=%lldus max=%lldus",
+        static_cast<long long>(duration),
+        static_cast<long long>(receivedCommands),
+        perSecond(receivedCommands),
+        static_cast<long long>(droppedCommands),
+        static_cast<long long>(commandLatency.getPercentileNanos(0.5) / 1000),
+        static_cast<long long>(commandLatency.getPercentileNanos(0.99) / 1000),
+        static_cast<long long>(commandLatency.fMaxNanos / 1000),
+        static_cast<long long>(sentStatsBatches),
+        perSecond(sentStatsBatches),
+        static_cast<long long>(droppedStatsBatches),
+        static_cast<long long>(statsMessaging.fReceiveLatency.getPercentileNanos(0.5) / 1000),
+        static_cast<long long>(statsMessaging.fReceiveLatency.getPercentileNanos(0.99) / 1000),
+        static_cast<long long>(statsMessaging.fReceiveLatency.fMaxNanos / 1000));
+}
+
+}
+}
+}
+}
@@ -0,0 +1,156 @@
+//------------------------------------------------------------------------------------------------------------
+// Tests for the audio capture (see Capture/AudioCapture.h)
+//------------------------------------------------------------------------------------------------------------
+#include <pongasoft/logging/logging.h>
+#include <gtest/gtest.h>
+
+#include "src/cpp/Capture/AudioCapture.h"
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+namespace pongasoft {
+namespace VST {
+namespace JSGain {
+namespace Test {
+
+using namespace Capture;
+
+namespace {
+
+uint32_t readU32(uint8_t const *iBytes)
+{
+  return iBytes[0] | (iBytes[1] << 8) | (iBytes[2] << 16) | (static_cast<uint32_t>(iBytes[3]) << 24);
+}
+
+uint64_t readU64(uint8_t const *iBytes)
+{
+  return readU32(iBytes) | (static_cast<uint64_t>(readU32(iBytes + 4)) << 32);
+}
+
+std::string readTag(uint8_t const *iBytes)
+{
+  return std::string(reinterpret_cast<char const *>(iBytes), 4);
+}
+
+}
+
+// AudioCaptureTest - WAV header and switch to RF64 above 4GB
+TEST(AudioCaptureTest, WavHeader)
+{
+  uint8_t header[kHeaderSize];
+
+  makeWavHeader(header, 48000, 1000);
+  ASSERT_EQ("RIFF", readTag(header));
+  ASSERT_EQ(kHeaderSize - 8 + 1000 * kFrameSize, readU32(header + 4));
+  ASSERT_EQ("WAVE", readTag(header + 8));
+  ASSERT_EQ("JUNK", readTag(header + 12));
+  ASSERT_EQ(28, readU32(header + 16));
+  ASSERT_EQ("fmt ", readTag(header + 48));
+  ASSERT_EQ(18, readU32(header + 52));
+  ASSERT_EQ(0x00020003, readU32(header + 56)); // IEEE float / 2 channels
+  ASSERT_EQ(48000, readU32(header + 60));
+  ASSERT_EQ(48000 * 8, readU32(header + 64));
+  ASSERT_EQ(0x00200008, readU32(header + 68)); // block align 8 / 32 bits
+  ASSERT_EQ("JUNK", readTag(header + 74));
+  ASSERT_EQ(kHeaderSize - 8 - 82, readU32(header + 78)); // padding up to the data chunk
+  ASSERT_EQ("data", readTag(header + kHeaderSize - 8));
+  ASSERT_EQ(1000 * kFrameSize, readU32(header + kHeaderSize - 4));
+
+  // 8GB of data
+  uint64_t numFrames = 1ULL << 30;
+  makeWavHeader(header, 96000, numFrames);
+  ASSERT_EQ("RF64", readTag(header));
+  ASSERT_EQ(0xFFFFFFFFu, readU32(header + 4));
+  ASSERT_EQ("ds64", readTag(header + 12));
+  ASSERT_EQ(kHeaderSize - 8 + numFrames * kFrameSize, readU64(header + 20));
+  ASSERT_EQ(numFrames * kFrameSize, readU64(header + 28));
+  ASSERT_EQ(numFrames, readU64(header + 36));
+  ASSERT_EQ(96000, readU32(header + 60));
+  ASSERT_EQ(0xFFFFFFFFu, readU32(header + kHeaderSize - 4));
+}
+
+// AudioCaptureTest - the blocks written by the "RT" end up in the file (interleaved)
+TEST(AudioCaptureTest, WriteFile)
+{
+  auto path = testing::TempDir() + "jsgain-capture-test.wav";
+
+  constexpr int32 kNumSamples = 1000;
+  constexpr int kNumBlocks = 20;
+
+  {
+    auto writer = CaptureWriter::create(path, 44100);
+    ASSERT_TRUE(writer);
+
+    std::vector<double> left(kNumSamples);
+    std::vector<double> right(kNumSamples);
+    for(int block = 0; block < kNumBlocks; block++)
+    {
+      for(int32 i = 0; i < kNumSamples; i++)
+      {
+        left[i] = (block * kNumSamples + i) / 65536.0;
+        right[i] = -left[i];
+      }
+      // odd blocks are mono (left duplicated)
+      ASSERT_TRUE(writer->write(left.data(), block % 2 == 0 ? right.data() : nullptr, kNumSamples));
+    }
+
+    writer->endOfStream();
+    for(int i = 0; i < 500 && !writer->isFinished(); i++)
+      std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    ASSERT_TRUE(writer->isFinished());
+    ASSERT_EQ(kNumBlocks * kNumSamples, writer->getNumFramesWritten());
+    ASSERT_EQ(0, writer->getDroppedBlocksCount());
+  }
+
+  std::ifstream file{path, std::ios::binary};
+  std::vector<uint8_t> bytes{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+  ASSERT_EQ(kHeaderSize + kNumBlocks * kNumSamples * kFrameSize, bytes.size());
+
+  uint8_t header[kHeaderSize];
+  makeWavHeader(header, 44100, kNumBlocks * kNumSamples);
+  ASSERT_EQ(0, std::memcmp(header, bytes.data(), kHeaderSize));
+
+  auto samples = reinterpret_cast<float const *>(bytes.data() + kHeaderSize);
+  for(int block = 0; block < kNumBlocks; block++)
+  {
+    for(int32 i = 0; i < kNumSamples; i++)
+    {
+      auto frame = block * kNumSamples + i;
+      auto expected = static_cast<float>(frame / 65536.0);
+      ASSERT_EQ(expected, samples[frame * 2]);
+      ASSERT_EQ(block % 2 == 0 ? -expected : expected, samples[frame * 2 + 1]);
+    }
+  }
+
+  std::remove(path.c_str());
+}
+
+// AudioCaptureTest - a block which does not fit is dropped (never waits)
+TEST(AudioCaptureTest, DroppedBlocks)
+{
+  auto path = testing::TempDir() + "jsgain-capture-dropped-test.wav";
+
+  {
+    auto writer = CaptureWriter::create(path, 48000);
+    ASSERT_TRUE(writer);
+
+    std::vector<float> samples(CaptureWriter::kRingFrames + 1);
+    ASSERT_FALSE(writer->write(samples.data(), samples.data(), static_cast<int32>(samples.size())));
+    ASSERT_EQ(1, writer->getDroppedBlocksCount());
+    ASSERT_TRUE(writer->write(samples.data(), samples.data(), 512));
+  } // the destructor writes what is left
+
+  std::ifstream file{path, std::ios::binary | std::ios::ate};
+  ASSERT_EQ(kHeaderSize + 512 * kFrameSize, static_cast<size_t>(file.tellg()));
+
+  std::remove(path.c_str());
+}
+
+}
+}
+}
+}
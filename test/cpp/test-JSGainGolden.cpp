@@ -0,0 +1,489 @@
+//------------------------------------------------------------------------------------------------------------
+// This file contains the "golden output" regression tests: a corpus of deterministic signals (noise, sweep,
+// denormal tail, full scale square) is processed with various gain/bypass/automation scenarios by the
+// reference implementation (the original scalar processChannel) and by every kernel variant (see
+// RT/Reducers.h). The output must be bit exact:
+// - the hash of the reference output must match the stored (golden) hash, which guarantees that the corpus
+//   and the reference do not drift
+// - the hash of each kernel variant must match the reference hash
+//
+// The signals are generated with integer arithmetic only (no libm, no floating point expression which the
+// compiler could contract into an FMA) so that they are identical on every platform and compiler.
+//
+// Tolerances (only where the kernel is allowed to reorder floating point operations):
+// - output samples, peak, peak frame, silence flags, clip count: bit exact (no tolerance)
+// - RMS (sum of positive terms accumulated in kNumLanes lanes): at most kNumFrames ULPs, which is the worst
+//   case bound of reordering the sum of kNumFrames positive terms
+// - DC offset / correlation (sums of signed terms): absolute error at most kNumFrames * epsilon * sum(|terms|)
+//   (normalized like the metric), the worst case bound of reordering a sum
+//------------------------------------------------------------------------------------------------------------
+#include <pongasoft/logging/logging.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "src/cpp/RT/Reducers.h"
+
+namespace pongasoft {
+namespace VST {
+namespace JSGain {
+namespace Test {
+
+using namespace RT::Reducers;
+
+namespace {
+
+// not a multiple of kNumLanes nor of the block sizes => exercises the remainder loops
+constexpr int32 kNumFrames = 4099;
+
+constexpr double kEpsilon = std::numeric_limits<double>::epsilon();
+
+//------------------------------------------------------------------------
+// Signal - a stereo test signal
+//------------------------------------------------------------------------
+struct Signal
+{
+  std::string fName;
+  std::vector<double> fLeft;
+  std::vector<double> fRight;
+};
+
+// 32 bits LCG (Numerical Recipes) => [-1, 1) with 31 bits of precision (exact in double)
+class Noise
+{
+public:
+  explicit Noise(uint32 iSeed) : fState{iSeed} {}
+  double next()
+  {
+    fState = fState * 1664525u + 1013904223u;
+    return std::ldexp(static_cast<double>(static_cast<int32>(fState)), -31);
+  }
+private:
+  uint32 fState;
+};
+
+// parabolic approximation of sin for an integer phase (full cycle = 2^32) => [-1, 1] computed in integers
+double parabolicSine(uint32 iPhase)
+{
+  auto x = static_cast<int64>(static_cast<int32>(iPhase)) >> 16; // [-2^15, 2^15)
+  auto absX = x < 0 ? -x : x;
+  auto y = 4 * x * ((int64{1} << 15) - absX);                   // [-2^32, 2^32]
+  return std::ldexp(static_cast<double>(-y), -32);
+}
+
+std::vector<Signal> generateCorpus()
+{
+  std::vector<Signal> corpus{};
+
+  // white noise (uncorrelated channels)
+  {
+    Signal signal{"noise"};
+    Noise left{1}, right{2};
+    for(int32 i = 0; i < kNumFrames; i++)
+    {
+      signal.fLeft.emplace_back(left.next());
+      signal.fRight.emplace_back(right.next());
+    }
+    corpus.emplace_back(std::move(signal));
+  }
+
+  // exponential sweep (chirp) using an integer phase accumulator (right channel out of phase)
+  {
+    Signal signal{"sweep"};
+    uint32 phase = 0;
+    uint32 increment = 1u << 20;
+    for(int32 i = 0; i < kNumFrames; i++)
+    {
+      auto sample = parabolicSine(phase);
+      signal.fLeft.emplace_back(sample);
+      signal.fRight.emplace_back(-sample);
+      phase += increment;
+      increment += increment >> 10;
+    }
+    corpus.emplace_back(std::move(signal));
+  }
+
+  // noise decaying 1 bit every 2 frames: goes through the denormal range (float and double) down to 0
+  {
+    Signal signal{"denormal-tail"};
+    Noise left{3}, right{4};
+    for(int32 i = 0; i < kNumFrames; i++)
+    {
+      signal.fLeft.emplace_back(std::ldexp(left.next(), -i / 2));
+      signal.fRight.emplace_back(std::ldexp(right.next(), -i / 2));
+    }
+    corpus.emplace_back(std::move(signal));
+  }
+
+  // full scale square (+1/-1), period 64 frames
+  {
+    Signal signal{"square"};
+    for(int32 i = 0; i < kNumFrames; i++)
+    {
+      auto sample = (i / 32) % 2 == 0 ? 1.0 : -1.0;
+      signal.fLeft.emplace_back(sample);
+      signal.fRight.emplace_back(-sample);
+    }
+    corpus.emplace_back(std::move(signal));
+  }
+
+  return corpus;
+}
+
+//------------------------------------------------------------------------
+// Scenario - gains applied to each block (cycling through fGains)
+//------------------------------------------------------------------------
+struct Scenario
+{
+  std::string fName;
+  int32 fBlockSize;
+  std::vector<std::pair<double, double>> fGains; // (left, right) for each block
+};
+
+std::vector<Scenario> generateScenarios()
+{
+  return {
+    {"bypass", 64, {{1.0, 1.0}}},
+    {"gain", 64, {{0.5, 1.4142135623730951}}},
+    {"automation", 61, {{0.25, 1.0}, {1.0, 2.0}, {2.0, 0.001}, {0.001, 1.189207115002721}, {1.189207115002721, 0.25}}},
+  };
+}
+
+//------------------------------------------------------------------------
+// Result - everything computed for a (signal, scenario)
+//------------------------------------------------------------------------
+struct Result
+{
+  uint64 fHash{0};        // output samples, peak, peak frame and silence flags of every block
+  int64 fClipCount{0};
+  double fRMS{0};
+  double fDCOffset{0};
+  double fDCOffsetTolerance{0};
+  double fCorrelation{0};
+  double fCorrelationTolerance{0};
+};
+
+// FNV-1a (64 bits)
+class Hash
+{
+public:
+  template<typename T>
+  void add(T const &iValue)
+  {
+    unsigned char bytes[sizeof(T)];
+    std::memcpy(bytes, &iValue, sizeof(T));
+    for(auto byte: bytes)
+    {
+      fHash ^= byte;
+      fHash *= 0x100000001b3ULL;
+    }
+  }
+  uint64 get() const { return fHash; }
+private:
+  uint64 fHash{0xcbf29ce484222325ULL};
+};
+
+//------------------------------------------------------------------------
+// referenceProcessChannel - the original (scalar) implementation of
+// JSGainProcessor::processChannel: the gain is the double returned by
+// Gain::getValueInSample so the multiplication is done in double
+//------------------------------------------------------------------------
+template<typename SampleType>
+SampleType referenceProcessChannel(SampleType const *iIn, SampleType *oOut, int32 iNumSamples, double iGain,
+                                   int32 &oPeakFrame, bool &oSilent)
+{
+  SampleType max = 0;
+  oSilent = true;
+  oPeakFrame = 0;
+
+  for(int i = 0; i < iNumSamples; ++i)
+  {
+    SampleType sample = iIn[i];
+
+    if(iGain != 1.0)
+      sample *= iGain;
+
+    if(oSilent && !pongasoft::VST::isSilent(sample))
+      oSilent = false;
+
+    oOut[i] = sample;
+
+    if(sample < 0)
+      sample = -sample;
+
+    if(sample > max)
+    {
+      max = sample;
+      oPeakFrame = i;
+    }
+  }
+
+  return max;
+}
+
+template<typename SampleType>
+void hashBlock(Hash &ioHash, SampleType const *iLeft, SampleType const *iRight, int32 iNumFrames,
+               double iPeak, int32 iPeakFrame, bool iLeftSilent, bool iRightSilent)
+{
+  for(int32 i = 0; i < iNumFrames; i++)
+  {
+    ioHash.add(iLeft[i]);
+    if(iRight)
+      ioHash.add(iRight[i]);
+  }
+  ioHash.add(iPeak);
+  ioHash.add(iPeakFrame);
+  ioHash.add(static_cast<uint8>(iLeftSilent));
+  ioHash.add(static_cast<uint8>(iRightSilent));
+}
+
+template<typename SampleType>
+std::vector<SampleType> toSamples(std::vector<double> const &iSignal)
+{
+  return std::vector<SampleType>(iSignal.begin(), iSignal.end());
+}
+
+//------------------------------------------------------------------------
+// runReference - processes the signal with the reference implementation
+// (iStereo = false => left channel only)
+//------------------------------------------------------------------------
+template<typename SampleType>
+Result runReference(Signal const &iSignal, Scenario const &iScenario, bool iStereo)
+{
+  auto leftIn = toSamples<SampleType>(iSignal.fLeft);
+  auto rightIn = toSamples<SampleType>(iSignal.fRight);
+  std::vector<SampleType> leftOut(kNumFrames), rightOut(kNumFrames);
+
+  Hash hash{};
+  int32 block = 0;
+  for(int32 offset = 0; offset < kNumFrames; offset += iScenario.fBlockSize, block++)
+  {
+    auto numFrames = std::min(iScenario.fBlockSize, kNumFrames - offset);
+    auto const &gains = iScenario.fGains[block % iScenario.fGains.size()];
+
+    int32 leftPeakFrame, rightPeakFrame = 0;
+    bool leftSilent, rightSilent = true;
+    auto leftPeak = referenceProcessChannel<SampleType>(&leftIn[offset], &leftOut[offset], numFrames,
+                                                        gains.first, leftPeakFrame, leftSilent);
+    SampleType rightPeak = 0;
+    if(iStereo)
+      rightPeak = referenceProcessChannel<SampleType>(&rightIn[offset], &rightOut[offset], numFrames,
+                                                      gains.second, rightPeakFrame, rightSilent);
+
+    // the peak frame is the first frame where the max of both channels is reached
+    auto peak = std::max(leftPeak, rightPeak);
+    auto peakFrame = leftPeak == rightPeak ? std::min(leftPeakFrame, rightPeakFrame) :
+                     (leftPeak > rightPeak ? leftPeakFrame : rightPeakFrame);
+
+    hashBlock(hash, &leftOut[offset], iStereo ? &rightOut[offset] : nullptr, numFrames,
+              static_cast<double>(peak), peakFrame, leftSilent, iStereo ? rightSilent : leftSilent);
+  }
+
+  // metrics (sequential sums in double)
+  Result result{};
+  result.fHash = hash.get();
+  double sumSquares = 0, sum = 0, sumAbs = 0, leftRight = 0, leftRightAbs = 0, leftLeft = 0, rightRight = 0;
+  for(int32 i = 0; i < kNumFrames; i++)
+  {
+    double l = leftOut[i];
+    double r = iStereo ? rightOut[i] : leftOut[i];
+    sumSquares += l * l + r * r;
+    sum += l + r;
+    sumAbs += std::abs(l) + std::abs(r);
+    leftRight += l * r;
+    leftLeft += l * l;
+    rightRight += r * r;
+    leftRightAbs += std::abs(l * r);
+    if(std::abs(l) >= 1 || std::abs(r) >= 1)
+      result.fClipCount++;
+  }
+  result.fRMS = std::sqrt(sumSquares / (2.0 * kNumFrames));
+  result.fDCOffset = sum / (2.0 * kNumFrames);
+  result.fDCOffsetTolerance = kNumFrames * kEpsilon * sumAbs / (2.0 * kNumFrames);
+  auto energy = std::sqrt(leftLeft * rightRight);
+  result.fCorrelation = energy > 0 ? leftRight / energy : 0;
+  // numerator: reordered sum of signed terms / denominator: reordered sums of positive terms
+  result.fCorrelationTolerance = energy > 0 ? 2 * kNumFrames * kEpsilon * (leftRightAbs / energy + 1) : 0;
+  return result;
+}
+
+//------------------------------------------------------------------------
+// runKernel - processes the signal with the fused kernel (Reducers.h)
+//------------------------------------------------------------------------
+template<typename SampleType, typename Analysis>
+Result runKernel(Signal const &iSignal, Scenario const &iScenario, bool iStereo)
+{
+  auto leftIn = toSamples<SampleType>(iSignal.fLeft);
+  auto rightIn = toSamples<SampleType>(iSignal.fRight);
+  std::vector<SampleType> leftOut(kNumFrames), rightOut(kNumFrames);
+
+  Analysis analysis{};
+
+  Hash hash{};
+  int32 block = 0;
+  for(int32 offset = 0; offset < kNumFrames; offset += iScenario.fBlockSize, block++)
+  {
+    auto numFrames = std::min(iScenario.fBlockSize, kNumFrames - offset);
+    auto const &gains = iScenario.fGains[block % iScenario.fGains.size()];
+
+    // same as JSGainProcessor: peak and silence are per block
+    analysis.template reset<Peak>();
+    analysis.template reset<Silence>();
+
+    if(iStereo)
+      analysis.processStereo(&leftIn[offset], &rightIn[offset], &leftOut[offset], &rightOut[offset], numFrames,
+                             gains.first, gains.second);
+    else
+      analysis.processMono(&leftIn[offset], &leftOut[offset], numFrames, gains.first);
+
+    auto const &peak = analysis.template get<Peak>();
+    auto const &silence = analysis.template get<Silence>();
+    hashBlock(hash, &leftOut[offset], iStereo ? &rightOut[offset] : nullptr, numFrames,
+              peak.getPeak(), peak.getPeakFrame(), silence.isLeftSilent(),
+              iStereo ? silence.isRightSilent() : silence.isLeftSilent());
+  }
+
+  Result result{};
+  result.fHash = hash.get();
+  if constexpr(Analysis::template has<RMS>())
+    result.fRMS = analysis.template get<RMS>().getRMS();
+  if constexpr(Analysis::template has<DCOffset>())
+    result.fDCOffset = analysis.template get<DCOffset>().getDCOffset();
+  if constexpr(Analysis::template has<ClipCount>())
+    result.fClipCount = analysis.template get<ClipCount>().getClipCount();
+  if constexpr(Analysis::template has<Correlation>())
+    result.fCorrelation = analysis.template get<Correlation>().getCorrelation();
+  return result;
+}
+
+// number of representable doubles between a and b
+int64 ulpDistance(double a, double b)
+{
+  int64 ia, ib;
+  std::memcpy(&ia, &a, sizeof(a));
+  std::memcpy(&ib, &b, sizeof(b));
+  if(ia < 0) ia = std::numeric_limits<int64>::min() - ia;
+  if(ib < 0) ib = std::numeric_limits<int64>::min() - ib;
+  return ia > ib ? ia - ib : ib - ia;
+}
+
+//------------------------------------------------------------------------
+// The golden hashes of the reference output: "signal/scenario/type/channels"
+// If the corpus or the reference is changed on purpose, they must be
+// regenerated (the test logs the actual value when it does not match).
+//------------------------------------------------------------------------
+const std::map<std::string, uint64> kGoldenHashes = {
+  {"noise/bypass/float/stereo", 0x75f3ae0076d5fb8cULL},
+  {"noise/bypass/float/mono", 0x546bdb7998269febULL},
+  {"noise/gain/float/stereo", 0x65884976cd97a9f1ULL},
+  {"noise/gain/float/mono", 0x9ea09cd8f9238ea3ULL},
+  {"noise/automation/float/stereo", 0x7102c131db3c9767ULL},
+  {"noise/automation/float/mono", 0x47dd0cee1cc438c2ULL},
+  {"sweep/bypass/float/stereo", 0xa311e1cbeb57c3fcULL},
+  {"sweep/bypass/float/mono", 0xb618561b2aee9b18ULL},
+  {"sweep/gain/float/stereo", 0x2ef9eb1169fca84eULL},
+  {"sweep/gain/float/mono", 0x7538ec4839006843ULL},
+  {"sweep/automation/float/stereo", 0x1bb2bb99b65a8eeaULL},
+  {"sweep/automation/float/mono", 0x24ca4357390c56bdULL},
+  {"denormal-tail/bypass/float/stereo", 0xe858fee81bcda0eeULL},
+  {"denormal-tail/bypass/float/mono", 0x2d85ab9320c3c021ULL},
+  {"denormal-tail/gain/float/stereo", 0x093e3ba112d61ca0ULL},
+  {"denormal-tail/gain/float/mono", 0x492b052037022001ULL},
+  {"denormal-tail/automation/float/stereo", 0xc6b6109fa6f7d7c8ULL},
+  {"denormal-tail/automation/float/mono", 0xdcd6c7b7d2987124ULL},
+  {"square/bypass/float/stereo", 0x46172ead9a0db268ULL},
+  {"square/bypass/float/mono", 0xfe19e59c6939d76dULL},
+  {"square/gain/float/stereo", 0x55aa85bc18bf4bc2ULL},
+  {"square/gain/float/mono", 0x10fa51e6464bc17dULL},
+  {"square/automation/float/stereo", 0x47c75b0a3cb02033ULL},
+  {"square/automation/float/mono", 0xf27b4fffb06e5b61ULL},
+  {"noise/bypass/double/stereo", 0x2d24c1a9a05e75d7ULL},
+  {"noise/bypass/double/mono", 0x5006b4c9f8ee2400ULL},
+  {"noise/gain/double/stereo", 0x5d0a114d3ac49d84ULL},
+  {"noise/gain/double/mono", 0xd5234f3703bdd46bULL},
+  {"noise/automation/double/stereo", 0x05ee8326a51a8c66ULL},
+  {"noise/automation/double/mono", 0x70585ff7e605adafULL},
+  {"sweep/bypass/double/stereo", 0x365f6cc5129adceeULL},
+  {"sweep/bypass/double/mono", 0xac0a2329cbbe341dULL},
+  {"sweep/gain/double/stereo", 0xc617bf7cf483f1f2ULL},
+  {"sweep/gain/double/mono", 0x593719df1ce9942eULL},
+  {"sweep/automation/double/stereo", 0xbbb79c03c50c62fbULL},
+  {"sweep/automation/double/mono", 0x5cfebb51710cc42aULL},
+  {"denormal-tail/bypass/double/stereo", 0xdc3b5e810e919effULL},
+  {"denormal-tail/bypass/double/mono", 0xc1bf1c2975a7718aULL},
+  {"denormal-tail/gain/double/stereo", 0x04d6c6b9c1f3f924ULL},
+  {"denormal-tail/gain/double/mono", 0xf9c0b7d03fac9bd5ULL},
+  {"denormal-tail/automation/double/stereo", 0x894f88d891b1b16eULL},
+  {"denormal-tail/automation/double/mono", 0xe78796c43bdf09d5ULL},
+  {"square/bypass/double/stereo", 0xb4b1cd3acca971d8ULL},
+  {"square/bypass/double/mono", 0x1030ac9060bbe17dULL},
+  {"square/gain/double/stereo", 0x9194e087a6f6b574ULL},
+  {"square/gain/double/mono", 0x0b04388b773d5e7dULL},
+  {"square/automation/double/stereo", 0xa6d6ffb3c0e31a38ULL},
+  {"square/automation/double/mono", 0x1bd215cc01f1b8bdULL}
+};
+
+template<typename SampleType>
+constexpr char const *typeName() { return std::is_same_v<SampleType, Sample32> ? "float" : "double"; }
+
+template<typename SampleType>
+void checkCorpus()
+{
+  using PeakSilence = Analysis<Peak, Silence>;
+  using Full = Analysis<Peak, Silence, RMS, DCOffset, ClipCount, Correlation>;
+
+  for(auto const &signal: generateCorpus())
+  {
+    for(auto const &scenario: generateScenarios())
+    {
+      for(bool stereo: {true, false})
+      {
+        auto key = signal.fName + "/" + scenario.fName + "/" + typeName<SampleType>() + "/" + (stereo ? "stereo" : "mono");
+
+        auto reference = runReference<SampleType>(signal, scenario, stereo);
+
+        // golden
+        auto golden = kGoldenHashes.find(key);
+        ASSERT_TRUE(golden != kGoldenHashes.end()) << key << " => 0x" << std::hex << reference.fHash;
+        ASSERT_EQ(golden->second, reference.fHash) << key << " => 0x" << std::hex << reference.fHash;
+
+        // kernel variants (bit exact)
+        ASSERT_EQ(reference.fHash, (runKernel<SampleType, PeakSilence>(signal, scenario, stereo).fHash)) << key;
+        auto full = runKernel<SampleType, Full>(signal, scenario, stereo);
+        ASSERT_EQ(reference.fHash, full.fHash) << key;
+
+        // metrics (reordered sums => tolerance)
+        ASSERT_EQ(reference.fClipCount, full.fClipCount) << key;
+        ASSERT_LE(ulpDistance(reference.fRMS, full.fRMS), kNumFrames) << key;
+        ASSERT_LE(std::abs(reference.fDCOffset - full.fDCOffset), reference.fDCOffsetTolerance) << key;
+        ASSERT_LE(std::abs(reference.fCorrelation - full.fCorrelation), reference.fCorrelationTolerance) << key;
+      }
+    }
+  }
+}
+
+}
+
+// GoldenTest - every kernel variant matches the reference (32 bits)
+TEST(GoldenTest, Sample32)
+{
+  checkCorpus<Sample32>();
+}
+
+// GoldenTest - every kernel variant matches the reference (64 bits)
+TEST(GoldenTest, Sample64)
+{
+  checkCorpus<Sample64>();
+}
+
+}
+}
+}
+}
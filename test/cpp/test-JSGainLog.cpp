@@ -0,0 +1,141 @@
+//------------------------------------------------------------------------------------------------------------
+// Tests for the RT logger (see Log/RTLogger.h)
+//------------------------------------------------------------------------------------------------------------
+#include <pongasoft/logging/logging.h>
+#include <gtest/gtest.h>
+
+#include "src/cpp/Log/RTLogger.h"
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pongasoft {
+namespace VST {
+namespace JSGain {
+namespace Test {
+
+using namespace Log;
+
+enum class ETestEnum { kZero, kOne, kTwo };
+
+// RTLoggerTest - the records are formatted with the arguments copied by the RT
+TEST(RTLoggerTest, Format)
+{
+  RTLogger logger{};
+  std::vector<std::string> messages{};
+  auto sink = [&messages](std::string const &, std::string const &iMessage) { messages.emplace_back(iMessage); };
+
+  char text[32] = "hello";
+  ASSERT_TRUE(logger.log("Received <%s> / timestamp = %lld", text, int64_t{123456789012}));
+  text[0] = 'j'; // the buffer is reused right after: the logger has its own copy
+  ASSERT_TRUE(logger.log("%d%% %5.2f|%-4d|%x", 50, 3.14159, 7, 255u));
+  ASSERT_TRUE(logger.log("enum=%d bool=%d float=%g", ETestEnum::kTwo, true, 0.5f));
+  ASSERT_TRUE(logger.log("int as float %.1f / double as int %d / missing %d", 2, 1.5));
+  ASSERT_TRUE(logger.log("no argument"));
+
+  ASSERT_EQ(5, logger.flush(sink));
+  ASSERT_EQ(5, messages.size());
+  ASSERT_EQ("Received <hello> / timestamp = 123456789012", messages[0]);
+  ASSERT_EQ("50%  3.14|7   |ff", messages[1]);
+  ASSERT_EQ("enum=2 bool=1 float=0.5", messages[2]);
+  ASSERT_EQ("int as float 2.0 / double as int 1.5 / missing <?>", messages[3]);
+  ASSERT_EQ("no argument", messages[4]);
+
+  // strings are truncated to fit in the record
+  std::string longText(200, 'x');
+  ASSERT_TRUE(logger.log("%s|%s", longText.c_str(), "lost"));
+  messages.clear();
+  ASSERT_EQ(1, logger.flush(sink));
+  ASSERT_EQ(std::string(kMaxTextSize - 1, 'x') + "|", messages[0]);
+
+  // nothing left
+  ASSERT_EQ(0, logger.flush(sink));
+}
+
+// RTLoggerTest - when the queue is full, the messages are dropped and the count is reported
+TEST(RTLoggerTest, Dropped)
+{
+  RTLogger logger{};
+  std::vector<std::string> messages{};
+  auto sink = [&messages](std::string const &, std::string const &iMessage) { messages.emplace_back(iMessage); };
+
+  for(size_t i = 0; i < kQueueCapacity; i++)
+    ASSERT_TRUE(logger.log("%d", i));
+  ASSERT_FALSE(logger.log("dropped"));
+  ASSERT_FALSE(logger.log("dropped"));
+  ASSERT_EQ(2, logger.getDroppedCount());
+
+  ASSERT_EQ(kQueueCapacity, logger.flush(sink));
+  ASSERT_EQ(kQueueCapacity + 1, messages.size());
+  ASSERT_EQ("0", messages[0]);
+  ASSERT_EQ("2 message(s) dropped (queue full)", messages.back());
+
+  // reported only once
+  messages.clear();
+  ASSERT_TRUE(logger.log("after"));
+  logger.flush(sink);
+  ASSERT_EQ(std::vector<std::string>{"after"}, messages);
+}
+
+// RTLoggerTest - the background thread writes the messages of all the started loggers
+TEST(RTLoggerTest, BackgroundThread)
+{
+  std::mutex mutex{};
+  std::vector<std::string> messages{};
+  RTLogger::setSink([&mutex, &messages](std::string const &iName, std::string const &iMessage) {
+    std::lock_guard<std::mutex> lock{mutex};
+    messages.emplace_back(iName + ":" + iMessage);
+  });
+
+  auto count = [&mutex, &messages]() {
+    std::lock_guard<std::mutex> lock{mutex};
+    return messages.size();
+  };
+
+  {
+    RTLogger logger1{};
+    RTLogger logger2{};
+    logger1.start("l1");
+    logger2.start("l2");
+    ASSERT_TRUE(logger1.isStarted());
+
+    // the producers are other threads (like the RT)
+    std::thread producer1{[&logger1] { for(int i = 0; i < 100; i++) logger1.log("%d", i); }};
+    std::thread producer2{[&logger2] { for(int i = 0; i < 100; i++) logger2.log("%d", i); }};
+    producer1.join();
+    producer2.join();
+
+    for(int i = 0; i < 500 && count() < 200; i++)
+      std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    ASSERT_EQ(200, count());
+
+    // stop writes what is left
+    logger1.log("last");
+    logger1.stop();
+    ASSERT_FALSE(logger1.isStarted());
+    ASSERT_EQ(201, count());
+  } // logger2 stopped by the destructor
+
+  RTLogger::setSink(nullptr);
+
+  // the messages of each logger are in order
+  int expected1 = 0, expected2 = 0;
+  for(auto const &message: messages)
+  {
+    if(message == "l1:last")
+      continue;
+    if(message.rfind("l1:", 0) == 0)
+      ASSERT_EQ("l1:" + std::to_string(expected1++), message);
+    else
+      ASSERT_EQ("l2:" + std::to_string(expected2++), message);
+  }
+  ASSERT_EQ(100, expected1);
+  ASSERT_EQ(100, expected2);
+}
+
+}
+}
+}
+}
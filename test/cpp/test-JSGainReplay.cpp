@@ -0,0 +1,341 @@
+//------------------------------------------------------------------------------------------------------------
+// Tests for the process trace and its replay (see Replay/ProcessTrace.h and Replay/ProcessReplayer.h)
+//------------------------------------------------------------------------------------------------------------
+#include <pongasoft/logging/logging.h>
+#include <gtest/gtest.h>
+
+#include "src/cpp/Concurrent/ByteRing.h"
+#include "src/cpp/Replay/ProcessTrace.h"
+#include "src/cpp/Replay/ProcessReplayer.h"
+#include "src/cpp/RT/JSGainProcessor.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+namespace pongasoft {
+namespace VST {
+namespace JSGain {
+namespace Test {
+
+using namespace Replay;
+
+namespace {
+
+//------------------------------------------------------------------------
+// ParamValueQueue / ParameterChanges - minimal implementations (the
+// points of the queues of one call)
+//------------------------------------------------------------------------
+class ParamValueQueue : public IParamValueQueue
+{
+public:
+  explicit ParamValueQueue(ParamID iParamID) : fParamID{iParamID} {}
+
+  ParamID PLUGIN_API getParameterId() override { return fParamID; }
+  int32 PLUGIN_API getPointCount() override { return static_cast<int32>(fPoints.size()); }
+
+  tresult PLUGIN_API getPoint(int32 index, int32 &sampleOffset, ParamValue &value) override
+  {
+    if(index < 0 || index >= getPointCount())
+      return kResultFalse;
+    sampleOffset = fPoints[index].first;
+    value = fPoints[index].second;
+    return kResultOk;
+  }
+
+  tresult PLUGIN_API addPoint(int32 sampleOffset, ParamValue value, int32 &index) override
+  {
+    index = getPointCount();
+    fPoints.emplace_back(sampleOffset, value);
+    return kResultOk;
+  }
+
+  tresult PLUGIN_API queryInterface(const TUID /* iid */, void **obj) override { *obj = nullptr; return kNoInterface; }
+  uint32 PLUGIN_API addRef() override { return 1; }
+  uint32 PLUGIN_API release() override { return 1; }
+
+private:
+  ParamID fParamID;
+  std::vector<std::pair<int32, ParamValue>> fPoints{};
+};
+
+class ParameterChanges : public IParameterChanges
+{
+public:
+  void clear() { fQueues.clear(); }
+
+  int32 PLUGIN_API getParameterCount() override { return static_cast<int32>(fQueues.size()); }
+
+  IParamValueQueue *PLUGIN_API getParameterData(int32 index) override
+  {
+    return index >= 0 && index < getParameterCount() ? &fQueues[index] : nullptr;
+  }
+
+  IParamValueQueue *PLUGIN_API addParameterData(const ParamID &id, int32 &index) override
+  {
+    for(index = 0; index < getParameterCount(); index++)
+    {
+      if(fQueues[index].getParameterId() == id)
+        return &fQueues[index];
+    }
+    fQueues.emplace_back(id);
+    return &fQueues.back();
+  }
+
+  void addPoint(ParamID iParamID, int32 iSampleOffset, ParamValue iValue)
+  {
+    int32 index;
+    addParameterData(iParamID, index)->addPoint(iSampleOffset, iValue, index);
+  }
+
+  tresult PLUGIN_API queryInterface(const TUID /* iid */, void **obj) override { *obj = nullptr; return kNoInterface; }
+  uint32 PLUGIN_API addRef() override { return 1; }
+  uint32 PLUGIN_API release() override { return 1; }
+
+private:
+  std::vector<ParamValueQueue> fQueues{};
+};
+
+// waitUntilFinished - the writer thread closes the file after endOfStream
+bool waitUntilFinished(ProcessTraceRecorder const &iRecorder)
+{
+  for(int i = 0; i < 500 && !iRecorder.isFinished(); i++)
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+  return iRecorder.isFinished();
+}
+
+}
+
+// ByteRingTest - records are written as a whole (or not at all) and read in order across the wrap around
+TEST(ByteRingTest, WriteRead)
+{
+  Concurrent::ByteRing<16> ring{};
+  std::vector<uint8_t> bytes{};
+  auto consumer = [&bytes](uint8_t const *iBytes, size_t iSize) { bytes.insert(bytes.end(), iBytes, iBytes + iSize); };
+
+  uint8_t record[12];
+  for(uint8_t i = 0; i < 12; i++)
+    record[i] = i;
+
+  ASSERT_TRUE(ring.write(record, 12));
+  ASSERT_FALSE(ring.write(record, 5)); // does not fit
+  ASSERT_TRUE(ring.write(record, 4));
+  ASSERT_FALSE(ring.write(record, 1)); // full
+
+  ASSERT_EQ(16, ring.read(consumer));
+  ASSERT_EQ(16, bytes.size());
+  ASSERT_EQ(11, bytes[11]);
+  ASSERT_EQ(3, bytes[15]);
+
+  // wraps around
+  bytes.clear();
+  ASSERT_TRUE(ring.write(record, 12));
+  ASSERT_EQ(12, ring.read(consumer));
+  ASSERT_EQ(std::vector<uint8_t>(record, record + 12), bytes);
+  ASSERT_EQ(0, ring.read(consumer));
+}
+
+// ProcessTraceTest - what is recorded is what is loaded (and a truncated trace is loaded up to the last record)
+TEST(ProcessTraceTest, RoundTrip)
+{
+  auto path = testing::TempDir() + "jsgain-process-trace-test.jsgt";
+
+  constexpr int32 kNumSamples = 64;
+  constexpr int kNumCalls = 10;
+
+  {
+    ProcessSetup setup{kRealtime, kSample64, kNumSamples, 48000};
+    auto recorder = ProcessTraceRecorder::create(path, setup, EAudioRecording::kSamples);
+    ASSERT_TRUE(recorder);
+
+    ParamPoint params[] = {{1, 0, 0.25}, {2, 0, 0.75}};
+    recorder->recordParameters(params, 2, true);
+
+    std::vector<Sample64> left(kNumSamples), right(kNumSamples), out(kNumSamples);
+    Sample64 *inputs[] = {left.data(), right.data()};
+    Sample64 *outputs[] = {out.data(), out.data()};
+    AudioBusBuffers inputBus{};
+    inputBus.numChannels = 2;
+    inputBus.channelBuffers64 = inputs;
+    AudioBusBuffers outputBus{};
+    outputBus.numChannels = 2;
+    outputBus.channelBuffers64 = outputs;
+    ParameterChanges changes{};
+
+    ProcessData data{};
+    data.processMode = kRealtime;
+    data.symbolicSampleSize = kSample64;
+    data.numInputs = 1;
+    data.numOutputs = 1;
+    data.inputs = &inputBus;
+    data.outputs = &outputBus;
+    data.inputParameterChanges = &changes;
+
+    for(int call = 0; call < kNumCalls; call++)
+    {
+      data.numSamples = kNumSamples - call;
+      for(int32 i = 0; i < data.numSamples; i++)
+      {
+        left[i] = call + i;
+        right[i] = -left[i];
+      }
+      inputBus.silenceFlags = call % 2;
+      changes.clear();
+      changes.addPoint(1, 0, call / 10.0);
+      changes.addPoint(1, 10, call / 20.0);
+      changes.addPoint(3, 5, 1.0);
+
+      recorder->beginProcess(data, 1000 * call);
+      std::copy(left.begin(), left.end(), out.begin());
+      outputBus.silenceFlags = 3;
+      recorder->endProcess(data, 100 + call);
+    }
+
+    recorder->endOfStream();
+    ASSERT_TRUE(waitUntilFinished(*recorder));
+    ASSERT_EQ(0, recorder->getDroppedRecordsCount());
+  }
+
+  auto trace = ProcessTrace::load(path);
+  ASSERT_TRUE(trace);
+  ASSERT_EQ(48000, trace->fHeader.fSampleRate);
+  ASSERT_EQ(kNumSamples, trace->fHeader.fMaxSamplesPerBlock);
+  ASSERT_EQ(kSample64, trace->fHeader.fSymbolicSampleSize);
+  ASSERT_EQ(EAudioRecording::kSamples, trace->fHeader.fAudio);
+  ASSERT_EQ(2, trace->fParameters.size());
+  ASSERT_EQ(0.75, trace->fParameters[1].fValue);
+  ASSERT_TRUE(trace->fModulationBusActive);
+  ASSERT_EQ(kNumCalls, trace->fCalls.size());
+
+  for(int call = 0; call < kNumCalls; call++)
+  {
+    auto const &c = trace->fCalls[call];
+    ASSERT_EQ(1000 * call, c.fRecord.fTimeNanos);
+    ASSERT_EQ(100 + call, c.fRecord.fDurationNanos);
+    ASSERT_EQ(kNumSamples - call, c.fRecord.fNumSamples);
+    ASSERT_EQ(3, c.fParamPoints.size());
+    ASSERT_EQ(1, c.fParamPoints[1].fParamID);
+    ASSERT_EQ(10, c.fParamPoints[1].fSampleOffset);
+    ASSERT_EQ(call / 20.0, c.fParamPoints[1].fValue);
+    ASSERT_EQ(3, c.fParamPoints[2].fParamID);
+    ASSERT_EQ(static_cast<uint64>(call % 2), c.fInputBuses[0].fSilenceFlags);
+    ASSERT_EQ(3, c.fOutputBuses[0].fSilenceFlags);
+
+    auto samples = reinterpret_cast<Sample64 const *>(c.fInputSamples.data());
+    ASSERT_EQ(2 * c.fRecord.fNumSamples * sizeof(Sample64), c.fInputSamples.size());
+    ASSERT_EQ(call + 5, samples[5]);
+    ASSERT_EQ(-call - 5, samples[c.fRecord.fNumSamples + 5]);
+    ASSERT_EQ(2, c.fOutputHashes.size());
+    ASSERT_EQ(hashSamples(samples, c.fRecord.fNumSamples), c.fOutputHashes[0]);
+  }
+
+  // truncated (ex: the host crashed while recording)
+  {
+    std::ifstream file{path, std::ios::binary};
+    std::vector<char> bytes{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    file.close();
+    std::ofstream truncated{path, std::ios::binary | std::ios::trunc};
+    truncated.write(bytes.data(), static_cast<std::streamsize>(bytes.size() - 10));
+  }
+  trace = ProcessTrace::load(path);
+  ASSERT_TRUE(trace);
+  ASSERT_EQ(kNumCalls - 1, trace->fCalls.size());
+
+  std::remove(path.c_str());
+}
+
+// ProcessReplayTest - replaying a trace recorded with the samples reproduces the exact same output
+TEST(ProcessReplayTest, RecordReplay)
+{
+  auto path = testing::TempDir() + "jsgain-process-replay-test.jsgt";
+
+  constexpr int32 kMaxSamples = 256;
+  constexpr int kNumCalls = 50;
+
+  {
+    RT::JSGainProcessor processor{};
+    ASSERT_EQ(kResultOk, processor.initialize(nullptr));
+    ProcessSetup setup{kRealtime, kSample32, kMaxSamples, 44100};
+    ASSERT_EQ(kResultOk, processor.setupProcessing(setup));
+    ASSERT_EQ(kResultOk, processor.setActive(true));
+
+    auto recorder = ProcessTraceRecorder::create(path, setup, EAudioRecording::kSamples);
+    ASSERT_TRUE(recorder);
+    recorder->recordParameters(nullptr, 0, false);
+
+    std::vector<Sample32> leftIn(kMaxSamples), rightIn(kMaxSamples), leftOut(kMaxSamples), rightOut(kMaxSamples);
+    Sample32 *inputs[] = {leftIn.data(), rightIn.data()};
+    Sample32 *outputs[] = {leftOut.data(), rightOut.data()};
+    AudioBusBuffers inputBus{};
+    inputBus.numChannels = 2;
+    inputBus.channelBuffers32 = inputs;
+    AudioBusBuffers outputBus{};
+    outputBus.numChannels = 2;
+    outputBus.channelBuffers32 = outputs;
+    ParameterChanges changes{};
+    ParameterChanges outputChanges{};
+
+    ProcessData data{};
+    data.processMode = kRealtime;
+    data.symbolicSampleSize = kSample32;
+    data.numInputs = 1;
+    data.numOutputs = 1;
+    data.inputs = &inputBus;
+    data.outputs = &outputBus;
+    data.inputParameterChanges = &changes;
+    data.outputParameterChanges = &outputChanges;
+
+    for(int call = 0; call < kNumCalls; call++)
+    {
+      // variable block size and gain automation (the host does not always send full blocks)
+      data.numSamples = call % 3 == 0 ? kMaxSamples : 37 + call;
+      for(int32 i = 0; i < data.numSamples; i++)
+      {
+        leftIn[i] = static_cast<Sample32>(std::sin((call * kMaxSamples + i) * 0.01));
+        rightIn[i] = -leftIn[i] / 2;
+      }
+      changes.clear();
+      outputChanges.clear();
+      if(call % 5 == 0)
+        changes.addPoint(EJSGainParamID::kLeftGain, 0, (call % 10) / 10.0);
+
+      recorder->beginProcess(data, call);
+      processor.process(data);
+      recorder->endProcess(data, 0);
+    }
+
+    recorder->endOfStream();
+    ASSERT_TRUE(waitUntilFinished(*recorder));
+
+    processor.setActive(false);
+    processor.terminate();
+  }
+
+  auto trace = ProcessTrace::load(path);
+  ASSERT_TRUE(trace);
+  ASSERT_EQ(kNumCalls, trace->fCalls.size());
+
+  auto result = replay(*trace, 2);
+  ASSERT_TRUE(result);
+  ASSERT_EQ(kNumCalls, result->fDurationsNanos.size());
+  ASSERT_EQ(kNumCalls, result->fNumVerifiedCalls);
+  ASSERT_EQ(0, result->fNumMismatchedCalls);
+
+  // a different input is detected
+  trace->fCalls[7].fInputSamples[3] ^= 0x80; // sign of the first sample
+  result = replay(*trace);
+  ASSERT_TRUE(result);
+  ASSERT_EQ(1, result->fNumMismatchedCalls);
+  ASSERT_EQ(7, result->fFirstMismatchedCall);
+
+  std::remove(path.c_str());
+}
+
+}
+}
+}
+}
@@ -0,0 +1,65 @@
+//------------------------------------------------------------------------------------------------------------
+// Tests for the shared memory telemetry (only compiled when JSGAIN_ENABLE_TELEMETRY is ON)
+//------------------------------------------------------------------------------------------------------------
+#include <pongasoft/logging/logging.h>
+#include <gtest/gtest.h>
+
+#include "src/cpp/Telemetry/Telemetry.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace pongasoft {
+namespace VST {
+namespace JSGain {
+namespace Test {
+
+using namespace Telemetry;
+
+// TelemetryTest - writer/reader round trip
+TEST(TelemetryTest, WriterReader)
+{
+  // use a segment private to this test
+  auto segmentName = std::string{"/jsgain-telemetry-test-"} + std::to_string(getpid());
+
+  TelemetryWriter writer1{};
+  TelemetryWriter writer2{};
+  ASSERT_TRUE(writer1.open(segmentName));
+  ASSERT_TRUE(writer2.open(segmentName));
+  ASSERT_NE(writer1.getInstanceID(), writer2.getInstanceID());
+
+  writer1.update([](Record &oRecord) {
+    oRecord.fFrameCount = 10;
+    oRecord.fPeak = 0.5;
+    oRecord.fBypass = 1;
+  });
+  writer2.update([](Record &oRecord) { oRecord.fFrameCount = 20; });
+
+  TelemetryReader reader{};
+  ASSERT_TRUE(reader.open(segmentName));
+
+  int64_t totalFrames = 0;
+  auto count = reader.forEachInstance([&totalFrames](uint32_t iSlot, int32_t iPID, Record const &iRecord) {
+    ASSERT_EQ(getpid(), iPID);
+    totalFrames += iRecord.fFrameCount;
+  });
+  ASSERT_EQ(2, count);
+  ASSERT_EQ(30, totalFrames);
+
+  // releasing the slot => no longer visible
+  writer2.close();
+  ASSERT_EQ(1, reader.forEachInstance([](uint32_t, int32_t, Record const &iRecord) {
+    ASSERT_EQ(10, iRecord.fFrameCount);
+    ASSERT_EQ(0.5, iRecord.fPeak);
+    ASSERT_EQ(1, iRecord.fBypass);
+  }));
+
+  writer1.close();
+  reader.close();
+  shm_unlink(segmentName.c_str());
+}
+
+}
+}
+}
+}
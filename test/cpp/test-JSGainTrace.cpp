@@ -0,0 +1,88 @@
+//------------------------------------------------------------------------------------------------------------
+// Tests for the trace zones (only compiled when JSGAIN_ENABLE_TRACE is ON)
+//------------------------------------------------------------------------------------------------------------
+#include <pongasoft/logging/logging.h>
+#include <gtest/gtest.h>
+
+#include "src/cpp/Trace/Trace.h"
+
+#include <sstream>
+#include <string>
+#include <thread>
+
+namespace pongasoft {
+namespace VST {
+namespace JSGain {
+namespace Test {
+
+namespace {
+
+// number of (non overlapping) occurrences of iPattern in iText
+int count(std::string const &iText, std::string const &iPattern)
+{
+  int res = 0;
+  for(auto pos = iText.find(iPattern); pos != std::string::npos; pos = iText.find(iPattern, pos + iPattern.size()))
+    res++;
+  return res;
+}
+
+}
+
+// TraceTest - zones, counters and frame marks of several threads end up in the Chrome trace
+TEST(TraceTest, ChromeTrace)
+{
+  std::thread rt{[]() {
+    JSGAIN_TRACE_THREAD("test.rt");
+    for(int i = 0; i < 3; i++)
+    {
+      JSGAIN_TRACE_FRAME("test.frame");
+      JSGAIN_TRACE_ZONE("test.process");
+      JSGAIN_TRACE_COUNTER("test.counter", 42 + i);
+    }
+  }};
+  rt.join();
+
+  {
+    JSGAIN_TRACE_THREAD("test.gui");
+    JSGAIN_TRACE_ZONE("test.draw");
+  }
+
+  std::ostringstream s;
+  Trace::dumpChromeTrace(s);
+  auto trace = s.str();
+
+  ASSERT_EQ(0u, trace.find("{\"displayTimeUnit\":\"ns\",\"traceEvents\":["));
+  ASSERT_EQ("]}\n", trace.substr(trace.size() - 3));
+
+  ASSERT_EQ(1, count(trace, "\"args\":{\"name\":\"test.rt\"}"));
+  ASSERT_EQ(1, count(trace, "\"args\":{\"name\":\"test.gui\"}"));
+  ASSERT_EQ(3, count(trace, "{\"name\":\"test.frame\""));
+  ASSERT_EQ(3, count(trace, "{\"name\":\"test.process\""));
+  ASSERT_EQ(1, count(trace, "{\"name\":\"test.draw\""));
+  ASSERT_EQ(1, count(trace, "\"ph\":\"C\",\"args\":{\"value\":43}"));
+  ASSERT_EQ(0u, Trace::getDroppedEventsCount());
+}
+
+// TraceTest - a thread keeps its last kEventsPerThread events (the oldest one is not dumped since the thread
+// could be overwriting it)
+TEST(TraceTest, RingKeepsLatestEvents)
+{
+  std::thread writer{[]() {
+    JSGAIN_TRACE_THREAD("test.ring");
+    for(uint32_t i = 0; i < Trace::kEventsPerThread + 10; i++)
+      JSGAIN_TRACE_COUNTER(i < 10 ? "test.old" : "test.new", i);
+  }};
+  writer.join();
+
+  std::ostringstream s;
+  Trace::dumpChromeTrace(s);
+  auto trace = s.str();
+
+  ASSERT_EQ(0, count(trace, "{\"name\":\"test.old\""));
+  ASSERT_EQ(static_cast<int>(Trace::kEventsPerThread) - 1, count(trace, "{\"name\":\"test.new\""));
+}
+
+}
+}
+}
+}
@@ -0,0 +1,124 @@
+//------------------------------------------------------------------------------------------------------------
+// Small command line tool which replays a process trace recorded with the "$record" command (see
+// src/cpp/Replay/ProcessTrace.h) on a new processor, outside of any host, and compares the duration of the
+// recorded calls with the replayed ones. When the trace contains the samples ("$record samples") the output is
+// also checked (bit exact). It is built only when the CMake option JSGAIN_ENABLE_REPLAY_TOOL is ON.
+//
+// Usage: jsgain-replay <trace file> [repetitions (default 1)]
+//------------------------------------------------------------------------------------------------------------
+#include "src/cpp/Replay/ProcessReplayer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+#include <vector>
+
+using namespace pongasoft::VST::JSGain::Replay;
+
+//------------------------------------------------------------------------
+// Summary
+//------------------------------------------------------------------------
+struct Summary
+{
+  double fMean{};
+  int64 fP50{};
+  int64 fP99{};
+  int64 fMax{};
+
+  static Summary from(std::vector<int64> iDurations)
+  {
+    Summary summary{};
+    if(iDurations.empty())
+      return summary;
+    std::sort(iDurations.begin(), iDurations.end());
+    summary.fMean = std::accumulate(iDurations.begin(), iDurations.end(), 0.0) / iDurations.size();
+    summary.fP50 = iDurations[iDurations.size() / 2];
+    summary.fP99 = iDurations[std::min(iDurations.size() - 1, iDurations.size() * 99 / 100)];
+    summary.fMax = iDurations.back();
+    return summary;
+  }
+
+  void print(char const *iName) const
+  {
+    printf("%-9s mean %9.0fns | p50 %9lldns | p99 %9lldns | max %9lldns\n",
+           iName, fMean, static_cast<long long>(fP50), static_cast<long long>(fP99), static_cast<long long>(fMax));
+  }
+};
+
+//------------------------------------------------------------------------
+// main
+//------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+  if(argc < 2)
+  {
+    fprintf(stderr, "Usage: %s <trace file> [repetitions]\n", argv[0]);
+    return 1;
+  }
+
+  int repetitions = argc > 2 ? std::max(std::atoi(argv[2]), 1) : 1;
+
+  auto trace = ProcessTrace::load(argv[1]);
+  if(!trace)
+  {
+    fprintf(stderr, "Cannot read trace %s\n", argv[1]);
+    return 1;
+  }
+
+  auto const &header = trace->fHeader;
+  printf("%s: %zu calls | %.0fHz | max %d samples | %d bits | audio %s\n",
+         argv[1],
+         trace->fCalls.size(),
+         header.fSampleRate,
+         header.fMaxSamplesPerBlock,
+         header.fSymbolicSampleSize == kSample64 ? 64 : 32,
+         header.fAudio == EAudioRecording::kSamples ? "samples" : header.fAudio == EAudioRecording::kHashes ? "hashes" : "none");
+
+  auto result = replay(*trace, repetitions);
+  if(!result)
+  {
+    fprintf(stderr, "Cannot replay trace %s\n", argv[1]);
+    return 1;
+  }
+
+  std::vector<int64> recorded{};
+  recorded.reserve(trace->fCalls.size());
+  for(auto const &call: trace->fCalls)
+    recorded.emplace_back(call.fRecord.fDurationNanos);
+
+  Summary::from(recorded).print("recorded");
+  Summary::from(result->fDurationsNanos).print("replayed");
+
+  // the slowest recorded calls (what the replay is usually for)
+  std::vector<size_t> calls(trace->fCalls.size());
+  std::iota(calls.begin(), calls.end(), 0);
+  auto numSlowest = std::min<size_t>(10, calls.size());
+  std::partial_sort(calls.begin(), calls.begin() + numSlowest, calls.end(), [&recorded](size_t a, size_t b) {
+    return recorded[a] > recorded[b];
+  });
+
+  printf("slowest recorded calls:\n");
+  for(size_t i = 0; i < numSlowest; i++)
+  {
+    auto const &record = trace->fCalls[calls[i]].fRecord;
+    printf("  #%-8zu %5d samples | %3u param points | recorded %9lldns | replayed %9lldns\n",
+           calls[i],
+           record.fNumSamples,
+           record.fNumParamPoints,
+           static_cast<long long>(record.fDurationNanos),
+           static_cast<long long>(result->fDurationsNanos[calls[i]]));
+  }
+
+  if(result->fNumVerifiedCalls > 0)
+  {
+    printf("output: %lld/%lld calls identical",
+           static_cast<long long>(result->fNumVerifiedCalls - result->fNumMismatchedCalls),
+           static_cast<long long>(result->fNumVerifiedCalls));
+    if(result->fNumMismatchedCalls > 0)
+      printf(" (first difference: #%lld)", static_cast<long long>(result->fFirstMismatchedCall));
+    printf("\n");
+  }
+
+  return result->fNumMismatchedCalls > 0 ? 2 : 0;
+}
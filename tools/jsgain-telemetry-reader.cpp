@@ -0,0 +1,65 @@
+//------------------------------------------------------------------------------------------------------------
+// Small command line tool which reads the telemetry published by every running instance of the plugin (see
+// src/cpp/Telemetry/Telemetry.h) and prints it. It is built only when the CMake option
+// JSGAIN_ENABLE_TELEMETRY is ON.
+//
+// Usage: jsgain-telemetry-reader [segment name (default /jsgain-telemetry)] [count (default 1)] [interval ms]
+//------------------------------------------------------------------------------------------------------------
+#include "src/cpp/Telemetry/Telemetry.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+using namespace pongasoft::VST::JSGain::Telemetry;
+
+//------------------------------------------------------------------------
+// toDb
+//------------------------------------------------------------------------
+static double toDb(double iSample)
+{
+  return iSample > 0 ? 20.0 * std::log10(iSample) : -INFINITY;
+}
+
+//------------------------------------------------------------------------
+// main
+//------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+  std::string segmentName = argc > 1 ? argv[1] : kDefaultSegmentName;
+  int count = argc > 2 ? std::atoi(argv[2]) : 1;
+  int intervalMs = argc > 3 ? std::atoi(argv[3]) : 1000;
+
+  TelemetryReader reader{};
+  if(!reader.open(segmentName))
+  {
+    fprintf(stderr, "Cannot open telemetry segment %s\n", segmentName.c_str());
+    return 1;
+  }
+
+  for(int i = 0; i < count; i++)
+  {
+    if(i > 0)
+      std::this_thread::sleep_for(std::chrono::milliseconds(intervalMs));
+
+    printf("| SLOT | PID     | INSTANCE           | FRAMES     | PEAK dB | MAX dB  | BLOCK us | MAX us   | SIL | BYP |\n");
+    auto instances = reader.forEachInstance([](uint32_t iSlot, int32_t iPID, Record const &iRecord) {
+      printf("| %4u | %7d | %018llx | %10lld | %7.2f | %7.2f | %8.1f | %8.1f | %3d | %3d |\n",
+             iSlot,
+             iPID,
+             static_cast<unsigned long long>(iRecord.fInstanceID),
+             static_cast<long long>(iRecord.fFrameCount),
+             toDb(iRecord.fPeak),
+             toDb(iRecord.fMaxSinceReset),
+             iRecord.fLastBlockDurationNanos / 1000.0,
+             iRecord.fMaxBlockDurationNanos / 1000.0,
+             iRecord.fSilent,
+             iRecord.fBypass);
+    });
+    printf("%d instance(s)\n", instances);
+  }
+
+  return 0;
+}